@@ -0,0 +1,125 @@
+#ifndef FILTER_KERNEL_CL
+#define FILTER_KERNEL_CL
+
+#include "scan_global_chain_kernel.cl"
+
+#ifdef KVS_AOS
+    typedef int2 Tuple;  /*for AOS*/
+#endif
+
+/*
+ * Compilation parameters:
+ *   predicate:   one of PRED_EQ, PRED_NE, PRED_LT, PRED_LE, PRED_GT, PRED_GE (key against low),
+ *                PRED_RANGE (low <= key < high) or PRED_BITMAP (bit key of the bitmap is set)
+ *   ELE_PER_WI:  consecutive tuples evaluated by a work-item in a tile (at most 32)
+ *   KVS_AOS/KVS_SOA: data structure, key-only if neither is set
+ * */
+#ifndef ELE_PER_WI
+#define ELE_PER_WI          (8)
+#endif
+
+inline bool predicate(int key, int low, int high, global const unsigned *bitmap, int bitmap_bits) {
+#if defined(PRED_EQ)
+    return key == low;
+#elif defined(PRED_NE)
+    return key != low;
+#elif defined(PRED_LT)
+    return key < low;
+#elif defined(PRED_LE)
+    return key <= low;
+#elif defined(PRED_GT)
+    return key > low;
+#elif defined(PRED_GE)
+    return key >= low;
+#elif defined(PRED_RANGE)
+    return (key >= low) && (key < high);
+#elif defined(PRED_BITMAP)
+    return (key >= 0) && (key < bitmap_bits) && ((bitmap[key >> 5] >> (key & 31)) & 1);
+#else
+    return true;
+#endif
+}
+
+/*
+ *  Fused filter: predicate evaluation, scan and scatter in a single pass
+ *  Tiles of local_size*ELE_PER_WI tuples are taken in order by the WGs
+ *  through dynamic tile IDs (next_tile), each WI evaluating ELE_PER_WI
+ *  consecutive tuples.
+ *  The match counts of the WIs are scanned in the local memory and the output
+ *  offset of the tile comes from the decoupled look-back of the chained scan
+ *  (look_back) over the tile status in inter, so the flags never leave the
+ *  registers. The output is stable. Afterwards, the inclusive prefix of the
+ *  last tile, inter[SCAN_STATUS_INTS*(num_tiles-1)+2], is the number of matches.
+ * */
+kernel void filter(
+#ifdef KVS_AOS
+        global const Tuple *d_in,
+        global Tuple *d_out,
+#else
+        global const int *d_in_keys,
+        global int *d_out_keys,
+#endif
+#ifdef KVS_SOA
+        global const int *d_in_values,
+        global int *d_out_values,
+#endif
+        int length,
+        int num_tiles,
+        int low,
+        int high,
+        global const unsigned *bitmap,
+        int bitmap_bits,
+        local int *lo,                  /*local_size*sizeof(int)*/
+        global int *inter)              /*tile status, see look_back*/
+{
+    int localId = get_local_id(0);
+    int localSize = get_local_size(0);
+    local int gs, gss, tile_id;
+
+    /*dynamic work-group execution*/
+    for(int w = next_tile(localId, inter, num_tiles, &tile_id); w < num_tiles;
+        w = next_tile(localId, inter, num_tiles, &tile_id)) {
+        int begin = (w * localSize + localId) * ELE_PER_WI;
+        int end = min(begin + ELE_PER_WI, length);
+
+        /*1.evaluation, the flags are kept as a bit mask*/
+        unsigned matches = 0;
+        int count = 0;
+        for(int i = begin; i < end; i++) {
+#ifdef KVS_AOS
+            int key = d_in[i].x;
+#else
+            int key = d_in_keys[i];
+#endif
+            if (predicate(key, low, high, bitmap, bitmap_bits)) {
+                matches |= (1u << (i - begin));
+                count++;
+            }
+        }
+        lo[localId] = count;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /*2.scan in the tile and across the tiles*/
+        local_serial_scan(lo, localSize, &gs);
+        look_back(w, localId, localSize, inter, &gs, &gss);
+
+        /*3.scatter, the tuples are still in the cache*/
+        int pos = gss + lo[localId];
+        for(int i = begin; i < end; i++) {
+            if (matches & (1u << (i - begin))) {
+#ifdef KVS_AOS
+                d_out[pos] = d_in[i];
+#else
+                d_out_keys[pos] = d_in_keys[i];
+#endif
+#ifdef KVS_SOA
+                d_out_values[pos] = d_in_values[i];
+#endif
+                pos++;
+            }
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);   /*lo is reused by the next tile*/
+    }
+}
+
+#endif
@@ -20,4 +20,77 @@ kernel void gather(global const int *d_in, global int* d_out, global const int*
     }
 }
 
+/*
+ * Multi-column gather: each index of loc is loaded once and drives all the
+ * columns of the launch. Column c is passed if COL_TYPE_c (int or int2) is
+ * defined, up to COLUMNS_PER_LAUNCH columns.
+ * */
+#define COLUMN_ARGS(c, T)   , global const T *in##c, global T *out##c
+
+kernel void gather_columns(
+        global const int* loc,
+        const int length, const int ele_per_thread,
+        const int from, const int to
+#ifdef COL_TYPE_0
+        COLUMN_ARGS(0, COL_TYPE_0)
+#endif
+#ifdef COL_TYPE_1
+        COLUMN_ARGS(1, COL_TYPE_1)
+#endif
+#ifdef COL_TYPE_2
+        COLUMN_ARGS(2, COL_TYPE_2)
+#endif
+#ifdef COL_TYPE_3
+        COLUMN_ARGS(3, COL_TYPE_3)
+#endif
+#ifdef COL_TYPE_4
+        COLUMN_ARGS(4, COL_TYPE_4)
+#endif
+#ifdef COL_TYPE_5
+        COLUMN_ARGS(5, COL_TYPE_5)
+#endif
+#ifdef COL_TYPE_6
+        COLUMN_ARGS(6, COL_TYPE_6)
+#endif
+#ifdef COL_TYPE_7
+        COLUMN_ARGS(7, COL_TYPE_7)
+#endif
+        ) {
+    int globalId = get_global_id(0);
+    int warpId = globalId >> WARP_BITS;
+
+    int begin = warpId * WARP_SIZE * ele_per_thread + (globalId & (WARP_SIZE-1));
+    int end = ((warpId + 1) * WARP_SIZE * ele_per_thread < length)? ((warpId + 1) * WARP_SIZE * ele_per_thread) : length;
+
+    for(int i = begin; i < end; i += WARP_SIZE) {
+        int pos = loc[i];
+        if (pos >= from && pos < to) {
+#ifdef COL_TYPE_0
+            out0[i] = in0[pos];
+#endif
+#ifdef COL_TYPE_1
+            out1[i] = in1[pos];
+#endif
+#ifdef COL_TYPE_2
+            out2[i] = in2[pos];
+#endif
+#ifdef COL_TYPE_3
+            out3[i] = in3[pos];
+#endif
+#ifdef COL_TYPE_4
+            out4[i] = in4[pos];
+#endif
+#ifdef COL_TYPE_5
+            out5[i] = in5[pos];
+#endif
+#ifdef COL_TYPE_6
+            out6[i] = in6[pos];
+#endif
+#ifdef COL_TYPE_7
+            out7[i] = in7[pos];
+#endif
+        }
+    }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+#ifndef HISTOGRAM_KERNEL_CL
+#define HISTOGRAM_KERNEL_CL
+
+/*
+ * Compilation parameters:
+ *   bucket function:  BUCKET_RADIX ((key >> shift) & (buckets-1), buckets is a power of 2),
+ *                     BUCKET_MOD (key mod buckets) or BUCKET_HASH (multiplicative hash)
+ *   LOCAL_HIS:        the shared histogram fits in the local memory (histogram_shared)
+ * The output histogram his[buckets] should be zero-initialized, every WG adds to it.
+ * */
+inline int bucket_of(int key, int buckets, int shift) {
+#if defined(BUCKET_MOD)
+    return (int)((unsigned)key % (unsigned)buckets);
+#elif defined(BUCKET_HASH)
+    return (int)mul_hi((unsigned)key * 0x9E3779B1u, (unsigned)buckets);
+#else
+    return (int)(((unsigned)key >> shift) & (buckets - 1));
+#endif
+}
+
+/*
+ * Private: each WI counts into its own column of the local memory
+ * (local_buckets[b*local_size+local_id]), no atomics on the updates.
+ * Skew does not matter, but buckets*local_size counters should fit.
+ * */
+kernel void histogram_private(
+        global const int *d_in,
+        int length,
+        global int *his,
+        int buckets,
+        int shift,
+        local int *local_buckets)       /*buckets*local_size*sizeof(int)*/
+{
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+
+    for(int i = local_id; i < buckets * local_size; i += local_size)
+        local_buckets[i] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int i = get_global_id(0); i < length; i += get_global_size(0)) {
+        local_buckets[bucket_of(d_in[i], buckets, shift) * local_size + local_id]++;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /*reduce the columns of a bucket, one bucket per WI*/
+    for(int b = local_id; b < buckets; b += local_size) {
+        int acc = 0;
+        for(int w = 0; w < local_size; w++) acc += local_buckets[b * local_size + ((w + b) & (local_size - 1))];
+        if (acc) atomic_add(his + b, acc);
+    }
+}
+
+/*
+ * Shared: one histogram per WG updated with local atomics, or the global
+ * histogram directly if it does not fit in the local memory (no LOCAL_HIS).
+ * Cheapest on uniform keys, updates to a heavy bucket are serialized.
+ * */
+kernel void histogram_shared(
+        global const int *d_in,
+        int length,
+        global int *his,
+        int buckets,
+        int shift,
+        local int *local_buckets)       /*buckets*sizeof(int) with LOCAL_HIS*/
+{
+#ifdef LOCAL_HIS
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+
+    for(int b = local_id; b < buckets; b += local_size) local_buckets[b] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int i = get_global_id(0); i < length; i += get_global_size(0))
+        atomic_inc(local_buckets + bucket_of(d_in[i], buckets, shift));
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int b = local_id; b < buckets; b += local_size) {
+        if (local_buckets[b]) atomic_add(his + b, local_buckets[b]);
+    }
+#else
+    for(int i = get_global_id(0); i < length; i += get_global_size(0))
+        atomic_inc(his + bucket_of(d_in[i], buckets, shift));
+#endif
+}
+
+/*
+ * Sort-based: the bucket IDs of a tile of local_size keys are sorted in the
+ * local memory (bitonic, local_size is a power of 2) and every run of equal
+ * IDs costs at most two atomics: its tail adds (tail+1) and its head subtracts
+ * head. A heavy bucket thus costs two atomics per tile instead of one per key.
+ * */
+kernel void histogram_sort(
+        global const int *d_in,
+        int length,
+        global int *his,
+        int buckets,
+        int shift,
+        local int *ids)                 /*local_size*sizeof(int)*/
+{
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+    const int num_tiles = (length + local_size - 1) / local_size;
+
+    for(int tile = get_group_id(0); tile < num_tiles; tile += get_num_groups(0)) {
+        int i = tile * local_size + local_id;
+        ids[local_id] = (i < length) ? bucket_of(d_in[i], buckets, shift) : INT_MAX;   /*padding sorted to the end*/
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for(int size = 2; size <= local_size; size <<= 1) {
+            for(int stride = size >> 1; stride > 0; stride >>= 1) {
+                int partner = local_id ^ stride;
+                if (partner > local_id) {
+                    int a = ids[local_id], b = ids[partner];
+                    bool ascending = ((local_id & size) == 0);
+                    if ((a > b) == ascending) {
+                        ids[local_id] = b;
+                        ids[partner] = a;
+                    }
+                }
+                barrier(CLK_LOCAL_MEM_FENCE);
+            }
+        }
+
+        int id = ids[local_id];
+        if (id != INT_MAX) {
+            bool head = (local_id == 0) || (ids[local_id - 1] != id);
+            bool tail = (local_id == local_size - 1) || (ids[local_id + 1] != id);
+            int delta = (tail ? local_id + 1 : 0) - (head ? local_id : 0);
+            if (delta) atomic_add(his + id, delta);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef JOIN_KERNEL_CL
+#define JOIN_KERNEL_CL
+
+#include "../params.h"
+
+/*
+ * Partitioned hash join kernels, one work-group per partition
+ * Compilation parameters:
+ *   TABLE_SIZE:  number of slots of the local hash table (power of 2, at most 65536)
+ *   RADIX_BITS:  total number of radix bits used in partitioning, the hash
+ *                function uses the key bits above them
+ * */
+#ifndef TABLE_SIZE
+#define TABLE_SIZE          (2048)
+#endif
+#ifndef RADIX_BITS
+#define RADIX_BITS          (0)
+#endif
+
+#define TABLE_MASK          (TABLE_SIZE-1)
+#define CHUNK_SIZE          (TABLE_SIZE/2)          /*max load factor 0.5*/
+/*multiplicative hashing, dense keys would otherwise fill the table as a single cluster*/
+#define JOIN_HASH(key)      ((((((unsigned)(key)) >> RADIX_BITS) * 0x9E3779B1u) >> 16) & TABLE_MASK)
+
+/*
+ *  Build a local hash table on each chunk of the R partition and probe it with
+ *  the whole S partition. Chunks only occur if the R partition is larger than
+ *  CHUNK_SIZE (skewed data), otherwise the partition is built once.
+ *
+ *  COUNT_ONLY: d_counts[group] = number of matches of the partition pair
+ *  otherwise:  matches are written from d_offsets[group] on as (R value, S value)
+ * */
+kernel void build_probe(
+        global const int *d_R_keys,
+        global const int *d_R_values,
+        int r_len,
+        global const int *d_S_keys,
+        global const int *d_S_values,
+        int s_len,
+        global const int *d_R_start,
+        global const int *d_S_start,
+#ifdef COUNT_ONLY
+        global int *d_counts)
+#else
+        global const int *d_offsets,
+        global int *d_out_R,
+        global int *d_out_S)
+#endif
+{
+    local int table_keys[TABLE_SIZE];
+    local int table_values[TABLE_SIZE];
+    local int local_counter;
+
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    int group_id = get_group_id(0);
+    int num_groups = get_num_groups(0);
+
+    int r_begin = d_R_start[group_id];
+    int s_begin = d_S_start[group_id];
+    int r_end = (group_id == num_groups - 1) ? r_len : d_R_start[group_id+1];
+    int s_end = (group_id == num_groups - 1) ? s_len : d_S_start[group_id+1];
+
+    if (local_id == 0) local_counter = 0;
+#ifndef COUNT_ONLY
+    int out_base = d_offsets[group_id];
+#endif
+    int my_count = 0;
+
+    for(int chunk_begin = r_begin; chunk_begin < r_end; chunk_begin += CHUNK_SIZE) {
+        int chunk_end = min(chunk_begin + CHUNK_SIZE, r_end);
+
+        /*1.clear the table*/
+        for(int i = local_id; i < TABLE_SIZE; i += local_size)
+            table_keys[i] = JOIN_EMPTY_KEY;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /*2.build with linear probing*/
+        for(int i = chunk_begin + local_id; i < chunk_end; i += local_size) {
+            int key = d_R_keys[i];
+            unsigned slot = JOIN_HASH(key);
+            while (atomic_cmpxchg(table_keys+slot, JOIN_EMPTY_KEY, key) != JOIN_EMPTY_KEY)
+                slot = (slot + 1) & TABLE_MASK;
+            table_values[slot] = d_R_values[i];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /*3.probe*/
+        for(int i = s_begin + local_id; i < s_end; i += local_size) {
+            int key = d_S_keys[i];
+            unsigned slot = JOIN_HASH(key);
+            int cur_key = table_keys[slot];
+            while (cur_key != JOIN_EMPTY_KEY) {
+                if (cur_key == key) {
+#ifdef COUNT_ONLY
+                    my_count++;
+#else
+                    int pos = out_base + atomic_inc(&local_counter);
+                    d_out_R[pos] = table_values[slot];
+                    d_out_S[pos] = d_S_values[i];
+#endif
+                }
+                slot = (slot + 1) & TABLE_MASK;
+                cur_key = table_keys[slot];
+            }
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);   /*the table is reused by the next chunk*/
+    }
+
+#ifdef COUNT_ONLY
+    if (my_count > 0) atomic_add(&local_counter, my_count);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (local_id == 0) d_counts[group_id] = local_counter;
+#endif
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PACK_KERNEL_CL
+#define PACK_KERNEL_CL
+
+#include "../params.h"
+
+/*
+ * Bit-packed int columns (PACK_LANES, PACK_BLOCK in params.h): value i is
+ * value k = (i % PACK_BLOCK) / PACK_LANES of lane l = i % PACK_LANES in block
+ * i / PACK_BLOCK, at bits [k*bits, (k+1)*bits) of the lane. A value spans at
+ * most two words, and consecutive values are in consecutive words, so the
+ * WIs of a warp read contiguous words. Values are the low bits of the ints,
+ * unpacked without sign extension.
+ * */
+#define PACK_MASK(bits)     (((bits) == 32) ? 0xffffffffu : ((1u << (bits)) - 1))
+
+/*value i of a column packed with bits bits*/
+inline int unpack_at(global const uint *words, int i, int bits) {
+    int r = i % PACK_BLOCK;
+    int bit = (r / PACK_LANES) * bits;
+    int w = bit >> 5, s = bit & 31;
+    global const uint *lane = words + (i / PACK_BLOCK) * bits * PACK_LANES + (r % PACK_LANES);
+
+    uint v = lane[w*PACK_LANES] >> s;
+    if (s + bits > 32) v |= lane[(w+1)*PACK_LANES] << (32 - s);
+    return (int)(v & PACK_MASK(bits));
+}
+
+/*
+ * res = packed word g of the values VALUE_AT(i), i < length (0 beyond), i.e.,
+ * bits [32w, 32w+32) of lane l of its block, with the values crossing the
+ * word boundaries shifted in
+ * */
+#define PACK_WORD(res, g, bits, length, VALUE_AT)                                   \
+{                                                                                   \
+    int block = (g) / ((bits)*PACK_LANES), rem = (g) % ((bits)*PACK_LANES);         \
+    int w = rem / PACK_LANES, l = rem % PACK_LANES;                                 \
+    res = 0;                                                                        \
+    for(int k = (w*32) / (bits); (k < 32) && (k*(bits) < (w+1)*32); k++) {          \
+        int i = block*PACK_BLOCK + k*PACK_LANES + l;                                \
+        uint v = (i < (length)) ? ((uint)(VALUE_AT(i)) & PACK_MASK(bits)) : 0;      \
+        int pos = k*(bits) - w*32;                                                  \
+        res |= (pos >= 0) ? (v << pos) : (v >> (-pos));                             \
+    }                                                                               \
+}
+
+/*pack length ints into num_words words, one WI per word*/
+kernel
+void pack_column(global const int *d_in, global uint *d_out, const int length,
+                 const int bits, const int num_words) {
+    #define IN_AT(i)    d_in[i]
+    for(int g = get_global_id(0); g < num_words; g += get_global_size(0)) {
+        uint word;
+        PACK_WORD(word, g, bits, length, IN_AT);
+        d_out[g] = word;
+    }
+    #undef IN_AT
+}
+
+kernel
+void unpack_column(global const uint *d_in, global int *d_out, const int length, const int bits) {
+    for(int i = get_global_id(0); i < length; i += get_global_size(0))
+        d_out[i] = unpack_at(d_in, i, bits);
+}
+
+/*d_out[i] = value d_loc[i] of the packed d_in*/
+kernel
+void gather_packed(global const uint *d_in, global int *d_out, global const int *d_loc,
+                   const int length, const int bits) {
+    for(int i = get_global_id(0); i < length; i += get_global_size(0))
+        d_out[i] = unpack_at(d_in, d_loc[i], bits);
+}
+
+/*gather_packed with the output packed with the same bits, one WI per output word*/
+kernel
+void gather_packed_out(global const uint *d_in, global uint *d_out, global const int *d_loc,
+                       const int length, const int bits, const int num_words) {
+    #define GATHER_AT(i)    unpack_at(d_in, d_loc[i], bits)
+    for(int g = get_global_id(0); g < num_words; g += get_global_size(0)) {
+        uint word;
+        PACK_WORD(word, g, bits, length, GATHER_AT);
+        d_out[g] = word;
+    }
+    #undef GATHER_AT
+}
+
+#endif
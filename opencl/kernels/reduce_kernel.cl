@@ -0,0 +1,101 @@
+#ifndef REDUCE_KERNEL_CL
+#define REDUCE_KERNEL_CL
+
+/*
+ * Compilation parameters:
+ *   type:      one of TYPE_INT, TYPE_LONG, TYPE_FLOAT, TYPE_DOUBLE
+ *   operator:  one of REDUCE_SUM, REDUCE_MIN, REDUCE_MAX
+ * */
+#if defined(TYPE_LONG)
+    typedef long T;
+    #define T_MAX       LONG_MAX
+    #define T_LOWEST    LONG_MIN
+#elif defined(TYPE_FLOAT)
+    typedef float T;
+    #define T_MAX       INFINITY
+    #define T_LOWEST    (-INFINITY)
+#elif defined(TYPE_DOUBLE)
+    #pragma OPENCL EXTENSION cl_khr_fp64 : enable
+    typedef double T;
+    #define T_MAX       INFINITY
+    #define T_LOWEST    (-INFINITY)
+#else
+    typedef int T;
+    #define T_MAX       INT_MAX
+    #define T_LOWEST    INT_MIN
+#endif
+
+#if defined(REDUCE_MIN)
+    #define IDENTITY    (T_MAX)
+    #define OP(a,b)     min((a),(b))
+#elif defined(REDUCE_MAX)
+    #define IDENTITY    (T_LOWEST)
+    #define OP(a,b)     max((a),(b))
+#else
+    #define IDENTITY    ((T)0)
+    #define OP(a,b)     ((a)+(b))
+#endif
+
+/*tree reduction of one value per WI, local_size should be a power of 2*/
+inline T local_reduce(local T *l_data, T acc) {
+    const int local_id = get_local_id(0);
+    barrier(CLK_LOCAL_MEM_FENCE);       /*l_data may still be read from a previous call*/
+    l_data[local_id] = acc;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(int scale = get_local_size(0) >> 1; scale > 0; scale >>= 1) {
+        if (local_id < scale) l_data[local_id] = OP(l_data[local_id], l_data[local_id + scale]);
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    return l_data[0];
+}
+
+/*
+ * Single-pass reduction with a last-block finalize:
+ * 1. each WG reduces a grid-stride share of the input and writes its partial
+ * 2. the WG taking the last ticket reduces the partials and writes the result
+ * The ticket is reset by the last WG so that the buffer can be reused.
+ * */
+kernel void reduce(
+        global const T *d_in,
+        const int length,
+        global T *d_partials,                   /*one per WG*/
+        global volatile unsigned *d_ticket,     /*zero-initialized*/
+        global T *d_res,
+        local T *l_data)                        /*local_size elements*/
+{
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+    const int group_id = get_group_id(0);
+    const int num_groups = get_num_groups(0);
+    const int global_size = get_global_size(0);
+    local bool is_last;
+
+    /*two independent accumulators to overlap the loads*/
+    T acc0 = IDENTITY, acc1 = IDENTITY;
+    int i = get_global_id(0);
+    for(; i + global_size < length; i += 2*global_size) {
+        acc0 = OP(acc0, d_in[i]);
+        acc1 = OP(acc1, d_in[i + global_size]);
+    }
+    if (i < length) acc0 = OP(acc0, d_in[i]);
+    T acc = local_reduce(l_data, OP(acc0, acc1));
+
+    if (local_id == 0) {
+        d_partials[group_id] = acc;
+        mem_fence(CLK_GLOBAL_MEM_FENCE);    /*the partial is visible before the ticket is taken*/
+        is_last = (atomic_inc(d_ticket) == num_groups - 1);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (!is_last) return;
+
+    acc = IDENTITY;
+    for(int g = local_id; g < num_groups; g += local_size)
+        acc = OP(acc, ((global volatile T*)d_partials)[g]);
+    acc = local_reduce(l_data, acc);
+    if (local_id == 0) {
+        *d_res = acc;
+        *d_ticket = 0;
+    }
+}
+
+#endif
@@ -7,39 +7,120 @@
 #define REGISTERS (1)
 #endif
 
-/*adjacent synchronization*/
+/*PACKED_BITS: scan reads d_in from a column bit-packed with PACKED_BITS bits (pack_kernel.cl)*/
+#ifdef PACKED_BITS
+    #include "pack_kernel.cl"
+    typedef uint ScanIn;
+    #define LOAD_IN(d_in, idx)      unpack_at(d_in, idx, PACKED_BITS)
+#else
+    typedef int ScanIn;
+    #define LOAD_IN(d_in, idx)      d_in[idx]
+#endif
+
+/*
+ * Decoupled look-back: the tile publishes its aggregate, then inspects a
+ * window of SCAN_LOOKBACK_WINDOW predecessors at a time, adding their
+ * aggregates until a predecessor with an inclusive prefix is found. The
+ * window is restarted on tiles that have not published yet. The tile
+ * publishes its own inclusive prefix and the exclusive prefix goes to *s.
+ * status: SCAN_STATUS_INTS ints per tile (flag, aggregate, inclusive prefix)
+ * */
 inline void
-adjSyn(int blockId,
-       int localId,
-       global volatile int *inter,
-       local int* r,
-       local int *s) {
+look_back(int tile,
+          int localId,
+          int localSize,
+          global volatile int *status,
+          local int *r,
+          local int *s) {
+    local int win_flag[SCAN_LOOKBACK_WINDOW], win_val[SCAN_LOOKBACK_WINDOW];
+    local int end, done;
+
     if (localId == 0) {
-        int p = 0;
-        if (blockId == 0)   inter[0] = (*r);
+        global volatile int *my = status + tile * SCAN_STATUS_INTS;
+        if (tile == 0) {
+            my[2] = *r;
+            write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+            my[0] = SCAN_FLAG_PREFIX;
+            *s = 0;
+        }
         else {
-            while ((p = inter[blockId-1]) == SCAN_INTER_INVALID) {}
-            inter[blockId] = p + (*r);
+            my[1] = *r;
+            write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+            my[0] = SCAN_FLAG_AGGREGATE;
+            *s = 0;
+        }
+        end = tile;
+        done = (tile == 0);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    while (!done) {
+        /*1.the window of predecessors end-1, end-2, ... is read in parallel*/
+        for(int i = localId; i < SCAN_LOOKBACK_WINDOW; i += localSize) {
+            int t = end - 1 - i;
+            int flag = SCAN_FLAG_PREFIX, val = 0;
+            if (t >= 0) {
+                global volatile int *pre = status + t * SCAN_STATUS_INTS;
+                flag = pre[0];
+                read_mem_fence(CLK_GLOBAL_MEM_FENCE);
+                val = (flag == SCAN_FLAG_PREFIX) ? pre[2] : pre[1];
+            }
+            win_flag[i] = flag;
+            win_val[i] = val;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /*2.accumulate up to the first inclusive prefix or unpublished tile*/
+        if (localId == 0) {
+            int i = 0, acc = 0;
+            while (i < SCAN_LOOKBACK_WINDOW && win_flag[i] != SCAN_FLAG_INVALID) {
+                acc += win_val[i];
+                if (win_flag[i++] == SCAN_FLAG_PREFIX) {
+                    done = 1;
+                    break;
+                }
+            }
+            *s += acc;
+            end -= i;
         }
-        *s = p;
+        barrier(CLK_LOCAL_MEM_FENCE);
     }
+
+    if ((localId == 0) && (tile != 0)) {
+        global volatile int *my = status + tile * SCAN_STATUS_INTS;
+        my[2] = *s + *r;
+        write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+        my[0] = SCAN_FLAG_PREFIX;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/*
+ * Dynamic tile ID from the counter after the tile status, so the tiles are
+ * started in order and a look-back never waits for a tile that no WG owns.
+ * Returns num_tiles or more when all the tiles are taken.
+ * */
+inline int
+next_tile(int localId, global int *status, int num_tiles, local int *tile) {
+    if (localId == 0) *tile = atomic_inc(status + num_tiles * SCAN_STATUS_INTS);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    int t = *tile;
     barrier(CLK_LOCAL_MEM_FENCE);
+    return t;
 }
 
 /*strided load to registers, for CPU*/
 kernel
-void scan(global int *d_in,
+void scan(global ScanIn *d_in,
           global int *d_out,
           const int length,                   //input length
           local int *lo,                     //lo: local memory
           const int num_of_groups,            //#groups needed to be scanned
           const int R,                        //elements per thread in the registers
           const int L,                        //elements per thread in the local memory
-          global int *inter) {                 //for adjacent sync
+          global int *inter) {                 //tile status, see look_back
     auto localId = get_local_id(0);
     auto localSize = get_local_size(0);
-    auto groupId = get_group_id(0);
-    auto groupSize = get_num_groups(0);
     auto warpId = localId >> WARP_BITS;        //warp ID
     auto lane = localId & MASK;          //lane ID in the warp
 
@@ -47,8 +128,11 @@ void scan(global int *d_in,
     local int gs, gss;
     int tempL = (R != 0) ? L+1 : L; //how many elements a thread processes in the local memory
 
-    /*static work-group execution*/
-    for(int w = groupId; w < num_of_groups; w += groupSize) {
+    local int tile_id;
+
+    /*dynamic work-group execution*/
+    for(int w = next_tile(localId, inter, num_of_groups, &tile_id); w < num_of_groups;
+        w = next_tile(localId, inter, num_of_groups, &tile_id)) {
         int l_begin_global = localSize * (R + L) * w;
         int r_begin_global = l_begin_global + L * localSize;
 
@@ -60,7 +144,7 @@ void scan(global int *d_in,
             //load from global memory directly with strided access
             int localSum = 0;
             for(int r = 0; r < r_end_local - r_begin_local; r++) {
-                reg[r] = d_in[r+r_begin_local];
+                reg[r] = LOAD_IN(d_in, r+r_begin_local);
                 localSum += reg[r];
             }
             barrier(CLK_LOCAL_MEM_FENCE);
@@ -76,14 +160,14 @@ void scan(global int *d_in,
 
             c = l_begin_local + lane;
             while (c < l_end_local) {
-                lo[c] = d_in[l_begin_global + c];
+                lo[c] = LOAD_IN(d_in, l_begin_global + c);
                 c += WARP_SIZE;
             }
             barrier(CLK_LOCAL_MEM_FENCE);
         }
 
         scan_local(lo, tempL, &gs);      //local memory scan
-        adjSyn(w, localId, inter, &gs, &gss);   //adjacent sync
+        look_back(w, localId, localSize, inter, &gs, &gss);
 
         //add back and copy the local mem to global memory
         if (L != 0) {
@@ -114,11 +198,9 @@ void scan_coalesced(global int * d_in,                //d_inout: i/o array
                     const int num_of_groups,            //#groups needed to be scanned
                     const int R,                        //elements per thread in the registers
                     const int L,                        //elements per thread in the local memory
-                    global int * inter) {                 //for adjacent sync
+                    global int * inter) {                 //tile status, see look_back
     const unsigned localId = get_local_id(0);
     const unsigned localSize = get_local_size(0);
-    const unsigned groupId = get_group_id(0);
-    const unsigned groupSize = get_num_groups(0);
     const unsigned warpId = localId >> WARP_BITS;       //warp ID
     const unsigned lane = localId & MASK;          //lane ID in the warp
 
@@ -126,8 +208,11 @@ void scan_coalesced(global int * d_in,                //d_inout: i/o array
     local int gs, gss;
     int tempL = (R != 0) ? L+1 : L; //how many elements a thread processes in the local memory
 
-    /*static work-group execution*/
-    for (int w = groupId; w < num_of_groups; w += groupSize) {
+    local int tile_id;
+
+    /*dynamic work-group execution*/
+    for(int w = next_tile(localId, inter, num_of_groups, &tile_id); w < num_of_groups;
+        w = next_tile(localId, inter, num_of_groups, &tile_id)) {
         int l_begin_global = localSize * (R + L) * w;
         int r_begin_global = l_begin_global + L * localSize;
 
@@ -172,7 +257,7 @@ void scan_coalesced(global int * d_in,                //d_inout: i/o array
         }
 
         scan_local(lo, tempL, &gs);      //local memory scan,0.3ms
-        adjSyn(w, localId, inter, &gs, &gss);   //adjacent sync
+        look_back(w, localId, localSize, inter, &gs, &gss);
 
         //add back and copy the local mem to global memory
         if (L != 0) {
@@ -201,4 +286,42 @@ void scan_coalesced(global int * d_in,                //d_inout: i/o array
         }
     }
 }
+
+/*
+ * Batched exclusive scan of independent segments, segment g is
+ * [d_offsets[g], d_offsets[g+1]) and the last one ends at length.
+ * The WGs loop over the segments, each segment is scanned in tiles of
+ * local_size*REGISTERS elements and the carry is reset per segment.
+ * */
+kernel
+void scan_batched(global const int *d_in,
+                  global int *d_out,
+                  global const int *d_offsets,
+                  const int num_segments,
+                  const int length,
+                  local int *lo) {                  //local_size*REGISTERS ints
+    const int localId = get_local_id(0);
+    const int localSize = get_local_size(0);
+    const int tile_size = localSize * REGISTERS;
+    local int gs;
+
+    for(int seg = get_group_id(0); seg < num_segments; seg += get_num_groups(0)) {
+        int begin = d_offsets[seg];
+        int end = (seg == num_segments - 1) ? length : d_offsets[seg+1];
+        int carry = 0;
+
+        for(int t = begin; t < end; t += tile_size) {
+            for(int c = localId; c < tile_size; c += localSize)
+                lo[c] = (t + c < end) ? d_in[t + c] : 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            scan_local(lo, REGISTERS, &gs);
+
+            for(int c = localId; c < tile_size; c += localSize)
+                if (t + c < end) d_out[t + c] = lo[c] + carry;
+            carry += gs;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+    }
+}
 #endif
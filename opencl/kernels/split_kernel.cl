@@ -11,6 +11,45 @@
     #define GET_X_VALUE(d_in, idx)    d_in[idx]
 #endif
 
+/*
+ * PACKED_BITS: WG_histogram and WG_shuffle read the keys from a column
+ * bit-packed with PACKED_BITS bits (pack_kernel.cl) and write them unpacked,
+ * KO and KVS_SOA only
+ * */
+#ifdef PACKED_BITS
+    #include "pack_kernel.cl"
+    typedef uint KeyIn;
+    #define GET_KEY(d_in, idx)      unpack_at(d_in, idx, PACKED_BITS)
+    #define GET_TUPLE(d_in, idx)    unpack_at(d_in, idx, PACKED_BITS)
+#else
+    typedef Tuple KeyIn;
+    #define GET_KEY(d_in, idx)      GET_X_VALUE(d_in, idx)
+    #define GET_TUPLE(d_in, idx)    d_in[idx]
+#endif
+
+/*bucket of a key, KEY_SHIFT selects the digit in multi-level splits*/
+#ifndef KEY_SHIFT
+#define KEY_SHIFT   (0)
+#endif
+#define GET_BUCKET(key, mask)   ((((unsigned)(key)) >> KEY_SHIFT) & (mask))
+
+/*
+ * BUCKETS: bucket count fixed at compile time (a power of 2), WG_histogram
+ * and WG_shuffle then ignore their buckets argument, so the mask and the
+ * loops over the local histogram are constants
+ * */
+#ifdef BUCKETS
+    #define NUM_BUCKETS(buckets)    (BUCKETS)
+#else
+    #define NUM_BUCKETS(buckets)    (buckets)
+#endif
+
+/*digit of the next pass of a multi-pass split, histogrammed by the fused WG_shuffle*/
+#ifndef NEXT_KEY_SHIFT
+#define NEXT_KEY_SHIFT  (0)
+#endif
+#define GET_NEXT_BUCKET(key, mask)  ((((unsigned)(key)) >> NEXT_KEY_SHIFT) & (mask))
+
 #ifdef SMALLER_WARP_SIZE        //num <= WARP_SIZE
     #define LOCAL_SCAN(arr,num,offset)                                      \
     if (local_id < num) {                                                    \
@@ -331,6 +370,61 @@ kernel void gatherStartPos( global const int *d_his,
     }
 }
 
+/*
+ *  Segmented split: segment g is [d_start_in[g], d_start_in[g+1]) (the last one
+ *  ends at len_total) and is split on the digit ((key >> shift) & (buckets-1)).
+ *  Used as the second level of a multi-level split and by the batched split.
+ *  The WGs loop over the segments and the histogram is reset per segment.
+ *  Segment boundaries are kept and the start of sub-bucket b of segment g is
+ *  written to d_start_out[g*buckets+b]. buckets and local_size are powers of 2.
+ * */
+kernel void WG_split_segmented(
+    global const Tuple *d_in,
+    global Tuple *d_out,
+#ifdef KVS_SOA
+    global const Tuple *d_in_values,
+    global Tuple *d_out_values,
+#endif
+    global const int *d_start_in,
+    int num_segments,
+    int len_total,
+    int shift,
+    int buckets,
+    global int *d_start_out,
+    local int *local_his)       /*buckets*sizeof(int)*/
+{
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    unsigned mask = buckets - 1;
+
+    for(int seg = get_group_id(0); seg < num_segments; seg += get_num_groups(0)) {
+        int begin = d_start_in[seg];
+        int end = (seg == num_segments - 1) ? len_total : d_start_in[seg+1];
+
+        for(int b = local_id; b < buckets; b += local_size) local_his[b] = 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for(int i = begin + local_id; i < end; i += local_size)
+            atomic_inc(local_his + ((((unsigned)GET_X_VALUE(d_in, i)) >> shift) & mask));
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        scan_local(local_his, buckets);
+
+        for(int b = local_id; b < buckets; b += local_size)
+            d_start_out[seg*buckets+b] = begin + local_his[b];
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        for(int i = begin + local_id; i < end; i += local_size) {
+            int pos = begin + atomic_inc(local_his + ((((unsigned)GET_X_VALUE(d_in, i)) >> shift) & mask));
+            d_out[pos] = d_in[i];
+#ifdef KVS_SOA
+            d_out_values[pos] = d_in_values[i];
+#endif
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
 /*WI-level histogram: each thraed has a private histogram stored in the local memory*/
 kernel void WI_histogram(
         global const Tuple *d_in,       /*input keys*/
@@ -360,7 +454,7 @@ kernel void WI_histogram(
     barrier(CLK_LOCAL_MEM_FENCE);
 
     for(int i = begin_global; i < end_global; i += step) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         local_buckets[offset*local_size+local_id]++;
     }
     barrier(CLK_LOCAL_MEM_FENCE);
@@ -400,7 +494,7 @@ kernel void WI_shuffle(
     barrier(CLK_LOCAL_MEM_FENCE);
 
     for(int i = begin_global; i < end_global; i += step) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         int idx = offset*local_size + local_id;
 
         d_out[local_buckets[idx]] = d_in[i];
@@ -413,7 +507,7 @@ kernel void WI_shuffle(
 
 /*------------ WG-level kernels : WIs in a WG share a histogram ------------*/
 kernel void WG_histogram(
-    global const Tuple *d_in,   /*input data*/
+    global const KeyIn *d_in,   /*input data*/
     int len_total,              /*length of the dataset*/
     global int *his,            /*histogram output*/
     local int* local_buc,       /*local buffer: buckets*sizeof(int)*/
@@ -427,7 +521,7 @@ kernel void WG_histogram(
     int num_groups = get_num_groups(0);
 
     unsigned step = (local_size < WARP_SIZE) ? local_size : WARP_SIZE;
-    unsigned mask = buckets - 1;
+    unsigned mask = NUM_BUCKETS(buckets) - 1;
     unsigned offset, begin_global, end_global;
 
     compute_mixed_access(
@@ -435,24 +529,30 @@ kernel void WG_histogram(
             &begin_global, &end_global);
 
     /*local histogram initialization*/
-    for(int i = local_id; i < buckets; i += local_size)
+    for(int i = local_id; i < NUM_BUCKETS(buckets); i += local_size)
         local_buc[i] = 0;
     barrier(CLK_LOCAL_MEM_FENCE);
 
     /*global sequential access*/
     for(int i = begin_global; i < end_global; i += step) {
-       offset = GET_X_VALUE(d_in, i) & mask;
+       offset = GET_BUCKET(GET_KEY(d_in, i), mask);
        atomic_inc(local_buc+offset);
     }
     barrier(CLK_LOCAL_MEM_FENCE);
 
     /*histogram write*/
-    for(int i = local_id; i < buckets; i += local_size)
+    for(int i = local_id; i < NUM_BUCKETS(buckets); i += local_size)
         his[i*num_groups+group_id] = local_buc[i];
 }
 
+/*
+ * With NEXT_HIS, the tuples written are also counted in the WG_histogram
+ * layout of the next pass: d_out[pos] is read by WG pos/next_chunk of the
+ * next pass, so the next pass does not re-read the data for its histogram.
+ * his_next must be zeroed.
+ * */
 kernel void WG_shuffle(
-    global const Tuple *d_in,
+    global const KeyIn *d_in,
     global Tuple *d_out,
 #ifdef KVS_SOA
     global const Tuple *d_in_values,
@@ -461,7 +561,13 @@ kernel void WG_shuffle(
     int len_total,
     int buckets,
     global int *his,
-    local int *local_buc)
+    local int *local_buc
+#ifdef NEXT_HIS
+    ,global int *his_next,      /*next_buckets*num_groups ints*/
+    int next_buckets,
+    int next_chunk              /*tuples read by a WG of the next pass*/
+#endif
+    )
 {
     int local_id = get_local_id(0);
     int local_size = get_local_size(0);
@@ -471,21 +577,149 @@ kernel void WG_shuffle(
     int num_groups = get_num_groups(0);
 
     unsigned step = (local_size < WARP_SIZE) ? local_size : WARP_SIZE;
-    unsigned mask = buckets - 1;
+    unsigned mask = NUM_BUCKETS(buckets) - 1;
     unsigned offset, begin_global, end_global;
 
     compute_mixed_access(
             step, global_id, global_size, len_total,
             &begin_global, &end_global);
 
-    for(int i = local_id; i < buckets; i += local_size)
+    for(int i = local_id; i < NUM_BUCKETS(buckets); i += local_size)
         local_buc[i] = his[i*num_groups+group_id];
     barrier(CLK_LOCAL_MEM_FENCE);
 
     /*global sequential access*/
     for(int i = begin_global; i < end_global; i += step) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_KEY(d_in, i), mask);
         int pos = atomic_inc(local_buc+offset);
+        d_out[pos] = GET_TUPLE(d_in, i);
+#ifdef KVS_SOA
+        d_out_values[pos] = d_in_values[i];
+#endif
+#ifdef NEXT_HIS
+        offset = GET_NEXT_BUCKET(GET_KEY(d_in, i), next_buckets - 1);
+        atomic_inc(his_next + offset*num_groups + pos/next_chunk);
+#endif
+    }
+}
+
+/*
+ * ------------ Skew-aware WG-level kernels ------------
+ * The num_heavy heavy-hitter keys (sorted by bucket) get virtual buckets of
+ * their own right after the regular part of their bucket, so there are
+ * buckets+num_heavy virtual buckets. The heavy tuples of a WI are counted in
+ * registers and their slots are reserved with one atomic per heavy key, so
+ * they never contend on the local histogram.
+ * */
+inline int heavy_index(int key, constant int *heavy_keys, int num_heavy) {
+    for(int h = 0; h < num_heavy; h++)
+        if (key == heavy_keys[h]) return h;
+    return -1;
+}
+
+/*virtual bucket of the regular tuples of bucket b*/
+inline int regular_slot(int b, constant int *heavy_buckets, int num_heavy) {
+    int slot = b;
+    for(int h = 0; h < num_heavy; h++) slot += (heavy_buckets[h] < b);
+    return slot;
+}
+
+#define HEAVY_SLOT(heavy_buckets, h)    ((heavy_buckets)[h] + (h) + 1)
+
+kernel void WG_histogram_skew(
+    global const Tuple *d_in,
+    int len_total,
+    global int *his,                    /*histogram output, buckets+num_heavy virtual buckets*/
+    local int* local_buc,               /*local buffer: (buckets+num_heavy)*sizeof(int)*/
+    int buckets,
+    constant int *heavy_keys,
+    constant int *heavy_buckets,
+    int num_heavy)
+{
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    int global_id = get_global_id(0);
+    int global_size = get_global_size(0);
+    int group_id = get_group_id(0);
+    int num_groups = get_num_groups(0);
+
+    unsigned step = (local_size < WARP_SIZE) ? local_size : WARP_SIZE;
+    unsigned mask = buckets - 1;
+    unsigned begin_global, end_global;
+    int v_buckets = buckets + num_heavy;
+    int heavy_cnt[SPLIT_MAX_HEAVY] = {0};
+
+    compute_mixed_access(
+            step, global_id, global_size, len_total,
+            &begin_global, &end_global);
+
+    for(int i = local_id; i < v_buckets; i += local_size)
+        local_buc[i] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int i = begin_global; i < end_global; i += step) {
+        int key = GET_X_VALUE(d_in, i);
+        int h = heavy_index(key, heavy_keys, num_heavy);
+        if (h >= 0) heavy_cnt[h]++;
+        else        atomic_inc(local_buc + regular_slot(GET_BUCKET(key, mask), heavy_buckets, num_heavy));
+    }
+    for(int h = 0; h < num_heavy; h++)
+        if (heavy_cnt[h]) atomic_add(local_buc + HEAVY_SLOT(heavy_buckets, h), heavy_cnt[h]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int i = local_id; i < v_buckets; i += local_size)
+        his[i*num_groups+group_id] = local_buc[i];
+}
+
+kernel void WG_shuffle_skew(
+    global const Tuple *d_in,
+    global Tuple *d_out,
+#ifdef KVS_SOA
+    global const Tuple *d_in_values,
+    global Tuple *d_out_values,
+#endif
+    int len_total,
+    int buckets,
+    global int *his,                    /*scanned histogram of WG_histogram_skew*/
+    local int *local_buc,               /*local buffer: (buckets+num_heavy)*sizeof(int)*/
+    constant int *heavy_keys,
+    constant int *heavy_buckets,
+    int num_heavy)
+{
+    int local_id = get_local_id(0);
+    int local_size = get_local_size(0);
+    int global_id = get_global_id(0);
+    int global_size = get_global_size(0);
+    int group_id = get_group_id(0);
+    int num_groups = get_num_groups(0);
+
+    unsigned step = (local_size < WARP_SIZE) ? local_size : WARP_SIZE;
+    unsigned mask = buckets - 1;
+    unsigned begin_global, end_global;
+    int v_buckets = buckets + num_heavy;
+    int heavy_pos[SPLIT_MAX_HEAVY] = {0};
+
+    compute_mixed_access(
+            step, global_id, global_size, len_total,
+            &begin_global, &end_global);
+
+    for(int i = local_id; i < v_buckets; i += local_size)
+        local_buc[i] = his[i*num_groups+group_id];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /*reserve a contiguous range of each heavy region for the heavy tuples of this WI*/
+    for(int i = begin_global; i < end_global; i += step) {
+        int h = heavy_index(GET_X_VALUE(d_in, i), heavy_keys, num_heavy);
+        if (h >= 0) heavy_pos[h]++;
+    }
+    for(int h = 0; h < num_heavy; h++)
+        if (heavy_pos[h]) heavy_pos[h] = atomic_add(local_buc + HEAVY_SLOT(heavy_buckets, h), heavy_pos[h]);
+
+    for(int i = begin_global; i < end_global; i += step) {
+        int key = GET_X_VALUE(d_in, i);
+        int h = heavy_index(key, heavy_keys, num_heavy);
+        int pos = (h >= 0) ? heavy_pos[h]++ :
+                  atomic_inc(local_buc + regular_slot(GET_BUCKET(key, mask), heavy_buckets, num_heavy));
         d_out[pos] = d_in[i];
 #ifdef KVS_SOA
         d_out_values[pos] = d_in_values[i];
@@ -539,7 +773,7 @@ kernel void WG_shuffle_varied(
 
     /*scatter the input to the local memory*/
     for(int i = begin_global; i < end_global; i += step) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         int acc = atomic_inc(local_start_ptrs+offset+1);
 
         /*write to the buffer*/
@@ -557,7 +791,7 @@ kernel void WG_shuffle_varied(
     //write the data from the local mem to global mem (coalesced)
     int local_sum = local_start_ptrs[buckets];
     for(int i = local_id; i < local_sum; i += local_size) {
-        offset = GET_X_VALUE(reorder_buffer, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(reorder_buffer, i), mask);
         d_out[i+local_start_ptrs[offset]] = reorder_buffer[i];
 #ifdef KVS_SOA
         d_out_values[i+local_start_ptrs[offset]] = reorder_buffer_values[i];
@@ -624,7 +858,7 @@ void WG_shuffle_fixed(
 
     /*iterate the data partition*/
     for(int i = begin_global; i <end_global; i += step) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         unsigned buffer_len_idx = (offset+1)*ELE_PER_CACHELINE-1;
 
         /*write to the cache buffer*/
@@ -695,7 +929,7 @@ void single_histogram(
 
     /*iterate the data partition*/
     for(int i = start; i <end; i++) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         local_buc[offset]++;
     }
 
@@ -729,7 +963,7 @@ const int buckets,
 
     /*iterate the data partition*/
     for(int i = start; i <end; i++) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         unsigned addr = local_buc[offset]++;
         d_out[addr] = d_in[i];
     }
@@ -769,7 +1003,7 @@ void single_fixed_shuffle(
 
     /*iterate the data partition*/
     for(int i = start; i <end; i++) {
-        offset = GET_X_VALUE(d_in, i) & mask;
+        offset = GET_BUCKET(GET_X_VALUE(d_in, i), mask);
         unsigned buffer_len_idx = (offset+1)*ELE_PER_CACHELINE-1;
 
         /*write to the cache buffer*/
@@ -0,0 +1,71 @@
+#ifndef TRANSPOSE_KERNEL_CL
+#define TRANSPOSE_KERNEL_CL
+
+/*
+ * Compilation parameters:
+ *   FIELDS:    number of int fields of a record, 2, 4 or 8
+ *
+ * A record is one intFIELDS vector, so each WI moves a whole record with a
+ * single vector access and the field arrays are accessed with unit stride
+ * across the WIs: both sides stay coalesced without a local memory stage.
+ * */
+#if (FIELDS == 8)
+    typedef int8 Record;
+#elif (FIELDS == 4)
+    typedef int4 Record;
+#else
+    typedef int2 Record;
+#endif
+
+/*field arrays f0..f(FIELDS-1) as kernel parameters*/
+#if (FIELDS == 8)
+    #define FIELD_PARAMS(Q) Q int *f0, Q int *f1, Q int *f2, Q int *f3, \
+                            Q int *f4, Q int *f5, Q int *f6, Q int *f7
+#elif (FIELDS == 4)
+    #define FIELD_PARAMS(Q) Q int *f0, Q int *f1, Q int *f2, Q int *f3
+#else
+    #define FIELD_PARAMS(Q) Q int *f0, Q int *f1
+#endif
+
+/*AOS -> SOA: field f of records[i] goes to f<f>[i]*/
+kernel
+void aos_to_soa(global const Record *records, const int length, FIELD_PARAMS(global)) {
+    for(int i = get_global_id(0); i < length; i += get_global_size(0)) {
+        Record r = records[i];
+        f0[i] = r.s0;
+        f1[i] = r.s1;
+#if (FIELDS >= 4)
+        f2[i] = r.s2;
+        f3[i] = r.s3;
+#endif
+#if (FIELDS == 8)
+        f4[i] = r.s4;
+        f5[i] = r.s5;
+        f6[i] = r.s6;
+        f7[i] = r.s7;
+#endif
+    }
+}
+
+/*SOA -> AOS: records[i] is assembled from f0[i]..f(FIELDS-1)[i]*/
+kernel
+void soa_to_aos(global Record *records, const int length, FIELD_PARAMS(global const)) {
+    for(int i = get_global_id(0); i < length; i += get_global_size(0)) {
+        Record r;
+        r.s0 = f0[i];
+        r.s1 = f1[i];
+#if (FIELDS >= 4)
+        r.s2 = f2[i];
+        r.s3 = f3[i];
+#endif
+#if (FIELDS == 8)
+        r.s4 = f4[i];
+        r.s5 = f5[i];
+        r.s6 = f6[i];
+        r.s7 = f7[i];
+#endif
+        records[i] = r;
+    }
+}
+
+#endif
@@ -14,6 +14,31 @@
 #define SPLIT_VALUE_DEFAULT         (1024)       /*default value*/
 #define EXPERIMENT_TIMES            (5)
 
-/*invalid val set when doing chained scan*/
-#define SCAN_INTER_INVALID      (-1)
+/*
+ * tile status of the chained scan (decoupled look-back): a flag, the tile
+ * aggregate and the inclusive prefix per tile, then the dynamic tile counter.
+ * The status array is zero-initialized.
+ * */
+#define SCAN_FLAG_INVALID       (0)
+#define SCAN_FLAG_AGGREGATE     (1)     /*the aggregate of the tile is available*/
+#define SCAN_FLAG_PREFIX        (2)     /*the inclusive prefix of the tile is available*/
+#define SCAN_STATUS_INTS        (3)     /*ints per tile in the status array*/
+#define SCAN_LOOKBACK_WINDOW    (32)    /*predecessors inspected per look-back step*/
+
+/*empty slot of the join hash tables, keys must not take this value*/
+#define JOIN_EMPTY_KEY          (-2147483647-1)
+
+/*maximal number of heavy-hitter keys handled out of band by the skew-aware split*/
+#define SPLIT_MAX_HEAVY         (8)
+
+/*columns moved by a launch of the multi-column gather and scatter*/
+#define COLUMNS_PER_LAUNCH      (8)
+
+/*
+ * bit-packed columns: blocks of PACK_BLOCK values, each of PACK_LANES lanes
+ * holding 32 values in consecutive bits; word w of lane l of block b is at
+ * b*bits*PACK_LANES + w*PACK_LANES + l (see pack_kernel.cl)
+ * */
+#define PACK_LANES              (8)
+#define PACK_BLOCK              (32*PACK_LANES)
 #endif
\ No newline at end of file
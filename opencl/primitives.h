@@ -7,26 +7,73 @@
 #include "utility.h"
 #include "params.h"
 #include "types.h"
+#include "Profile.h"
 
 /*gather algorithm*/
 double gather(cl_mem d_source_values, cl_mem d_dest_values,
               int length, cl_mem d_loc, int localSize,
-              int gridSize, int pass);
+              int gridSize, int pass, Profile *prof=nullptr);
 
 /*scatter algorithm*/
 double scatter(cl_mem d_source_values, cl_mem d_dest_values,
                int length, cl_mem d_loc, int localSize,
-               int gridSize, int pass);
+               int gridSize, int pass, Profile *prof=nullptr);
+
+/*gather and scatter of num_columns columns driven by a single d_loc*/
+double gather_columns(const column_t *columns, int num_columns,
+                      int length, cl_mem d_loc, int local_size,
+                      int grid_size, int pass, Profile *prof=nullptr);
+double scatter_columns(const column_t *columns, int num_columns,
+                       int length, cl_mem d_loc, int local_size,
+                       int grid_size, int pass, Profile *prof=nullptr);
+
+/*
+ * bit-packed int columns of PACK_BLOCK-value blocks, see kernels/pack_kernel.cl
+ * only the low bits bits (1 to 32) of the values are kept
+ * */
+inline int packed_words(int length, int bits) {
+    return (length + PACK_BLOCK - 1) / PACK_BLOCK * bits * PACK_LANES;
+}
+double pack_column(cl_mem d_in, cl_mem d_out, int length, int bits,
+                   int local_size=256, int grid_size=4096, Profile *prof=nullptr);
+double unpack_column(cl_mem d_in, cl_mem d_out, int length, int bits,
+                     int local_size=256, int grid_size=4096, Profile *prof=nullptr);
+
+/*gather from a packed column, into ints or packed with the same bits (packed_out)*/
+double gather_packed(cl_mem d_in, int bits, cl_mem d_out, int length, cl_mem d_loc,
+                     bool packed_out=false, int local_size=256, int grid_size=4096,
+                     Profile *prof=nullptr);
+
+/*
+ * AOS <-> SOA transpose of records of num_fields ints (2, 4 or 8),
+ * d_fields holds num_fields arrays of length ints
+ * */
+double aos_to_soa(cl_mem d_records, const cl_mem *d_fields, int num_fields, int length,
+                  int local_size=256, int grid_size=32768, Profile *prof=nullptr);
+double soa_to_aos(const cl_mem *d_fields, cl_mem d_records, int num_fields, int length,
+                  int local_size=256, int grid_size=32768, Profile *prof=nullptr);
 
 /*scan algorithms*/
 double scan_chained(cl_mem d_in, cl_mem d_out,
                     int length, int localSize,
-                    int gridSize, int R, int L);
+                    int gridSize, int R, int L, Profile *prof=nullptr);
+
+/*scan_chained reading a column bit-packed with bits bits*/
+double scan_packed(cl_mem d_in, int bits, cl_mem d_out,
+                   int length, int local_size,
+                   int grid_size, int R, int L, Profile *prof=nullptr);
+
+/*exclusive scan of num_segments independent segments starting at d_offsets*/
+double scan_batched(cl_mem d_in, cl_mem d_out, cl_mem d_offsets,
+                    int num_segments, int length, int local_size=256,
+                    int grid_size=0, int R=4, Profile *prof=nullptr);
 
 double scan_RSS(cl_mem d_in, cl_mem d_out,
-                unsigned length, int local_size, int grid_size);
+                unsigned length, int local_size, int grid_size,
+                Profile *prof=nullptr);
 
-double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length);
+double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length,
+                       Profile *prof=nullptr);
 
 /*split algorithms*/
 double WI_split(
@@ -34,18 +81,103 @@ double WI_split(
         int length, int buckets,
         DataStruc structure,
         cl_mem d_in_values=0, cl_mem d_out_values=0,
-        int local_size=256, int grid_size=32768);
+        int local_size=256, int grid_size=32768,
+        Profile *prof=nullptr);
 
 double WG_split(
         cl_mem d_in, cl_mem d_out, cl_mem d_start,
         int length, int buckets, ReorderType reorder_type,
         DataStruc structure,
         cl_mem d_in_values=0, cl_mem d_out_values=0,
-        int local_size=256, int grid_size=32768);
+        int local_size=256, int grid_size=32768,
+        Profile *prof=nullptr);
+
+/*WG_split without reordering on keys bit-packed with bits bits, the output keys are unpacked (KO or SOA)*/
+double WG_split_packed(
+        cl_mem d_in, int bits, cl_mem d_out, cl_mem d_start,
+        int length, int buckets, DataStruc structure,
+        cl_mem d_in_values=0, cl_mem d_out_values=0,
+        int local_size=256, int grid_size=32768,
+        Profile *prof=nullptr);
+
+/*WG_split without reordering with the bucket count (a power of 2) compiled into the kernels*/
+double WG_split_const(
+        cl_mem d_in, cl_mem d_out, cl_mem d_start,
+        int length, int buckets, DataStruc structure,
+        cl_mem d_in_values=0, cl_mem d_out_values=0,
+        int local_size=256, int grid_size=32768,
+        Profile *prof=nullptr);
+
+/*
+ * LSD radix split on the low bits of the keys in passes of at most pass_bits
+ * bits, fused: the next pass histogram is counted during the shuffle
+ * */
+double WG_radix_split(
+        cl_mem d_in, cl_mem d_out, int length, int bits, int pass_bits,
+        bool fused, DataStruc structure,
+        cl_mem d_in_values=0, cl_mem d_out_values=0,
+        int local_size=256, int grid_size=32768,
+        Profile *prof=nullptr);
+
+/*
+ * batched split of num_segments independent segments starting at d_offsets
+ * d_start: num_segments*buckets ints, see splitImpl.cpp
+ * */
+double WG_split_batched(
+        cl_mem d_in, cl_mem d_out, cl_mem d_offsets, int num_segments,
+        int length, int buckets, DataStruc structure, cl_mem d_start,
+        cl_mem d_in_values=0, cl_mem d_out_values=0,
+        int local_size=256, int grid_size=0,
+        Profile *prof=nullptr);
+
+/*
+ * WG_split without reordering in which heavy-hitter keys found by sampling get
+ * dedicated regions, see splitImpl.cpp for the layout of d_start
+ * d_start: buckets+SPLIT_MAX_HEAVY ints, heavy_keys: SPLIT_MAX_HEAVY ints
+ * */
+double WG_split_skew(
+        cl_mem d_in, cl_mem d_out, cl_mem d_start,
+        int length, int buckets, DataStruc structure,
+        int *heavy_keys, int &num_heavy,
+        cl_mem d_in_values=0, cl_mem d_out_values=0,
+        int local_size=256, int grid_size=32768,
+        Profile *prof=nullptr);
 
 double single_split(
         cl_mem d_in, cl_mem d_out,
         int length, int buckets, bool reorder,
-        DataStruc structure);
+        DataStruc structure, Profile *prof=nullptr);
+
+/*filter algorithm, selecting the tuples whose keys satisfy pred*/
+double filter(
+        cl_mem d_in, cl_mem d_out, int length,
+        predicate_t pred, DataStruc structure, int &res_len,
+        cl_mem d_in_values=0, cl_mem d_out_values=0,
+        int local_size=256, int grid_size=0,   /*0: #CUs-1*/
+        Profile *prof=nullptr);
+
+/*
+ * histogram of the keys on func, his should hold func.buckets ints
+ * returns the strategy used in strategy when it is HIST_AUTO
+ * */
+double histogram(cl_mem d_in, int length, bucket_func_t func, cl_mem d_his,
+                 HistStrategy &strategy, int local_size=256, int grid_size=0,   /*0: 4 WGs per CU*/
+                 Profile *prof=nullptr);
+
+/*
+ * single-pass reduction, T is cl_int, cl_long, cl_float or cl_double
+ * sums are accumulated in T, REDUCE_COUNT returns length
+ * */
+template<typename T>
+double reduce(cl_mem d_in, int length, ReduceOp op, T &res,
+              int local_size=256, int grid_size=0,   /*0: 4 WGs per CU*/
+              Profile *prof=nullptr);
+
+/*join algorithms*/
+double hash_join(
+        cl_mem d_R_keys, cl_mem d_R_values, int r_len,
+        cl_mem d_S_keys, cl_mem d_S_values, int s_len,
+        cl_mem &d_out_R, cl_mem &d_out_S, int &res_len,
+        int local_size=256, Profile *prof=nullptr);
 
 
@@ -0,0 +1,103 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "../util/Plat.h"
+#include "log.h"
+using namespace std;
+
+#define FILTER_ELE_PER_WI       (8)
+
+/*compilation macro of each PredType*/
+static const char *pred_macros[] = {
+        "PRED_EQ", "PRED_NE", "PRED_LT", "PRED_LE", "PRED_GT", "PRED_GE", "PRED_RANGE", "PRED_BITMAP"
+};
+
+/*
+ *  Filter (stream compaction)
+ *  Input:  1.Table being filtered,     (d_in, d_in_values)
+ *          2.Table cardinality,        (length)
+ *          3.Predicate on the keys     (pred)
+ *  Output: 1.Qualified tuples in the input order (d_out, d_out_values)
+ *          2.Number of qualified tuples (res_len)
+ *
+ *  If DataStruc is SOA, then d_in represents the input keys.
+ *  If DataStruc is AOS, then d_in represents the input tuples, and the d_in_values, d_out_values should be set to 0
+ *  The output buffers should be able to hold length tuples.
+ *
+ *  Evaluation, scan and scatter are fused into a single kernel with the
+ *  decoupled look-back of scan_chained, the WGs take the tiles in order.
+ * */
+double filter(
+        cl_mem d_in, cl_mem d_out, int length,
+        predicate_t pred, DataStruc structure, int &res_len,
+        cl_mem d_in_values, cl_mem d_out_values,
+        int local_size, int grid_size, Profile *prof) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+    double total_time = 0;
+    int zero = 0;
+    if (grid_size == 0) grid_size = std::max((int)param.cus - 1, 1);   /*as in the chained scan*/
+    int tile_size = local_size * FILTER_ELE_PER_WI;
+    int num_tiles = (length + tile_size - 1) / tile_size;
+    if (num_tiles == 0) {
+        res_len = 0;
+        return 0;
+    }
+
+    char para_s[500] = {'\0'};
+    add_param(para_s, (char*)pred_macros[pred.type]);
+    add_param(para_s, "ELE_PER_WI", true, FILTER_ELE_PER_WI);
+    if (structure == KVS_SOA)       add_param(para_s, "KVS_SOA");
+    else if (structure == KVS_AOS)  add_param(para_s, "KVS_AOS");
+
+    auto t_beg = host_time_ns();
+    cl_kernel filter_kernel = get_kernel(param.device, param.context, "filter_kernel.cl", "filter", para_s);
+    prof_add_host(prof, "compile filter", t_beg);
+
+    t_beg = host_time_ns();
+    int status_len = SCAN_STATUS_INTS * num_tiles + 1;     /*tile status and the tile counter*/
+    cl_mem d_inter = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*status_len);
+    status = clEnqueueFillBuffer(param.queue, d_inter, &zero, sizeof(int), 0, sizeof(int)*status_len, 0, 0, 0);
+    checkErr(status, ERR_WRITE_BUFFER);
+    prof_add_host(prof, "alloc filter", t_beg);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)(local_size * grid_size)};
+
+    args_num = 0;
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(cl_mem), &d_out);
+    if (structure == KVS_SOA) {
+        status |= clSetKernelArg(filter_kernel, args_num++, sizeof(cl_mem), &d_in_values);
+        status |= clSetKernelArg(filter_kernel, args_num++, sizeof(cl_mem), &d_out_values);
+    }
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(int), &num_tiles);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(int), &pred.low);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(int), &pred.high);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(cl_mem), &pred.bitmap);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(int), &pred.bitmap_bits);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(int)*local_size, nullptr);
+    status |= clSetKernelArg(filter_kernel, args_num++, sizeof(cl_mem), &d_inter);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clFinish(param.queue);
+    status = clEnqueueNDRangeKernel(param.queue, filter_kernel, 1, 0, global_dim, local_dim, 0, nullptr, &event);
+    status = clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time = clEventTime(event);
+    prof_add_kernel(prof, "filter", event);
+
+    /*the last inclusive prefix is the number of matches*/
+    status = clEnqueueReadBuffer(param.queue, d_inter, CL_TRUE, sizeof(int)*(SCAN_STATUS_INTS*(num_tiles-1)+2), sizeof(int), &res_len, 0, 0, 0);
+    checkErr(status, ERR_READ_BUFFER);
+
+    cl_mem_free(d_inter);
+
+    return total_time;
+}
@@ -0,0 +1,128 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <algorithm>
+#include "../util/Plat.h"
+#include "log.h"
+using namespace std;
+
+#define HIST_WGS_PER_CU         (4)
+#define HIST_SAMPLE_BLOCKS      (16)        /*sampled blocks of contiguous keys*/
+#define HIST_SAMPLE_BLOCK_SIZE  (256)
+#define HIST_LMEM_RESERVED      (1024)      /*local memory used by the runtime*/
+
+/*compilation macro of each BucketFunc*/
+static const char *bucket_macros[] = {"BUCKET_RADIX", "BUCKET_MOD", "BUCKET_HASH"};
+static const char *strategy_names[] = {"auto", "private", "shared", "sort"};
+
+/*same as bucket_of in histogram_kernel.cl*/
+static int bucket_of(int key, const bucket_func_t &func) {
+    switch (func.type) {
+        case BUCKET_MOD:    return (int)((unsigned)key % (unsigned)func.buckets);
+        case BUCKET_HASH:   return (int)(((uint64_t)((unsigned)key * 0x9E3779B1u) * (unsigned)func.buckets) >> 32);
+        default:            return (int)(((unsigned)key >> func.shift) & (func.buckets - 1));
+    }
+}
+
+/*
+ * A sample is skewed if its most frequent bucket holds at least 1/32 of it
+ * and 8 times its uniform share. Then the atomics of the shared histogram
+ * are serialized on that bucket.
+ * */
+static bool sample_skewed(cl_mem d_in, int length, const bucket_func_t &func) {
+    device_param_t param = Plat::get_device_param();
+    vector<int> sample(HIST_SAMPLE_BLOCKS * HIST_SAMPLE_BLOCK_SIZE);
+    int sample_len = cl_mem_sample(param.queue, d_in, sizeof(int), length,
+                                   sample.data(), HIST_SAMPLE_BLOCKS, HIST_SAMPLE_BLOCK_SIZE);
+    if (sample_len == 0) return false;
+    sample.resize(sample_len);
+
+    for(auto &key : sample) key = bucket_of(key, func);
+    std::sort(sample.begin(), sample.end());
+    int max_run = 0, run = 0;
+    for(int i = 0; i < sample_len; i++) {
+        run = (i > 0 && sample[i] == sample[i-1]) ? run + 1 : 1;
+        max_run = std::max(max_run, run);
+    }
+    return ((uint64_t)max_run * 32 >= (uint64_t)sample_len) &&
+           ((uint64_t)max_run * func.buckets >= (uint64_t)sample_len * 8);
+}
+
+/*
+ *  Histogram
+ *  Input:  1.Keys,                         (d_in)
+ *          2.Number of keys,               (length)
+ *          3.Key to bucket function        (func)
+ *  Output: 1.Number of keys in each bucket (d_his)
+ *
+ *  HIST_AUTO samples the keys: skewed inputs use the private histograms if
+ *  they fit in the local memory and the sort-based kernel otherwise, other
+ *  inputs use the shared histograms.
+ * */
+double histogram(cl_mem d_in, int length, bucket_func_t func, cl_mem d_his,
+                 HistStrategy &strategy, int local_size, int grid_size, Profile *prof) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+    double total_time = 0;
+    int zero = 0;
+    if (grid_size == 0) grid_size = param.cus * HIST_WGS_PER_CU;
+
+    uint64_t lmem_avail = param.lmem_size - HIST_LMEM_RESERVED;
+    bool private_fits = (uint64_t)func.buckets * local_size * sizeof(int) <= lmem_avail;
+    bool shared_fits = (uint64_t)func.buckets * sizeof(int) <= lmem_avail;
+    if (strategy == HIST_PRIVATE && !private_fits) {
+        log_error("Private histograms of %d buckets do not fit in the local memory", func.buckets);
+        return -1;
+    }
+    if (strategy == HIST_AUTO) {
+        auto t_beg = host_time_ns();
+        if (sample_skewed(d_in, length, func)) strategy = private_fits ? HIST_PRIVATE : HIST_SORT;
+        else                                   strategy = HIST_SHARED;
+        prof_add_host(prof, "sample histogram", t_beg);
+        log_trace("Histogram strategy: %s", strategy_names[strategy]);
+    }
+
+    char para_s[500] = {'\0'};
+    add_param(para_s, (char*)bucket_macros[func.type]);
+    if (strategy == HIST_SHARED && shared_fits) add_param(para_s, "LOCAL_HIS");
+
+    const char *kernel_name = (strategy == HIST_PRIVATE) ? "histogram_private" :
+                              (strategy == HIST_SHARED) ? "histogram_shared" : "histogram_sort";
+    size_t lmem_bytes = sizeof(int);
+    if (strategy == HIST_PRIVATE)                       lmem_bytes = sizeof(int) * func.buckets * local_size;
+    else if (strategy == HIST_SHARED && shared_fits)    lmem_bytes = sizeof(int) * func.buckets;
+    else if (strategy == HIST_SORT)                     lmem_bytes = sizeof(int) * local_size;
+
+    auto t_beg = host_time_ns();
+    cl_kernel his_kernel = get_kernel(param.device, param.context, "histogram_kernel.cl", (char*)kernel_name, para_s);
+    prof_add_host(prof, "compile histogram", t_beg);
+
+    status = clEnqueueFillBuffer(param.queue, d_his, &zero, sizeof(int), 0, sizeof(int)*func.buckets, 0, 0, 0);
+    checkErr(status, ERR_WRITE_BUFFER);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)(local_size * grid_size)};
+
+    args_num = 0;
+    status |= clSetKernelArg(his_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(his_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(his_kernel, args_num++, sizeof(cl_mem), &d_his);
+    status |= clSetKernelArg(his_kernel, args_num++, sizeof(int), &func.buckets);
+    status |= clSetKernelArg(his_kernel, args_num++, sizeof(int), &func.shift);
+    status |= clSetKernelArg(his_kernel, args_num++, lmem_bytes, nullptr);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clFinish(param.queue);
+    status = clEnqueueNDRangeKernel(param.queue, his_kernel, 1, 0, global_dim, local_dim, 0, nullptr, &event);
+    status = clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time = clEventTime(event);
+    prof_add_kernel(prof, kernel_name, event);
+
+    return total_time;
+}
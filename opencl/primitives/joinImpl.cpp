@@ -0,0 +1,166 @@
+//
+//  Created by Zhuohang Lai on 5/16/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "../util/Plat.h"
+#include "log.h"
+using namespace std;
+
+#define JOIN_MAX_RADIX_BITS         (20)        /*largest fan-out of WG_split*/
+#define JOIN_SPLIT_GRID_SIZE        (1024)      /*the split histogram has buckets*grid_size entries*/
+#define JOIN_LMEM_RESERVED          (1024)      /*local memory not used by the hash table*/
+#define JOIN_MAX_TABLE_SIZE         (65536)     /*the kernel hash takes 16 bits*/
+
+/*partition a relation on its lowest bits radix bits*/
+static double join_partition(cl_mem d_keys, cl_mem d_values, int len, int bits, int local_size,
+                             cl_mem &d_part_keys, cl_mem &d_part_values, cl_mem &d_start,
+                             Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    cl_int status = 0;
+
+    auto t_beg = host_time_ns();
+    d_part_keys = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*len);
+    d_part_values = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*len);
+    d_start = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*(1<<bits));
+    prof_add_host(prof, "alloc partitions", t_beg);
+
+    /*WG_split goes hierarchical by itself if the fan-out exceeds the local memory*/
+    return WG_split(d_keys, d_part_keys, d_start, len, 1<<bits, NO_REORDER, KVS_SOA,
+                    d_values, d_part_values, local_size, JOIN_SPLIT_GRID_SIZE, prof);
+}
+
+/*
+ *  Partitioned hash join (equi-join on the keys)
+ *  Input:  1.Relation R                (d_R_keys, d_R_values, r_len), the build side
+ *          2.Relation S                (d_S_keys, d_S_values, s_len), the probe side
+ *  Output: 1.Join results as pairs     (d_out_R, d_out_S), the R and S values of each match
+ *          2.Number of results         (res_len)
+ *
+ *  The output buffers are allocated by the function (at least 1 element) and
+ *  should be released by the caller.
+ *
+ *  Both relations are split into partitions whose R side fits a local-memory
+ *  hash table. Partitions that exceed the local memory of a single split pass
+ *  are produced by the hierarchical WG_split. Results are materialized in
+ *  two phases: build_probe counts the matches of each partition pair, the counts
+ *  are scanned into output offsets, and build_probe writes the pairs.
+ *  Keys must not be JOIN_EMPTY_KEY.
+ * */
+double hash_join(cl_mem d_R_keys, cl_mem d_R_values, int r_len,
+                 cl_mem d_S_keys, cl_mem d_S_values, int s_len,
+                 cl_mem &d_out_R, cl_mem &d_out_S, int &res_len,
+                 int local_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+    double total_time = 0;
+    uint64_t t_beg;
+
+    /*largest hash table (keys and values) fitting in the local memory*/
+    int table_size = 1;
+    while ((uint64_t)table_size * 2 * 2 * sizeof(int) + JOIN_LMEM_RESERVED <= param.lmem_size &&
+           table_size < JOIN_MAX_TABLE_SIZE) table_size <<= 1;
+    int chunk_size = table_size / 2;
+
+    /*radix bits so that an R partition fits a single chunk on average*/
+    int total_bits = 1;
+    while (((uint64_t)r_len >> total_bits) > (uint64_t)chunk_size) total_bits++;
+    total_bits = std::min(total_bits, JOIN_MAX_RADIX_BITS);
+    int partitions = 1 << total_bits;
+    log_trace("Join: table_size=%d, radix bits=%d", table_size, total_bits);
+
+    /*1.partitioning*/
+    cl_mem d_R_part_keys, d_R_part_values, d_R_start;
+    cl_mem d_S_part_keys, d_S_part_values, d_S_start;
+    total_time += join_partition(d_R_keys, d_R_values, r_len, total_bits, local_size,
+                                 d_R_part_keys, d_R_part_values, d_R_start, prof);
+    total_time += join_partition(d_S_keys, d_S_values, s_len, total_bits, local_size,
+                                 d_S_part_keys, d_S_part_values, d_S_start, prof);
+
+    /*2.count the matches of each partition pair*/
+    char para_s[500] = {'\0'};
+    add_param(para_s, "TABLE_SIZE", true, table_size);
+    add_param(para_s, "RADIX_BITS", true, total_bits);
+
+    t_beg = host_time_ns();
+    char count_para_s[500] = {'\0'};
+    strcat(count_para_s, para_s);
+    add_param(count_para_s, "COUNT_ONLY", false);
+    cl_kernel count_kernel = get_kernel(param.device, param.context, "join_kernel.cl", "build_probe", count_para_s);
+    cl_kernel write_kernel = get_kernel(param.device, param.context, "join_kernel.cl", "build_probe", para_s);
+    prof_add_host(prof, "compile build_probe", t_beg);
+
+    t_beg = host_time_ns();
+    cl_mem d_counts = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*partitions);
+    cl_mem d_offsets = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*partitions);
+    prof_add_host(prof, "alloc counts", t_beg);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)local_size * partitions};   /*a work-group per partition pair*/
+
+    args_num = 0;
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_R_part_keys);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_R_part_values);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(int), &r_len);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_S_part_keys);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_S_part_values);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(int), &s_len);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_R_start);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_S_start);
+    status |= clSetKernelArg(count_kernel, args_num++, sizeof(cl_mem), &d_counts);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clEnqueueNDRangeKernel(param.queue, count_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+    clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time += clEventTime(event);
+    prof_add_kernel(prof, "build_probe (count)", event);
+
+    /*3.output offsets*/
+    total_time += scan_chained(d_counts, d_offsets, partitions, 64, std::max((int)param.cus-1, 1), 112, 0, prof);
+
+    int last_count, last_offset;
+    status = clEnqueueReadBuffer(param.queue, d_counts, CL_TRUE, sizeof(int)*(partitions-1), sizeof(int), &last_count, 0, 0, 0);
+    status |= clEnqueueReadBuffer(param.queue, d_offsets, CL_TRUE, sizeof(int)*(partitions-1), sizeof(int), &last_offset, 0, 0, 0);
+    checkErr(status, ERR_READ_BUFFER);
+    res_len = last_offset + last_count;
+
+    /*4.materialize the results*/
+    t_beg = host_time_ns();
+    d_out_R = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*std::max(res_len, 1));
+    d_out_S = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*std::max(res_len, 1));
+    prof_add_host(prof, "alloc results", t_beg);
+
+    args_num = 0;
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_R_part_keys);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_R_part_values);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(int), &r_len);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_S_part_keys);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_S_part_values);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(int), &s_len);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_R_start);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_S_start);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_offsets);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_out_R);
+    status |= clSetKernelArg(write_kernel, args_num++, sizeof(cl_mem), &d_out_S);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clEnqueueNDRangeKernel(param.queue, write_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+    clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time += clEventTime(event);
+    prof_add_kernel(prof, "build_probe (write)", event);
+
+    /*memory release*/
+    cl_mem_free(d_R_part_keys);
+    cl_mem_free(d_R_part_values);
+    cl_mem_free(d_R_start);
+    cl_mem_free(d_S_part_keys);
+    cl_mem_free(d_S_part_values);
+    cl_mem_free(d_S_start);
+    cl_mem_free(d_counts);
+    cl_mem_free(d_offsets);
+
+    return total_time;
+}
@@ -0,0 +1,118 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "../util/Plat.h"
+#include "log.h"
+using namespace std;
+
+/*launch one of the kernels of pack_kernel.cl, the arguments are set by the caller*/
+static double launch_pack_kernel(cl_kernel kernel, const char *kernel_name,
+                                 int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    cl_int status;
+    cl_event event;
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)(local_size * grid_size)};
+
+    status = clFinish(param.queue);
+    status = clEnqueueNDRangeKernel(param.queue, kernel, 1, 0, global_dim, local_dim, 0, nullptr, &event);
+    status = clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+
+    prof_add_kernel(prof, kernel_name, event);
+    return clEventTime(event);
+}
+
+static bool check_bits(int bits) {
+    if (bits < 1 || bits > 32) {
+        log_error("Wrong parameters: packed values of %d bits", bits);
+        return false;
+    }
+    return true;
+}
+
+/*
+ *  Bit packing of an int column
+ *  Input:  1.Column of length ints,    (d_in), only the low bits bits of each value are kept
+ *  Output: 1.Packed column             (d_out, packed_words(length, bits) words)
+ * */
+double pack_column(cl_mem d_in, cl_mem d_out, int length, int bits,
+                   int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    if (!check_bits(bits)) return -1;
+
+    cl_int status = 0;
+    int args_num = 0;
+    int num_words = packed_words(length, bits);
+
+    auto t_beg = host_time_ns();
+    cl_kernel pack_kernel = get_kernel(param.device, param.context, "pack_kernel.cl", "pack_column");
+    prof_add_host(prof, "compile pack_column", t_beg);
+
+    status |= clSetKernelArg(pack_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(pack_kernel, args_num++, sizeof(cl_mem), &d_out);
+    status |= clSetKernelArg(pack_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(pack_kernel, args_num++, sizeof(int), &bits);
+    status |= clSetKernelArg(pack_kernel, args_num++, sizeof(int), &num_words);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    return launch_pack_kernel(pack_kernel, "pack_column", local_size, grid_size, prof);
+}
+
+double unpack_column(cl_mem d_in, cl_mem d_out, int length, int bits,
+                     int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    if (!check_bits(bits)) return -1;
+
+    cl_int status = 0;
+    int args_num = 0;
+
+    auto t_beg = host_time_ns();
+    cl_kernel unpack_kernel = get_kernel(param.device, param.context, "pack_kernel.cl", "unpack_column");
+    prof_add_host(prof, "compile unpack_column", t_beg);
+
+    status |= clSetKernelArg(unpack_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(unpack_kernel, args_num++, sizeof(cl_mem), &d_out);
+    status |= clSetKernelArg(unpack_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(unpack_kernel, args_num++, sizeof(int), &bits);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    return launch_pack_kernel(unpack_kernel, "unpack_column", local_size, grid_size, prof);
+}
+
+/*
+ *  Gather from a packed column
+ *  Input:  1.Packed column,            (d_in, packed with bits bits)
+ *          2.Locations                 (d_loc, length ints)
+ *  Output: 1.d_in[d_loc[i]] at i       (d_out, length ints, or packed_words(length, bits)
+ *                                       words packed with bits bits if packed_out)
+ *
+ *  The random reads fall into bits/32 of the footprint of an int column, so
+ *  more of the input stays in the caches than with gather.
+ * */
+double gather_packed(cl_mem d_in, int bits, cl_mem d_out, int length, cl_mem d_loc,
+                     bool packed_out, int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    if (!check_bits(bits)) return -1;
+
+    cl_int status = 0;
+    int args_num = 0;
+    int num_words = packed_words(length, bits);
+    const char *kernel_name = packed_out ? "gather_packed_out" : "gather_packed";
+
+    auto t_beg = host_time_ns();
+    cl_kernel gather_kernel = get_kernel(param.device, param.context, "pack_kernel.cl", (char*)kernel_name);
+    prof_add_host(prof, "compile gather_packed", t_beg);
+
+    status |= clSetKernelArg(gather_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(gather_kernel, args_num++, sizeof(cl_mem), &d_out);
+    status |= clSetKernelArg(gather_kernel, args_num++, sizeof(cl_mem), &d_loc);
+    status |= clSetKernelArg(gather_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(gather_kernel, args_num++, sizeof(int), &bits);
+    if (packed_out) status |= clSetKernelArg(gather_kernel, args_num++, sizeof(int), &num_words);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    return launch_pack_kernel(gather_kernel, kernel_name, local_size, grid_size, prof);
+}
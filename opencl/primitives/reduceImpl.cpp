@@ -0,0 +1,94 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "../util/Plat.h"
+#include "log.h"
+using namespace std;
+
+#define REDUCE_WGS_PER_CU       (4)
+
+/*compilation macro of each element type and ReduceOp*/
+static const char *type_macro(cl_int)       { return "TYPE_INT"; }
+static const char *type_macro(cl_long)      { return "TYPE_LONG"; }
+static const char *type_macro(cl_float)     { return "TYPE_FLOAT"; }
+static const char *type_macro(cl_double)    { return "TYPE_DOUBLE"; }
+static const char *op_macros[] = {"REDUCE_SUM", "REDUCE_MIN", "REDUCE_MAX"};
+
+/*
+ *  Reduction
+ *  Input:  1.Array being reduced,      (d_in)
+ *          2.Array length,             (length)
+ *          3.Operator                  (op)
+ *  Output: 1.The reduction value       (res)
+ *
+ *  Single kernel: each WG reduces its grid-stride share and the last WG to
+ *  finish reduces the per-WG partials, so no second launch is needed.
+ *  REDUCE_COUNT does not touch the data.
+ * */
+template<typename T>
+double reduce(cl_mem d_in, int length, ReduceOp op, T &res,
+              int local_size, int grid_size, Profile *prof) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+    double total_time = 0;
+    cl_uint ticket_init = 0;
+    if (op == REDUCE_COUNT) {
+        res = (T)length;
+        return 0;
+    }
+    if (grid_size == 0) grid_size = param.cus * REDUCE_WGS_PER_CU;
+
+    char para_s[500] = {'\0'};
+    add_param(para_s, (char*)type_macro(res));
+    add_param(para_s, (char*)op_macros[op]);
+
+    auto t_beg = host_time_ns();
+    cl_kernel reduce_kernel = get_kernel(param.device, param.context, "reduce_kernel.cl", "reduce", para_s);
+    prof_add_host(prof, "compile reduce", t_beg);
+
+    t_beg = host_time_ns();
+    cl_mem d_partials = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(T)*grid_size);
+    cl_mem d_ticket = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(cl_uint));
+    cl_mem d_res = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(T));
+    status = clEnqueueFillBuffer(param.queue, d_ticket, &ticket_init, sizeof(cl_uint), 0, sizeof(cl_uint), 0, 0, 0);
+    checkErr(status, ERR_WRITE_BUFFER);
+    prof_add_host(prof, "alloc reduce", t_beg);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)(local_size * grid_size)};
+
+    args_num = 0;
+    status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(cl_mem), &d_partials);
+    status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(cl_mem), &d_ticket);
+    status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(cl_mem), &d_res);
+    status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(T)*local_size, nullptr);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clFinish(param.queue);
+    status = clEnqueueNDRangeKernel(param.queue, reduce_kernel, 1, 0, global_dim, local_dim, 0, nullptr, &event);
+    status = clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time = clEventTime(event);
+    prof_add_kernel(prof, "reduce", event);
+
+    status = clEnqueueReadBuffer(param.queue, d_res, CL_TRUE, 0, sizeof(T), &res, 0, 0, 0);
+    checkErr(status, ERR_READ_BUFFER);
+
+    cl_mem_free(d_partials);
+    cl_mem_free(d_ticket);
+    cl_mem_free(d_res);
+
+    return total_time;
+}
+
+template double reduce<cl_int>(cl_mem, int, ReduceOp, cl_int&, int, int, Profile*);
+template double reduce<cl_long>(cl_mem, int, ReduceOp, cl_long&, int, int, Profile*);
+template double reduce<cl_float>(cl_mem, int, ReduceOp, cl_float&, int, int, Profile*);
+template double reduce<cl_double>(cl_mem, int, ReduceOp, cl_double&, int, int, Profile*);
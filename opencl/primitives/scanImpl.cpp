@@ -8,14 +8,17 @@
 using namespace std;
 
 /*
+ *  Single-pass scan with decoupled look-back: the WGs take tiles from an
+ *  atomic counter, publish the tile aggregate and then the inclusive prefix,
+ *  and look back over a window of predecessors (see look_back).
  *  grid size should be equal to the # of computing units
  *  R: number of elements in registers in each work-item
  *  L: number of elememts in local memory
  */
-double
-scan_chained(cl_mem d_in, cl_mem d_out,
-             int length, int local_size,
-             int grid_size, int R, int L) {
+static double
+scan_chained_impl(cl_mem d_in, cl_mem d_out,
+                  int length, int local_size,
+                  int grid_size, int R, int L, int packed_bits, Profile *prof) {
     if (R==0 && L==0) {
         log_error("Parameter error. R and L can not be 0 at the same time");
         return 1;
@@ -27,18 +30,24 @@ scan_chained(cl_mem d_in, cl_mem d_out,
     cl_int status = 0;
     int args_num = 0;
     char extra_flags[500] = "\0"; //extra flages
-    int val_invalid = SCAN_INTER_INVALID;
+    int zero = 0;
     int tile_size = local_size * (R + L);
     int num_tiles = (length + tile_size - 1) / tile_size;
     auto lo_size = (R == 0) ? L*local_size : (L+1)*local_size; //intermediate memory size
     auto local_mem_size = std::max(lo_size, local_size*R); //actual memory size
 
     sprintf(extra_flags, "-DREGISTERS=%d", (R==0) ? 1 : R); //specify the REGISTERS macro
+    if (packed_bits != 0) add_param(extra_flags, (char*)"PACKED_BITS", true, packed_bits);
+    auto t_beg = host_time_ns();
     cl_kernel chain_scan_kernel = get_kernel(param.device, param.context, "scan_global_chain_kernel.cl", "scan", extra_flags);
+    prof_add_host(prof, "compile scan_chained", t_beg);
 
-    cl_mem d_inter = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int)* num_tiles, nullptr, &status);
-    status = clEnqueueFillBuffer(param.queue, d_inter, &val_invalid, sizeof(int), 0, sizeof(int)*num_tiles, 0, 0, 0);
+    t_beg = host_time_ns();
+    int status_len = SCAN_STATUS_INTS * num_tiles + 1;     /*tile status and the tile counter*/
+    cl_mem d_inter = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*status_len);
+    status = clEnqueueFillBuffer(param.queue, d_inter, &zero, sizeof(int), 0, sizeof(int)*status_len, 0, 0, 0);
     checkErr(status, ERR_WRITE_BUFFER);
+    prof_add_host(prof, "alloc scan_chained", t_beg);
 
     size_t local_dim[1] = {(size_t)local_size};
     size_t global_dim[1] = {(size_t)(local_size * grid_size)};
@@ -59,14 +68,77 @@ scan_chained(cl_mem d_in, cl_mem d_out,
     status = clFinish(param.queue);
     checkErr(status, ERR_EXEC_KERNEL);
     totalTime = clEventTime(event);
+    prof_add_kernel(prof, "scan_chained", event);
 
-    clReleaseMemObject(d_inter);
+    cl_mem_free(d_inter);
 
     return totalTime;
 }
 
+double
+scan_chained(cl_mem d_in, cl_mem d_out,
+             int length, int local_size,
+             int grid_size, int R, int L, Profile *prof) {
+    return scan_chained_impl(d_in, d_out, length, local_size, grid_size, R, L, 0, prof);
+}
+
+/*scan_chained of a column bit-packed with bits bits, the WIs unpack the values they load*/
+double
+scan_packed(cl_mem d_in, int bits, cl_mem d_out,
+            int length, int local_size,
+            int grid_size, int R, int L, Profile *prof) {
+    if (bits < 1 || bits > 32) {
+        log_error("Wrong parameters: packed values of %d bits", bits);
+        return -1;
+    }
+    return scan_chained_impl(d_in, d_out, length, local_size, grid_size, R, L, bits, prof);
+}
+
+/*
+ *  Batched exclusive scan of many independent segments in one launch
+ *  d_offsets: start of each of the num_segments segments, the last one ends at length
+ *  R: elements per work-item in a tile
+ *  grid_size = 0: a WG per segment
+ */
+double scan_batched(cl_mem d_in, cl_mem d_out, cl_mem d_offsets,
+                    int num_segments, int length, int local_size,
+                    int grid_size, int R, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+
+    cl_event event;
+    cl_int status = 0;
+    int args_num = 0;
+    char extra_flags[500] = "\0";
+    if (num_segments == 0) return 0;    /*no WG to launch*/
+    if ((grid_size == 0) || (grid_size > num_segments)) grid_size = num_segments;
+
+    sprintf(extra_flags, "-DREGISTERS=%d", R);
+    auto t_beg = host_time_ns();
+    cl_kernel batched_kernel = get_kernel(param.device, param.context, "scan_global_chain_kernel.cl", "scan_batched", extra_flags);
+    prof_add_host(prof, "compile scan_batched", t_beg);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)(local_size * grid_size)};
+
+    status |= clSetKernelArg(batched_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(batched_kernel, args_num++, sizeof(cl_mem), &d_out);
+    status |= clSetKernelArg(batched_kernel, args_num++, sizeof(cl_mem), &d_offsets);
+    status |= clSetKernelArg(batched_kernel, args_num++, sizeof(int), &num_segments);
+    status |= clSetKernelArg(batched_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(batched_kernel, args_num++, sizeof(int)*local_size*R, nullptr);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clFinish(param.queue);
+    status = clEnqueueNDRangeKernel(param.queue, batched_kernel, 1, 0, global_dim, local_dim, 0, nullptr, &event);
+    status = clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    prof_add_kernel(prof, "scan_batched", event);
+
+    return clEventTime(event);
+}
+
 /* Ruduce-Scan-Scan scheme for GPUs*/
-double scan_RSS(cl_mem d_in, cl_mem d_out, unsigned length, int local_size, int grid_size) {
+double scan_RSS(cl_mem d_in, cl_mem d_out, unsigned length, int local_size, int grid_size, Profile *prof) {
     log_trace("Function: %s", __FUNCTION__);
     device_param_t param = Plat::get_device_param();
 
@@ -90,12 +162,14 @@ double scan_RSS(cl_mem d_in, cl_mem d_out, unsigned length, int local_size, int
     add_param(param_str, "MAX_NUM_REGS", true, max_reg_per_WI);
 
     /*--------------- Step 1: reduce ---------------*/
+    auto t_beg = host_time_ns();
     cl_kernel reduce_kernel = get_kernel(param.device, param.context, "scan_global_RSS_kernel.cl", "reduce", param_str);
+    prof_add_host(prof, "compile RSS_reduce", t_beg);
 
     size_t reduce_local[1] = {(size_t)local_size};
     size_t reduce_global[1] = {(size_t)(global_size)};
 
-    cl_mem d_reduction = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int)*grid_size, nullptr, &status);
+    cl_mem d_reduction = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*grid_size);
 
     args_num = 0;
     status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(cl_mem), &d_in);
@@ -110,9 +184,12 @@ double scan_RSS(cl_mem d_in, cl_mem d_out, unsigned length, int local_size, int
     clFinish(param.queue);
     double reduce_time = clEventTime(event);
     totalTime += reduce_time;
+    prof_add_kernel(prof, "RSS_reduce", event);
 
     /*--------------- Step 2: scan ---------------*/
+    t_beg = host_time_ns();
     cl_kernel scan_small_kernel = get_kernel(param.device, param.context, "scan_global_RSS_kernel.cl", "scan_exclusive_small", param_str); //still need extra paras
+    prof_add_host(prof, "compile RSS_scan_small", t_beg);
 
     size_t scan_small_local[1] = {(size_t)local_size};
     size_t scan_small_global[1] = {(size_t)(local_size*1)};
@@ -131,9 +208,12 @@ double scan_RSS(cl_mem d_in, cl_mem d_out, unsigned length, int local_size, int
 
     double scan_small_time = clEventTime(event);
     totalTime += scan_small_time;
+    prof_add_kernel(prof, "RSS_scan_small", event);
 
     /*--------------- Step 3: final scan ---------------*/
+    t_beg = host_time_ns();
     cl_kernel scan_kernel = get_kernel(param.device, param.context, "scan_global_RSS_kernel.cl", "scan_exclusive", param_str);
+    prof_add_host(prof, "compile RSS_scan", t_beg);
 
     size_t scan_local[1] = {(size_t)local_size};
     size_t scan_global[1] = {(size_t)(local_size*grid_size)};
@@ -153,14 +233,15 @@ double scan_RSS(cl_mem d_in, cl_mem d_out, unsigned length, int local_size, int
     status = clFinish(param.queue);
     double scan_time = clEventTime(event);
     totalTime += scan_time;
+    prof_add_kernel(prof, "RSS_scan", event);
 
-    clReleaseMemObject(d_reduction);
+    cl_mem_free(d_reduction);
 
     return totalTime;
 }
 
 /*single-thread RSS scan for CPUs and MICs*/
-double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length) {
+double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length, Profile *prof) {
     device_param_t param = Plat::get_device_param();
     int grid_size = 1024;           /*this does not matter*/
     int local_size = 1;             /*single-work-item*/
@@ -172,12 +253,14 @@ double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length) {
     int args_num = 0;
 
     /*--------------- Step 1: reduce ---------------*/
+    auto t_beg = host_time_ns();
     cl_kernel reduce_kernel = get_kernel(param.device, param.context, "scan_global_RSS_single_kernel.cl", "reduce");
+    prof_add_host(prof, "compile RSS_single_reduce", t_beg);
 
     size_t local_dim[1] = {(size_t)local_size};
     size_t global_dim[1] = {(size_t)(local_size*grid_size)};
 
-    cl_mem d_reduction = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int)*grid_size, nullptr, &status);
+    cl_mem d_reduction = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*grid_size);
 
     args_num = 0;
     status |= clSetKernelArg(reduce_kernel, args_num++, sizeof(cl_mem), &d_in);
@@ -192,9 +275,12 @@ double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length) {
     checkErr(status, ERR_EXEC_KERNEL);
     double reduce_time = clEventTime(event);
     totalTime += reduce_time;
+    prof_add_kernel(prof, "RSS_single_reduce", event);
 
     /*--------------- Step 2: scan ---------------*/
+    t_beg = host_time_ns();
     cl_kernel scan_small_kernel = get_kernel(param.device, param.context, "scan_global_RSS_single_kernel.cl", "scan_small"); //still need extra paras
+    prof_add_host(prof, "compile RSS_single_scan_small", t_beg);
 
     size_t small_local[1] = {(size_t)(1)};
     size_t small_global[1] = {(size_t)(1)};
@@ -210,9 +296,12 @@ double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length) {
     checkErr(status, ERR_EXEC_KERNEL);
     double scan_small_time = clEventTime(event);
     totalTime += scan_small_time;
+    prof_add_kernel(prof, "RSS_single_scan_small", event);
 
     /*--------------- Step 3: final scan ---------------*/
+    t_beg = host_time_ns();
     cl_kernel scan_kernel = get_kernel(param.device, param.context, "scan_global_RSS_single_kernel.cl", "scan_exclusive");
+    prof_add_host(prof, "compile RSS_single_scan", t_beg);
 
     args_num = 0;
     status |= clSetKernelArg(scan_kernel, args_num++, sizeof(cl_mem), &d_in);
@@ -229,8 +318,9 @@ double scan_RSS_single(cl_mem d_in, cl_mem d_out, unsigned length) {
 
     double scan_time = clEventTime(event);
     totalTime += scan_time;
+    prof_add_kernel(prof, "RSS_single_scan", event);
 
-    clReleaseMemObject(d_reduction);
+    cl_mem_free(d_reduction);
 
     return totalTime;
 }
@@ -3,10 +3,13 @@
 //  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
 //
 
+#include <algorithm>
+#include <cstring>
 #include "../util/Plat.h"
+#include "log.h"
 using namespace std;
 
-double scatter(cl_mem d_in, cl_mem d_out, int length, cl_mem d_loc, int localSize, int gridSize, int pass) {
+double scatter(cl_mem d_in, cl_mem d_out, int length, cl_mem d_loc, int localSize, int gridSize, int pass, Profile *prof) {
     device_param_t param = Plat::get_device_param();
 
     cl_event event;
@@ -15,7 +18,9 @@ double scatter(cl_mem d_in, cl_mem d_out, int length, cl_mem d_loc, int localSiz
     int argsNum = 0;
 
     //kernel reading
+    auto t_beg = host_time_ns();
     cl_kernel scatterKernel = get_kernel(param.device, param.context, "scatter_kernel.cl", "scatter");
+    prof_add_host(prof, "compile scatter", t_beg);
 
     //set kernel arguments
     int globalSize = gridSize * localSize;
@@ -49,6 +54,78 @@ double scatter(cl_mem d_in, cl_mem d_out, int length, cl_mem d_loc, int localSiz
         checkErr(status, ERR_EXEC_KERNEL);
 
         totalTime += clEventTime(event);
+        prof_add_kernel(prof, "scatter", event);
     }
     return totalTime;
 }
+
+/*
+ *  Multi-column scatter: d_in[i] of column c goes to d_out[d_loc[i]], for every column
+ *  Columns of 4 and 8 bytes are moved COLUMNS_PER_LAUNCH at a time, so d_loc
+ *  is read once per launch instead of once per column.
+ * */
+double scatter_columns(const column_t *columns, int num_columns,
+                      int length, cl_mem d_loc,
+                      int local_size, int grid_size, int pass, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+
+    cl_event event;
+    double total_time = 0;
+    cl_int status = 0;
+
+    for(int c = 0; c < num_columns; c++) {
+        if (columns[c].width != sizeof(int) && columns[c].width != sizeof(cl_int2)) {
+            log_error("Wrong parameters: column %d has %d-byte elements", c, columns[c].width);
+            return -1;
+        }
+    }
+
+    int global_size = grid_size * local_size;
+    int ele_per_thread = (length + global_size - 1) / global_size;
+    int len_per_run = (length + pass - 1) / pass;
+    size_t local[1] = {(size_t)local_size};
+    size_t global[1] = {(size_t)global_size};
+
+    for(int first = 0; first < num_columns; first += COLUMNS_PER_LAUNCH) {
+        int launch_columns = std::min(num_columns - first, COLUMNS_PER_LAUNCH);
+
+        /*the element type of each column is a compilation parameter*/
+        char para_s[500] = {'\0'};
+        for(int c = 0; c < launch_columns; c++) {
+            char macro[32];
+            sprintf(macro, " -DCOL_TYPE_%d=%s ", c, (columns[first+c].width == sizeof(int)) ? "int" : "int2");
+            strcat(para_s, macro);
+        }
+        auto t_beg = host_time_ns();
+        cl_kernel scatter_kernel = get_kernel(param.device, param.context, "scatter_kernel.cl", "scatter_columns", para_s);
+        prof_add_host(prof, "compile scatter_columns", t_beg);
+
+        int args_num = 0;
+        status |= clSetKernelArg(scatter_kernel, args_num++, sizeof(cl_mem), &d_loc);
+        status |= clSetKernelArg(scatter_kernel, args_num++, sizeof(int), &length);
+        status |= clSetKernelArg(scatter_kernel, args_num++, sizeof(int), &ele_per_thread);
+        args_num += 2;  /*from and to*/
+        for(int c = 0; c < launch_columns; c++) {
+            status |= clSetKernelArg(scatter_kernel, args_num++, sizeof(cl_mem), &columns[first+c].d_in);
+            status |= clSetKernelArg(scatter_kernel, args_num++, sizeof(cl_mem), &columns[first+c].d_out);
+        }
+        checkErr(status, ERR_SET_ARGUMENTS);
+
+        //multi-pass kernel
+        for(int i = 0; i < pass; i++) {
+            int from = i * len_per_run;
+            int to = (i+1) * len_per_run;
+            status |= clSetKernelArg(scatter_kernel, 3, sizeof(int), &from);
+            status |= clSetKernelArg(scatter_kernel, 4, sizeof(int), &to);
+            checkErr(status, ERR_SET_ARGUMENTS);
+
+            status = clEnqueueNDRangeKernel(param.queue, scatter_kernel, 1, 0, global, local, 0, 0, &event);
+            status |= clFinish(param.queue);
+            checkErr(status, ERR_EXEC_KERNEL);
+
+            total_time += clEventTime(event);
+            prof_add_kernel(prof, "scatter_columns", event);
+        }
+    }
+    return total_time;
+}
@@ -2,10 +2,17 @@
 //  Created by Zhuohang Lai on 4/7/15.
 //  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
 //
+#include <algorithm>
 #include "../util/Plat.h"
 #include "log.h"
 using namespace std;
 
+#define SPLIT_SAMPLE_BLOCKS         (16)        /*sampled blocks of contiguous keys for the heavy hitters*/
+#define SPLIT_SAMPLE_BLOCK_LEN      (256)
+#define SPLIT_HEAVY_RATIO           (64)        /*heavy hitters hold at least 1/64 of the sample*/
+#define SPLIT_LMEM_RESERVED         (1024)      /*local memory used by the runtime*/
+#define SPLIT_MAX_BUCKETS           (1<<20)     /*largest fan-out of the hierarchical split*/
+
 /*
  *  WI-level partitioning (Each WI owns a private histogram)
  *  Input:  1.Table being partitioned,  (d_in, d_in_values)
@@ -22,7 +29,7 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
                 int length, int buckets,
                 DataStruc structure,
                 cl_mem d_in_values, cl_mem d_out_values,
-                int local_size, int grid_size) {
+                int local_size, int grid_size, Profile *prof) {
     device_param_t param = Plat::get_device_param();
 
     /*check the value setting*/
@@ -44,9 +51,17 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
         }
     }
 
+    /*private histograms do not fit in the local memory, use the shared ones*/
+    if ((uint64_t)sizeof(int) * buckets * local_size > param.lmem_size - SPLIT_LMEM_RESERVED) {
+        log_trace("WI_split: private histograms exceed the local memory, use WG_split");
+        return WG_split(d_in, d_out, d_start, length, buckets, NO_REORDER, structure,
+                        d_in_values, d_out_values, local_size, grid_size, prof);
+    }
+
     cl_int status = 0;
     cl_event event;
     int argsNum = 0;
+    uint64_t t_beg;
 
     cl_kernel histogram_kernel, gather_his_kernel, shuffle_kernel;
     cl_mem d_his=0;
@@ -65,7 +80,9 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
 
     /*1.histogram*/
     //kernel reading
+    t_beg = host_time_ns();
     histogram_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WI_histogram", para_s);
+    prof_add_host(prof, "compile WI_histogram", t_beg);
 
     //check whether the histogram can be placed in the global memory (at most 2^32 Bytes)
 //    long limit = 1<<32;
@@ -73,8 +90,9 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
 
     /*hostogram allocation*/
     unsigned long his_len = buckets*global_size;
-    d_his = clCreateBuffer(param.context, CL_MEM_READ_WRITE, his_len*sizeof(int), nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
+    t_beg = host_time_ns();
+    d_his = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, his_len*sizeof(int));
+    prof_add_host(prof, "alloc histogram", t_beg);
 
     //set kernel arguments
     argsNum = 0;
@@ -91,15 +109,18 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
 
     histogram_time = clEventTime(event);
     total_time += histogram_time;
+    prof_add_kernel(prof, "WI_histogram", event);
 
     /*2.scan*/
 //    double scanTime = scan_chained(d_his_in, d_his_out, his_len, info, 1024, 15, 0, 11);
-    scan_time = scan_chained(d_his, d_his, his_len, 64, 39, 112, 0);
+    scan_time = scan_chained(d_his, d_his, his_len, 64, 39, 112, 0, prof);
     total_time += scan_time;
 
     /*2.5 gather the start position (optional)*/
     if (d_start != 0) {
+        t_beg = host_time_ns();
         gather_his_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "gatherStartPos", para_s);
+        prof_add_host(prof, "compile gatherStartPos", t_beg);
         argsNum = 0;
         status |= clSetKernelArg(gather_his_kernel, argsNum++, sizeof(cl_mem), &d_his);
         status |= clSetKernelArg(gather_his_kernel, argsNum++, sizeof(int), &his_len);
@@ -111,10 +132,13 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
         status = clFinish(param.queue);
         gather_time = clEventTime(event);
         total_time += gather_time;
+        prof_add_kernel(prof, "gatherStartPos", event);
     }
 
     /*3.shuffle*/
+    t_beg = host_time_ns();
     shuffle_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WI_shuffle", para_s);
+    prof_add_host(prof, "compile WI_shuffle", t_beg);
 
     argsNum = 0;
     status |= clSetKernelArg(shuffle_kernel, argsNum++, sizeof(cl_mem), &d_in);
@@ -134,35 +158,30 @@ double WI_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
     checkErr(status, ERR_EXEC_KERNEL);
     shuffle_time = clEventTime(event);
     total_time += shuffle_time;
+    prof_add_kernel(prof, "WI_shuffle", event);
 
-    clReleaseMemObject(d_his);
+    cl_mem_free(d_his);
     checkErr(status, ERR_EXEC_KERNEL);
 
     return total_time;
 }
 
 /*
- *  WG-level partitioning (WIs in a WG share a histogram)
- *  Input:  1.Table being partitioned,  (d_in, d_in_values)
- *          2.Table cadinality,         (length)
- *          3.Buckets                   (buckets)
- *  Output: 1.Partitioned table         (d_out, d_out_values)
- *          2.Array recording the start position of each bucket in the table (d_start)
- *
- *  If DataStruc is SOA, then d_in represents the input keys.
- *  If DataStruc is AOS, then d_in represents the input tuples, and the d_in_values, d_out_values shoule be set to 0
- *
- *  Reorder:
- *      reorder = NO_REORDER: no reorder;
- *      reorder = FIXED_REORDER: with fixed-length reorder buffers  (lsize must be 1)
- *      reorder = VARIED_REORDER: with varied-length reorder buffers
- *
-*/
-double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
-                int length, int buckets, ReorderType reorder_type,
-                DataStruc structure,
-                cl_mem d_in_values, cl_mem d_out_values,
-                int local_size, int grid_size) {
+ * single WG-level pass on the digit (key >> key_shift) & (buckets-1), see WG_split
+ * d_his_known: histogram of this pass counted by the previous one (consumed), 0 to count it here
+ * d_his_next:  if set, the shuffle also counts the digit (key >> next_shift) & (next_buckets-1)
+ *              of the output in the WG_histogram layout, without reordering only
+ * packed_bits: if set, d_in is a key column bit-packed with packed_bits bits, without reordering only
+ * const_buckets: compile buckets into WG_histogram and WG_shuffle (-DBUCKETS), without reordering only
+ * */
+static double WG_split_pass(cl_mem d_in, cl_mem d_out, cl_mem d_start,
+                            int length, int buckets, int key_shift, ReorderType reorder_type,
+                            DataStruc structure,
+                            cl_mem d_in_values, cl_mem d_out_values,
+                            int local_size, int grid_size, Profile *prof,
+                            cl_mem d_his_known=0, cl_mem d_his_next=0,
+                            int next_shift=0, int next_buckets=0, int packed_bits=0,
+                            bool const_buckets=false) {
     device_param_t param = Plat::get_device_param();
     uint64_t cus = param.cus;
 
@@ -193,18 +212,18 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
     cl_int status = 0;
     cl_event event;
     int args_num = 0;
+    uint64_t t_beg;
 
     /*set the compilation paramters. Each kernel in the kernel file should be compilted with this parameter*/
     char para_s[500] = {'\0'};
     if (structure == KO)            strcat(para_s, " -DKO ");
     else if (structure == KVS_SOA)  strcat(para_s, " -DKVS_SOA ");
     else if (structure == KVS_AOS)  strcat(para_s, " -DKVS_AOS ");
-
-//    checkLocalMemOverflow(sizeof(int) * buckets);    //this small, because of using atomic add
+    add_param(para_s, "KEY_SHIFT", true, key_shift);
+    if (packed_bits != 0) add_param(para_s, "PACKED_BITS", true, packed_bits);
+    if (const_buckets) add_param(para_s, "BUCKETS", true, buckets);
 
     cl_kernel histogram_kernel, shuffle_kernel, gather_his_kernel;
-    int *h_global_buffer_int = nullptr, *h_global_buffer_int_values=nullptr;
-    tuple_t *h_global_buffer_tuple = nullptr;
     cl_mem d_his=0, d_his_origin=0, d_global_buffer=0, d_global_buffer_values=0;
     double histogram_time, gather_time, scan_time, shuffle_time, total_time = 0;
 
@@ -218,46 +237,57 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
     size_t local_dim[1] = {(size_t) local_size};
     size_t global_dim[1] = {(size_t) global_size};
 
-    /*1.histogram*/
-    histogram_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_histogram", para_s);
+    /*1.histogram, unless counted by the previous pass*/
     int his_len = buckets * grid_size;
-    d_his = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int) * his_len, nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
+    if (d_his_known != 0) d_his = d_his_known;
+    else {
+        t_beg = host_time_ns();
+        histogram_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_histogram", para_s);
+        prof_add_host(prof, "compile WG_histogram", t_beg);
 
-    //set kernel arguments
-    args_num = 0;
-    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_in);
-    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &length);
-    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_his);
-    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int) * buckets, nullptr);
-    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &buckets);
-    checkErr(status, ERR_SET_ARGUMENTS);
+        t_beg = host_time_ns();
+        d_his = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int) * his_len);
+        prof_add_host(prof, "alloc histogram", t_beg);
 
-    status = clEnqueueNDRangeKernel(param.queue, histogram_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
-    clFinish(param.queue);
-    checkErr(status, ERR_EXEC_KERNEL);
-    histogram_time = clEventTime(event);
-    total_time += histogram_time;
+        //set kernel arguments
+        args_num = 0;
+        status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_in);
+        status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &length);
+        status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_his);
+        status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int) * buckets, nullptr);
+        status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &buckets);
+        checkErr(status, ERR_SET_ARGUMENTS);
+
+        status = clEnqueueNDRangeKernel(param.queue, histogram_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+        clFinish(param.queue);
+        checkErr(status, ERR_EXEC_KERNEL);
+        histogram_time = clEventTime(event);
+        total_time += histogram_time;
+        prof_add_kernel(prof, "WG_histogram", event);
+    }
 
     //copy the global histogram before scan
     if (reorder_type == VARIED_REORDER) {
-        d_his_origin = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int) * his_len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
+        t_beg = host_time_ns();
+        d_his_origin = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int) * his_len);
         status = clEnqueueCopyBuffer(param.queue, d_his, d_his_origin, 0, 0, sizeof(int) * his_len, 0, 0, 0);
         checkErr(status, ERR_EXEC_KERNEL);
         status = clFinish(param.queue);
+        prof_add_host(prof, "copy histogram", t_beg);
     }
 
     /*2.scan*/
 //      scan_time = scan_chained(d_his, d_his, his_len, 1024, cus, 0, 11);
-    scan_time = scan_chained(d_his, d_his, his_len, 64, cus-1, 112, 0);
+    scan_time = scan_chained(d_his, d_his, his_len, 64, cus-1, 112, 0, prof);
 //    scan_time = scan_chained(d_his, d_his, his_len, 64, 240, 33, 0);
 
     total_time += scan_time;
 
     /*2.5 gather the start position (optional)*/
     if (d_start != nullptr) {
+        t_beg = host_time_ns();
         gather_his_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "gatherStartPos", para_s);
+        prof_add_host(prof, "compile gatherStartPos", t_beg);
         args_num = 0;
         status |= clSetKernelArg(gather_his_kernel, args_num++, sizeof(cl_mem), &d_his);
         status |= clSetKernelArg(gather_his_kernel, args_num++, sizeof(int), &his_len);
@@ -269,9 +299,15 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
         status = clFinish(param.queue);
         gather_time = clEventTime(event);
         total_time += gather_time;
+        prof_add_kernel(prof, "gatherStartPos", event);
     }
 
     /*3.shuffle*/
+    if (d_his_next != 0) {
+        add_param(para_s, "NEXT_HIS");
+        add_param(para_s, "NEXT_KEY_SHIFT", true, next_shift);
+    }
+    t_beg = host_time_ns();
     if (reorder_type == FIXED_REORDER) {
         strcat(para_s, "-DCACHELINE_SIZE=");
         char cacheline_size_str[20];
@@ -282,6 +318,7 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
     else if (reorder_type == VARIED_REORDER)
         shuffle_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_shuffle_varied", para_s);
     else shuffle_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_shuffle", para_s);
+    prof_add_host(prof, "compile WG_shuffle", t_beg);
 
     args_num = 0;
     status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_in);
@@ -295,7 +332,18 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
     status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_his);
     status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int) * (buckets+1), nullptr);
 
-    if (reorder_type == VARIED_REORDER) {           /*varied-length reorder buffers*/
+    if (d_his_next != 0) {      /*the next pass reads (length+global_size-1)/global_size tuples per WI*/
+        int zero = 0;
+        int next_chunk = local_size * ((length + global_size - 1) / global_size);
+        status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_his_next);
+        status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int), &next_buckets);
+        status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int), &next_chunk);
+        checkErr(status, ERR_SET_ARGUMENTS);
+        status = clEnqueueFillBuffer(param.queue, d_his_next, &zero, sizeof(int), 0,
+                                     sizeof(int) * next_buckets * grid_size, 0, 0, 0);
+        checkErr(status, ERR_WRITE_BUFFER);
+    }
+    else if (reorder_type == VARIED_REORDER) {           /*varied-length reorder buffers*/
         status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_his_origin);
         if (structure == KVS_AOS)
             status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(tuple_t) * local_buffer_len, nullptr);
@@ -306,31 +354,30 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
         }
     }
     else if (reorder_type == FIXED_REORDER) {       /*fixed-length reorder buffers*/
-        /*alignment buffers*/
+        /*alignment buffers, kept in host memory on host-unified devices*/
+        t_beg = host_time_ns();
         if (structure == KVS_AOS) {
             ele_per_cacheline = cacheline_size / sizeof(tuple_t);
-            h_global_buffer_tuple = (tuple_t*)_mm_malloc(sizeof(tuple_t)*ele_per_cacheline*buckets*grid_size, cacheline_size);
-            d_global_buffer = clCreateBuffer(param.context, CL_MEM_USE_HOST_PTR| CL_MEM_READ_WRITE, sizeof(tuple_t)*ele_per_cacheline*buckets*grid_size, h_global_buffer_tuple, &status);
-            checkErr(status, ERR_HOST_ALLOCATION);
-
+            d_global_buffer = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE,
+                                            sizeof(tuple_t)*ele_per_cacheline*buckets*grid_size,
+                                            nullptr, param.host_unified);
             status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_global_buffer);
         }
         else {
             ele_per_cacheline = cacheline_size / sizeof(int);
-            h_global_buffer_int = (int*)_mm_malloc(sizeof(int)*ele_per_cacheline*buckets*grid_size, cacheline_size);
-            d_global_buffer = clCreateBuffer(param.context, CL_MEM_USE_HOST_PTR| CL_MEM_READ_WRITE, sizeof(int)*ele_per_cacheline*buckets*grid_size, h_global_buffer_int, &status);
-            checkErr(status, ERR_HOST_ALLOCATION);
-
+            d_global_buffer = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE,
+                                            sizeof(int)*ele_per_cacheline*buckets*grid_size,
+                                            nullptr, param.host_unified);
             status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_global_buffer);
 
             if (structure == KVS_SOA) {     /*buffer for values */
-                h_global_buffer_int_values = (int *) _mm_malloc(sizeof(int) * ele_per_cacheline * buckets * grid_size, cacheline_size);
-                d_global_buffer_values = clCreateBuffer(param.context, CL_MEM_USE_HOST_PTR| CL_MEM_READ_WRITE, sizeof(int)*ele_per_cacheline*buckets*grid_size, h_global_buffer_int_values, &status);
-                checkErr(status, ERR_HOST_ALLOCATION);
-
+                d_global_buffer_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE,
+                                                       sizeof(int)*ele_per_cacheline*buckets*grid_size,
+                                                       nullptr, param.host_unified);
                 status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_global_buffer_values);
             }
         }
+        prof_add_host(prof, "alloc reorder buffers", t_beg);
     }
     checkErr(status, ERR_SET_ARGUMENTS);
 
@@ -339,16 +386,517 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
     checkErr(status, ERR_EXEC_KERNEL);
     shuffle_time = clEventTime(event);
     total_time += shuffle_time;
+    prof_add_kernel(prof, "WG_shuffle", event);
 
     /*memory release*/
     cl_mem_free(d_his_origin);
-    cl_mem_free(d_his);
+    if (d_his != d_his_known) cl_mem_free(d_his);
     cl_mem_free(d_global_buffer);
     cl_mem_free(d_global_buffer_values);
 
-    if (h_global_buffer_int)            _mm_free(h_global_buffer_int);
-    if (h_global_buffer_int_values)     _mm_free(h_global_buffer_int_values);
-    if (h_global_buffer_tuple)          _mm_free(h_global_buffer_tuple);
+    return total_time;
+}
+
+/*split each segment of d_in on (key >> shift) & (buckets-1), the WGs loop over the segments*/
+static double split_segmented(cl_mem d_in, cl_mem d_out, cl_mem d_in_values, cl_mem d_out_values,
+                              DataStruc structure, cl_mem d_start_in, int segments,
+                              int length, int shift, int buckets, cl_mem d_start_out,
+                              int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+
+    char para_s[500] = {'\0'};
+    if (structure == KO)            strcat(para_s, " -DKO ");
+    else if (structure == KVS_SOA)  strcat(para_s, " -DKVS_SOA ");
+    else if (structure == KVS_AOS)  strcat(para_s, " -DKVS_AOS ");
+
+    auto t_beg = host_time_ns();
+    cl_kernel segmented_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_split_segmented", para_s);
+    prof_add_host(prof, "compile WG_split_segmented", t_beg);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)local_size * grid_size};
+
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(cl_mem), &d_out);
+    if (structure == KVS_SOA) {
+        status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(cl_mem), &d_in_values);
+        status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(cl_mem), &d_out_values);
+    }
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(cl_mem), &d_start_in);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(int), &segments);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(int), &shift);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(int), &buckets);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(cl_mem), &d_start_out);
+    status |= clSetKernelArg(segmented_kernel, args_num++, sizeof(int)*buckets, nullptr);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clEnqueueNDRangeKernel(param.queue, segmented_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+    clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    prof_add_kernel(prof, "WG_split_segmented", event);
+    return clEventTime(event);
+}
+
+/*
+ *  Two-level split for bucket counts whose histogram does not fit in the local
+ *  memory: a coarse WG pass on the high bits of the bucket ID, then a segmented
+ *  pass on the low fine_bits bits inside each coarse bucket. Bucket
+ *  c*2^fine_bits+f is coarse bucket c, sub-bucket f, so the output and d_start
+ *  are the same as those of a single pass. The segmented pass runs a WG per
+ *  coarse bucket, so the two levels should take about half of the bits each.
+ * */
+static double WG_split_hierarchical(cl_mem d_in, cl_mem d_out, cl_mem d_start,
+                                    int length, int buckets, int fine_bits,
+                                    DataStruc structure,
+                                    cl_mem d_in_values, cl_mem d_out_values,
+                                    int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    cl_int status = 0;
+    double total_time = 0;
+    int fine_buckets = 1 << fine_bits;
+    int coarse_buckets = buckets >> fine_bits;
+    size_t ele_size = (structure == KVS_AOS) ? sizeof(tuple_t) : sizeof(int);
+    log_trace("Hierarchical split: %d coarse buckets, %d fine buckets", coarse_buckets, fine_buckets);
+
+    auto t_beg = host_time_ns();
+    cl_mem d_coarse = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, ele_size*length);
+    cl_mem d_coarse_values = 0, d_start_out = d_start;
+    if (structure == KVS_SOA) {
+        d_coarse_values = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*length);
+    }
+    cl_mem d_coarse_start = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*coarse_buckets);
+    if (d_start_out == 0) {
+        d_start_out = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*buckets);
+    }
+    prof_add_host(prof, "alloc hierarchical split", t_beg);
+
+    total_time += WG_split_pass(d_in, d_coarse, d_coarse_start, length, coarse_buckets, fine_bits, NO_REORDER,
+                                structure, d_in_values, d_coarse_values, local_size, grid_size, prof);
+    total_time += split_segmented(d_coarse, d_out, d_coarse_values, d_out_values, structure,
+                                  d_coarse_start, coarse_buckets, length, 0, fine_buckets, d_start_out,
+                                  local_size, coarse_buckets, prof);    /*a WG per coarse bucket*/
+
+    cl_mem_free(d_coarse);
+    cl_mem_free(d_coarse_values);
+    cl_mem_free(d_coarse_start);
+    if (d_start_out != d_start) cl_mem_free(d_start_out);
+
+    return total_time;
+}
+
+/*
+ *  WG-level partitioning (WIs in a WG share a histogram)
+ *  Input:  1.Table being partitioned,  (d_in, d_in_values)
+ *          2.Table cadinality,         (length)
+ *          3.Buckets                   (buckets)
+ *  Output: 1.Partitioned table         (d_out, d_out_values)
+ *          2.Array recording the start position of each bucket in the table (d_start)
+ *
+ *  If DataStruc is SOA, then d_in represents the input keys.
+ *  If DataStruc is AOS, then d_in represents the input tuples, and the d_in_values, d_out_values shoule be set to 0
+ *
+ *  Reorder:
+ *      reorder = NO_REORDER: no reorder;
+ *      reorder = FIXED_REORDER: with fixed-length reorder buffers  (lsize must be 1)
+ *      reorder = VARIED_REORDER: with varied-length reorder buffers
+ *
+ *  The local memory use is checked against lmem_size. Varied-length reorder
+ *  buffers that do not fit fall back to no reordering, and bucket counts whose
+ *  histogram does not fit (up to SPLIT_MAX_BUCKETS) are split in two levels
+ *  without reordering.
+*/
+double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
+                int length, int buckets, ReorderType reorder_type,
+                DataStruc structure,
+                cl_mem d_in_values, cl_mem d_out_values,
+                int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    uint64_t lmem_avail = param.lmem_size - SPLIT_LMEM_RESERVED;
+
+    /*largest single-pass fan-out: the shuffle kernels keep buckets+1 counters*/
+    int max_bits = 0;
+    while (sizeof(int) * ((2 << max_bits) + 1) <= lmem_avail) max_bits++;
+
+    if (buckets > (1 << max_bits)) {
+        int bits = 0;
+        while ((1 << bits) < buckets) bits++;
+        if (buckets > SPLIT_MAX_BUCKETS || bits - max_bits > max_bits) {
+            log_error(ERR_LOCAL_MEM_OVERFLOW);
+            log_error("Split: %d buckets exceed the two-level fan-out", buckets);
+            return -1;
+        }
+        /*balanced levels: the second one has a WG per coarse bucket*/
+        return WG_split_hierarchical(d_in, d_out, d_start, length, buckets, (bits + 1) / 2, structure,
+                                     d_in_values, d_out_values, local_size, grid_size, prof);
+    }
+
+    if (reorder_type == VARIED_REORDER) {
+        uint64_t local_buffer_len = length / grid_size;
+        uint64_t buffer_bytes = (structure == KVS_AOS) ? sizeof(tuple_t) * local_buffer_len :
+                                sizeof(cl_mem) * local_buffer_len + ((structure == KVS_SOA) ? sizeof(int) * local_buffer_len : 0);
+        if (sizeof(int) * (buckets + 1) + buffer_bytes > lmem_avail) {
+            log_trace("Split: reorder buffers exceed the local memory, no reordering");
+            reorder_type = NO_REORDER;
+        }
+    }
+    return WG_split_pass(d_in, d_out, d_start, length, buckets, 0, reorder_type, structure,
+                         d_in_values, d_out_values, local_size, grid_size, prof);
+}
+
+/*
+ *  WG_split without reordering on a key column bit-packed with bits bits
+ *  Input:  1.Packed keys and the values,   (d_in, d_in_values)
+ *  Output: 1.Partitioned table, unpacked   (d_out, d_out_values)
+ *
+ *  The histogram and the shuffle unpack the keys as they read them, so the
+ *  two passes over the keys move bits/32 of the bytes. KO or KVS_SOA only.
+ * */
+double WG_split_packed(cl_mem d_in, int bits, cl_mem d_out, cl_mem d_start,
+                       int length, int buckets, DataStruc structure,
+                       cl_mem d_in_values, cl_mem d_out_values,
+                       int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+
+    if (structure == KVS_AOS || bits < 1 || bits > 32) {
+        log_error("Wrong parameters: packed splits take KO or SOA keys of 1 to 32 bits");
+        return -1;
+    }
+    if (sizeof(int) * (buckets + 1) > param.lmem_size - SPLIT_LMEM_RESERVED) {
+        log_error(ERR_LOCAL_MEM_OVERFLOW);
+        return -1;
+    }
+    return WG_split_pass(d_in, d_out, d_start, length, buckets, 0, NO_REORDER, structure,
+                         d_in_values, d_out_values, local_size, grid_size, prof,
+                         0, 0, 0, 0, bits);
+}
+
+/*
+ *  WG_split without reordering in which the bucket count is a compilation
+ *  parameter of the kernels (BUCKETS in split_kernel.cl), so the bucket mask
+ *  and the loops over the local histogram are constants. A kernel is built
+ *  per bucket count, see typed_primitives.h.
+ * */
+double WG_split_const(cl_mem d_in, cl_mem d_out, cl_mem d_start,
+                      int length, int buckets, DataStruc structure,
+                      cl_mem d_in_values, cl_mem d_out_values,
+                      int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+
+    if (buckets < 1 || (buckets & (buckets - 1)) != 0) {
+        log_error("Wrong parameters: %d buckets is not a power of 2", buckets);
+        return -1;
+    }
+    if (sizeof(int) * (buckets + 1) > param.lmem_size - SPLIT_LMEM_RESERVED) {
+        log_error(ERR_LOCAL_MEM_OVERFLOW);
+        return -1;
+    }
+    return WG_split_pass(d_in, d_out, d_start, length, buckets, 0, NO_REORDER, structure,
+                         d_in_values, d_out_values, local_size, grid_size, prof,
+                         0, 0, 0, 0, 0, true);
+}
+
+/*
+ *  Multi-pass LSD radix split on the low bits of the keys
+ *  Input:  1.Table being partitioned,  (d_in, d_in_values)
+ *          2.Table cadinality,         (length)
+ *          3.Radix bits                (bits, in passes of at most pass_bits bits)
+ *  Output: 1.Partitioned table         (d_out, d_out_values), same as a WG_split on 2^bits buckets
+ *
+ *  fused = false: each pass is a WG_split_pass (histogram, scan, shuffle).
+ *  fused = true:  the shuffle of a pass also counts the digit of the next pass,
+ *                 so only the first pass reads the input for its histogram.
+ *                 The counts are global atomics spread over the next histogram.
+ *  With more than two passes, d_out also holds an intermediate pass.
+ * */
+double WG_radix_split(cl_mem d_in, cl_mem d_out, int length, int bits, int pass_bits,
+                      bool fused, DataStruc structure,
+                      cl_mem d_in_values, cl_mem d_out_values,
+                      int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    double total_time = 0;
+    size_t ele_size = (structure == KVS_AOS) ? sizeof(tuple_t) : sizeof(int);
+    if (bits < 1 || bits > 31 || pass_bits < 1) {
+        log_error("Wrong parameters: radix split on %d bits in passes of %d bits", bits, pass_bits);
+        return -1;
+    }
+    pass_bits = std::min(pass_bits, bits);
+    int passes = (bits + pass_bits - 1) / pass_bits;
+    if (sizeof(int) * ((1 << pass_bits) + 1) > param.lmem_size - SPLIT_LMEM_RESERVED) {
+        log_error(ERR_LOCAL_MEM_OVERFLOW);
+        log_error("Radix split: the histogram of a %d-bit pass exceeds the local memory", pass_bits);
+        return -1;
+    }
+    if (passes == 1) {
+        return WG_split_pass(d_in, d_out, nullptr, length, 1 << bits, 0, NO_REORDER, structure,
+                             d_in_values, d_out_values, local_size, grid_size, prof);
+    }
+
+    /*ping-pong buffers, arranged for the last pass to write d_out*/
+    auto t_beg = host_time_ns();
+    cl_mem d_tmp = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, ele_size*length);
+    cl_mem d_tmp_values = 0;
+    if (structure == KVS_SOA) {
+        d_tmp_values = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*length);
+    }
+    cl_mem d_his[2] = {0, 0};
+    if (fused) {
+        int max_buckets = 1 << pass_bits;
+        d_his[0] = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*max_buckets*grid_size);
+        d_his[1] = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*max_buckets*grid_size);
+    }
+    prof_add_host(prof, "alloc radix split", t_beg);
+
+    cl_mem src = d_in, src_values = d_in_values;
+    for(int p = 0; p < passes; p++) {
+        int shift = bits * p / passes;
+        int next_shift = bits * (p+1) / passes;
+        int next_next_shift = bits * (p+2) / passes;
+        bool to_out = ((passes - 1 - p) % 2 == 0);
+        cl_mem dst = to_out ? d_out : d_tmp;
+        cl_mem dst_values = to_out ? d_out_values : d_tmp_values;
+        cl_mem his_known = (fused && p > 0) ? d_his[p % 2] : 0;
+        cl_mem his_next = (fused && p < passes - 1) ? d_his[(p+1) % 2] : 0;
+
+        double pass_time = WG_split_pass(src, dst, nullptr, length, 1 << (next_shift - shift), shift, NO_REORDER,
+                                         structure, src_values, dst_values, local_size, grid_size, prof,
+                                         his_known, his_next, next_shift, 1 << (next_next_shift - next_shift));
+        if (pass_time < 0) {
+            total_time = -1;
+            break;
+        }
+        total_time += pass_time;
+        src = dst;
+        src_values = dst_values;
+    }
+
+    cl_mem_free(d_tmp);
+    cl_mem_free(d_tmp_values);
+    cl_mem_free(d_his[0]);
+    cl_mem_free(d_his[1]);
+    return total_time;
+}
+
+/*
+ *  Batched WG-level partitioning of many independent segments in one launch
+ *  Input:  1.Segments being partitioned,   (d_in, d_in_values)
+ *          2.Segment start positions       (d_offsets, num_segments ints, the last segment ends at length)
+ *          3.Buckets                       (buckets, a power of 2)
+ *  Output: 1.Partitioned segments          (d_out, d_out_values), segment boundaries are kept
+ *          2.Start position of bucket b of segment s in the table (d_start[s*buckets+b])
+ *
+ *  A WG splits a segment at a time with its histogram in the local memory, so
+ *  no global histogram is built and the whole batch is a single kernel.
+ *  grid_size = 0: a WG per segment.
+ * */
+double WG_split_batched(cl_mem d_in, cl_mem d_out, cl_mem d_offsets, int num_segments,
+                        int length, int buckets, DataStruc structure, cl_mem d_start,
+                        cl_mem d_in_values, cl_mem d_out_values,
+                        int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+    if (structure == KVS_SOA && ((d_in_values == 0) || (d_out_values == 0))) {
+        log_error("Wrong parameters: values are not set");
+        return -1;
+    }
+    if ((uint64_t)sizeof(int) * buckets > param.lmem_size - SPLIT_LMEM_RESERVED) {
+        log_error(ERR_LOCAL_MEM_OVERFLOW);
+        log_error("Batched split: the histogram of %d buckets exceeds the local memory", buckets);
+        return -1;
+    }
+    if (num_segments == 0) return 0;    /*no WG to launch*/
+    if ((grid_size == 0) || (grid_size > num_segments)) grid_size = num_segments;
+
+    return split_segmented(d_in, d_out, d_in_values, d_out_values, structure, d_offsets, num_segments,
+                           length, 0, buckets, d_start, local_size, grid_size, prof);
+}
+
+/*
+ *  Heavy hitters of a sample of the keys: the up to SPLIT_MAX_HEAVY most
+ *  frequent keys holding at least 1/SPLIT_HEAVY_RATIO of the sample each,
+ *  returned sorted by bucket and then by key
+ * */
+static int sample_heavy_keys(cl_mem d_in, int length, int buckets, DataStruc structure, int *heavy_keys) {
+    device_param_t param = Plat::get_device_param();
+    const int max_sample = SPLIT_SAMPLE_BLOCKS * SPLIT_SAMPLE_BLOCK_LEN;
+    vector<int> sample(max_sample);
+    int sample_len;
+    if (structure == KVS_AOS) {
+        vector<tuple_t> tuples(max_sample);
+        sample_len = cl_mem_sample(param.queue, d_in, sizeof(tuple_t), length,
+                                   tuples.data(), SPLIT_SAMPLE_BLOCKS, SPLIT_SAMPLE_BLOCK_LEN);
+        for(int i = 0; i < sample_len; i++) sample[i] = tuples[i].s[0];
+    }
+    else {
+        sample_len = cl_mem_sample(param.queue, d_in, sizeof(int), length,
+                                   sample.data(), SPLIT_SAMPLE_BLOCKS, SPLIT_SAMPLE_BLOCK_LEN);
+    }
+    sample.resize(sample_len);
+    std::sort(sample.begin(), sample.end());
+
+    vector<pair<int,int>> runs;    /*(count, key)*/
+    for(int i = 0, head = 0; i <= sample_len; i++) {
+        if (i == sample_len || sample[i] != sample[head]) {
+            if ((i - head) * SPLIT_HEAVY_RATIO >= sample_len) runs.push_back(make_pair(i - head, sample[head]));
+            head = i;
+        }
+    }
+    std::sort(runs.rbegin(), runs.rend());
+    int num_heavy = std::min((int)runs.size(), SPLIT_MAX_HEAVY);
+    for(int h = 0; h < num_heavy; h++) heavy_keys[h] = runs[h].second;
+    std::sort(heavy_keys, heavy_keys + num_heavy, [buckets](int a, int b) {
+        int bucket_a = a & (buckets - 1), bucket_b = b & (buckets - 1);
+        return (bucket_a != bucket_b) ? (bucket_a < bucket_b) : (a < b);
+    });
+    return num_heavy;
+}
+
+/*
+ *  Skew-aware WG-level partitioning
+ *  Input:  same as WG_split without reordering
+ *  Output: 1.Partitioned table                 (d_out, d_out_values)
+ *          2.Start positions of the virtual buckets (d_start, buckets+SPLIT_MAX_HEAVY ints)
+ *          3.Heavy-hitter keys sorted by bucket (heavy_keys, SPLIT_MAX_HEAVY ints, num_heavy)
+ *
+ *  A sample of the keys is taken first and each heavy-hitter key gets a
+ *  dedicated contiguous region placed right after the other tuples of its
+ *  bucket, so bucket b still spans a contiguous range of the output. The
+ *  heavy tuples are counted privately per WI and reserved in blocks, so the
+ *  local histogram atomics are only taken by the regular tuples.
+ *
+ *  With h heavy keys in buckets lower than b, d_start[b+h] is the start of the
+ *  regular tuples of bucket b, and heavy key j starts at
+ *  d_start[(heavy_keys[j] & (buckets-1)) + j + 1]. Without heavy hitters the
+ *  layout is the one of WG_split. With heavy hitters the split is a single
+ *  pass, the buckets+num_heavy counters should fit in the local memory.
+ * */
+double WG_split_skew(cl_mem d_in, cl_mem d_out, cl_mem d_start,
+                     int length, int buckets, DataStruc structure,
+                     int *heavy_keys, int &num_heavy,
+                     cl_mem d_in_values, cl_mem d_out_values,
+                     int local_size, int grid_size, Profile *prof) {
+    device_param_t param = Plat::get_device_param();
+
+    if (structure == KVS_SOA) { /*SOA should have both keys and values*/
+        if ( (d_in_values == 0) || (d_out_values == 0) ) {
+            log_error("Wrong parameters: values are not set");
+            return -1;
+        }
+    }
+
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+    double total_time = 0;
+
+    auto t_beg = host_time_ns();
+    num_heavy = sample_heavy_keys(d_in, length, buckets, structure, heavy_keys);
+    prof_add_host(prof, "sample heavy hitters", t_beg);
+    log_trace("Split with %d heavy hitters", num_heavy);
+    if (num_heavy == 0) {
+        return WG_split(d_in, d_out, d_start, length, buckets, NO_REORDER, structure,
+                        d_in_values, d_out_values, local_size, grid_size, prof);
+    }
+    if (sizeof(int) * (buckets + num_heavy) > param.lmem_size - SPLIT_LMEM_RESERVED) {
+        log_error(ERR_LOCAL_MEM_OVERFLOW);
+        log_error("Skew split: the histogram of %d buckets and %d heavy hitters exceeds the local memory",
+                  buckets, num_heavy);
+        return -1;
+    }
+
+    char para_s[500] = {'\0'};
+    if (structure == KO)            strcat(para_s, " -DKO ");
+    else if (structure == KVS_SOA)  strcat(para_s, " -DKVS_SOA ");
+    else if (structure == KVS_AOS)  strcat(para_s, " -DKVS_AOS ");
+
+    int heavy_buckets[SPLIT_MAX_HEAVY];
+    for(int h = 0; h < num_heavy; h++) heavy_buckets[h] = heavy_keys[h] & (buckets - 1);
+
+    int v_buckets = buckets + num_heavy;
+    int his_len = v_buckets * grid_size;
+    size_t local_dim[1] = {(size_t) local_size};
+    size_t global_dim[1] = {(size_t) (local_size * grid_size)};
+
+    t_beg = host_time_ns();
+    cl_kernel histogram_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_histogram_skew", para_s);
+    cl_kernel shuffle_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "WG_shuffle_skew", para_s);
+    prof_add_host(prof, "compile WG_split_skew", t_beg);
+
+    t_beg = host_time_ns();
+    cl_mem d_his = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int) * his_len);
+    cl_mem d_heavy_keys = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY,
+                                        sizeof(int) * num_heavy, heavy_keys);
+    cl_mem d_heavy_buckets = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY,
+                                           sizeof(int) * num_heavy, heavy_buckets);
+    prof_add_host(prof, "alloc histogram", t_beg);
+
+    /*1.histogram*/
+    args_num = 0;
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_his);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int) * v_buckets, nullptr);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &buckets);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_heavy_keys);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(cl_mem), &d_heavy_buckets);
+    status |= clSetKernelArg(histogram_kernel, args_num++, sizeof(int), &num_heavy);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clEnqueueNDRangeKernel(param.queue, histogram_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+    clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time += clEventTime(event);
+    prof_add_kernel(prof, "WG_histogram_skew", event);
+
+    /*2.scan*/
+    total_time += scan_chained(d_his, d_his, his_len, 64, std::max((int)param.cus-1, 1), 112, 0, prof);
+
+    /*2.5 gather the start position (optional)*/
+    if (d_start != nullptr) {
+        t_beg = host_time_ns();
+        cl_kernel gather_his_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "gatherStartPos", para_s);
+        prof_add_host(prof, "compile gatherStartPos", t_beg);
+        args_num = 0;
+        status |= clSetKernelArg(gather_his_kernel, args_num++, sizeof(cl_mem), &d_his);
+        status |= clSetKernelArg(gather_his_kernel, args_num++, sizeof(int), &his_len);
+        status |= clSetKernelArg(gather_his_kernel, args_num++, sizeof(cl_mem), &d_start);
+        status |= clSetKernelArg(gather_his_kernel, args_num++, sizeof(int), &grid_size);
+        checkErr(status, ERR_SET_ARGUMENTS);
+
+        status = clEnqueueNDRangeKernel(param.queue, gather_his_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+        status = clFinish(param.queue);
+        total_time += clEventTime(event);
+        prof_add_kernel(prof, "gatherStartPos", event);
+    }
+
+    /*3.shuffle*/
+    args_num = 0;
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_out);
+    if (structure == KVS_SOA) {
+        status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_in_values);
+        status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_out_values);
+    }
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int), &length);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int), &buckets);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_his);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int) * v_buckets, nullptr);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_heavy_keys);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(cl_mem), &d_heavy_buckets);
+    status |= clSetKernelArg(shuffle_kernel, args_num++, sizeof(int), &num_heavy);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clEnqueueNDRangeKernel(param.queue, shuffle_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+    clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+    total_time += clEventTime(event);
+    prof_add_kernel(prof, "WG_shuffle_skew", event);
+
+    cl_mem_free(d_his);
+    cl_mem_free(d_heavy_keys);
+    cl_mem_free(d_heavy_buckets);
 
     return total_time;
 }
@@ -365,12 +913,12 @@ double WG_split(cl_mem d_in, cl_mem d_out, cl_mem d_start,
 */
 double single_split(cl_mem d_in, cl_mem d_out,
                     int length, int buckets, bool reorder,
-                    DataStruc structure) {
+                    DataStruc structure, Profile *prof) {
     device_param_t param = Plat::get_device_param();
 
     int local_size = 1, grid_size = 39;
     int len_per_group = (length + grid_size - 1)/grid_size;
-    int cacheline_size, ele_per_cacheline;
+    int cacheline_size = param.cacheline_size, ele_per_cacheline;
 
     /*check the value setting*/
     if (structure == KVS_SOA) { /*SOA should have both keys and values*/
@@ -392,6 +940,7 @@ double single_split(cl_mem d_in, cl_mem d_out,
     cl_int status = 0;
     cl_event event;
     int argsNum = 0;
+    uint64_t t_beg;
 
     /*set the compilation paramters. Each kernel in the kernel file should be compilted with this parameter*/
     char para_s[500] = {'\0'};
@@ -400,8 +949,6 @@ double single_split(cl_mem d_in, cl_mem d_out,
 
     cl_kernel histogram_kernel, scatter_kernel, gather_his_kernel;
     cl_mem d_his, d_global_buffer, d_global_buffer_values;
-    int *h_global_buffer_int = nullptr;
-    tuple_t *h_global_buffer_tuple = nullptr;
     double histogram_time, scan_time, scatter_time, total_time = 0;
 
     int global_size = local_size * grid_size;
@@ -412,10 +959,14 @@ double single_split(cl_mem d_in, cl_mem d_out,
     size_t global_dim[1] = {(size_t) global_size};
 
     /*1.histogram*/
+    t_beg = host_time_ns();
     histogram_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "single_histogram", para_s);
+    prof_add_host(prof, "compile single_histogram", t_beg);
+
     int his_len = buckets * grid_size;
-    d_his = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int)*his_len, nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
+    t_beg = host_time_ns();
+    d_his = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*his_len);
+    prof_add_host(prof, "alloc histogram", t_beg);
 
     //set kernel arguments
     argsNum = 0;
@@ -432,17 +983,18 @@ double single_split(cl_mem d_in, cl_mem d_out,
     checkErr(status, ERR_EXEC_KERNEL);
     histogram_time = clEventTime(event);
     total_time += histogram_time;
+    prof_add_kernel(prof, "single_histogram", event);
 
     /*2.scan*/
 //    double scanTime = scan_chained(d_his_in, d_his_out, his_len,  info, 1024, 15, 0, 11);
-    scan_time = scan_chained(d_his, d_his, his_len, 64, 39, 112, 0);
+    scan_time = scan_chained(d_his, d_his, his_len, 64, 39, 112, 0, prof);
 //    scan_time = scan_chained(d_his, d_his, his_len, info, 64, 240, 33, 0);
 
     total_time += scan_time;
 
     /*3.scatter*/
+    t_beg = host_time_ns();
     if (reorder) {
-        cacheline_size = param.cacheline_size;
         strcat(para_s, "-DCACHELINE_SIZE=");
         char cacheline_size_str[20];
         my_itoa(cacheline_size, cacheline_size_str, 10);
@@ -450,20 +1002,23 @@ double single_split(cl_mem d_in, cl_mem d_out,
         scatter_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "single_fixed_shuffle", para_s);
     }
     else scatter_kernel = get_kernel(param.device, param.context, "split_kernel.cl", "single_shuffle", para_s);
+    prof_add_host(prof, "compile single_shuffle", t_beg);
 
-    /*alignment buffers*/
+    /*alignment buffers, kept in host memory on host-unified devices*/
+    t_beg = host_time_ns();
     if (structure == KVS_AOS) {
         ele_per_cacheline = cacheline_size / sizeof(tuple_t);
-        h_global_buffer_tuple = (tuple_t*)_mm_malloc(sizeof(tuple_t)*ele_per_cacheline*buckets*grid_size, cacheline_size);
-        d_global_buffer = clCreateBuffer(param.context, CL_MEM_USE_HOST_PTR| CL_MEM_READ_WRITE, sizeof(tuple_t)*ele_per_cacheline*buckets*grid_size, h_global_buffer_tuple, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
+        d_global_buffer = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE,
+                                        sizeof(tuple_t)*ele_per_cacheline*buckets*grid_size,
+                                        nullptr, param.host_unified);
     }
     else {
         ele_per_cacheline = cacheline_size / sizeof(int);
-        h_global_buffer_int = (int*)_mm_malloc(sizeof(int)*ele_per_cacheline*buckets*grid_size, cacheline_size);
-        d_global_buffer = clCreateBuffer(param.context, CL_MEM_USE_HOST_PTR| CL_MEM_READ_WRITE, sizeof(int)*ele_per_cacheline*buckets*grid_size, h_global_buffer_int, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
+        d_global_buffer = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE,
+                                        sizeof(int)*ele_per_cacheline*buckets*grid_size,
+                                        nullptr, param.host_unified);
     }
+    prof_add_host(prof, "alloc reorder buffers", t_beg);
 
     //end of test
     argsNum = 0;
@@ -485,12 +1040,10 @@ double single_split(cl_mem d_in, cl_mem d_out,
     checkErr(status, ERR_EXEC_KERNEL);
     scatter_time = clEventTime(event);
     total_time += scatter_time;
+    prof_add_kernel(prof, "single_shuffle", event);
 
-    clReleaseMemObject(d_his);
-    clReleaseMemObject(d_global_buffer);
-
-    if(h_global_buffer_int) _mm_free(h_global_buffer_int);
-    if(h_global_buffer_tuple) _mm_free(h_global_buffer_tuple);
+    cl_mem_free(d_his);
+    cl_mem_free(d_global_buffer);
 
     checkErr(status, ERR_EXEC_KERNEL);
 
@@ -0,0 +1,71 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "../util/Plat.h"
+#include "log.h"
+using namespace std;
+
+/*launch aos_to_soa or soa_to_aos, the record buffer is always the first argument*/
+static double transpose(const char *kernel_name, cl_mem d_records, const cl_mem *d_fields,
+                        int num_fields, int length, int local_size, int grid_size, Profile *prof) {
+    log_trace("Function: %s", kernel_name);
+    device_param_t param = Plat::get_device_param();
+
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+
+    if (num_fields != 2 && num_fields != 4 && num_fields != 8) {
+        log_error("Wrong parameters: records of %d fields, only 2, 4 and 8 are supported", num_fields);
+        return -1;
+    }
+
+    char para_s[500] = {'\0'};
+    add_param(para_s, (char*)"FIELDS", true, num_fields);
+
+    auto t_beg = host_time_ns();
+    cl_kernel transpose_kernel = get_kernel(param.device, param.context, "transpose_kernel.cl", (char*)kernel_name, para_s);
+    prof_add_host(prof, "compile transpose", t_beg);
+
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)(local_size * grid_size)};
+
+    status |= clSetKernelArg(transpose_kernel, args_num++, sizeof(cl_mem), &d_records);
+    status |= clSetKernelArg(transpose_kernel, args_num++, sizeof(int), &length);
+    for(int f = 0; f < num_fields; f++)
+        status |= clSetKernelArg(transpose_kernel, args_num++, sizeof(cl_mem), &d_fields[f]);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    status = clFinish(param.queue);
+    status = clEnqueueNDRangeKernel(param.queue, transpose_kernel, 1, 0, global_dim, local_dim, 0, nullptr, &event);
+    status = clFinish(param.queue);
+    checkErr(status, ERR_EXEC_KERNEL);
+
+    prof_add_kernel(prof, kernel_name, event);
+    return clEventTime(event);
+}
+
+/*
+ *  AOS to SOA transpose
+ *  Input:  1.Records of num_fields ints,   (d_records, length*num_fields ints)
+ *          2.Number of fields, 2, 4 or 8   (num_fields)
+ *  Output: 1.One array per field           (d_fields[0..num_fields), length ints each)
+ *
+ *  For KVS_AOS tuples (cl_int2), d_fields[0] gets the keys and d_fields[1] the values.
+ * */
+double aos_to_soa(cl_mem d_records, const cl_mem *d_fields, int num_fields, int length,
+                  int local_size, int grid_size, Profile *prof) {
+    return transpose("aos_to_soa", d_records, d_fields, num_fields, length, local_size, grid_size, prof);
+}
+
+/*
+ *  SOA to AOS transpose, the inverse of aos_to_soa
+ *  Input:  1.One array per field           (d_fields[0..num_fields), length ints each)
+ *          2.Number of fields, 2, 4 or 8   (num_fields)
+ *  Output: 1.Records of num_fields ints,   (d_records, length*num_fields ints)
+ * */
+double soa_to_aos(const cl_mem *d_fields, cl_mem d_records, int num_fields, int length,
+                  int local_size, int grid_size, Profile *prof) {
+    return transpose("soa_to_aos", d_records, d_fields, num_fields, length, local_size, grid_size, prof);
+}
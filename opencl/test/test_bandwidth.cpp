@@ -29,20 +29,16 @@ bool test_bandwidth() {
     log_info("Data cardinality: %d (%.1f MB)", len, 1.0*len*sizeof(int)/1024/1024);
 
     //data initialization
-    int *h_in_1 = new int[len];
-    int *h_in_2 = new int[len];
+    bool zero_copy = param.host_unified;
+    int *h_in_1 = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_in_2 = (int*)host_malloc_aligned(sizeof(int)*len);
     for(int i = 0; i < len; i++) {
         h_in_1[i] = i;
         h_in_2[i] = i + 10;
     }
-    cl_mem d_in_1 = clCreateBuffer(param.context, CL_MEM_READ_WRITE , sizeof(int)*len, nullptr, &status);
-    cl_mem d_in_2 = clCreateBuffer(param.context, CL_MEM_READ_WRITE , sizeof(int)*len, nullptr, &status);
-    cl_mem d_out = clCreateBuffer(param.context, CL_MEM_WRITE_ONLY , sizeof(int)*len, nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
-    status = clEnqueueWriteBuffer(param.queue, d_in_1, CL_TRUE, 0, sizeof(int)*len, h_in_1, 0, 0, 0);
-    checkErr(status, ERR_WRITE_BUFFER);
-    status = clEnqueueWriteBuffer(param.queue, d_in_2, CL_TRUE, 0, sizeof(int)*len, h_in_2, 0, 0, 0);
-    checkErr(status, ERR_WRITE_BUFFER);
+    cl_mem d_in_1 = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(int)*len, h_in_1, zero_copy);
+    cl_mem d_in_2 = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(int)*len, h_in_2, zero_copy);
+    cl_mem d_out = cl_mem_create(param.context, param.queue, CL_MEM_WRITE_ONLY, sizeof(int)*len, nullptr, zero_copy);
 
     /* --- copy kernel --- */
     args_num = 0;
@@ -114,8 +110,8 @@ bool test_bandwidth() {
     status = clReleaseMemObject(d_in_2);
     status = clReleaseMemObject(d_out);
     checkErr(status, ERR_RELEASE_MEM);
-    delete[] h_in_1;
-    delete[] h_in_2;
+    host_free_aligned(h_in_1);
+    host_free_aligned(h_in_2);
 
     /* compute the bandwidth */
     log_info("Copy: time=%.1f ms, bandwidth=%.1f GB/s",
@@ -0,0 +1,164 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+using namespace std;
+
+/*random segment sizes in [1, 2*ave_len), returns the total length*/
+static int generate_offsets(int *h_offsets, int num_segments, int ave_len) {
+    srand(1234);
+    int acc = 0;
+    for(int s = 0; s < num_segments; s++) {
+        h_offsets[s] = acc;
+        acc += 1 + rand() % (2 * ave_len - 1);
+    }
+    return acc;
+}
+
+/*
+ *  Batched exclusive scan of num_segments segments of ave_len elements on average
+ * */
+bool test_scan_batched(int num_segments, int ave_len, double &ave_time) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    double time_recorder[EXPERIMENT_TIMES];
+
+    int *h_offsets = (int*)host_malloc_aligned(sizeof(int)*num_segments);
+    int len = generate_offsets(h_offsets, num_segments, ave_len);
+    int *h_in = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_out = (int*)host_malloc_aligned(sizeof(int)*len);
+    for(int i = 0; i < len; i++) h_in[i] = rand() & 0xf;
+
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in, zero_copy);
+    cl_mem d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, h_out, zero_copy);
+    cl_mem d_offsets = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*num_segments, h_offsets, zero_copy);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        time_recorder[e] = scan_batched(d_in, d_out, d_offsets, num_segments, len);
+        if (e == 0) {
+            cl_mem_read(param.queue, d_out, sizeof(int)*len, h_out, zero_copy);
+            for(int s = 0; s < num_segments && res; s++) {
+                int end = (s == num_segments - 1) ? len : h_offsets[s+1];
+                int acc = 0;
+                for(int i = h_offsets[s]; i < end; i++) {
+                    if (h_out[i] != acc) {
+                        log_error("Wrong result in segment %d at %d: %d, expected %d", s, i, h_out[i], acc);
+                        res = false;
+                        break;
+                    }
+                    acc += h_in[i];
+                }
+            }
+        }
+        if (!res) break;
+    }
+    ave_time = average_Hampel(time_recorder, EXPERIMENT_TIMES);
+
+    cl_mem_free(d_in);
+    cl_mem_free(d_out);
+    cl_mem_free(d_offsets);
+    host_free_aligned(h_in);
+    host_free_aligned(h_out);
+    host_free_aligned(h_offsets);
+    return res;
+}
+
+/*
+ *  Batched key-only split of num_segments segments of ave_len elements on average
+ * */
+bool test_split_batched(int num_segments, int ave_len, int buckets, double &ave_time) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    double time_recorder[EXPERIMENT_TIMES];
+
+    int *h_offsets = (int*)host_malloc_aligned(sizeof(int)*num_segments);
+    int len = generate_offsets(h_offsets, num_segments, ave_len);
+    int *h_in = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_out = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_start = (int*)host_malloc_aligned(sizeof(int)*num_segments*buckets);
+    random_generator_int(h_in, len, len, 1234);
+
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in, zero_copy);
+    cl_mem d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, h_out, zero_copy);
+    cl_mem d_offsets = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*num_segments, h_offsets, zero_copy);
+    cl_mem d_start = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*num_segments*buckets, h_start, zero_copy);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        time_recorder[e] = WG_split_batched(d_in, d_out, d_offsets, num_segments, len, buckets, KO, d_start);
+        if (time_recorder[e] < 0) {
+            res = false;
+            break;
+        }
+        if (e == 0) {
+            cl_mem_read(param.queue, d_out, sizeof(int)*len, h_out, zero_copy);
+            cl_mem_read(param.queue, d_start, sizeof(int)*num_segments*buckets, h_start, zero_copy);
+
+            /*every sub-bucket holds its keys and the segment keeps its key sum*/
+            for(int s = 0; s < num_segments && res; s++) {
+                int begin = h_offsets[s];
+                int end = (s == num_segments - 1) ? len : h_offsets[s+1];
+                long long sum_in = 0, sum_out = 0;
+                for(int i = begin; i < end; i++) {
+                    sum_in += h_in[i];
+                    sum_out += h_out[i];
+                }
+                if (sum_in != sum_out) {
+                    log_error("Wrong result: segment %d lost keys", s);
+                    res = false;
+                    break;
+                }
+                for(int b = 0; b < buckets && res; b++) {
+                    int b_begin = h_start[s*buckets+b];
+                    int b_end = (b == buckets - 1) ? end : h_start[s*buckets+b+1];
+                    for(int i = b_begin; i < b_end; i++) {
+                        if ((i < begin) || (i >= end) || ((h_out[i] & (buckets - 1)) != b)) {
+                            log_error("Wrong result in segment %d, bucket %d at %d", s, b, i);
+                            res = false;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (!res) break;
+    }
+    ave_time = average_Hampel(time_recorder, EXPERIMENT_TIMES);
+
+    cl_mem_free(d_in);
+    cl_mem_free(d_out);
+    cl_mem_free(d_offsets);
+    cl_mem_free(d_start);
+    host_free_aligned(h_in);
+    host_free_aligned(h_out);
+    host_free_aligned(h_offsets);
+    host_free_aligned(h_start);
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    int num_segments = (argc > 1) ? stoi(argv[1]) : 16384;
+
+    for(int ave_len : {16, 256, 4096}) {
+        double ave_time;
+        if (test_scan_batched(num_segments, ave_len, ave_time))
+            log_info("scan_batched: segments=%d, ave_len=%d, time=%.2f ms, %.1f segments/us",
+                     num_segments, ave_len, ave_time, num_segments / ave_time / 1000);
+        for(int buckets : {16, 256}) {
+            if (test_split_batched(num_segments, ave_len, buckets, ave_time))
+                log_info("WG_split_batched: segments=%d, ave_len=%d, buckets=%d, time=%.2f ms, %.1f segments/us",
+                         num_segments, ave_len, buckets, ave_time, num_segments / ave_time / 1000);
+        }
+    }
+    return 0;
+}
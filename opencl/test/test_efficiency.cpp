@@ -0,0 +1,139 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <functional>
+#include "Plat.h"
+#include "log.h"
+using namespace std;
+
+/*
+ * Roofline-style efficiency of the primitives
+ * 1. the peak bandwidth of the device is measured with the copy kernel (2n accesses)
+ * 2. each primitive is reported as the fraction of the peak it achieves,
+ *    using the number of data accesses the algorithm performs on n ints
+ * */
+struct prim_model_t {
+    const char              *name;
+    function<double()>      run;                /*returns the kernel time in ms*/
+    double                  accesses_per_ele;   /*in ints*/
+};
+
+/*average kernel time of EXPERIMENT_TIMES runs, after a warm-up run which also compiles the kernels*/
+double measure(const function<double()> &run) {
+    double times[EXPERIMENT_TIMES];
+    run();
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) times[e] = run();
+    return average_Hampel(times, EXPERIMENT_TIMES);
+}
+
+double peak_bandwidth(cl_mem d_in, cl_mem d_out, int len) {
+    device_param_t param = Plat::get_device_param();
+    cl_int status = 0;
+    cl_event event;
+    int args_num = 0;
+    int local_size = 1024;
+    size_t local_dim[1] = {(size_t)local_size};
+    size_t global_dim[1] = {(size_t)len};
+
+    auto copy_kernel = get_kernel(param.device, param.context, "mem_kernel.cl", "copy_bandwidth");
+    status |= clSetKernelArg(copy_kernel, args_num++, sizeof(cl_mem), &d_in);
+    status |= clSetKernelArg(copy_kernel, args_num++, sizeof(cl_mem), &d_out);
+    checkErr(status, ERR_SET_ARGUMENTS);
+
+    double copy_time = measure([&]() {
+        cl_int status = clEnqueueNDRangeKernel(param.queue, copy_kernel, 1, 0, global_dim, local_dim, 0, 0, &event);
+        status = clFinish(param.queue);
+        checkErr(status, ERR_EXEC_KERNEL);
+        return clEventTime(event);
+    });
+    double peak = compute_bandwidth((uint64_t)len*2, sizeof(int), copy_time);
+    log_info("Peak (copy): time=%.2f ms, bandwidth=%.1f GB/s", copy_time, peak);
+    return peak;
+}
+
+bool test_efficiency(int len, int buckets) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool zero_copy = param.host_unified;
+    int *h_in = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_loc = (int*)host_malloc_aligned(sizeof(int)*len);
+    random_generator_int(h_in, len, len, 1234);
+    random_generator_int_unique(h_loc, len, 1234);
+    tuple_t *h_tuples = (tuple_t*)host_malloc_aligned(sizeof(tuple_t)*len);    /*the keys and values of SOA*/
+    for(int i = 0; i < len; i++) {
+        h_tuples[i].x = h_in[i];
+        h_tuples[i].y = h_loc[i];
+    }
+
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(int)*len, h_in, zero_copy);
+    cl_mem d_loc = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_loc, zero_copy);
+    cl_mem d_out = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(int)*len, nullptr, zero_copy);
+    cl_mem d_in_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_loc, zero_copy);
+    cl_mem d_out_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(int)*len, nullptr, zero_copy);
+    cl_mem d_tuples_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(tuple_t)*len, h_tuples, zero_copy);
+    cl_mem d_tuples_out = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(tuple_t)*len, nullptr, zero_copy);
+
+    double peak = peak_bandwidth(d_in, d_out, len);
+
+    /*kernel configurations, the same as the tests of each primitive*/
+    int gather_local_size = 1024, gather_grid_size = len / gather_local_size / 16;
+    int scan_local_size = 64, scan_grid_size = (int)param.cus - 1;
+    int wi_local_size = 128, wi_grid_size = 2048;
+    double wi_his_accesses = 3.0 * buckets * wi_local_size * wi_grid_size / len; /*write, scan read+write*/
+
+    vector<prim_model_t> prims = {
+            /*the index array is read in every pass*/
+            {"gather (1 pass)",   [&]() { return gather(d_in, d_out, len, d_loc, gather_local_size, gather_grid_size, 1); }, 3},
+            {"gather (4 passes)", [&]() { return gather(d_in, d_out, len, d_loc, gather_local_size, gather_grid_size, 4); }, 6},
+            {"scatter (1 pass)",  [&]() { return scatter(d_in, d_out, len, d_loc, gather_local_size, gather_grid_size, 1); }, 3},
+            {"scatter (4 passes)",[&]() { return scatter(d_in, d_out, len, d_loc, gather_local_size, gather_grid_size, 4); }, 6},
+            /*chained scan reads and writes each element once*/
+            {"scan_chained",      [&]() { return scan_chained(d_in, d_out, len, scan_local_size, scan_grid_size, 112, 0); }, 2},
+            /*reduce: read, scan: read+write*/
+            {"scan_RSS",          [&]() { return scan_RSS(d_in, d_out, len, 1024, (int)param.cus*2); }, 3},
+            /*histogram: read keys, shuffle: read+write keys (and values)*/
+            {"WG_split KO",       [&]() { return WG_split(d_in, d_out, 0, len, buckets, NO_REORDER, KO); }, 3},
+            {"WG_split SOA",      [&]() { return WG_split(d_in, d_out, 0, len, buckets, NO_REORDER, KVS_SOA,
+                                                          d_in_values, d_out_values); }, 5},
+            {"WG_split AOS",      [&]() { return WG_split(d_tuples_in, d_tuples_out, 0, len, buckets, NO_REORDER, KVS_AOS); }, 6},
+            /*the private histograms are not negligible for WI_split*/
+            {"WI_split KO",       [&]() { return WI_split(d_in, d_out, 0, len, buckets, KO,
+                                                          0, 0, wi_local_size, wi_grid_size); }, 3 + wi_his_accesses},
+    };
+
+    log_info("Length=%d, buckets=%d, peak=%.1f GB/s", len, buckets, peak);
+    for(auto &p : prims) {
+        double time = measure(p.run);
+        double bandwidth = compute_bandwidth((uint64_t)(len*p.accesses_per_ele), sizeof(int), time);
+        log_info("%-20s time=%.2f ms, accesses=%.1fn, throughput=%.1f GB/s, %.1f%% of peak",
+                 p.name, time, p.accesses_per_ele, bandwidth, 100.0*bandwidth/peak);
+    }
+
+    cl_mem_free(d_in);
+    cl_mem_free(d_loc);
+    cl_mem_free(d_out);
+    cl_mem_free(d_in_values);
+    cl_mem_free(d_out_values);
+    cl_mem_free(d_tuples_in);
+    cl_mem_free(d_tuples_out);
+    host_free_aligned(h_in);
+    host_free_aligned(h_loc);
+    host_free_aligned(h_tuples);
+
+    return true;
+}
+
+/*
+ * Usage:
+ *    ./test_efficiency [DATA_NUM] [BUCKETS]
+ * */
+int main(int argc, const char *argv[]) {
+    Plat::plat_init();
+    int len = (argc > 1) ? stoi(argv[1]) : (1<<25);
+    int buckets = (argc > 2) ? stoi(argv[2]) : 256;
+    assert(len % 1024 == 0);    /*the copy kernel has no boundary check*/
+    assert(test_efficiency(len, buckets));
+    return 0;
+}
@@ -0,0 +1,162 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+using namespace std;
+
+static bool host_predicate(int key, const predicate_t &pred, const unsigned *h_bitmap) {
+    switch (pred.type) {
+        case PRED_EQ:       return key == pred.low;
+        case PRED_NE:       return key != pred.low;
+        case PRED_LT:       return key < pred.low;
+        case PRED_LE:       return key <= pred.low;
+        case PRED_GT:       return key > pred.low;
+        case PRED_GE:       return key >= pred.low;
+        case PRED_RANGE:    return (key >= pred.low) && (key < pred.high);
+        case PRED_BITMAP:   return (key >= 0) && (key < pred.bitmap_bits) && ((h_bitmap[key>>5] >> (key&31)) & 1);
+    }
+    return false;
+}
+
+/*
+ *  Filter test, keys are uniform in [0, len), values are the input positions
+ *  so that the order of the output can be checked
+ * */
+bool test_filter(int len, predicate_t pred, const unsigned *h_bitmap,
+                 DataStruc structure, double &ave_time, int &res_len) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    double tempTime, *time_recorder = new double[EXPERIMENT_TIMES];
+
+    int *h_in_keys = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_in_values = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_out_keys = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_out_values = (int*)host_malloc_aligned(sizeof(int)*len);
+    tuple_t *h_in = nullptr, *h_out = nullptr;
+    random_generator_int(h_in_keys, len, len, 1234);
+    for(int i = 0; i < len; i++) h_in_values[i] = i;
+
+    cl_mem d_in = 0, d_out = 0, d_in_values = 0, d_out_values = 0;
+    if (structure == KVS_AOS) {
+        h_in = (tuple_t*)host_malloc_aligned(sizeof(tuple_t)*len);
+        h_out = (tuple_t*)host_malloc_aligned(sizeof(tuple_t)*len);
+        for(int i = 0; i < len; i++) {
+            h_in[i].x = h_in_keys[i];
+            h_in[i].y = h_in_values[i];
+        }
+        d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(tuple_t)*len, h_in, zero_copy);
+        d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(tuple_t)*len, h_out, zero_copy);
+    }
+    else {
+        d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in_keys, zero_copy);
+        d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, h_out_keys, zero_copy);
+        if (structure == KVS_SOA) {
+            d_in_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in_values, zero_copy);
+            d_out_values = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, h_out_values, zero_copy);
+        }
+    }
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        tempTime = filter(d_in, d_out, len, pred, structure, res_len, d_in_values, d_out_values);
+
+        /*check the result*/
+        if (e == 0 && res_len > 0) {
+            if (structure == KVS_AOS) {
+                cl_mem_read(param.queue, d_out, sizeof(tuple_t)*res_len, h_out, zero_copy);
+                for(int i = 0; i < res_len; i++) {
+                    h_out_keys[i] = h_out[i].x;
+                    h_out_values[i] = h_out[i].y;
+                }
+            }
+            else {
+                cl_mem_read(param.queue, d_out, sizeof(int)*res_len, h_out_keys, zero_copy);
+                if (structure == KVS_SOA)
+                    cl_mem_read(param.queue, d_out_values, sizeof(int)*res_len, h_out_values, zero_copy);
+            }
+        }
+        if (e == 0) {
+            int j = 0;
+            for(int i = 0; i < len && res; i++) {
+                if (!host_predicate(h_in_keys[i], pred, h_bitmap)) continue;
+                if (j >= res_len || h_out_keys[j] != h_in_keys[i] ||
+                    (structure != KO && h_out_values[j] != i)) {
+                    log_error("wrong result at output %d", j);
+                    res = false;
+                }
+                j++;
+            }
+            if (res && j != res_len) {
+                log_error("wrong result, %d outputs, expected %d", res_len, j);
+                res = false;
+            }
+        }
+        time_recorder[e] = tempTime;
+        if (!res) break;
+    }
+    ave_time = average_Hampel(time_recorder, EXPERIMENT_TIMES);
+
+    /*memory free*/
+    cl_mem_free(d_in);
+    cl_mem_free(d_out);
+    cl_mem_free(d_in_values);
+    cl_mem_free(d_out_values);
+    host_free_aligned(h_in_keys);
+    host_free_aligned(h_in_values);
+    host_free_aligned(h_out_keys);
+    host_free_aligned(h_out_values);
+    host_free_aligned(h_in);
+    host_free_aligned(h_out);
+    if(time_recorder)   delete[] time_recorder;
+
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    device_param_t param = Plat::get_device_param();
+    int length = (argc > 1) ? stoi(argv[1]) : (1<<25);
+
+    /*bitmap selecting every third key*/
+    unsigned *h_bitmap = new unsigned[(length+31)/32]();
+    for(int k = 0; k < length; k += 3) h_bitmap[k>>5] |= (1u << (k&31));
+    cl_mem d_bitmap = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY,
+                                    sizeof(unsigned)*((length+31)/32), h_bitmap, false);
+
+    const char *struc_names[] = {"KO", "KVS_AOS", "KVS_SOA"};
+    for(int s = KO; s <= KVS_SOA; s++) {
+        DataStruc structure = (DataStruc)s;
+
+        /*selectivity from 1/64 to 1*/
+        for(int sel = 64; sel >= 1; sel >>= 1) {
+            predicate_t pred = {PRED_LT, length/sel, 0, 0, 0};
+            double ave_time;
+            int res_len;
+            if (test_filter(length, pred, h_bitmap, structure, ave_time, res_len)) {
+                log_info("%s, key < %d: selected=%d, time=%.1f ms, throughput=%.1f GB/s",
+                         struc_names[s], pred.low, res_len, ave_time, compute_bandwidth(length, sizeof(int), ave_time));
+            }
+        }
+
+        predicate_t range = {PRED_RANGE, length/4, length/2, 0, 0};
+        predicate_t bitmap = {PRED_BITMAP, 0, 0, d_bitmap, length};
+        for(auto pred : {range, bitmap}) {
+            double ave_time;
+            int res_len;
+            if (test_filter(length, pred, h_bitmap, structure, ave_time, res_len)) {
+                log_info("%s, %s: selected=%d, time=%.1f ms, throughput=%.1f GB/s",
+                         struc_names[s], (pred.type == PRED_RANGE) ? "range" : "bitmap",
+                         res_len, ave_time, compute_bandwidth(length, sizeof(int), ave_time));
+            }
+        }
+    }
+    cl_mem_free(d_bitmap);
+    delete[] h_bitmap;
+    return 0;
+}
@@ -2,6 +2,8 @@
 //  Created by Zhuohang Lai on 4/7/15.
 //  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
 //
+#include <cstring>
+#include <vector>
 #include "Plat.h"
 #include "log.h"
 using namespace std;
@@ -17,26 +19,20 @@ bool test_gather(int len) {
     auto elements_per_thread = 16;               //elements per thread
     auto grid_size = len / local_size / elements_per_thread;
 
-    //data initialization
-    int *h_in = new int[len];
-    int *h_loc = new int[len];
-    int *h_out = new int[len];
+    //data initialization, page-aligned so that CPU devices can use them without copies
+    bool zero_copy = param.host_unified;
+    int *h_in = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_loc = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_out = (int*)host_malloc_aligned(sizeof(int)*len);
 #pragma omp parallel for
     for(int i = 0; i < len; i++)    h_in[i] = i;
     log_info("Initializing data (%d items)...", len);
-    random_generator_int_unique(h_loc, len);
+    random_generator_int_unique(h_loc, len, 1234);
     log_info("Initialization finished");
 
-    cl_mem d_in = clCreateBuffer(param.context, CL_MEM_READ_ONLY, sizeof(int)*len, nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
-    status = clEnqueueWriteBuffer(param.queue, d_in, CL_TRUE, 0, sizeof(int)*len, h_in, 0, 0, 0);
-    checkErr(status, ERR_WRITE_BUFFER);
-    cl_mem d_out = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
-    cl_mem d_loc = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, nullptr, &status);
-    checkErr(status, ERR_HOST_ALLOCATION);
-    status = clEnqueueWriteBuffer(param.queue, d_loc, CL_TRUE, 0, sizeof(int)*len, h_loc, 0, 0, 0);
-    checkErr(status, ERR_WRITE_BUFFER);
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in, zero_copy);
+    cl_mem d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*len, h_out, zero_copy);
+    cl_mem d_loc = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_loc, zero_copy);
 
     /*loop for multi-pass*/
     for(int pass = 1; pass <= 32 ; pass<<=1) {
@@ -50,8 +46,7 @@ bool test_gather(int len) {
                  len, 1.0*len* sizeof(int)/1024/1024, pass, grid_size, myTime, myTime/len*1e6, 1.0*len* sizeof(int)/myTime/1e6);
     }
     /*Load output back to host*/
-    status = clEnqueueReadBuffer(param.queue, d_out, CL_TRUE, 0, sizeof(int) * len, h_out, 0, nullptr, nullptr);
-    checkErr(status, ERR_READ_BUFFER);
+    cl_mem_read(param.queue, d_out, sizeof(int) * len, h_out, zero_copy);
 
     status = clReleaseMemObject(d_out);
     checkErr(status, ERR_RELEASE_MEM);
@@ -70,13 +65,80 @@ bool test_gather(int len) {
     }
     if (res) log_info("Results check passed");
 
-    delete[] h_loc;
-    delete[] h_in;
-    delete[] h_out;
+    host_free_aligned(h_loc);
+    host_free_aligned(h_in);
+    host_free_aligned(h_out);
 
     return res;
 }
 
+/*
+ *  Gather of num_columns columns of 4 and 8 bytes, one gather_columns call
+ *  per column against a single call moving all of them
+ * */
+bool test_gather_columns(int len, int num_columns) {
+    log_trace("Function: %s", __FUNCTION__);
+    bool res = true;
+    auto param = Plat::get_device_param();
+
+    auto local_size = 1024;
+    auto elements_per_thread = 16;
+    auto grid_size = len / local_size / elements_per_thread;
+    bool zero_copy = param.host_unified;
+    double separate_times[EXPERIMENT_TIMES], multi_times[EXPERIMENT_TIMES];
+
+    int *h_loc = (int*)host_malloc_aligned(sizeof(int)*len);
+    random_generator_int_unique(h_loc, len, 1234);
+    cl_mem d_loc = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_loc, zero_copy);
+
+    vector<column_t> columns(num_columns);
+    vector<char*> h_in(num_columns), h_out(num_columns);
+    uint64_t total_bytes = 0;
+    for(int c = 0; c < num_columns; c++) {
+        int width = (c % 2 == 0) ? sizeof(int) : sizeof(cl_int2);
+        h_in[c] = (char*)host_malloc_aligned((uint64_t)width*len);
+        h_out[c] = (char*)host_malloc_aligned((uint64_t)width*len);
+        for(uint64_t b = 0; b < (uint64_t)width*len; b++) h_in[c][b] = (char)(b * 7 + c);
+        columns[c].width = width;
+        columns[c].d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, (uint64_t)width*len, h_in[c], zero_copy);
+        columns[c].d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, (uint64_t)width*len, h_out[c], zero_copy);
+        total_bytes += (uint64_t)width*len;
+    }
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        separate_times[e] = 0;
+        for(int c = 0; c < num_columns; c++)
+            separate_times[e] += gather_columns(&columns[c], 1, len, d_loc, local_size, grid_size, 1);
+        multi_times[e] = gather_columns(columns.data(), num_columns, len, d_loc, local_size, grid_size, 1);
+    }
+
+    for(int c = 0; c < num_columns && res; c++) {
+        int width = columns[c].width;
+        cl_mem_read(param.queue, columns[c].d_out, (uint64_t)width*len, h_out[c], zero_copy);
+        for(int i = 0; i < len; i++) {
+            if (memcmp(h_out[c] + (uint64_t)i*width, h_in[c] + (uint64_t)h_loc[i]*width, width) != 0) {
+                log_error("Wrong result in column %d at %d", c, i);
+                res = false;
+                break;
+            }
+        }
+    }
+    double separate_time = average_Hampel(separate_times, EXPERIMENT_TIMES);
+    double multi_time = average_Hampel(multi_times, EXPERIMENT_TIMES);
+    log_info("%d columns (%.1f MB): separate=%.1f ms, multi-column=%.1f ms",
+             num_columns, 1.0*total_bytes/1024/1024, separate_time, multi_time);
+
+    for(int c = 0; c < num_columns; c++) {
+        cl_mem_free(columns[c].d_in);
+        cl_mem_free(columns[c].d_out);
+        host_free_aligned(h_in[c]);
+        host_free_aligned(h_out[c]);
+    }
+    cl_mem_free(d_loc);
+    host_free_aligned(h_loc);
+    return res;
+}
+
 /*
  * Usage:
  *    ./test_gather DATA_CARDINALITY
@@ -85,5 +147,6 @@ int main(int argc, const char *argv[]) {
     Plat::plat_init();
     unsigned long long card = stoull(argv[1]);
     assert(test_gather(card));
+    assert(test_gather_columns(card, 8));
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+using namespace std;
+
+static int host_bucket(int key, const bucket_func_t &func) {
+    switch (func.type) {
+        case BUCKET_MOD:    return (int)((unsigned)key % (unsigned)func.buckets);
+        case BUCKET_HASH:   return (int)(((uint64_t)((unsigned)key * 0x9E3779B1u) * (unsigned)func.buckets) >> 32);
+        default:            return (int)(((unsigned)key >> func.shift) & (func.buckets - 1));
+    }
+}
+
+/*
+ *  Histogram test with the given strategy, HIST_AUTO is resolved on the first run
+ * */
+bool test_histogram(const int *h_in, int len, bucket_func_t func, HistStrategy &strategy, double &ave_time) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    double tempTime, *time_recorder = new double[EXPERIMENT_TIMES];
+
+    int *h_his = (int*)host_malloc_aligned(sizeof(int)*func.buckets);
+    vector<int> expected(func.buckets, 0);
+    for(int i = 0; i < len; i++) expected[host_bucket(h_in[i], func)]++;
+
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, (void*)h_in, zero_copy);
+    cl_mem d_his = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*func.buckets, h_his, zero_copy);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        tempTime = histogram(d_in, len, func, d_his, strategy);
+        if (tempTime < 0) {
+            res = false;
+            break;
+        }
+        if (e == 0) {
+            cl_mem_read(param.queue, d_his, sizeof(int)*func.buckets, h_his, zero_copy);
+            for(int b = 0; b < func.buckets; b++) {
+                if (h_his[b] != expected[b]) {
+                    log_error("wrong result at bucket %d, %d, expected %d", b, h_his[b], expected[b]);
+                    res = false;
+                    break;
+                }
+            }
+        }
+        time_recorder[e] = tempTime;
+        if (!res) break;
+    }
+    ave_time = average_Hampel(time_recorder, EXPERIMENT_TIMES);
+
+    cl_mem_free(d_in);
+    cl_mem_free(d_his);
+    host_free_aligned(h_his);
+    if(time_recorder)   delete[] time_recorder;
+
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    int length = (argc > 1) ? stoi(argv[1]) : (1<<25);
+    const char *strategy_names[] = {"auto", "private", "shared", "sort"};
+    const char *func_names[] = {"radix", "mod", "hash"};
+
+    int *h_uniform = (int*)host_malloc_aligned(sizeof(int)*length);
+    int *h_zipf = (int*)host_malloc_aligned(sizeof(int)*length);
+    random_generator_int(h_uniform, length, length, 1234);
+    random_generator_zipf(h_zipf, length, 1<<20, 1.0, 1234);
+
+    for(auto h_in : {h_uniform, h_zipf}) {
+        for(int buckets : {16, 1024, 1<<16}) {
+            for(int f = BUCKET_RADIX; f <= BUCKET_HASH; f++) {
+                bucket_func_t func = {(BucketFunc)f, buckets, 0};
+                for(int s = HIST_AUTO; s <= HIST_SORT; s++) {
+                    HistStrategy strategy = (HistStrategy)s;
+                    double ave_time;
+                    if (test_histogram(h_in, length, func, strategy, ave_time)) {
+                        log_info("%s, %s, buckets=%d, %s%s: time=%.2f ms, throughput=%.1f GB/s",
+                                 (h_in == h_uniform) ? "uniform" : "zipf", func_names[f], buckets,
+                                 strategy_names[s], (s == HIST_AUTO) ? strategy_names[strategy] : "",
+                                 ave_time, compute_bandwidth(length, sizeof(int), ave_time));
+                    }
+                }
+            }
+        }
+    }
+    host_free_aligned(h_uniform);
+    host_free_aligned(h_zipf);
+    return 0;
+}
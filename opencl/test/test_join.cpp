@@ -0,0 +1,125 @@
+//
+//  Created by Zhuohang Lai on 5/16/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+#include <unordered_map>
+using namespace std;
+
+/*
+ *  Partitioned hash join test
+ *  R has unique keys in [0, r_len), S keys are drawn from [0, s_range), so the
+ *  match ratio of S is r_len/s_range. Both payloads are set to the keys so that
+ *  every output pair must hold the same value twice.
+ * */
+bool test_join(int r_len, int s_len, int s_range, double &ave_time,
+               int &res_len, int local_size, Profile *prof=nullptr) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    double tempTime, *time_recorder = new double[EXPERIMENT_TIMES];
+    bool zero_copy = param.host_unified;
+
+    int *h_R_keys = (int*)host_malloc_aligned(sizeof(int)*r_len);
+    int *h_S_keys = (int*)host_malloc_aligned(sizeof(int)*s_len);
+    random_generator_int_unique(h_R_keys, r_len, 1234);
+    random_generator_int(h_S_keys, s_len, s_range, 1234);
+
+    /*payloads equal to the keys*/
+    cl_mem d_R_keys = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*r_len, h_R_keys, zero_copy);
+    cl_mem d_R_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*r_len, h_R_keys, zero_copy);
+    cl_mem d_S_keys = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*s_len, h_S_keys, zero_copy);
+    cl_mem d_S_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*s_len, h_S_keys, zero_copy);
+
+    /*expected number of results*/
+    unordered_map<int,int> r_multiplicity;
+    for(int i = 0; i < r_len; i++) r_multiplicity[h_R_keys[i]]++;
+    long expected = 0;
+    for(int i = 0; i < s_len; i++) {
+        auto it = r_multiplicity.find(h_S_keys[i]);
+        if (it != r_multiplicity.end()) expected += it->second;
+    }
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        Profile *run_prof = (e == 0) ? prof : nullptr;
+        cl_mem d_out_R = 0, d_out_S = 0;
+        tempTime = hash_join(d_R_keys, d_R_values, r_len,
+                             d_S_keys, d_S_values, s_len,
+                             d_out_R, d_out_S, res_len,
+                             local_size, run_prof);
+
+        /*check the result*/
+        if (e == 0) {
+            if (res_len != expected) {
+                log_error("wrong result, %d results, expected %ld", res_len, expected);
+                res = false;
+            }
+            else if (res_len > 0) {
+                int *h_out_R = (int*)host_malloc_aligned(sizeof(int)*res_len);
+                int *h_out_S = (int*)host_malloc_aligned(sizeof(int)*res_len);
+                cl_mem_read(param.queue, d_out_R, sizeof(int)*res_len, h_out_R, false);
+                cl_mem_read(param.queue, d_out_S, sizeof(int)*res_len, h_out_S, false);
+                for(int i = 0; i < res_len; i++) {
+                    if (h_out_R[i] != h_out_S[i]) {
+                        log_error("wrong result, pair %d is (%d, %d)", i, h_out_R[i], h_out_S[i]);
+                        res = false;
+                        break;
+                    }
+                }
+                host_free_aligned(h_out_R);
+                host_free_aligned(h_out_S);
+            }
+        }
+        cl_mem_free(d_out_R);
+        cl_mem_free(d_out_S);
+        time_recorder[e] = tempTime;
+        if (res == false)   break;
+    }
+    ave_time = average_Hampel(time_recorder, EXPERIMENT_TIMES);
+
+    /*memory free*/
+    cl_mem_free(d_R_keys);
+    cl_mem_free(d_R_values);
+    cl_mem_free(d_S_keys);
+    cl_mem_free(d_S_values);
+    host_free_aligned(h_R_keys);
+    host_free_aligned(h_S_keys);
+    if(time_recorder)   delete[] time_recorder;
+
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    int r_len = (argc > 1) ? stoi(argv[1]) : (1<<24);
+    int s_len = (argc > 2) ? stoi(argv[2]) : (1<<24);
+
+    /*per-stage breakdown of a single call*/
+    {
+        Profile prof;
+        double ave_time;
+        int res_len;
+        test_join(r_len, s_len, r_len, ave_time, res_len, 256, &prof);
+        prof.print();
+        prof.export_trace("join_trace.json");
+    }
+
+    /*match ratio of S from 100% down to 12.5%*/
+    for(int ratio = 1; ratio <= 8; ratio <<= 1) {
+        double ave_time;
+        int res_len;
+        if (test_join(r_len, s_len, r_len*ratio, ave_time, res_len, 256)) {
+            double throughput = compute_bandwidth(r_len+s_len, sizeof(int), ave_time);
+            log_info("R=%d, S=%d, match ratio=1/%d, results=%d, time=%.1f ms, throughput=%.1f GB/s",
+                     r_len, s_len, ratio, res_len, ave_time, throughput);
+        }
+        else {
+            log_error("Wrong results");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <cassert>
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+using namespace std;
+
+/*
+ *  Primitives on a key column bit-packed with bits bits against the same
+ *  primitives on the int column: pack/unpack round trip, gather (to ints and
+ *  packed), scan_packed and WG_split_packed
+ * */
+bool test_packed(int len, int bits, int buckets) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    int num_words = packed_words(len, bits);
+    double int_times[EXPERIMENT_TIMES], packed_times[EXPERIMENT_TIMES];
+
+    int *h_in = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_loc = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_out = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_ref = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_start = (int*)host_malloc_aligned(sizeof(int)*buckets);
+    random_generator_int(h_in, len, (bits == 32) ? INT_MAX : (1 << bits), 1234);
+    random_generator_int_unique(h_loc, len, 1234);
+
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in, zero_copy);
+    cl_mem d_loc = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_loc, zero_copy);
+    cl_mem d_out = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*len);
+    cl_mem d_ref = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*len);
+    cl_mem d_start = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*buckets);
+    cl_mem d_packed = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(cl_uint)*num_words);
+    cl_mem d_packed_out = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(cl_uint)*num_words);
+
+    /*1.round trip*/
+    double pack_time = pack_column(d_in, d_packed, len, bits);
+    double unpack_time = unpack_column(d_packed, d_out, len, bits);
+    cl_mem_read(param.queue, d_out, sizeof(int)*len, h_out);
+    for(int i = 0; i < len && res; i++) {
+        if (h_out[i] != h_in[i]) {
+            log_error("Wrong unpacked value at %d: %d, expected %d", i, h_out[i], h_in[i]);
+            res = false;
+        }
+    }
+    log_info("bits=%d: pack time=%.2f ms, unpack time=%.2f ms, %.1f%% of the int column",
+             bits, pack_time, unpack_time, 100.0 * num_words / len);
+
+    /*2.gather into ints and into a packed column*/
+    for(int e = 0; e < EXPERIMENT_TIMES && res; e++) {
+        int_times[e] = gather(d_in, d_ref, len, d_loc, 256, 4096, 1);
+        packed_times[e] = gather_packed(d_packed, bits, d_out, len, d_loc);
+    }
+    double packed_out_time = gather_packed(d_packed, bits, d_packed_out, len, d_loc, true);
+    unpack_column(d_packed_out, d_ref, len, bits);
+    cl_mem_read(param.queue, d_out, sizeof(int)*len, h_out);
+    cl_mem_read(param.queue, d_ref, sizeof(int)*len, h_ref);
+    for(int i = 0; i < len && res; i++) {
+        if ((h_out[i] != h_in[h_loc[i]]) || (h_ref[i] != h_in[h_loc[i]])) {
+            log_error("Wrong gathered value at %d: %d and %d (packed output), expected %d",
+                      i, h_out[i], h_ref[i], h_in[h_loc[i]]);
+            res = false;
+        }
+    }
+    log_info("bits=%d: gather time=%.2f ms, gather_packed time=%.2f ms, with packed output=%.2f ms",
+             bits, average_Hampel(int_times, EXPERIMENT_TIMES),
+             average_Hampel(packed_times, EXPERIMENT_TIMES), packed_out_time);
+
+    /*3.scan, the same wrap-around as the int scan on overflow*/
+    int scan_local_size = 64, scan_grid_size = (int)param.cus - 1;
+    for(int e = 0; e < EXPERIMENT_TIMES && res; e++) {
+        int_times[e] = scan_chained(d_in, d_ref, len, scan_local_size, scan_grid_size, 112, 0);
+        packed_times[e] = scan_packed(d_packed, bits, d_out, len, scan_local_size, scan_grid_size, 112, 0);
+    }
+    cl_mem_read(param.queue, d_out, sizeof(int)*len, h_out);
+    cl_mem_read(param.queue, d_ref, sizeof(int)*len, h_ref);
+    if (res && memcmp(h_out, h_ref, sizeof(int)*len) != 0) {
+        log_error("Wrong result of scan_packed");
+        res = false;
+    }
+    log_info("bits=%d: scan_chained time=%.2f ms, scan_packed time=%.2f ms", bits,
+             average_Hampel(int_times, EXPERIMENT_TIMES), average_Hampel(packed_times, EXPERIMENT_TIMES));
+
+    /*4.split, every key lies in the range of its bucket*/
+    for(int e = 0; e < EXPERIMENT_TIMES && res; e++) {
+        int_times[e] = WG_split(d_in, d_ref, 0, len, buckets, NO_REORDER, KO);
+        packed_times[e] = WG_split_packed(d_packed, bits, d_out, d_start, len, buckets, KO);
+    }
+    cl_mem_read(param.queue, d_out, sizeof(int)*len, h_out);
+    cl_mem_read(param.queue, d_start, sizeof(int)*buckets, h_start);
+    long long sum_in = 0, sum_out = 0;
+    for(int i = 0; i < len; i++) {
+        sum_in += h_in[i];
+        sum_out += h_out[i];
+    }
+    if (res && sum_in != sum_out) {
+        log_error("Wrong result of WG_split_packed: keys are lost");
+        res = false;
+    }
+    for(int b = 0; b < buckets && res; b++) {
+        int end = (b == buckets - 1) ? len : h_start[b+1];
+        for(int i = h_start[b]; i < end; i++) {
+            if ((h_out[i] & (buckets - 1)) != b) {
+                log_error("Wrong result of WG_split_packed in bucket %d at %d", b, i);
+                res = false;
+                break;
+            }
+        }
+    }
+    log_info("bits=%d: WG_split time=%.2f ms, WG_split_packed time=%.2f ms", bits,
+             average_Hampel(int_times, EXPERIMENT_TIMES), average_Hampel(packed_times, EXPERIMENT_TIMES));
+
+    cl_mem_free(d_in);
+    cl_mem_free(d_loc);
+    cl_mem_free(d_out);
+    cl_mem_free(d_ref);
+    cl_mem_free(d_start);
+    cl_mem_free(d_packed);
+    cl_mem_free(d_packed_out);
+    host_free_aligned(h_in);
+    host_free_aligned(h_loc);
+    host_free_aligned(h_out);
+    host_free_aligned(h_ref);
+    host_free_aligned(h_start);
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    int len = (argc > 1) ? stoi(argv[1]) : 1<<24;
+
+    for(int bits : {8, 13, 24, 32})
+        assert(test_packed(len, bits, 256));
+    return 0;
+}
@@ -0,0 +1,92 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <cmath>
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+using namespace std;
+
+/*host reference, sums are accumulated in double for the floating-point types*/
+template<typename T>
+static double host_reduce(const T *h_in, int len, ReduceOp op) {
+    double acc = (op == REDUCE_SUM || op == REDUCE_COUNT || len == 0) ? 0 : (double)h_in[0];
+    T acc_int = 0;
+    for(int i = 0; i < len; i++) {
+        switch (op) {
+            case REDUCE_SUM:    acc += h_in[i]; acc_int += h_in[i]; break;
+            case REDUCE_MIN:    acc = std::min(acc, (double)h_in[i]); break;
+            case REDUCE_MAX:    acc = std::max(acc, (double)h_in[i]); break;
+            case REDUCE_COUNT:  acc += 1; break;
+        }
+    }
+    return (op == REDUCE_SUM && std::is_integral<T>::value) ? (double)acc_int : acc;
+}
+
+/*
+ *  Reduction test, integers are uniform in [0, 1024), floating-point values in [0, 1)
+ * */
+template<typename T>
+bool test_reduce(int len, ReduceOp op, double &ave_time) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    double tempTime, *time_recorder = new double[EXPERIMENT_TIMES];
+
+    T *h_in = (T*)host_malloc_aligned(sizeof(T)*len);
+    srand(1234);
+    for(int i = 0; i < len; i++) {
+        if (std::is_integral<T>::value) h_in[i] = (T)(rand() & 1023);
+        else                            h_in[i] = (T)rand() / RAND_MAX;
+    }
+    double expected = host_reduce(h_in, len, op);
+    cl_mem d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(T)*len, h_in, zero_copy);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        T result;
+        tempTime = reduce(d_in, len, op, result);
+
+        /*floating-point sums depend on the reduction order*/
+        double tolerance = std::is_integral<T>::value ? 0 : 1e-4 * fabs(expected);
+        if (e == 0 && fabs((double)result - expected) > tolerance) {
+            log_error("wrong result, %.4f, expected %.4f", (double)result, expected);
+            res = false;
+            break;
+        }
+        time_recorder[e] = tempTime;
+    }
+    ave_time = average_Hampel(time_recorder, EXPERIMENT_TIMES);
+
+    cl_mem_free(d_in);
+    host_free_aligned(h_in);
+    if(time_recorder)   delete[] time_recorder;
+
+    return res;
+}
+
+template<typename T>
+void test_all_ops(int length, const char *type_name) {
+    const char *op_names[] = {"sum", "min", "max", "count"};
+    for(int o = REDUCE_SUM; o <= REDUCE_COUNT; o++) {
+        double ave_time;
+        if (test_reduce<T>(length, (ReduceOp)o, ave_time)) {
+            log_info("%s %s: time=%.2f ms, throughput=%.1f GB/s", type_name, op_names[o],
+                     ave_time, compute_bandwidth(length, sizeof(T), ave_time));
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    int length = (argc > 1) ? stoi(argv[1]) : (1<<25);
+
+    test_all_ops<cl_int>(length, "int32");
+    test_all_ops<cl_long>(length, "int64");
+    test_all_ops<cl_float>(length, "float");
+    test_all_ops<cl_double>(length, "double");
+    return 0;
+}
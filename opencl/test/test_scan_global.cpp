@@ -12,8 +12,9 @@ bool test_scan(int len, double &ave_time, int local_size, int grid_size, scan_ar
     bool res = true;
     device_param_t param = Plat::get_device_param();
 
-    int *h_input = new int[len];
-    int *h_output = new int[len];
+    bool zero_copy = param.host_unified;
+    int *h_input = (int*)host_malloc_aligned(sizeof(int)*len);
+    int *h_output = (int*)host_malloc_aligned(sizeof(int)*len);
     cl_mem d_in, d_out;
 
     srand(time(nullptr));
@@ -26,13 +27,8 @@ bool test_scan(int len, double &ave_time, int local_size, int grid_size, scan_ar
     auto algo = arg.algo;
     double record_times[EXPERIMENT_TIMES], cur_time;
     for(int e = 0; e < EXPERIMENT_TIMES; e++) {
-        d_in = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int) * len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
-        d_out = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(int) * len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
-
-        status = clEnqueueWriteBuffer(param.queue, d_in, CL_TRUE, 0, sizeof(int) * len, h_input, 0, 0, 0);
-        checkErr(status, ERR_WRITE_BUFFER);
+        d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_WRITE, sizeof(int) * len, h_input, zero_copy);
+        d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int) * len, h_output, zero_copy);
         clFinish(param.queue);
 
         switch (algo) {
@@ -49,11 +45,7 @@ bool test_scan(int len, double &ave_time, int local_size, int grid_size, scan_ar
                 break;
             }
         }
-        status = clEnqueueReadBuffer(param.queue, d_out, CL_TRUE, 0, sizeof(int) * len,
-                                     h_output, 0, nullptr, nullptr);
-
-        checkErr(status, ERR_READ_BUFFER);
-        status = clFinish(param.queue);
+        cl_mem_read(param.queue, d_out, sizeof(int) * len, h_output, zero_copy);
         status = clReleaseMemObject(d_in);
         checkErr(status, ERR_RELEASE_MEM);
         status = clReleaseMemObject(d_out);
@@ -74,8 +66,8 @@ bool test_scan(int len, double &ave_time, int local_size, int grid_size, scan_ar
         if(!res) break;
         record_times[e] = cur_time;
     }
-    if(h_input) delete[] h_input;
-    if(h_output) delete[] h_output;
+    host_free_aligned(h_input);
+    host_free_aligned(h_output);
 
     if (!res) return res;
     ave_time = average_Hampel(record_times, EXPERIMENT_TIMES);
@@ -6,11 +6,27 @@
 #include "log.h"
 #include "../params.h"
 #include "../types.h"
+#include "../typed_primitives.h"
+
+/*prim::split on the bucket counts tested in main, the bucket count is a template parameter*/
+template<int Buckets>
+double typed_split(cl_mem d_in, cl_mem d_out, int len, DataStruc structure,
+                   cl_mem d_in_values, cl_mem d_out_values,
+                   int local_size, int grid_size, Profile *prof) {
+    if (structure == KO)
+        return prim::split<int, void, prim::SOA, Buckets>(d_in, d_out, 0, len, 0, 0, local_size, grid_size, prof);
+    else if (structure == KVS_SOA)
+        return prim::split<int, int, prim::SOA, Buckets>(d_in, d_out, 0, len, d_in_values, d_out_values,
+                                                         local_size, grid_size, prof);
+    return prim::split<int, int, prim::AOS, Buckets>(d_in, d_out, 0, len, 0, 0, local_size, grid_size, prof);
+}
 
 bool test_split(int len, int buckets, double &ave_time,
                 SPLIT_ALGO algo, // WI_split, WG_split, WG_reorder_split, Single_split, Single_reorder_split
                 DataStruc structure, //KO, AOS or SOA
-                int local_size, int grid_size) {
+                int local_size, int grid_size,
+                Profile *prof=nullptr,  /*if set, the first run is profiled*/
+                double zipf_alpha=0) {  /*0: uniform keys, otherwise Zipf keys with this exponent*/
     log_trace("Function: %s", __FUNCTION__);
     device_param_t param = Plat::get_device_param();
 
@@ -23,13 +39,18 @@ bool test_split(int len, int buckets, double &ave_time,
 
     cl_mem d_in_keys=0, d_in_values=0, d_out_keys=0, d_out_values=0;
     cl_mem d_in=0, d_out=0;
-
-    /*host memory allocation & initialization*/
-    h_in_keys = new int[len];
-    h_out_keys = new int[len];
-    h_in_values = new int[len];
-    h_out_values = new int[len];
-    random_generator_int(h_in_keys, len, len, 1234);
+    cl_mem d_start=0;                           /*for WG_skew*/
+    int heavy_keys[SPLIT_MAX_HEAVY], num_heavy = 0;
+    int *h_start = new int[buckets+SPLIT_MAX_HEAVY];
+
+    /*host memory allocation & initialization (page-aligned for zero-copy buffers)*/
+    bool zero_copy = param.host_unified;
+    h_in_keys = (int*)host_malloc_aligned(sizeof(int)*len);
+    h_out_keys = (int*)host_malloc_aligned(sizeof(int)*len);
+    h_in_values = (int*)host_malloc_aligned(sizeof(int)*len);
+    h_out_values = (int*)host_malloc_aligned(sizeof(int)*len);
+    if (zipf_alpha > 0) random_generator_zipf(h_in_keys, len, std::min(len, 1<<20), zipf_alpha, 1234);
+    else                random_generator_int(h_in_keys, len, len, 1234);
 #pragma omp parallel for
     for(auto i = 0; i < len; i++) { /*all values set to SPLIT_VALUE_DEFAULT*/
         h_in_values[i] = SPLIT_VALUE_DEFAULT;
@@ -37,45 +58,26 @@ bool test_split(int len, int buckets, double &ave_time,
 
     if (structure == KVS_AOS) { /*KVS_AOS*/
         /*extra host memory initialization*/
-        h_in = new tuple_t[len];
-        h_out = new tuple_t[len];
+        h_in = (tuple_t*)host_malloc_aligned(sizeof(tuple_t)*len);
+        h_out = (tuple_t*)host_malloc_aligned(sizeof(tuple_t)*len);
         for(int i = 0; i < len; i++) {
             h_in[i].x = h_in_keys[i];
             h_in[i].y = h_in_values[i];
         }
 
-        /*device memory initialization*/
-        d_in = clCreateBuffer(param.context, CL_MEM_READ_ONLY, sizeof(tuple_t)*len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
-        d_out = clCreateBuffer(param.context, CL_MEM_READ_WRITE, sizeof(tuple_t)*len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
-
-        /*memory copy*/
-        status = clEnqueueWriteBuffer(param.queue, d_in, CL_TRUE, 0, sizeof(tuple_t)*len, h_in, 0, 0, 0);
-        checkErr(status, ERR_WRITE_BUFFER);
+        /*device memory initialization, copied only if the device is not host-unified*/
+        d_in = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(tuple_t)*len, h_in, zero_copy);
+        d_out = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(tuple_t)*len, h_out, zero_copy);
     }
     else {      /*KO or KVS_SOA*/
         /*device memory initialization*/
-        d_in_keys = clCreateBuffer(param.context, CL_MEM_READ_ONLY, sizeof(int)*len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
-        d_out_keys = clCreateBuffer(param.context, CL_MEM_WRITE_ONLY, sizeof(int)*len, nullptr, &status);
-        checkErr(status, ERR_HOST_ALLOCATION);
-
-        /*memory copy*/
-        status = clEnqueueWriteBuffer(param.queue, d_in_keys, CL_TRUE, 0, sizeof(int)*len, h_in_keys, 0, 0, 0);
-        checkErr(status, ERR_WRITE_BUFFER);
+        d_in_keys = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in_keys, zero_copy);
+        d_out_keys = cl_mem_create_output(param.context, CL_MEM_WRITE_ONLY, sizeof(int)*len, h_out_keys, zero_copy);
 
         /*further initialize the values*/
         if(structure == KVS_SOA) {
-            /*device memory initialization*/
-            d_in_values = clCreateBuffer(param.context, CL_MEM_READ_ONLY, sizeof(int)*len, nullptr, &status);
-            checkErr(status, ERR_HOST_ALLOCATION);
-            d_out_values = clCreateBuffer(param.context, CL_MEM_WRITE_ONLY, sizeof(int)*len, nullptr, &status);
-            checkErr(status, ERR_HOST_ALLOCATION);
-
-            /*memory copy*/
-            status = clEnqueueWriteBuffer(param.queue, d_in_values, CL_TRUE, 0, sizeof(int)*len, h_in_values, 0, 0, 0);
-            checkErr(status, ERR_WRITE_BUFFER);
+            d_in_values = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len, h_in_values, zero_copy);
+            d_out_values = cl_mem_create_output(param.context, CL_MEM_WRITE_ONLY, sizeof(int)*len, h_out_values, zero_copy);
         }
     }
 
@@ -91,55 +93,94 @@ bool test_split(int len, int buckets, double &ave_time,
 
     for(int e = 0; e < EXPERIMENT_TIMES; e++) {
         if (res == false)   break;
+        Profile *run_prof = (e == 0) ? prof : nullptr;
         switch (algo) {
             case WI:     /*WI-level split*/
                 tempTime = WI_split(
                         d_in_unified, d_out_unified, 0,
                         len, buckets, structure,
                         d_in_values, d_out_values,
-                        local_size, grid_size);
+                        local_size, grid_size, run_prof);
                 break;
             case WG:     /*WG-level split*/
                 tempTime = WG_split(
                         d_in_unified, d_out_unified, 0,
                         len, buckets, NO_REORDER, structure,
                         d_in_values, d_out_values,
-                        local_size, grid_size);
+                        local_size, grid_size, run_prof);
                 break;
             case WG_varied_reorder:     /*WG-level split, reorder*/
                 tempTime = WG_split(
                         d_in_unified, d_out_unified, 0,
                         len, buckets, VARIED_REORDER, structure,
                         d_in_values, d_out_values,
-                        local_size, grid_size);
+                        local_size, grid_size, run_prof);
                 break;
             case WG_fixed_reorder:     /*WG-level split, reorder*/
                 tempTime = WG_split(
                         d_in_unified, d_out_unified, 0,
                         len, buckets, FIXED_REORDER, structure,
                         d_in_values, d_out_values,
-                        local_size, grid_size);
+                        local_size, grid_size, run_prof);
                 break;
             case Single:     /*WG-level split, reorder*/
                 tempTime = single_split(
                         d_in_unified, d_out_unified,
-                        len, buckets, false, structure);
+                        len, buckets, false, structure, run_prof);
                 break;
             case Single_reorder:     /*WG-level split, reorder*/
                 tempTime = single_split(
                         d_in_unified, d_out_unified,
-                        len, buckets, true, structure);
+                        len, buckets, true, structure, run_prof);
+                break;
+            case WG_skew:     /*WG-level split, heavy hitters out of band*/
+                if (d_start == 0) {
+                    d_start = clCreateBuffer(param.context, CL_MEM_READ_WRITE,
+                                             sizeof(int)*(buckets+SPLIT_MAX_HEAVY), nullptr, &status);
+                    checkErr(status, ERR_HOST_ALLOCATION);
+                }
+                tempTime = WG_split_skew(
+                        d_in_unified, d_out_unified, d_start,
+                        len, buckets, structure,
+                        heavy_keys, num_heavy,
+                        d_in_values, d_out_values,
+                        local_size, grid_size, run_prof);
+                break;
+            case WG_radix:     /*two LSD passes of half of the bits*/
+            case WG_radix_fused:
+            {
+                int bits = 0;
+                while ((1 << bits) < buckets) bits++;
+                tempTime = WG_radix_split(
+                        d_in_unified, d_out_unified,
+                        len, bits, (bits + 1) / 2,
+                        algo == WG_radix_fused, structure,
+                        d_in_values, d_out_values,
+                        local_size, grid_size, run_prof);
+                break;
+            }
+            case WG_typed:     /*WG-level split, buckets compiled in*/
+            {
+                auto func = (buckets == 16) ? typed_split<16> :
+                            (buckets == 256) ? typed_split<256> :
+                            (buckets == 4096) ? typed_split<4096> : nullptr;
+                if (func == nullptr) {
+                    log_error("No typed split on %d buckets", buckets);
+                    return false;
+                }
+                tempTime = func(
+                        d_in_unified, d_out_unified,
+                        len, structure,
+                        d_in_values, d_out_values,
+                        local_size, grid_size, run_prof);
                 break;
+            }
         }
 
         /*check the result*/
         if (e == 0) {
             if (structure == KVS_AOS) {
-                status = clEnqueueReadBuffer(
-                        param.queue, d_out, CL_TRUE, 0,
-                        sizeof(tuple_t)*len, h_out, 0, 0, 0);
-                checkErr(status, ERR_READ_BUFFER);
-                status = clFinish(param.queue);
+                cl_mem_read(param.queue, d_out, sizeof(tuple_t)*len, h_out, zero_copy);
                 /*initialize only for checking*/
 
                 for(int i = 0; i < len; i++) {
@@ -148,18 +189,11 @@ bool test_split(int len, int buckets, double &ave_time,
                 }
             }
             else {
-                status = clEnqueueReadBuffer(
-                        param.queue, d_out_keys, CL_TRUE, 0,
-                        sizeof(int) * len, h_out_keys, 0, 0, 0);
-                checkErr(status, ERR_READ_BUFFER);
+                cl_mem_read(param.queue, d_out_keys, sizeof(int) * len, h_out_keys, zero_copy);
                 if (structure == KVS_SOA) {
-                    status = clEnqueueReadBuffer(
-                            param.queue, d_out_values, CL_TRUE, 0,
-                            sizeof(int) * len, h_out_values, 0, 0, 0);
-                    checkErr(status, ERR_READ_BUFFER);
+                    cl_mem_read(param.queue, d_out_values, sizeof(int) * len, h_out_values, zero_copy);
                 }
             }
-            status = clFinish(param.queue);
 
             /*check the sum*/
             unsigned mask = buckets - 1;
@@ -201,6 +235,25 @@ bool test_split(int len, int buckets, double &ave_time,
                 log_error("right: %d, output: %d", check_total_in, check_total_out);
                 break;
             }
+
+            /*check the heavy-hitter regions*/
+            if (algo == WG_skew && num_heavy > 0) {
+                log_info("%d heavy hitters", num_heavy);
+                status = clEnqueueReadBuffer(param.queue, d_start, CL_TRUE, 0,
+                                             sizeof(int)*(buckets+num_heavy), h_start, 0, 0, 0);
+                checkErr(status, ERR_READ_BUFFER);
+                for(int h = 0; h < num_heavy && res; h++) {
+                    int slot = (heavy_keys[h] & mask) + h + 1;
+                    int end = (slot + 1 < buckets + num_heavy) ? h_start[slot+1] : len;
+                    for(int i = h_start[slot]; i < end; i++) {
+                        if (h_out_keys[i] != heavy_keys[h]) {
+                            res = false;
+                            log_error("wrong result, heavy hitter %d not in its region", heavy_keys[h]);
+                            break;
+                        }
+                    }
+                }
+            }
         }
         time_recorder[e] = tempTime;
     }
@@ -213,13 +266,15 @@ bool test_split(int len, int buckets, double &ave_time,
     cl_mem_free(d_out_values);
     cl_mem_free(d_in);
     cl_mem_free(d_out);
-
-    if(h_in_keys)       delete[] h_in_keys;
-    if(h_out_keys)      delete[] h_out_keys;
-    if(h_in_values)     delete[] h_in_values;
-    if(h_out_values)    delete[] h_out_values;
-    if(h_in)            delete[] h_in;
-    if(h_out)           delete[] h_out;
+    cl_mem_free(d_start);
+    delete[] h_start;
+
+    host_free_aligned(h_in_keys);
+    host_free_aligned(h_out_keys);
+    host_free_aligned(h_in_values);
+    host_free_aligned(h_out_values);
+    host_free_aligned(h_in);
+    host_free_aligned(h_out);
     if(time_recorder)   delete[] time_recorder;
 
     return res;
@@ -361,11 +416,58 @@ int main(int argc, char *argv[]) {
     Plat::plat_init();
     int length = 1<<25;
 
+    /*per-stage breakdown of a single call, viewable in chrome://tracing or ui.perfetto.dev*/
+    {
+        Profile prof;
+        double ave_time;
+        test_split(length, 1024, ave_time, WG_varied_reorder, KO, 256, 32768, &prof);
+        prof.print();
+        prof.export_trace("split_trace.json");
+    }
+
     cout<<"WG_varied_reorder, KO:"<<endl;
     for (int buckets = 2; buckets <= 4096; buckets <<= 1) {
         double ave_time;
         test_split(length, buckets, ave_time, WG_varied_reorder, KO, 256, 32768);
         log_info("Buckets=%d, time=%.1f ms", buckets, ave_time);
     }
+
+    /*fan-outs whose histogram exceeds the local memory, split in two levels*/
+    cout<<"WG, KVS_SOA, large fan-outs:"<<endl;
+    for (int buckets = 1<<14; buckets <= (1<<20); buckets <<= 2) {
+        double ave_time;
+        if (test_split(length, buckets, ave_time, WG, KVS_SOA, 256, 1024))
+            log_info("Buckets=%d, time=%.1f ms", buckets, ave_time);
+    }
+
+    /*Zipf keys: plain WG split against the skew-aware one*/
+    for(auto algo : {WG, WG_skew}) {
+        cout<<((algo == WG) ? "WG" : "WG_skew")<<", KVS_SOA, Zipf keys (alpha=1):"<<endl;
+        for (int buckets = 16; buckets <= 4096; buckets <<= 2) {
+            double ave_time;
+            if (test_split(length, buckets, ave_time, algo, KVS_SOA, 256, 32768, nullptr, 1.0))
+                log_info("Buckets=%d, time=%.1f ms", buckets, ave_time);
+        }
+    }
+
+    /*runtime bucket count against the one compiled into the kernels*/
+    for(auto algo : {WG, WG_typed}) {
+        cout<<((algo == WG) ? "WG" : "WG_typed")<<", KVS_SOA:"<<endl;
+        for (int buckets = 16; buckets <= 4096; buckets <<= 4) {
+            double ave_time;
+            if (test_split(length, buckets, ave_time, algo, KVS_SOA, 256, 32768))
+                log_info("Buckets=%d, time=%.1f ms", buckets, ave_time);
+        }
+    }
+
+    /*two-pass radix split, the fused one counts the second histogram in the first shuffle*/
+    for(auto algo : {WG_radix, WG_radix_fused}) {
+        cout<<((algo == WG_radix) ? "WG_radix" : "WG_radix_fused")<<", KVS_SOA:"<<endl;
+        for (int buckets = 1<<8; buckets <= (1<<16); buckets <<= 4) {
+            double ave_time;
+            if (test_split(length, buckets, ave_time, algo, KVS_SOA, 256, 32768))
+                log_info("Buckets=%d, time=%.1f ms", buckets, ave_time);
+        }
+    }
     return 0;
 }
\ No newline at end of file
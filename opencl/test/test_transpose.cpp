@@ -0,0 +1,87 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <cassert>
+#include <cstring>
+#include "Plat.h"
+#include "log.h"
+#include "../params.h"
+#include "../types.h"
+using namespace std;
+
+/*
+ *  AOS -> SOA -> AOS round trip of len records of num_fields ints
+ * */
+bool test_transpose(int len, int num_fields, double &aos_soa_time, double &soa_aos_time) {
+    log_trace("Function: %s", __FUNCTION__);
+    device_param_t param = Plat::get_device_param();
+
+    bool res = true;
+    bool zero_copy = param.host_unified;
+    double aos_soa_recorder[EXPERIMENT_TIMES], soa_aos_recorder[EXPERIMENT_TIMES];
+
+    int *h_records = (int*)host_malloc_aligned(sizeof(int)*len*num_fields);
+    int *h_back = (int*)host_malloc_aligned(sizeof(int)*len*num_fields);
+    int *h_field = (int*)host_malloc_aligned(sizeof(int)*len);
+    random_generator_int(h_records, len*num_fields, len, 1234);
+
+    cl_mem d_records = cl_mem_create(param.context, param.queue, CL_MEM_READ_ONLY, sizeof(int)*len*num_fields, h_records, zero_copy);
+    cl_mem d_back = cl_mem_create_output(param.context, CL_MEM_READ_WRITE, sizeof(int)*len*num_fields, h_back, zero_copy);
+    cl_mem d_fields[8];
+    for(int f = 0; f < num_fields; f++)
+        d_fields[f] = cl_mem_alloc(param.context, CL_MEM_READ_WRITE, sizeof(int)*len);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        aos_soa_recorder[e] = aos_to_soa(d_records, d_fields, num_fields, len);
+        soa_aos_recorder[e] = soa_to_aos(d_fields, d_back, num_fields, len);
+        if ((aos_soa_recorder[e] < 0) || (soa_aos_recorder[e] < 0)) {
+            res = false;
+            break;
+        }
+        if (e == 0) {
+            for(int f = 0; f < num_fields && res; f++) {
+                cl_mem_read(param.queue, d_fields[f], sizeof(int)*len, h_field, false);
+                for(int i = 0; i < len; i++) {
+                    if (h_field[i] != h_records[i*num_fields+f]) {
+                        log_error("Wrong SOA result in field %d at %d: %d, expected %d",
+                                  f, i, h_field[i], h_records[i*num_fields+f]);
+                        res = false;
+                        break;
+                    }
+                }
+            }
+            cl_mem_read(param.queue, d_back, sizeof(int)*len*num_fields, h_back, zero_copy);
+            if (res && memcmp(h_back, h_records, sizeof(int)*len*num_fields) != 0) {
+                log_error("Wrong AOS result after the round trip");
+                res = false;
+            }
+        }
+        if (!res) break;
+    }
+    aos_soa_time = average_Hampel(aos_soa_recorder, EXPERIMENT_TIMES);
+    soa_aos_time = average_Hampel(soa_aos_recorder, EXPERIMENT_TIMES);
+
+    cl_mem_free(d_records);
+    cl_mem_free(d_back);
+    for(int f = 0; f < num_fields; f++) cl_mem_free(d_fields[f]);
+    host_free_aligned(h_records);
+    host_free_aligned(h_back);
+    host_free_aligned(h_field);
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    Plat::plat_init();
+    int len = (argc > 1) ? stoi(argv[1]) : 1<<24;
+
+    for(int num_fields : {2, 4, 8}) {
+        double aos_soa_time, soa_aos_time;
+        assert(test_transpose(len, num_fields, aos_soa_time, soa_aos_time));
+        /*every record is read once and written once*/
+        log_info("fields=%d: aos_to_soa time=%.2f ms (%.1f GB/s), soa_to_aos time=%.2f ms (%.1f GB/s)",
+                 num_fields, aos_soa_time, 2.0*len*num_fields*sizeof(int)/aos_soa_time/1e6,
+                 soa_aos_time, 2.0*len*num_fields*sizeof(int)/soa_aos_time/1e6);
+    }
+    return 0;
+}
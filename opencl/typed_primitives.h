@@ -0,0 +1,75 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#pragma once
+
+#include <algorithm>
+#include <type_traits>
+#include "Plat.h"
+#include "primitives.h"
+
+/*
+ * Typed split, scan and gather with the template parameters of
+ * openmp/typed_primitives.h. The parameters select the compilation flags of
+ * the kernels: the layout is -DKO, -DKVS_SOA or -DKVS_AOS, the bucket count is
+ * -DBUCKETS and the element width of the gather is the COL_TYPE of
+ * gather_columns. The kernels are built per instantiation by get_kernel.
+ *
+ * The kernels only move 4-byte keys and payloads (8-byte gather elements),
+ * other types fail to compile.
+ * */
+namespace prim {
+
+/*layouts of the split tuples*/
+struct SOA {};      /*keys and payloads in separate buffers*/
+struct AOS {};      /*buffer of tuple_t*/
+
+/*DataStruc of the split kernels*/
+template<typename Key, typename Payload, typename Layout>
+struct split_structure;
+
+template<> struct split_structure<int, void, SOA>     { static const DataStruc value = KO; };
+template<> struct split_structure<int, int, SOA>      { static const DataStruc value = KVS_SOA; };
+template<> struct split_structure<int, int, AOS>      { static const DataStruc value = KVS_AOS; };
+
+/*
+ * WG_split_const into Buckets buckets, d_in_values and d_out_values are the
+ * payload buffers of SOA
+ *      split<int, void, SOA, Buckets>:    keys only
+ *      split<int, int, SOA, Buckets>:     keys and payloads in two buffers
+ *      split<int, int, AOS, Buckets>:     tuple_t buffers
+ * */
+template<typename Key, typename Payload, typename Layout, int Buckets>
+double split(cl_mem d_in, cl_mem d_out, cl_mem d_start, int length,
+             cl_mem d_in_values=0, cl_mem d_out_values=0,
+             int local_size=256, int grid_size=32768, Profile *prof=nullptr) {
+    static_assert(Buckets > 0 && (Buckets & (Buckets - 1)) == 0, "Buckets should be a power of 2");
+    return WG_split_const(d_in, d_out, d_start, length, Buckets,
+                          split_structure<Key, Payload, Layout>::value,
+                          d_in_values, d_out_values, local_size, grid_size, prof);
+}
+
+/*exclusive scan_chained, grid_size 0 takes all the CUs but one*/
+template<typename T, ReduceOp Op>
+double scan(cl_mem d_in, cl_mem d_out, int length,
+            int local_size=64, int grid_size=0, int R=112, int L=0, Profile *prof=nullptr) {
+    static_assert(std::is_same<T, int>::value && Op == REDUCE_SUM, "the scan kernels only sum ints");
+    if (grid_size == 0) grid_size = std::max((int)Plat::get_device_param().cus - 1, 1);
+    return scan_chained(d_in, d_out, length, local_size, grid_size, R, L, prof);
+}
+
+/*gather (d_out[i] = d_in[d_loc[i]]) of 4-byte or 8-byte elements in pass passes*/
+template<typename T, typename Idx>
+double gather(cl_mem d_in, cl_mem d_out, cl_mem d_loc, int length,
+              int local_size=256, int grid_size=32768, int pass=1, Profile *prof=nullptr) {
+    static_assert(sizeof(T) == sizeof(cl_int) || sizeof(T) == sizeof(cl_int2), "gather elements should be 4 or 8 bytes");
+    static_assert(std::is_same<Idx, int>::value, "the gather kernels take int indexes");
+    column_t column;
+    column.d_in = d_in;
+    column.d_out = d_out;
+    column.width = sizeof(T);
+    return gather_columns(&column, 1, length, d_loc, local_size, grid_size, pass, prof);
+}
+
+} /*namespace prim*/
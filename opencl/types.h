@@ -35,14 +35,63 @@ enum DataStruc {
  * WG: work-group level split
  * WG_reorder_fixed: work-group level split with fixed-length reorder buffers
  * WG_reorder_varied: work-group level split with varied-length reorder buffers
+ * WG_skew: work-group level split with heavy hitters in dedicated regions
  *
  * */
 enum SPLIT_ALGO {
-    WI, WG, WG_fixed_reorder, WG_varied_reorder, Single, Single_reorder
+    WI, WG, WG_fixed_reorder, WG_varied_reorder, Single, Single_reorder, WG_skew,
+    WG_radix, WG_radix_fused,   /*two LSD passes, see WG_radix_split*/
+    WG_typed                    /*WG without reordering, buckets compiled in, see typed_primitives.h*/
 };
 
 enum ReorderType {
     NO_REORDER, FIXED_REORDER, VARIED_REORDER
 };
 
-typedef cl_int2 tuple_t;    /*for AOS*/
\ No newline at end of file
+typedef cl_int2 tuple_t;    /*for AOS*/
+
+/*a payload column of the multi-column gather and scatter*/
+struct column_t {
+    cl_mem d_in;
+    cl_mem d_out;
+    int width;          /*bytes per element, 4 or 8*/
+};
+
+/*filter predicates*/
+enum PredType {
+    PRED_EQ, PRED_NE, PRED_LT, PRED_LE, PRED_GT, PRED_GE,  /*key compared to low*/
+    PRED_RANGE,                                             /*low <= key < high*/
+    PRED_BITMAP                                             /*bit key of the bitmap is set, keys out of [0, bitmap_bits) fail*/
+};
+
+struct predicate_t {
+    PredType type;
+    int low;
+    int high;
+    cl_mem bitmap;      /*bitmap_bits bits in 32-bit words*/
+    int bitmap_bits;
+};
+
+/*key to bucket functions of the histogram*/
+enum BucketFunc {
+    BUCKET_RADIX,       /*(key >> shift) & (buckets-1), buckets is a power of 2*/
+    BUCKET_MOD,         /*key mod buckets*/
+    BUCKET_HASH         /*multiplicative hash of the key, scaled to [0, buckets)*/
+};
+
+struct bucket_func_t {
+    BucketFunc type;
+    int buckets;
+    int shift;          /*only for BUCKET_RADIX*/
+};
+
+/*histogram strategies, HIST_AUTO decides from a sample of the keys*/
+enum HistStrategy {
+    HIST_AUTO,
+    HIST_PRIVATE,       /*private histogram per WI*/
+    HIST_SHARED,        /*shared histogram per WG with atomics*/
+    HIST_SORT           /*tiles sorted by bucket, one update per run*/
+};
+
+/*reduction operators*/
+enum ReduceOp {REDUCE_SUM, REDUCE_MIN, REDUCE_MAX, REDUCE_COUNT};
\ No newline at end of file
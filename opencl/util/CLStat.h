@@ -0,0 +1,183 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+/*OpenCL memory and time stat classes, the counterparts of cuda/util/CUDAStat.cuh*/
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include "log.h"
+
+/*memory statistics*/
+class CLMemStat {
+private:
+    long cur_use; //current use of memory in bytes
+    long max_use; //maximum use of memory in bytes
+    long acc_use; //accumulated memory used in bytes
+    long untracked; //releases of objects allocated outside of the wrappers
+
+    std::map<unsigned long, long> addr_bytes; //store the allocated address and sizes
+public:
+    CLMemStat() {
+        reset();
+    }
+    void malloc_mem_stat(unsigned long addr, long add_bytes) {
+        cur_use += add_bytes;
+        acc_use += add_bytes;
+        if (cur_use > max_use) {
+            max_use = cur_use;
+        }
+
+        /*record the allocated address and memory size*/
+        addr_bytes[addr] = add_bytes;
+    }
+    void delete_mem_stat(unsigned long addr) {
+        auto iter = addr_bytes.find(addr);
+        if (iter == addr_bytes.end()) { /*e.g., a clCreateBuffer in a test released with cl_mem_free*/
+            untracked++;
+            return;
+        }
+
+        long delete_bytes = iter->second;
+        addr_bytes.erase(iter); //remove the address
+        cur_use -= delete_bytes;
+        assert(cur_use >= 0);
+    }
+    long get_max_use() {
+        return max_use;
+    }
+    long get_acc_use() {
+        return acc_use;
+    }
+    long get_cur_use() {
+        return cur_use;
+    }
+    long get_untracked() {
+        return untracked;
+    }
+    void reset() {
+        cur_use = 0;
+        max_use = 0;
+        acc_use = 0;
+        untracked = 0;
+
+        addr_bytes.clear();
+    }
+};
+
+/*time statistics*/
+class CLTimeStat {
+private:
+    uint32_t idx;                               //current start idx of the kernel interested
+    std::vector<std::string> file_name;         //name of the file the kernel is invoked in
+    std::vector<std::string> host_func_name;    //name of the host function the kernel is invoked in
+    std::vector<std::string> kernel_name;       //name of the kernel invoked
+    std::vector<float> kernel_time;             //kernel time in ms
+
+public:
+    CLTimeStat() {
+        idx = 0;
+    }
+
+    uint32_t get_idx() {
+        return kernel_time.size();
+    }
+
+    void reset() {
+        idx = (uint32_t)kernel_time.size();
+    }
+
+    float elapsed() {
+        auto end = (uint32_t)kernel_time.size();
+        float res = 0.0;
+        for(auto i = idx; i < end; i++)
+            res += this->kernel_time[i];
+        return res;
+    }
+
+    float diff_time(uint32_t start_idx) {
+        float res = 0.0;
+        for(auto i = start_idx; i < (uint32_t)kernel_time.size(); i++)
+            res += this->kernel_time[i];
+        return res;
+    }
+
+    void insert_record( std::string file,
+                        std::string host_func,
+                        std::string kernel,
+                        float ker_time) {
+        file_name.emplace_back(file);
+        host_func_name.emplace_back(host_func);
+        kernel_name.emplace_back(kernel);
+        kernel_time.emplace_back(ker_time);
+    }
+
+    /*calls and time of each (file, host function, kernel) since the last reset*/
+    void print() {
+        std::map<std::tuple<std::string, std::string, std::string>, std::pair<int, double>> stages;
+        for(auto i = idx; i < (uint32_t)kernel_time.size(); i++) {
+            auto &stage = stages[std::make_tuple(file_name[i], host_func_name[i], kernel_name[i])];
+            stage.first++;
+            stage.second += kernel_time[i];
+        }
+        for(auto &stage : stages) {
+            log_info("%s:%s:%s, calls=%d, time=%.3f ms, average=%.3f ms",
+                     std::get<0>(stage.first).c_str(), std::get<1>(stage.first).c_str(),
+                     std::get<2>(stage.first).c_str(), stage.second.first,
+                     stage.second.second, stage.second.second / stage.second.first);
+        }
+    }
+};
+
+/*
+ * Process-wide stats, filled only when compiled with USE_STAT:
+ * device buffers of cl_mem_alloc/cl_mem_create/cl_mem_free, host arrays of
+ * host_malloc_aligned/host_free_aligned, and the kernels passed to prof_add_kernel.
+ * Never destroyed, so they outlive the summary at exit.
+ * */
+inline CLMemStat &cl_device_mem_stat() {
+    static CLMemStat *stat = new CLMemStat();
+    return *stat;
+}
+inline CLMemStat &cl_host_mem_stat() {
+    static CLMemStat *stat = new CLMemStat();
+    return *stat;
+}
+inline CLTimeStat &cl_time_stat() {
+    static CLTimeStat *stat = new CLTimeStat();
+    return *stat;
+}
+
+/*recording hooks of the wrappers, no-ops without USE_STAT*/
+#ifdef USE_STAT
+#define STAT_MALLOC(stat, addr, bytes)          (stat).malloc_mem_stat((unsigned long)(addr), (long)(bytes))
+#define STAT_FREE(stat, addr)                   (stat).delete_mem_stat((unsigned long)(addr))
+#define STAT_KERNEL(file, func, kernel, time)   cl_time_stat().insert_record( \
+        (strrchr(file, '/') ? strrchr(file, '/') + 1 : file), func, kernel, (float)(time))
+#else
+#define STAT_MALLOC(stat, addr, bytes)
+#define STAT_FREE(stat, addr)
+#define STAT_KERNEL(file, func, kernel, time)
+#endif
+
+/*end-of-run summary, registered by Plat::plat_init with USE_STAT*/
+inline void cl_stat_print() {
+    log_info("------ Device memory: max=%.1f MB, accumulated=%.1f MB, current=%.1f MB ------",
+             cl_device_mem_stat().get_max_use() / 1024.0 / 1024,
+             cl_device_mem_stat().get_acc_use() / 1024.0 / 1024,
+             cl_device_mem_stat().get_cur_use() / 1024.0 / 1024);
+    log_info("------ Host memory: max=%.1f MB, accumulated=%.1f MB, current=%.1f MB ------",
+             cl_host_mem_stat().get_max_use() / 1024.0 / 1024,
+             cl_host_mem_stat().get_acc_use() / 1024.0 / 1024,
+             cl_host_mem_stat().get_cur_use() / 1024.0 / 1024);
+    if (cl_device_mem_stat().get_untracked() > 0)
+        log_warn("%ld device buffers were released without being allocated by the wrappers",
+                 cl_device_mem_stat().get_untracked());
+    log_info("------ Kernels: %.3f ms in total ------", cl_time_stat().elapsed());
+    cl_time_stat().print();
+}
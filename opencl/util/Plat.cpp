@@ -29,6 +29,9 @@ void Plat::plat_init(cl_device_type new_type) {
         _instance->_type = new_type;
         _instance->init_properties();
         atexit(autoDestroy);               /*to call destroy() before exit*/
+#ifdef USE_STAT
+        atexit(cl_stat_print);             /*memory and kernel time summary*/
+#endif
     }
     else {
         log_info("Platform has been initialized");
@@ -121,6 +124,11 @@ void Plat::init_properties() {
     cl_device_type my_type;
     clGetDeviceInfo(my_device, CL_DEVICE_TYPE, sizeof(cl_device_type), &my_type, nullptr);
 
+    /*host-unified memory: CPUs and integrated devices can use host buffers directly*/
+    cl_bool unified = CL_FALSE;
+    clGetDeviceInfo(my_device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &unified, nullptr);
+    this->_device_params.host_unified = (unified == CL_TRUE) || (my_type == CL_DEVICE_TYPE_CPU);
+
     /*a simple kernel*/
     cl_kernel temp_kernel = get_kernel(this->_device_params.device, this->_device_params.context, "mem_kernel.cl", "scale_mixed");
 
@@ -142,6 +150,7 @@ void Plat::init_properties() {
     log_info("Maximal memory object size: %.1f GB", this->_device_params.max_alloc_size*1.0/1024/1024/1024);
     log_info("Global memory cache line size: %d bytes", _device_params.cacheline_size);
     log_info("Wavefront size: %d", _device_params.wavefront);
+    log_info("Host-unified memory: %s", _device_params.host_unified ? "yes (zero-copy buffers)" : "no");
 
     log_info("------ End of hardware checking ------");
 }
\ No newline at end of file
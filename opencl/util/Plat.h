@@ -29,6 +29,7 @@ struct device_param_t {
     uint64_t            max_alloc_size;     /*maximal memory object alloc size*/
     uint64_t            max_local_size;     /*maximal local size*/
     uint64_t            wavefront;          /*wavefront size*/
+    bool                host_unified;       /*device shares the host memory, zero-copy buffers preferred*/
 };
 
 /*
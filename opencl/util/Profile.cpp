@@ -0,0 +1,130 @@
+//
+// Per-call profile of the OpenCL primitives.
+//
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include "Profile.h"
+#include "log.h"
+using namespace std;
+
+uint64_t host_time_ns() {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profile::add_kernel(const char *name, cl_event event) {
+    cl_ulong queued = 0, submit = 0, start = 0, end = 0;
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, nullptr);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &submit, nullptr);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, nullptr);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, nullptr);
+
+    /*the kernel has just finished, so its end is taken as "now" on the host clock*/
+    if (!_offset_set) {
+        _device_to_host = (int64_t)host_time_ns() - (int64_t)end;
+        _offset_set = true;
+    }
+
+    prof_record_t record;
+    record.name = name;
+    record.is_kernel = true;
+    record.queued = queued + _device_to_host;
+    record.submit = submit + _device_to_host;
+    record.start = start + _device_to_host;
+    record.end = end + _device_to_host;
+    _records.emplace_back(record);
+}
+
+void Profile::add_host(const char *name, uint64_t start, uint64_t end) {
+    prof_record_t record;
+    record.name = name;
+    record.is_kernel = false;
+    record.queued = record.submit = record.start = start;
+    record.end = end;
+    _records.emplace_back(record);
+}
+
+void Profile::reset() {
+    _records.clear();
+    _offset_set = false;
+    _device_to_host = 0;
+}
+
+double Profile::stage_time(const char *name) const {
+    double res = 0;
+    for(auto &r : _records)
+        if (r.name == name) res += (r.end - r.start) / 1000000.0;
+    return res;
+}
+
+double Profile::kernel_time() const {
+    double res = 0;
+    for(auto &r : _records)
+        if (r.is_kernel) res += (r.end - r.start) / 1000000.0;
+    return res;
+}
+
+double Profile::host_time() const {
+    double res = 0;
+    for(auto &r : _records)
+        if (!r.is_kernel) res += (r.end - r.start) / 1000000.0;
+    return res;
+}
+
+void Profile::print() const {
+    /*aggregate by name, keeping the order of first appearance*/
+    vector<string> names;
+    map<string, double> exec_time, wait_time;
+    map<string, int> counts;
+    for(auto &r : _records) {
+        if (counts.find(r.name) == counts.end()) names.emplace_back(r.name);
+        counts[r.name]++;
+        exec_time[r.name] += (r.end - r.start) / 1000000.0;
+        if (r.is_kernel) wait_time[r.name] += (r.start - r.queued) / 1000000.0;
+    }
+    log_info("------ Profile: kernel %.3f ms, host %.3f ms ------", kernel_time(), host_time());
+    for(auto &n : names) {
+        log_info("%-32s calls=%d, time=%.3f ms, queued=%.3f ms",
+                 n.c_str(), counts[n], exec_time[n], wait_time[n]);
+    }
+}
+
+/*
+ * Chrome trace event format, loadable by chrome://tracing and ui.perfetto.dev
+ * tid 0: host stages, tid 1: kernel execution, tid 2: kernel queued->start
+ * */
+bool Profile::export_trace(const char *file_name) const {
+    FILE *fp = fopen(file_name, "w");
+    if (fp == nullptr) {
+        log_error("Cannot create the trace file %s", file_name);
+        return false;
+    }
+    uint64_t base = UINT64_MAX;
+    for(auto &r : _records) base = std::min(base, r.queued);
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"ph\":\"M\",\"pid\":0,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"host\"}},\n");
+    fprintf(fp, "{\"ph\":\"M\",\"pid\":0,\"tid\":1,\"name\":\"thread_name\",\"args\":{\"name\":\"device\"}},\n");
+    fprintf(fp, "{\"ph\":\"M\",\"pid\":0,\"tid\":2,\"name\":\"thread_name\",\"args\":{\"name\":\"queue\"}}");
+    for(auto &r : _records) {
+        double ts = (r.start - base) / 1000.0, dur = (r.end - r.start) / 1000.0; /*in us*/
+        if (r.is_kernel) {
+            fprintf(fp, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":1,\"cat\":\"kernel\",\"name\":\"%s\","
+                        "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"queued_us\":%.3f,\"submit_us\":%.3f}}",
+                    r.name.c_str(), ts, dur, (r.queued - base) / 1000.0, (r.submit - base) / 1000.0);
+            fprintf(fp, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":2,\"cat\":\"queue\",\"name\":\"%s\","
+                        "\"ts\":%.3f,\"dur\":%.3f}",
+                    r.name.c_str(), (r.queued - base) / 1000.0, (r.start - r.queued) / 1000.0);
+        }
+        else {
+            fprintf(fp, ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":0,\"cat\":\"host\",\"name\":\"%s\","
+                        "\"ts\":%.3f,\"dur\":%.3f}",
+                    r.name.c_str(), ts, dur);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    log_info("Trace written to %s (%d records)", file_name, (int)_records.size());
+    return true;
+}
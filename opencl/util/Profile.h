@@ -0,0 +1,61 @@
+//
+// Per-call profile of the OpenCL primitives.
+//
+#pragma once
+
+#include <string>
+#include <vector>
+#include "utility.h"
+#include "CLStat.h"
+
+/*one interval recorded during a primitive call, all timestamps in ns*/
+struct prof_record_t {
+    std::string     name;           /*kernel name or host stage*/
+    bool            is_kernel;      /*device kernel or host-side interval*/
+    uint64_t        queued;         /*CL_PROFILING_COMMAND_QUEUED (kernels only)*/
+    uint64_t        submit;         /*CL_PROFILING_COMMAND_SUBMIT (kernels only)*/
+    uint64_t        start;
+    uint64_t        end;
+};
+
+/*
+ * Profile class, collecting the kernels and host stages (compilation, allocation)
+ * of the primitive calls it is passed to.
+ * Device timestamps are shifted to the host clock using the offset observed
+ * when the first kernel is recorded, so both can be shown on one timeline.
+ * */
+class Profile {
+private:
+    std::vector<prof_record_t> _records;
+    int64_t _device_to_host;            /*host_ns - device_ns*/
+    bool _offset_set;
+public:
+    Profile() : _device_to_host(0), _offset_set(false) {}
+
+    void add_kernel(const char *name, cl_event event);    /*event must have completed*/
+    void add_host(const char *name, uint64_t start, uint64_t end);
+    void reset();
+
+    const std::vector<prof_record_t> &records() const { return _records; }
+    double stage_time(const char *name) const;          /*summed time of the records with the name, in ms*/
+    double kernel_time() const;                         /*summed kernel execution time, in ms*/
+    double host_time() const;                           /*summed host-side time, in ms*/
+
+    void print() const;                                 /*per-stage breakdown to the log*/
+    bool export_trace(const char *file_name) const;     /*Chrome trace / Perfetto JSON*/
+};
+
+uint64_t host_time_ns();
+
+/*
+ * null-safe helpers used inside the primitives
+ * the kernel is also recorded in cl_time_stat() with the calling file and function (USE_STAT)
+ * */
+inline void prof_add_kernel(Profile *prof, const char *name, cl_event event,
+                            const char *file=__builtin_FILE(), const char *func=__builtin_FUNCTION()) {
+    if (prof) prof->add_kernel(name, event);
+    STAT_KERNEL(file, func, name, clEventTime(event));
+}
+inline void prof_add_host(Profile *prof, const char *name, uint64_t start) {
+    if (prof) prof->add_host(name, start, host_time_ns());
+}
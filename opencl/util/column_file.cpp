@@ -0,0 +1,163 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "log.h"
+#include "column_file.h"
+using namespace std;
+
+#define COPY_CHUNK      (1<<20)     /*ints per chunk of the parallel copy*/
+
+static uint64_t align_up(uint64_t bytes) {
+    return (bytes + COLUMN_FILE_ALIGN - 1) / COLUMN_FILE_ALIGN * COLUMN_FILE_ALIGN;
+}
+
+bool column_file_write(const char *path, const void *const *columns, int num_columns,
+                       uint64_t length, int ele_size) {
+    if (num_columns < 1 || num_columns > COLUMN_FILE_MAX_COLUMNS) {
+        log_error("Wrong parameters: %d columns (at most %d)", num_columns, COLUMN_FILE_MAX_COLUMNS);
+        return false;
+    }
+    column_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = COLUMN_FILE_MAGIC;
+    header.version = COLUMN_FILE_VERSION;
+    header.num_columns = (uint32_t)num_columns;
+    header.ele_size = (uint32_t)ele_size;
+    header.length = length;
+
+    uint64_t column_bytes = length * ele_size;
+    uint64_t offset = align_up(sizeof(header));
+    for(int c = 0; c < num_columns; c++) {
+        header.offsets[c] = offset;
+        offset += align_up(column_bytes);
+    }
+
+    /*readers never see a partial file, even when several runs fill the cache*/
+    string tmp_path = string(path) + ".tmp." + to_string(getpid());
+    FILE *fp = fopen(tmp_path.c_str(), "wb");
+    if (fp == nullptr) {
+        log_error("Failed to create %s", tmp_path.c_str());
+        return false;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1);
+    for(int c = 0; c < num_columns && ok; c++) {
+        ok = (fseek(fp, (long)header.offsets[c], SEEK_SET) == 0) &&
+             (fwrite(columns[c], 1, column_bytes, fp) == column_bytes);
+    }
+    /*pad the last column so that the file covers whole aligned blocks*/
+    ok = ok && (ftruncate(fileno(fp), (off_t)offset) == 0);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path) != 0) {
+        log_error("Failed to write %s", path);
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool column_file_map(const char *path, column_file_t &file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("Failed to open %s", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(column_file_header_t)) {
+        log_error("%s is not a column file", path);
+        close(fd);
+        return false;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void *addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        log_error("Failed to map %s", path);
+        return false;
+    }
+    madvise(addr, (size_t)st.st_size, MADV_WILLNEED);
+
+    const column_file_header_t *header = (const column_file_header_t*)addr;
+    bool valid = (header->magic == COLUMN_FILE_MAGIC) && (header->version == COLUMN_FILE_VERSION) &&
+                 (header->num_columns >= 1) && (header->num_columns <= COLUMN_FILE_MAX_COLUMNS);
+    for(uint32_t c = 0; c < header->num_columns && valid; c++) {
+        valid = (header->offsets[c] % COLUMN_FILE_ALIGN == 0) &&
+                (header->offsets[c] + header->length * header->ele_size <= (uint64_t)st.st_size);
+    }
+    if (!valid) {
+        log_error("%s is not a column file of version %d", path, COLUMN_FILE_VERSION);
+        munmap(addr, (size_t)st.st_size);
+        return false;
+    }
+    file.addr = addr;
+    file.bytes = (uint64_t)st.st_size;
+    file.header = header;
+    return true;
+}
+
+void column_file_unmap(column_file_t &file) {
+    if (file.addr == nullptr) return;
+    munmap(file.addr, (size_t)file.bytes);
+    file.addr = nullptr;
+    file.bytes = 0;
+    file.header = nullptr;
+}
+
+bool column_file_read(const char *path, int c, int *keys, uint64_t length) {
+    column_file_t file;
+    if (!column_file_map(path, file)) return false;
+
+    bool ok = (c >= 0) && (c < file.num_columns()) &&
+              (file.header->ele_size == sizeof(int)) && (file.length() >= length);
+    if (!ok) {
+        log_error("%s has no column %d of %llu ints", path, c, (unsigned long long)length);
+    }
+    else {
+        const int *column = (const int*)file.column(c);
+        int64_t chunks = (int64_t)((length + COPY_CHUNK - 1) / COPY_CHUNK);
+#pragma omp parallel for schedule(static)
+        for(int64_t i = 0; i < chunks; i++) {
+            uint64_t begin = i * COPY_CHUNK;
+            uint64_t num = (begin + COPY_CHUNK <= length) ? COPY_CHUNK : length - begin;
+            memcpy(keys + begin, column + begin, sizeof(int)*num);
+        }
+    }
+    column_file_unmap(file);
+    return ok;
+}
+
+/*the cache file of name, empty if the cache is disabled*/
+static string dataset_cache_path(const char *name) {
+    const char *dir = getenv("DATASET_CACHE");
+    if (dir == nullptr || dir[0] == '\0') return "";
+    return string(dir) + "/" + name + ".col";
+}
+
+bool dataset_cache_load(const char *name, int *keys, uint64_t length) {
+    string path = dataset_cache_path(name);
+    if (path.empty() || access(path.c_str(), R_OK) != 0) return false;
+    if (!column_file_read(path.c_str(), 0, keys, length)) return false;
+    log_trace("Loaded dataset %s", path.c_str());
+    return true;
+}
+
+void dataset_cache_store(const char *name, const int *keys, uint64_t length) {
+    string path = dataset_cache_path(name);
+    if (path.empty()) return;
+    mkdir(getenv("DATASET_CACHE"), 0755);     /*fails harmlessly if it exists*/
+    const void *columns[1] = {keys};
+    if (column_file_write(path.c_str(), columns, 1, length))
+        log_trace("Cached dataset %s", path.c_str());
+}
@@ -4,7 +4,12 @@
 //
 #include "../primitives.h"
 #include "log.h"
+#include "CLStat.h"
+#include "column_file.h"
 #include <omp.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 using namespace std;
 
 double diffTime(struct timeval end, struct timeval start) {
@@ -93,6 +98,7 @@ void cl_mem_free(cl_mem object) {
     if (object != 0 || object != nullptr) {
         cl_int status = clReleaseMemObject(object);
         checkErr(status, "Failed to release the device memory object.");
+        STAT_FREE(cl_device_mem_stat(), object);
     }
 }
 
@@ -103,6 +109,113 @@ double clEventTime(const cl_event event){
     return (end - start) / 1000000.0;
 }
 
+/*page-aligned host memory, required by CL_MEM_USE_HOST_PTR to be zero-copy*/
+void *host_malloc_aligned(size_t bytes) {
+    void *ptr = nullptr;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t padded = (bytes + page_size - 1) / page_size * page_size; /*whole pages*/
+    if (posix_memalign(&ptr, page_size, padded) != 0) {
+        log_error(ERR_HOST_ALLOCATION);
+        exit(EXIT_FAILURE);
+    }
+    STAT_MALLOC(cl_host_mem_stat(), ptr, padded);
+    return ptr;
+}
+
+void host_free_aligned(void *ptr) {
+    if (ptr) {
+        free(ptr);
+        STAT_FREE(cl_host_mem_stat(), ptr);
+    }
+}
+
+cl_mem cl_mem_alloc(cl_context context, cl_mem_flags flags, size_t bytes) {
+    cl_int status;
+    cl_mem object = clCreateBuffer(context, flags, bytes, nullptr, &status);
+    checkErr(status, ERR_HOST_ALLOCATION);
+    STAT_MALLOC(cl_device_mem_stat(), object, bytes);
+    return object;
+}
+
+cl_mem cl_mem_create(cl_context context, cl_command_queue queue,
+                     cl_mem_flags flags, size_t bytes,
+                     void *h_ptr, bool zero_copy) {
+    cl_int status;
+    cl_mem object;
+    if (zero_copy) {
+        if (h_ptr != nullptr)   flags |= CL_MEM_USE_HOST_PTR;   /*wrap the host array*/
+        else                    flags |= CL_MEM_ALLOC_HOST_PTR; /*runtime-allocated host memory*/
+        object = clCreateBuffer(context, flags, bytes, h_ptr, &status);
+        checkErr(status, ERR_HOST_ALLOCATION);
+    }
+    else {
+        object = clCreateBuffer(context, flags, bytes, nullptr, &status);
+        checkErr(status, ERR_HOST_ALLOCATION);
+        if (h_ptr != nullptr) {
+            status = clEnqueueWriteBuffer(queue, object, CL_TRUE, 0, bytes, h_ptr, 0, 0, 0);
+            checkErr(status, ERR_WRITE_BUFFER);
+        }
+    }
+    STAT_MALLOC(cl_device_mem_stat(), object, bytes);
+    return object;
+}
+
+cl_mem cl_mem_create_output(cl_context context, cl_mem_flags flags, size_t bytes,
+                            void *h_ptr, bool zero_copy) {
+    /*no queue needed, there is nothing to upload*/
+    return cl_mem_create(context, nullptr, flags, bytes, zero_copy ? h_ptr : nullptr, zero_copy);
+}
+
+void cl_mem_read(cl_command_queue queue, cl_mem object,
+                 size_t bytes, void *h_ptr, bool zero_copy) {
+    cl_int status;
+    if (zero_copy) {
+        /*mapping synchronizes the host view; no copy if the buffer wraps h_ptr*/
+        void *mapped = cl_mem_map(queue, object, CL_MAP_READ, bytes);
+        if (mapped != h_ptr)    memcpy(h_ptr, mapped, bytes);
+        cl_mem_unmap(queue, object, mapped);
+    }
+    else {
+        status = clEnqueueReadBuffer(queue, object, CL_TRUE, 0, bytes, h_ptr, 0, 0, 0);
+        checkErr(status, ERR_READ_BUFFER);
+    }
+}
+
+int cl_mem_sample(cl_command_queue queue, cl_mem object, size_t ele_size, int length,
+                  void *sample, int blocks, int block_len) {
+    cl_int status;
+    if (length <= blocks * block_len) {
+        if (length > 0) {
+            status = clEnqueueReadBuffer(queue, object, CL_TRUE, 0, ele_size*length, sample, 0, 0, 0);
+            checkErr(status, ERR_READ_BUFFER);
+        }
+        return length;
+    }
+    for(int s = 0; s < blocks; s++) {
+        size_t offset = (blocks > 1) ? (size_t)(length - block_len) * s / (blocks - 1) : 0;
+        status = clEnqueueReadBuffer(queue, object, CL_FALSE, ele_size*offset, ele_size*block_len,
+                                     (char*)sample + ele_size*block_len*s, 0, 0, 0);
+        checkErr(status, ERR_READ_BUFFER);
+    }
+    status = clFinish(queue);
+    checkErr(status, ERR_READ_BUFFER);
+    return blocks * block_len;
+}
+
+void *cl_mem_map(cl_command_queue queue, cl_mem object, cl_map_flags flags, size_t bytes) {
+    cl_int status;
+    void *mapped = clEnqueueMapBuffer(queue, object, CL_TRUE, flags, 0, bytes, 0, 0, 0, &status);
+    checkErr(status, ERR_MAP_BUFFER);
+    return mapped;
+}
+
+void cl_mem_unmap(cl_command_queue queue, cl_mem object, void *mapped) {
+    cl_int status = clEnqueueUnmapMemObject(queue, object, mapped, 0, 0, 0);
+    checkErr(status, ERR_MAP_BUFFER);
+    status = clFinish(queue);
+    checkErr(status, ERR_MAP_BUFFER);
+}
+
 void add_param(char *param, char *macro, bool has_value, int value) {
     strcat(param, " -D");
     strcat(param, macro);
@@ -210,8 +323,12 @@ cl_kernel get_kernel(
 /*data generators*/
 /*
  * Generate random uniform int value array
+ * The generators are served from the dataset cache (column_file.h) if enabled.
  * */
 void random_generator_int(int *keys, uint64_t length, int max, unsigned long long seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "uniform_%llu_%d_%llu", (unsigned long long)length, max, seed);
+    if (dataset_cache_load(name, keys, length)) return;
 #pragma omp parallel
     {
         unsigned int tid = omp_get_thread_num();
@@ -219,13 +336,47 @@ void random_generator_int(int *keys, uint64_t length, int max, unsigned long lon
 #pragma omp for schedule(dynamic)
         for(int i = 0; i < length ; i++)    keys[i] = rand_r(&my_seed) % max;
     }
+    dataset_cache_store(name, keys, length);
+}
+
+/*
+ * Generate Zipf-distributed int value array in [0, max), key k has the
+ * probability proportional to 1/(k+1)^alpha, so key 0 is the most frequent.
+ * The CDF of the max keys is kept in memory.
+ * */
+void random_generator_zipf(int *keys, uint64_t length, int max, double alpha, unsigned long long seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "zipf_%llu_%d_%.17g_%llu", (unsigned long long)length, max, alpha, seed);
+    if (dataset_cache_load(name, keys, length)) return;
+    std::vector<double> cdf(max);
+    double acc = 0;
+    for(int k = 0; k < max; k++) {
+        acc += 1.0 / pow(k + 1.0, alpha);
+        cdf[k] = acc;
+    }
+    for(int k = 0; k < max; k++) cdf[k] /= acc;
+#pragma omp parallel
+    {
+        unsigned int tid = omp_get_thread_num();
+        unsigned int my_seed = seed + tid;
+#pragma omp for schedule(dynamic)
+        for(uint64_t i = 0; i < length; i++) {
+            double u = (double)rand_r(&my_seed) / RAND_MAX;
+            int k = (int)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+            keys[i] = std::min(k, max - 1);
+        }
+    }
+    dataset_cache_store(name, keys, length);
 }
 
 /*
- * Generate random uniform unique int value array
+ * Generate random uniform unique int value array, a permutation of [0, length) shuffled from seed
  * */
-void random_generator_int_unique(int *keys, uint64_t length) {
-    srand((unsigned)time(nullptr));
+void random_generator_int_unique(int *keys, uint64_t length, unsigned long long seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "unique_%llu_%llu", (unsigned long long)length, seed);
+    if (dataset_cache_load(name, keys, length)) return;
+    srand((unsigned)seed);
 #pragma omp parallel for
     for(int i = 0; i < length ; i++) {
         keys[i] = i;
@@ -238,4 +389,5 @@ void random_generator_int_unique(int *keys, uint64_t length) {
         std::swap(keys[from], keys[to]);
     }
     log_trace("Key shuffling finished");
+    dataset_cache_store(name, keys, length);
 }
\ No newline at end of file
@@ -38,6 +38,7 @@
 #define ERR_LOCAL_MEM_OVERFLOW              "Local memory overflow "
 #define ERR_COPY_BUFFER                     "Failed to copy the buffer."
 #define ERR_RELEASE_MEM                     "Failed to release the device memory object."
+#define ERR_MAP_BUFFER                      "Failed to map the buffer."
 
 #ifndef PROJECT_ROOT
 #define PROJECT_ROOT " "
@@ -48,6 +49,34 @@ void cl_mem_free(cl_mem object);
 double clEventTime(const cl_event event);
 void add_param(char *param, char *macro, bool has_value=false, int value=-1);
 
+/*
+ * Buffer helpers. With zero_copy set (host-unified devices such as CPUs), the
+ * buffer wraps the host array (CL_MEM_USE_HOST_PTR) or host-side memory
+ * (CL_MEM_ALLOC_HOST_PTR) and data is accessed by map/unmap instead of copies.
+ * Host arrays wrapped this way should come from host_malloc_aligned.
+ * */
+void *host_malloc_aligned(size_t bytes);
+void host_free_aligned(void *ptr);
+cl_mem cl_mem_alloc(cl_context context, cl_mem_flags flags, size_t bytes);    /*uninitialized device buffer*/
+cl_mem cl_mem_create(cl_context context, cl_command_queue queue,
+                     cl_mem_flags flags, size_t bytes,
+                     void *h_ptr=nullptr, bool zero_copy=false);
+/*output buffer, wraps h_ptr with zero_copy and is never written from h_ptr otherwise, see cl_mem_read*/
+cl_mem cl_mem_create_output(cl_context context, cl_mem_flags flags, size_t bytes,
+                            void *h_ptr, bool zero_copy);
+void cl_mem_read(cl_command_queue queue, cl_mem object,
+                 size_t bytes, void *h_ptr, bool zero_copy=false);
+void *cl_mem_map(cl_command_queue queue, cl_mem object, cl_map_flags flags, size_t bytes);
+void cl_mem_unmap(cl_command_queue queue, cl_mem object, void *mapped);
+
+/*
+ * read blocks of block_len consecutive elements evenly spread over the length
+ * elements of object into sample (blocks*block_len elements at most)
+ * returns the number of elements read, all of them if length is small
+ * */
+int cl_mem_sample(cl_command_queue queue, cl_mem object, size_t ele_size, int length,
+                  void *sample, int blocks, int block_len);
+
 /*create the cl_kernel according to the file name and function name*/
 cl_kernel get_kernel(cl_device_id device, cl_context context,
                      char *file_name, char *func_name, char *params=nullptr);
@@ -58,4 +87,5 @@ double compute_bandwidth(unsigned long dataSize, int wordSize, double elapsedTim
 double average_Hampel(double *input, int num);
 
 void random_generator_int(int *keys, uint64_t length, int max, unsigned long long seed);
-void random_generator_int_unique(int *keys, uint64_t length);
+void random_generator_int_unique(int *keys, uint64_t length, unsigned long long seed);
+void random_generator_zipf(int *keys, uint64_t length, int max, double alpha, unsigned long long seed);
@@ -4,4 +4,15 @@
 
 #pragma once
 
-#define EXPERIMENT_TIMES    (5)
\ No newline at end of file
+#define EXPERIMENT_TIMES    (5)
+#define MAX_THREAD_NUM      (256)
+
+/*empty slot of the join hash tables, keys must not take this value*/
+#define JOIN_EMPTY_KEY      (-2147483647-1)
+
+/*bit-packed columns: blocks of PACK_BLOCK values in PACK_LANES interleaved lanes, the layout of opencl/params.h*/
+#define PACK_LANES          (8)
+#define PACK_BLOCK          (32*PACK_LANES)
+
+/*indexes moved through all the columns at a time by gather_columns/scatter_columns, 256KB*/
+#define COLUMN_BLOCK        (1<<16)
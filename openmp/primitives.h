@@ -0,0 +1,181 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#pragma once
+
+#include <cstdint>
+#include "params.h"
+
+/*
+ * All the primitives return the elapsed time in ms
+ * */
+
+/*sequential memory access (Stream Benchmark), the bandwidth reference*/
+double copy_omp(int *input, int *output, uint64_t len);
+double scale_omp(int *input, int *output, uint64_t len);
+double copy_omp_ss(int *input, int *output, uint64_t len);      /*streaming stores, 32B-aligned*/
+double scale_omp_ss(int *input, int *output, uint64_t len);     /*streaming stores, 32B-aligned*/
+
+/*gather and scatter*/
+double gather(int *input, int *output, int *idx, uint64_t len);
+double gather_mp(int *input, int *output, int *idx, uint64_t len, int pass);  /*multi-pass*/
+double scatter(int *input, int *output, int *idx, uint64_t len);
+
+/*a payload column of the multi-column gather and scatter*/
+struct column_t {
+    const void *in;
+    void *out;
+    int width;          /*bytes per element, 4 or 8*/
+};
+
+/*
+ * gather (out[i] = in[idx[i]]) and scatter (out[idx[i]] = in[i]) of
+ * num_columns columns, all the columns are moved per block of idx
+ * */
+double gather_columns(const column_t *columns, int num_columns, const int *idx, uint64_t len);
+double scatter_columns(const column_t *columns, int num_columns, const int *idx, uint64_t len);
+
+/*
+ * AOS <-> SOA transpose of len records of num_fields ints (2, 4 or 8):
+ * records[i*num_fields+f] <-> fields[f][i], in-register shuffles (AVX2, or
+ * AVX-512 with USE_AVX512) and streaming stores for outputs larger than the LLC
+ * */
+double aos_to_soa(const int *records, int * const *fields, int num_fields, uint64_t len);
+double soa_to_aos(const int * const *fields, int *records, int num_fields, uint64_t len);
+
+/*
+ * bit-packed int columns: the low bits bits (1 to 32) of the values in
+ * blocks of PACK_BLOCK values, packed_words(len, bits) words in the layout of
+ * opencl/kernels/pack_kernel.cl, packed and unpacked with AVX2 shifts
+ * */
+inline uint64_t packed_words(uint64_t len, int bits) {
+    return (len + PACK_BLOCK - 1) / PACK_BLOCK * bits * PACK_LANES;
+}
+double pack_omp(const int *input, uint32_t *output, uint64_t len, int bits);
+double unpack_omp(const uint32_t *input, int *output, uint64_t len, int bits);
+
+/*gather from a packed column into output, or packed with the same bits into output_packed if it is set*/
+double gather_packed_omp(const uint32_t *input, int bits, const int *idx, uint64_t len,
+                         int *output, uint32_t *output_packed=nullptr);
+
+/*exclusive scan of a packed column, same result as scan_RTS_omp on the unpacked one*/
+double scan_packed_omp(const uint32_t *input, int bits, int *output, uint64_t len);
+
+/*exclusive scan algorithms*/
+double scan_SSA_omp(int *input, int* output, uint64_t len);     /*scan-scan-add, 4n data accesses*/
+double scan_RTS_omp(int *input, int* output, uint64_t len);     /*reduce-then-scan, 3n data accesses*/
+double scan_tbb(int *input, int* output, uint64_t len);
+
+/*key to bucket functions of the histogram*/
+enum BucketFunc {
+    BUCKET_RADIX,       /*(key >> shift) & (buckets-1), buckets is a power of 2*/
+    BUCKET_MOD,         /*key mod buckets*/
+    BUCKET_HASH         /*multiplicative hash of the key, scaled to [0, buckets)*/
+};
+
+struct bucket_func_t {
+    BucketFunc type;
+    int buckets;
+    int shift;          /*only for BUCKET_RADIX*/
+};
+
+/*histogram strategies, HIST_AUTO decides from the bucket count and a sample of the keys*/
+enum HistStrategy {
+    HIST_AUTO,
+    HIST_PRIVATE,       /*private histogram per thread*/
+    HIST_SHARED,        /*shared histogram with atomics*/
+    HIST_SORT           /*chunks sorted by bucket, one atomic per run*/
+};
+
+/*histogram of the keys on func into his[func.buckets], HIST_AUTO is replaced by the strategy used*/
+double histogram_omp(const int *keys, uint64_t len, const bucket_func_t &func,
+                     uint64_t *his, HistStrategy &strategy);
+
+/*
+ * reduction of the whole input, T is int32_t, int64_t, float or double
+ * sums are accumulated in T, REDUCE_COUNT returns len
+ * */
+enum ReduceOp {REDUCE_SUM, REDUCE_MIN, REDUCE_MAX, REDUCE_COUNT};
+
+template<typename T>
+double reduce_omp(const T *input, uint64_t len, ReduceOp op, T &res);
+
+/*filter predicates*/
+enum PredType {
+    PRED_EQ, PRED_NE, PRED_LT, PRED_LE, PRED_GT, PRED_GE,  /*key compared to low*/
+    PRED_RANGE,                                             /*low <= key < high*/
+    PRED_BITMAP                                             /*bit key of the bitmap is set, keys out of [0, bitmap_bits) fail*/
+};
+
+struct predicate_t {
+    PredType type;
+    int low;
+    int high;
+    const uint32_t *bitmap;
+    uint64_t bitmap_bits;
+};
+
+/*
+ * filter (stream compaction), the qualified tuples are written in the input order
+ * values can be nullptr (key-only), the outputs should be able to hold len tuples
+ * */
+double filter_omp(const int *keys_in, const int *values_in,
+                  int *keys_out, int *values_out,
+                  uint64_t len, const predicate_t &pred, uint64_t &res_len);
+
+/*
+ * radix split on (key >> shift) & (buckets-1), stable, values can be nullptr
+ * start[b] is the first position of bucket b, start[buckets] = len
+ * */
+double split_omp(const int *keys_in, const int *values_in,
+                 int *keys_out, int *values_out,
+                 uint64_t len, int buckets, int shift, uint64_t *start);
+
+/*
+ * split_omp with atomic-free in-register ranking (AVX2, or AVX-512 with
+ * USE_AVX512), same interface and output, meant for small bucket counts
+ * */
+double split_simd_omp(const int *keys_in, const int *values_in,
+                      int *keys_out, int *values_out,
+                      uint64_t len, int buckets, int shift, uint64_t *start);
+
+/*
+ * LSD radix split on the low bits of the keys in passes of at most pass_bits
+ * bits, same output as split_omp on 2^bits buckets (without the start positions);
+ * fused: each scatter counts the digit of the next pass, which then skips its
+ * histogram read (only if the counts, threads^2*2^pass_bits uint64s, are
+ * smaller than the keys), returns -1 on wrong bits
+ * */
+double radix_split_omp(const int *keys_in, const int *values_in,
+                       int *keys_out, int *values_out,
+                       uint64_t len, int bits, int pass_bits, bool fused);
+
+/*split_omp on keys packed with bits bits, the output keys are unpacked*/
+double split_packed_omp(const uint32_t *keys_in, int bits, const int *values_in,
+                        int *keys_out, int *values_out,
+                        uint64_t len, int buckets, int shift, uint64_t *start);
+
+/*untimed, single-threaded unpacking of values [begin, end) to output[0, end-begin), begin is a multiple of PACK_BLOCK*/
+void unpack_range(const uint32_t *input, int *output, uint64_t begin, uint64_t end, int bits);
+
+/*untimed building blocks of split_omp for other primitives: parallel, and single-threaded for use in tasks*/
+void split_par(const int *keys_in, const int *values_in,
+               int *keys_out, int *values_out,
+               uint64_t len, int buckets, int shift, uint64_t *start);
+void split_seq(const int *keys_in, const int *values_in,
+               int *keys_out, int *values_out,
+               uint64_t len, int buckets, int shift, uint64_t *start);
+
+/*
+ * radix-partitioned hash join, returns the number of matches in res_len
+ * the (R value, S value) pairs are materialized only if out_R and out_S are set
+ * */
+double hash_join_omp(const int *R_keys, const int *R_values, uint64_t r_len,
+                     const int *S_keys, const int *S_values, uint64_t s_len,
+                     uint64_t &res_len, int **out_R=nullptr, int **out_S=nullptr);
+
+/*non-partitioned hash join with a shared lock-free table, same interface as hash_join_omp*/
+double hash_join_np_omp(const int *R_keys, const int *R_values, uint64_t r_len,
+                        const int *S_keys, const int *S_values, uint64_t s_len,
+                        uint64_t &res_len, int **out_R=nullptr, int **out_S=nullptr);
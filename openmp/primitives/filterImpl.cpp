@@ -0,0 +1,112 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <algorithm>
+#include "../primitives.h"
+#include "timer.h"
+
+template<PredType type>
+inline bool eval(int key, const predicate_t &pred) {
+    switch (type) {     /*resolved at compile time*/
+        case PRED_EQ:       return key == pred.low;
+        case PRED_NE:       return key != pred.low;
+        case PRED_LT:       return key < pred.low;
+        case PRED_LE:       return key <= pred.low;
+        case PRED_GT:       return key > pred.low;
+        case PRED_GE:       return key >= pred.low;
+        case PRED_RANGE:    return (pred.low < pred.high) &&    /*empty range as in filter_kernel.cl*/
+                                   (unsigned)key - (unsigned)pred.low < (unsigned)pred.high - (unsigned)pred.low;
+        case PRED_BITMAP:   return ((uint64_t)(unsigned)key < pred.bitmap_bits) &&
+                                   ((pred.bitmap[(unsigned)key >> 5] >> (key & 31)) & 1);
+    }
+    return false;
+}
+
+/*number of matches in [begin, end)*/
+template<PredType type>
+static uint64_t count_chunk(const int *keys_in, uint64_t begin, uint64_t end, const predicate_t &pred) {
+    uint64_t count = 0;
+    for(uint64_t i = begin; i < end; i++) count += eval<type>(keys_in[i], pred);
+    return count;
+}
+
+/*
+ * Write the matches of [begin, end) from pos on, branch-free: every tuple is
+ * written and the position only advances on a match. The loop stops after the
+ * last match so that nothing is written past the range of this chunk.
+ * */
+template<PredType type>
+static void write_chunk(const int *keys_in, const int *values_in,
+                        int *keys_out, int *values_out,
+                        uint64_t begin, uint64_t end, uint64_t pos, uint64_t count,
+                        const predicate_t &pred) {
+    uint64_t pos_end = pos + count;
+    if (count == 0) return;
+    for(uint64_t i = begin; i < end; i++) {
+        int key = keys_in[i];
+        keys_out[pos] = key;
+        if (values_in) values_out[pos] = values_in[i];
+        pos += eval<type>(key, pred);
+        if (pos == pos_end) break;
+    }
+}
+
+/*
+ * Filter without a flag array:
+ * 1. each thread counts the matches of its static chunk, only the keys are read
+ * 2. scan of the per-thread counts
+ * 3. each thread evaluates its chunk again and writes the matches
+ * */
+template<PredType type>
+static void filter_impl(const int *keys_in, const int *values_in,
+                        int *keys_out, int *values_out,
+                        uint64_t len, const predicate_t &pred, uint64_t &res_len) {
+    uint64_t counts[MAX_THREAD_NUM+1] = {0};
+
+#pragma omp parallel num_threads(std::min(omp_get_max_threads(), MAX_THREAD_NUM))
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint64_t begin = len * tid / nthreads;
+        uint64_t end = len * (tid+1) / nthreads;
+
+        /*1.count*/
+        uint64_t my_count = count_chunk<type>(keys_in, begin, end, pred);
+        counts[tid] = my_count;
+#pragma omp barrier
+
+        /*2.scan*/
+#pragma omp single
+        {
+            uint64_t acc = 0;
+            for(int th = 0; th <= nthreads; th++) {
+                uint64_t temp = counts[th];
+                counts[th] = acc;
+                acc += temp;
+            }
+            res_len = counts[nthreads];
+        }
+
+        /*3.write*/
+        write_chunk<type>(keys_in, values_in, keys_out, values_out, begin, end, counts[tid], my_count, pred);
+    }
+}
+
+double filter_omp(const int *keys_in, const int *values_in,
+                  int *keys_out, int *values_out,
+                  uint64_t len, const predicate_t &pred, uint64_t &res_len) {
+    Timer t;
+    switch (pred.type) {
+        case PRED_EQ:       filter_impl<PRED_EQ>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_NE:       filter_impl<PRED_NE>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_LT:       filter_impl<PRED_LT>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_LE:       filter_impl<PRED_LE>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_GT:       filter_impl<PRED_GT>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_GE:       filter_impl<PRED_GE>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_RANGE:    filter_impl<PRED_RANGE>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+        case PRED_BITMAP:   filter_impl<PRED_BITMAP>(keys_in, values_in, keys_out, values_out, len, pred, res_len); break;
+    }
+    return t.elapsed()*1000;
+}
@@ -0,0 +1,74 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <algorithm>
+#include "../primitives.h"
+#include "timer.h"
+#include "log.h"
+#include "thread_pool.h"
+
+#define POOL_GRAIN      (1<<12)     /*indexes per chunk of the pool jobs*/
+
+/*gather, chunks of indexes on the thread pool (thread_pool.h)*/
+double gather(int *input, int *output, int *idx, uint64_t len) {
+    Timer t;
+    ThreadPool::get().parallel_for(len, POOL_GRAIN, [=](uint64_t begin, uint64_t end) {
+        for(uint64_t i = begin; i < end; i++) {
+            output[i] = input[idx[i]];
+        }
+    });
+    return t.elapsed()*1000;
+}
+
+/*
+ * multi-pass gather, each pass only loads the input in [from, to),
+ * so that the randomly accessed range stays in the cache
+ * (see gather_passes in cache_probe.h for the number of passes)
+ * */
+double gather_mp(int *input, int *output, int *idx, uint64_t len, int pass) {
+    uint64_t len_per_pass = (len + pass - 1) / pass;
+    Timer t;
+    for(int p = 0; p < pass; p++) {
+        int from = p * len_per_pass;
+        int to = (p+1) * len_per_pass;
+#pragma omp parallel for schedule(static)
+        for(int i = 0; i < len; i++) {
+            int pos = idx[i];
+            if (pos >= from && pos < to) output[i] = input[pos];
+        }
+    }
+    return t.elapsed()*1000;
+}
+
+template<typename T>
+static void gather_block(const void *input, void *output, const int *idx, uint64_t begin, uint64_t end) {
+    const T *in = (const T*)input;
+    T *out = (T*)output;
+    for(uint64_t i = begin; i < end; i++) out[i] = in[idx[i]];
+}
+
+/*
+ * multi-column gather: a block of COLUMN_BLOCK indexes is loaded once and
+ * stays in the L2 while all the columns are moved, the blocks are the chunks
+ * of a thread pool job as in gather
+ * */
+double gather_columns(const column_t *columns, int num_columns, const int *idx, uint64_t len) {
+    for(int c = 0; c < num_columns; c++) {
+        if (columns[c].width != sizeof(int32_t) && columns[c].width != sizeof(int64_t)) {
+            log_error("Wrong parameters: column %d has %d-byte elements", c, columns[c].width);
+            return -1;
+        }
+    }
+    Timer t;
+    ThreadPool::get().parallel_for(len, COLUMN_BLOCK, [=](uint64_t begin, uint64_t end) {
+        for(int c = 0; c < num_columns; c++) {
+            if (columns[c].width == sizeof(int32_t))
+                gather_block<int32_t>(columns[c].in, columns[c].out, idx, begin, end);
+            else
+                gather_block<int64_t>(columns[c].in, columns[c].out, idx, begin, end);
+        }
+    });
+    return t.elapsed()*1000;
+}
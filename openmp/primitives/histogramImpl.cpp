@@ -0,0 +1,145 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "../primitives.h"
+#include "timer.h"
+#include "cache_probe.h"
+
+#define HIST_SAMPLE_SIZE        (4096)
+#define HIST_SORT_CHUNK         (256)       /*bucket IDs sorted at a time by the sort-based strategy*/
+
+template<BucketFunc type>
+inline uint32_t bucket_of(int key, const bucket_func_t &func) {
+    switch (type) {     /*resolved at compile time*/
+        case BUCKET_MOD:    return (unsigned)key % (unsigned)func.buckets;
+        case BUCKET_HASH:   return (uint32_t)(((uint64_t)((unsigned)key * 0x9E3779B1u) * (unsigned)func.buckets) >> 32);
+        default:            return ((unsigned)key >> func.shift) & (func.buckets - 1);
+    }
+}
+
+/*
+ * A sample is skewed if its most frequent bucket holds at least 1/32 of it
+ * and 8 times its uniform share, then the atomics on that bucket contend.
+ * */
+template<BucketFunc type>
+static bool sample_skewed(const int *keys, uint64_t len, const bucket_func_t &func) {
+    uint64_t sample_len = std::min<uint64_t>(len, HIST_SAMPLE_SIZE);
+    if (sample_len == 0) return false;
+    std::vector<uint32_t> sample(sample_len);
+    for(uint64_t s = 0; s < sample_len; s++) sample[s] = bucket_of<type>(keys[len / sample_len * s], func);
+    std::sort(sample.begin(), sample.end());
+
+    uint64_t max_run = 0, run = 0;
+    for(uint64_t s = 0; s < sample_len; s++) {
+        run = (s > 0 && sample[s] == sample[s-1]) ? run + 1 : 1;
+        max_run = std::max(max_run, run);
+    }
+    return (max_run * 32 >= sample_len) && (max_run * func.buckets >= sample_len * 8);
+}
+
+/*private histogram per thread, merged bucket-wise*/
+template<BucketFunc type>
+static void histogram_private(const int *keys, uint64_t len, const bucket_func_t &func, uint64_t *his) {
+    int buckets = func.buckets;
+    int max_threads = std::min(omp_get_max_threads(), MAX_THREAD_NUM);
+    uint64_t *local_his = host_new<uint64_t>((uint64_t)buckets * max_threads);
+    int nthreads = 1;
+
+#pragma omp parallel num_threads(max_threads)
+    {
+        int tid = omp_get_thread_num();
+#pragma omp single
+        nthreads = omp_get_num_threads();
+        uint64_t *my_his = local_his + (uint64_t)buckets * tid;
+        memset(my_his, 0, sizeof(uint64_t)*buckets);
+#pragma omp for schedule(static)
+        for(uint64_t i = 0; i < len; i++) my_his[bucket_of<type>(keys[i], func)]++;
+
+#pragma omp for schedule(static)
+        for(int b = 0; b < buckets; b++) {
+            uint64_t acc = 0;
+            for(int th = 0; th < nthreads; th++) acc += local_his[(uint64_t)buckets * th + b];
+            his[b] = acc;
+        }
+    }
+    host_delete(local_his);
+}
+
+/*single shared histogram updated with atomics*/
+template<BucketFunc type>
+static void histogram_shared(const int *keys, uint64_t len, const bucket_func_t &func, uint64_t *his) {
+    memset(his, 0, sizeof(uint64_t)*func.buckets);
+#pragma omp parallel for schedule(static)
+    for(uint64_t i = 0; i < len; i++) __sync_fetch_and_add(&his[bucket_of<type>(keys[i], func)], 1);
+}
+
+/*
+ * Sort-based: the bucket IDs of each chunk are sorted and every run of equal
+ * IDs is added to the shared histogram with one atomic, so a heavy bucket
+ * costs one atomic per chunk instead of one per key
+ * */
+template<BucketFunc type>
+static void histogram_sort(const int *keys, uint64_t len, const bucket_func_t &func, uint64_t *his) {
+    memset(his, 0, sizeof(uint64_t)*func.buckets);
+    uint64_t num_chunks = (len + HIST_SORT_CHUNK - 1) / HIST_SORT_CHUNK;
+
+#pragma omp parallel
+    {
+        uint32_t ids[HIST_SORT_CHUNK];
+#pragma omp for schedule(static)
+        for(uint64_t c = 0; c < num_chunks; c++) {
+            uint64_t begin = c * HIST_SORT_CHUNK;
+            int chunk_len = (int)std::min<uint64_t>(HIST_SORT_CHUNK, len - begin);
+            for(int i = 0; i < chunk_len; i++) ids[i] = bucket_of<type>(keys[begin+i], func);
+            std::sort(ids, ids + chunk_len);
+
+            int head = 0;
+            for(int i = 1; i <= chunk_len; i++) {
+                if (i == chunk_len || ids[i] != ids[head]) {
+                    __sync_fetch_and_add(&his[ids[head]], (uint64_t)(i - head));
+                    head = i;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * HIST_AUTO: private histograms if a histogram fits in the L2 and the merge
+ * costs less than the counting, otherwise the sort-based strategy for skewed
+ * samples and the shared histogram for the others
+ * */
+template<BucketFunc type>
+static void histogram_impl(const int *keys, uint64_t len, const bucket_func_t &func,
+                           uint64_t *his, HistStrategy &strategy) {
+    if (strategy == HIST_AUTO) {
+        const cache_info_t &info = get_cache_info();
+        uint64_t threads = omp_get_max_threads();
+        bool private_cheap = ((uint64_t)func.buckets * sizeof(uint64_t) <= info.l2_size) &&
+                             ((uint64_t)func.buckets * threads <= len);
+        if (private_cheap)                              strategy = HIST_PRIVATE;
+        else if (sample_skewed<type>(keys, len, func))  strategy = HIST_SORT;
+        else                                            strategy = HIST_SHARED;
+    }
+    switch (strategy) {
+        case HIST_PRIVATE:  histogram_private<type>(keys, len, func, his); break;
+        case HIST_SHARED:   histogram_shared<type>(keys, len, func, his); break;
+        default:            histogram_sort<type>(keys, len, func, his); break;
+    }
+}
+
+double histogram_omp(const int *keys, uint64_t len, const bucket_func_t &func,
+                     uint64_t *his, HistStrategy &strategy) {
+    Timer t;
+    switch (func.type) {
+        case BUCKET_RADIX:  histogram_impl<BUCKET_RADIX>(keys, len, func, his, strategy); break;
+        case BUCKET_MOD:    histogram_impl<BUCKET_MOD>(keys, len, func, his, strategy); break;
+        case BUCKET_HASH:   histogram_impl<BUCKET_HASH>(keys, len, func, his, strategy); break;
+    }
+    return t.elapsed()*1000;
+}
@@ -0,0 +1,344 @@
+//
+//  Created by Zhuohang Lai on 5/16/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include "../primitives.h"
+#include "timer.h"
+#include "log.h"
+#include "cache_probe.h"
+#include "utility.h"
+#include "task_graph.h"
+using namespace std;
+
+#define PROBE_TASK_TUPLES   (1<<16)     /*S tuples probed by a single task*/
+#define NP_GROUP_SIZE       (16)        /*tuples whose slots are prefetched together*/
+
+/*slots of the non-partitioned table pack (key, value) into 64 bits, so that an insertion is a single CAS*/
+#define NP_SLOT(key, value)     ((((uint64_t)(uint32_t)(value)) << 32) | (uint32_t)(key))
+#define NP_SLOT_KEY(slot)       ((int)(uint32_t)(slot))
+#define NP_SLOT_VALUE(slot)     ((int)((slot) >> 32))
+#define NP_EMPTY_SLOT           NP_SLOT(JOIN_EMPTY_KEY, 0)
+
+/*multiplicative hashing on the bits above the radix bits, taking the top table_bits bits of the product*/
+#define JOIN_HASH(key, shift, table_bits)   (((((unsigned)(key)) >> (shift)) * 0x9E3779B1u) >> (32 - (table_bits)))
+
+/*radix bits so that the table of an R partition (2 slots per tuple, key and value) fits in half of the L2*/
+static int join_radix_bits(uint64_t r_len, const cache_info_t &info) {
+    uint64_t part_tuples = std::max<uint64_t>(info.l2_size / 2 / (2*2*sizeof(int)), 1);
+    int bits = 1;
+    while ((r_len >> bits) > part_tuples) bits++;
+    return bits;
+}
+
+/*buffers of a partitioned relation in a TaskGraph, start has one more entry holding the length*/
+struct partition_bufs_t {
+    int keys, values, start;
+};
+
+/*
+ * Nodes of the multi-pass radix partitioning, @pass_bits[p] bits in pass p
+ * The first pass is a parallel split over the whole relation, the later
+ * passes refine every partition of the previous pass independently.
+ * Every pass writes new buffers of the graph, so the ones of a pass are
+ * freed as soon as the next pass is done. Returns the buffers of the last pass.
+ * */
+static partition_bufs_t add_partition_nodes(TaskGraph &graph, const char *name,
+                                            const int *keys, const int *values, uint64_t len,
+                                            const vector<int> &pass_bits) {
+    partition_bufs_t in = {-1, -1, -1};
+    uint64_t parts = 1;
+    int shift = 0;
+    for(size_t p = 0; p < pass_bits.size(); p++) {
+        int buckets = 1 << pass_bits[p];
+        partition_bufs_t out = {graph.add_buffer(sizeof(int)*len), graph.add_buffer(sizeof(int)*len),
+                                graph.add_buffer(sizeof(uint64_t)*(parts*buckets+1))};
+        if (p == 0) {
+            graph.add_node(name, [&graph, keys, values, len, buckets, out] {
+                split_par(keys, values, graph.get<int>(out.keys), graph.get<int>(out.values),
+                          len, buckets, 0, graph.get<uint64_t>(out.start));
+            }, {}, {out.keys, out.values, out.start});
+        }
+        else {
+            graph.add_node(name, [&graph, len, parts, buckets, shift, in, out] {
+                const int *in_keys = graph.get<int>(in.keys), *in_values = graph.get<int>(in.values);
+                const uint64_t *start = graph.get<uint64_t>(in.start);
+                int *out_keys = graph.get<int>(out.keys), *out_values = graph.get<int>(out.values);
+                uint64_t *new_start = graph.get<uint64_t>(out.start);
+#pragma omp parallel for schedule(dynamic, 1)
+                for(uint64_t q = 0; q < parts; q++) {
+                    uint64_t begin = start[q];
+                    vector<uint64_t> sub_start(buckets+1);
+                    split_seq(in_keys+begin, in_values+begin, out_keys+begin, out_values+begin,
+                              start[q+1]-begin, buckets, shift, sub_start.data());
+                    for(int b = 0; b < buckets; b++) new_start[q*buckets+b] = begin + sub_start[b];
+                }
+                new_start[parts*buckets] = len;
+            }, {in.keys, in.values, in.start}, {out.keys, out.values, out.start});
+        }
+        in = out;
+        parts *= buckets;
+        shift += pass_bits[p];
+    }
+    return in;
+}
+
+/*probe [begin, end) of S, returns the number of matches, which are appended to res_R/res_S if not null*/
+static uint64_t probe_range(const int *table_keys, const int *table_values,
+                            unsigned mask, int shift, int table_bits,
+                            const int *keys, const int *values,
+                            uint64_t begin, uint64_t end,
+                            vector<int> *res_R, vector<int> *res_S) {
+    uint64_t count = 0;
+    for(uint64_t i = begin; i < end; i++) {
+        int key = keys[i];
+        unsigned slot = JOIN_HASH(key, shift, table_bits);
+        while (table_keys[slot] != JOIN_EMPTY_KEY) {
+            if (table_keys[slot] == key) {
+                count++;
+                if (res_R) {
+                    res_R->emplace_back(table_values[slot]);
+                    res_S->emplace_back(values[i]);
+                }
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    return count;
+}
+
+/*
+ * build and probe of the partitions, returns the number of matches
+ * (materialized to out_R/out_S if they are set, see hash_join_omp)
+ * */
+static uint64_t build_probe(const int *R_part_keys, const int *R_part_values, const uint64_t *R_start,
+                            const int *S_part_keys, const int *S_part_values, const uint64_t *S_start,
+                            int total_bits, int **out_R, int **out_S) {
+    uint64_t parts = 1ull << total_bits;
+    bool materialize = (out_R != nullptr) && (out_S != nullptr);
+
+    /*probe units: PROBE_TASK_TUPLES of the S side of a partition*/
+    vector<uint64_t> unit_begin(parts+1, 0);
+    for(uint64_t p = 0; p < parts; p++) {
+        uint64_t s_part_len = S_start[p+1] - S_start[p];
+        uint64_t units = std::max<uint64_t>((s_part_len + PROBE_TASK_TUPLES - 1) / PROBE_TASK_TUPLES, 1);
+        unit_begin[p+1] = unit_begin[p] + units;
+    }
+    uint64_t num_units = unit_begin[parts];
+    vector<uint64_t> unit_count(num_units+1, 0);
+    vector<vector<int>> unit_R(materialize ? num_units : 0), unit_S(materialize ? num_units : 0);
+
+    /*2.build and probe, tasks are scheduled dynamically for load balance under skew*/
+#pragma omp parallel
+#pragma omp single
+    {
+        for(uint64_t p = 0; p < parts; p++) {
+#pragma omp task firstprivate(p)
+            {
+                uint64_t r_begin = R_start[p], r_end = R_start[p+1];
+                int table_bits = 1;
+                while ((1ull << table_bits) < 2*(r_end-r_begin)) table_bits++;
+                uint64_t slots = 1ull << table_bits;
+                unsigned mask = (unsigned)(slots - 1);
+                int *table_keys = host_new<int>(slots);
+                int *table_values = host_new<int>(slots);
+                for(uint64_t i = 0; i < slots; i++) table_keys[i] = JOIN_EMPTY_KEY;
+
+                /*build with linear probing*/
+                for(uint64_t i = r_begin; i < r_end; i++) {
+                    int key = R_part_keys[i];
+                    unsigned slot = JOIN_HASH(key, total_bits, table_bits);
+                    while (table_keys[slot] != JOIN_EMPTY_KEY) slot = (slot + 1) & mask;
+                    table_keys[slot] = key;
+                    table_values[slot] = R_part_values[i];
+                }
+
+                /*probe*/
+                for(uint64_t u = unit_begin[p]; u < unit_begin[p+1]; u++) {
+#pragma omp task firstprivate(u)
+                    {
+                        uint64_t begin = S_start[p] + (u - unit_begin[p]) * PROBE_TASK_TUPLES;
+                        uint64_t end = std::min<uint64_t>(begin + PROBE_TASK_TUPLES, S_start[p+1]);
+                        unit_count[u] = probe_range(table_keys, table_values, mask, total_bits, table_bits,
+                                                    S_part_keys, S_part_values, begin, end,
+                                                    materialize ? &unit_R[u] : nullptr,
+                                                    materialize ? &unit_S[u] : nullptr);
+                    }
+                }
+#pragma omp taskwait
+                host_delete(table_keys);
+                host_delete(table_values);
+            }
+        }
+    }
+
+    /*3.output offsets and materialization*/
+    uint64_t acc = 0;
+    for(uint64_t u = 0; u <= num_units; u++) {
+        uint64_t temp = unit_count[u];
+        unit_count[u] = acc;
+        acc += temp;
+    }
+    if (materialize) {
+        *out_R = new int[std::max<uint64_t>(acc, 1)];
+        *out_S = new int[std::max<uint64_t>(acc, 1)];
+#pragma omp parallel for schedule(dynamic, 16)
+        for(uint64_t u = 0; u < num_units; u++) {
+            memcpy(*out_R + unit_count[u], unit_R[u].data(), sizeof(int)*unit_R[u].size());
+            memcpy(*out_S + unit_count[u], unit_S[u].data(), sizeof(int)*unit_S[u].size());
+        }
+    }
+    return acc;
+}
+
+/*
+ *  Radix-partitioned hash join (equi-join on the keys)
+ *  1. R and S are partitioned on the lowest radix bits, chosen so that the
+ *     table of an R partition fits in half of the L2. The fan-out of each pass
+ *     is bounded by split_fanout_bits (one cache line per bucket in the L1),
+ *     so more bits need more passes instead of more TLB/cache misses.
+ *     The passes are nodes of a TaskGraph: R and S are partitioned
+ *     concurrently, and the buffers of a pass are freed once the next is done.
+ *  2. A task per partition builds an open-addressing table on its R side and
+ *     probes it with its S side; large S sides are probed by several tasks.
+ *  3. If @out_R and @out_S are set, the matched (R value, S value) pairs are
+ *     copied to new[]-allocated arrays (freed by the caller), otherwise only
+ *     the number of matches is computed.
+ *  Keys must not be JOIN_EMPTY_KEY.
+ * */
+double hash_join_omp(const int *R_keys, const int *R_values, uint64_t r_len,
+                     const int *S_keys, const int *S_values, uint64_t s_len,
+                     uint64_t &res_len, int **out_R, int **out_S) {
+    const cache_info_t &info = get_cache_info();
+    int total_bits = join_radix_bits(r_len, info);
+    int fanout_bits = split_fanout_bits(info);
+    int passes = (total_bits + fanout_bits - 1) / fanout_bits;
+    vector<int> pass_bits;
+    for(int p = 0; p < passes; p++) {
+        pass_bits.emplace_back(total_bits*(p+1)/passes - total_bits*p/passes);
+    }
+    log_trace("Join: %d radix bits in %d pass(es)", total_bits, passes);
+
+    /*
+     * the plan: the partitioning passes of R and S are independent and run
+     * concurrently on half of the threads each, then the build and probe
+     * */
+    TaskGraph graph(2);
+    partition_bufs_t R_part = add_partition_nodes(graph, "partition R", R_keys, R_values, r_len, pass_bits);
+    partition_bufs_t S_part = add_partition_nodes(graph, "partition S", S_keys, S_values, s_len, pass_bits);
+    graph.add_node("build and probe", [&] {
+        res_len = build_probe(graph.get<int>(R_part.keys), graph.get<int>(R_part.values), graph.get<uint64_t>(R_part.start),
+                              graph.get<int>(S_part.keys), graph.get<int>(S_part.values), graph.get<uint64_t>(S_part.start),
+                              total_bits, out_R, out_S);
+    }, {R_part.keys, R_part.values, R_part.start, S_part.keys, S_part.values, S_part.start}, {});
+
+    double total_time = graph.run();
+    log_trace("Join: peak of the partitioning buffers %.1f MB", graph.peak_bytes() / 1024.0 / 1024);
+    return total_time;
+}
+
+/*
+ *  Non-partitioned hash join (equi-join on the keys)
+ *  1. All threads insert R into a shared linear-probing table with CAS, the
+ *     table is backed by huge pages to keep the random accesses free of TLB misses.
+ *  2. All threads probe the table with S. Build and probe use group
+ *     prefetching: the slots of NP_GROUP_SIZE tuples are hashed and prefetched
+ *     before any of them is accessed, so that their cache misses overlap.
+ *  3. Output as in hash_join_omp: pairs if @out_R and @out_S are set, otherwise the count.
+ *  Keys must not be JOIN_EMPTY_KEY.
+ * */
+double hash_join_np_omp(const int *R_keys, const int *R_values, uint64_t r_len,
+                        const int *S_keys, const int *S_values, uint64_t s_len,
+                        uint64_t &res_len, int **out_R, int **out_S) {
+    int table_bits = 1;
+    while ((1ull << table_bits) < 2*r_len) table_bits++;
+    uint64_t slots = 1ull << table_bits;
+    unsigned mask = (unsigned)(slots - 1);
+    bool materialize = (out_R != nullptr) && (out_S != nullptr);
+
+    uint64_t *table = (uint64_t*)alloc_huge_pages(sizeof(uint64_t)*slots);
+    int max_threads = omp_get_max_threads();
+    vector<uint64_t> thread_count(max_threads+1, 0);
+    vector<vector<int>> thread_R(materialize ? max_threads : 0), thread_S(materialize ? max_threads : 0);
+    Timer t;
+
+#pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        unsigned group_slot[NP_GROUP_SIZE];
+
+        /*1.initialization, the pages are first touched by all the threads*/
+#pragma omp for schedule(static)
+        for(uint64_t i = 0; i < slots; i++) table[i] = NP_EMPTY_SLOT;
+
+        /*2.build*/
+#pragma omp for schedule(static)
+        for(uint64_t g = 0; g < r_len; g += NP_GROUP_SIZE) {
+            uint64_t end = std::min<uint64_t>(g + NP_GROUP_SIZE, r_len);
+            for(uint64_t i = g; i < end; i++) {
+                group_slot[i-g] = JOIN_HASH(R_keys[i], 0, table_bits);
+                __builtin_prefetch(table + group_slot[i-g], 1);
+            }
+            for(uint64_t i = g; i < end; i++) {
+                uint64_t entry = NP_SLOT(R_keys[i], R_values[i]);
+                unsigned slot = group_slot[i-g];
+                while (!__sync_bool_compare_and_swap(table + slot, NP_EMPTY_SLOT, entry))
+                    slot = (slot + 1) & mask;
+            }
+        }
+
+        /*3.probe, matches are buffered per thread*/
+        uint64_t my_count = 0;
+        vector<int> *res_R = materialize ? &thread_R[tid] : nullptr;
+        vector<int> *res_S = materialize ? &thread_S[tid] : nullptr;
+#pragma omp for schedule(static) nowait
+        for(uint64_t g = 0; g < s_len; g += NP_GROUP_SIZE) {
+            uint64_t end = std::min<uint64_t>(g + NP_GROUP_SIZE, s_len);
+            for(uint64_t i = g; i < end; i++) {
+                group_slot[i-g] = JOIN_HASH(S_keys[i], 0, table_bits);
+                __builtin_prefetch(table + group_slot[i-g], 0);
+            }
+            for(uint64_t i = g; i < end; i++) {
+                int key = S_keys[i];
+                unsigned slot = group_slot[i-g];
+                uint64_t entry;
+                while ((entry = table[slot]) != NP_EMPTY_SLOT) {
+                    if (NP_SLOT_KEY(entry) == key) {
+                        my_count++;
+                        if (res_R) {
+                            res_R->emplace_back(NP_SLOT_VALUE(entry));
+                            res_S->emplace_back(S_values[i]);
+                        }
+                    }
+                    slot = (slot + 1) & mask;
+                }
+            }
+        }
+        thread_count[tid] = my_count;
+    }
+
+    /*4.output offsets and materialization*/
+    uint64_t acc = 0;
+    for(int th = 0; th <= max_threads; th++) {
+        uint64_t temp = thread_count[th];
+        thread_count[th] = acc;
+        acc += temp;
+    }
+    res_len = acc;
+    if (materialize) {
+        *out_R = new int[std::max<uint64_t>(res_len, 1)];
+        *out_S = new int[std::max<uint64_t>(res_len, 1)];
+#pragma omp parallel for schedule(static, 1)
+        for(int th = 0; th < max_threads; th++) {
+            memcpy(*out_R + thread_count[th], thread_R[th].data(), sizeof(int)*thread_R[th].size());
+            memcpy(*out_S + thread_count[th], thread_S[th].data(), sizeof(int)*thread_S[th].size());
+        }
+    }
+    double total_time = t.elapsed()*1000;
+
+    free_huge_pages(table);
+    return total_time;
+}
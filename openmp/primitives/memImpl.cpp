@@ -0,0 +1,57 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <immintrin.h>
+#include "../primitives.h"
+#include "timer.h"
+
+#define SCALAR  (3)
+
+/* Sequential memory copy operation */
+double copy_omp(int *input, int *output, uint64_t len) {
+    Timer t;
+#pragma omp parallel for schedule(static)
+    for(uint64_t i = 0; i < len; i++) {
+        output[i] = input[i];
+    }
+    return t.elapsed()*1000; //in ms
+}
+
+/* Sequential scaling operation */
+double scale_omp(int *input, int *output, uint64_t len) {
+    Timer t;
+#pragma omp parallel for schedule(static)
+    for(uint64_t i = 0; i < len; i++) {
+        output[i] = input[i] * SCALAR;
+    }
+    return t.elapsed()*1000; //in ms
+}
+
+/* Sequential memory copy operation with nontemporal streaming stores */
+double copy_omp_ss(int *input, int *output, uint64_t len) {
+    Timer t;
+#pragma omp parallel for schedule(auto)
+    for(uint64_t i = 0; i < len/8; i++) { //256-bit = 8 int values
+        register __m256i *dest = (__m256i*)output + i;
+        register __m256i source = *((__m256i*)input + i);
+        _mm256_stream_si256(dest,source);   //streaming store
+    }
+    return t.elapsed()*1000; //in ms
+}
+
+/* Sequential memory copy operation with nontemporal streaming stores */
+double scale_omp_ss(int *input, int *output, uint64_t len) {
+    __m256i v = _mm256_set_epi32(SCALAR,SCALAR,SCALAR,SCALAR,
+                                 SCALAR,SCALAR,SCALAR,SCALAR);
+    Timer t;
+#pragma omp parallel for schedule(auto)
+    for(uint64_t i = 0; i < len/8; i++) { //256-bit = 8 int values
+        register __m256i *dest = (__m256i*)output + i;
+        register __m256i source = *((__m256i*)input + i);
+        source = _mm256_mullo_epi32 (source, v);
+        _mm256_stream_si256(dest,source);   //streaming store
+    }
+    return t.elapsed()*1000; //in ms
+}
@@ -0,0 +1,224 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#include "../primitives.h"
+#include "timer.h"
+#include "log.h"
+
+/*
+ * Layout (the one of opencl/kernels/pack_kernel.cl): value i is value
+ * k = (i % PACK_BLOCK) / PACK_LANES of lane l = i % PACK_LANES in block
+ * i / PACK_BLOCK, at bits [k*bits, (k+1)*bits) of the lane, and word w of
+ * lane l is at block*bits*PACK_LANES + w*PACK_LANES + l. A 256-bit register
+ * thus holds word w of all the lanes, and values k*PACK_LANES..k*PACK_LANES+7
+ * come out of one or two such registers with shifts only. The AVX2 width is
+ * part of the format, so AVX-512 builds use the same 8-lane code.
+ * */
+#define PACK_MASK(bits)     (((bits) == 32) ? 0xffffffffu : ((1u << (bits)) - 1))
+
+static bool check_bits(int bits) {
+    if (bits < 1 || bits > 32) {
+        log_error("Wrong parameters: packed values of %d bits", bits);
+        return false;
+    }
+    return true;
+}
+
+/*the PACK_BLOCK values of the block at words*/
+static inline void unpack_block(const uint32_t *words, int bits, int *out) {
+    const __m256i mask = _mm256_set1_epi32(PACK_MASK(bits));
+    for(int k = 0; k < PACK_BLOCK / PACK_LANES; k++) {
+        int bit = k * bits, w = bit >> 5, s = bit & 31;
+        __m256i v = _mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)(words + w*PACK_LANES)),
+                                     _mm_cvtsi32_si128(s));
+        if (s + bits > 32) {    /*the rest of the values from the next word*/
+            __m256i hi = _mm256_loadu_si256((const __m256i*)(words + (w+1)*PACK_LANES));
+            v = _mm256_or_si256(v, _mm256_sll_epi32(hi, _mm_cvtsi32_si128(32 - s)));
+        }
+        _mm256_storeu_si256((__m256i*)(out + k*PACK_LANES), _mm256_and_si256(v, mask));
+    }
+}
+
+/*pack the PACK_BLOCK values of in into the bits*PACK_LANES words of a block*/
+static inline void pack_block(const int *in, int bits, uint32_t *words) {
+    const __m256i mask = _mm256_set1_epi32(PACK_MASK(bits));
+    __m256i acc = _mm256_setzero_si256();
+    for(int k = 0; k < PACK_BLOCK / PACK_LANES; k++) {
+        int bit = k * bits, w = bit >> 5, s = bit & 31;
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(in + k*PACK_LANES)), mask);
+        acc = _mm256_or_si256(acc, _mm256_sll_epi32(v, _mm_cvtsi32_si128(s)));
+        if (s + bits >= 32) {   /*word w is complete, the spilled bits start word w+1*/
+            _mm256_storeu_si256((__m256i*)(words + w*PACK_LANES), acc);
+            acc = (s + bits > 32) ? _mm256_srl_epi32(v, _mm_cvtsi32_si128(32 - s)) : _mm256_setzero_si256();
+        }
+    }
+}
+
+/*value i of a packed column, for random accesses*/
+static inline int unpack_value(const uint32_t *words, uint64_t i, int bits) {
+    uint64_t r = i % PACK_BLOCK;
+    int bit = (int)(r / PACK_LANES) * bits;
+    int w = bit >> 5, s = bit & 31;
+    const uint32_t *lane = words + i / PACK_BLOCK * bits * PACK_LANES + r % PACK_LANES;
+
+    uint32_t v = lane[w*PACK_LANES] >> s;
+    if (s + bits > 32) v |= lane[(w+1)*PACK_LANES] << (32 - s);
+    return (int)(v & PACK_MASK(bits));
+}
+
+/*
+ * values idx[0..7] of a packed column with two AVX2 gathers: the word holding
+ * the low bits of each value, and the next word of the lane for the values
+ * that cross a word boundary (masked, it may lie past the end of the block)
+ * */
+static inline __m256i unpack_gather(const uint32_t *words, const int *idx, int bits) {
+    const __m256i lane_mask = _mm256_set1_epi32(PACK_LANES - 1);
+    __m256i i = _mm256_loadu_si256((const __m256i*)idx);
+    __m256i bit = _mm256_mullo_epi32(_mm256_srli_epi32(_mm256_and_si256(i, _mm256_set1_epi32(PACK_BLOCK - 1)), 3),
+                                     _mm256_set1_epi32(bits));
+    __m256i s = _mm256_and_si256(bit, _mm256_set1_epi32(31));
+    __m256i pos = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(i, 8), _mm256_set1_epi32(bits * PACK_LANES)),
+                                                    _mm256_slli_epi32(_mm256_srli_epi32(bit, 5), 3)),
+                                   _mm256_and_si256(i, lane_mask));
+    __m256i lo = _mm256_i32gather_epi32((const int*)words, pos, 4);
+    __m256i cross = _mm256_cmpgt_epi32(_mm256_add_epi32(s, _mm256_set1_epi32(bits)), _mm256_set1_epi32(32));
+    __m256i hi = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)words,
+                                             _mm256_add_epi32(pos, _mm256_set1_epi32(PACK_LANES)), cross, 4);
+    __m256i v = _mm256_or_si256(_mm256_srlv_epi32(lo, s),       /*shifts by 32 give 0*/
+                                _mm256_sllv_epi32(hi, _mm256_sub_epi32(_mm256_set1_epi32(32), s)));
+    return _mm256_and_si256(v, _mm256_set1_epi32(PACK_MASK(bits)));
+}
+
+/*values [begin, end) of a packed column to output[0, end-begin), begin is a multiple of PACK_BLOCK*/
+void unpack_range(const uint32_t *input, int *output, uint64_t begin, uint64_t end, int bits) {
+    int buf[PACK_BLOCK];
+    for(uint64_t i = begin; i < end; i += PACK_BLOCK) {
+        const uint32_t *words = input + i / PACK_BLOCK * bits * PACK_LANES;
+        if (i + PACK_BLOCK <= end) unpack_block(words, bits, output + (i - begin));
+        else {  /*partial last block*/
+            unpack_block(words, bits, buf);
+            memcpy(output + (i - begin), buf, sizeof(int)*(end - i));
+        }
+    }
+}
+
+double pack_omp(const int *input, uint32_t *output, uint64_t len, int bits) {
+    if (!check_bits(bits)) return -1;
+    uint64_t blocks = (len + PACK_BLOCK - 1) / PACK_BLOCK;
+    Timer t;
+#pragma omp parallel for schedule(static)
+    for(uint64_t b = 0; b < blocks; b++) {
+        uint32_t *words = output + b * bits * PACK_LANES;
+        if ((b+1) * PACK_BLOCK <= len) pack_block(input + b*PACK_BLOCK, bits, words);
+        else {  /*zero-padded last block*/
+            int buf[PACK_BLOCK] = {0};
+            memcpy(buf, input + b*PACK_BLOCK, sizeof(int)*(len - b*PACK_BLOCK));
+            pack_block(buf, bits, words);
+        }
+    }
+    return t.elapsed()*1000;
+}
+
+double unpack_omp(const uint32_t *input, int *output, uint64_t len, int bits) {
+    if (!check_bits(bits)) return -1;
+    uint64_t blocks = (len + PACK_BLOCK - 1) / PACK_BLOCK;
+    Timer t;
+#pragma omp parallel for schedule(static)
+    for(uint64_t b = 0; b < blocks; b++) {
+        unpack_range(input, output + b*PACK_BLOCK, b*PACK_BLOCK, std::min((b+1)*PACK_BLOCK, len), bits);
+    }
+    return t.elapsed()*1000;
+}
+
+/*
+ * Gather from a packed column: the random reads fall into bits/32 of the
+ * footprint of an int column. With output_packed, every block of outputs is
+ * gathered into a buffer and packed in registers.
+ * */
+double gather_packed_omp(const uint32_t *input, int bits, const int *idx, uint64_t len,
+                         int *output, uint32_t *output_packed) {
+    if (!check_bits(bits)) return -1;
+    Timer t;
+    uint64_t vec_len = len / PACK_LANES * PACK_LANES;
+    if (output_packed == nullptr) {
+#pragma omp parallel for schedule(static)
+        for(uint64_t i = 0; i < vec_len; i += PACK_LANES) {
+            _mm256_storeu_si256((__m256i*)(output + i), unpack_gather(input, idx + i, bits));
+        }
+        for(uint64_t i = vec_len; i < len; i++) output[i] = unpack_value(input, idx[i], bits);
+    }
+    else {
+        uint64_t blocks = (len + PACK_BLOCK - 1) / PACK_BLOCK;
+#pragma omp parallel for schedule(static)
+        for(uint64_t b = 0; b < blocks; b++) {
+            int buf[PACK_BLOCK] = {0};
+            uint64_t end = std::min((b+1)*PACK_BLOCK, len);
+            uint64_t i = b*PACK_BLOCK;
+            for(; i + PACK_LANES <= end; i += PACK_LANES)
+                _mm256_storeu_si256((__m256i*)(buf + i - b*PACK_BLOCK), unpack_gather(input, idx + i, bits));
+            for(; i < end; i++)
+                buf[i - b*PACK_BLOCK] = unpack_value(input, idx[i], bits);
+            pack_block(buf, bits, output_packed + b * bits * PACK_LANES);
+        }
+    }
+    return t.elapsed()*1000;
+}
+
+/*
+ * Exclusive scan of a packed column, reduce-then-scan as scan_RTS_omp on
+ * block-aligned thread chunks; each block is unpacked to the stack in both
+ * passes, so the input is read twice in its packed size.
+ * */
+double scan_packed_omp(const uint32_t *input, int bits, int *output, uint64_t len) {
+    if (!check_bits(bits)) return -1;
+    int reduce_sum[MAX_THREAD_NUM] = {0};
+    uint64_t blocks = (len + PACK_BLOCK - 1) / PACK_BLOCK;
+    Timer t;
+
+#pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint64_t begin = std::min(blocks * tid / nthreads * PACK_BLOCK, len);
+        uint64_t end = std::min(blocks * (tid+1) / nthreads * PACK_BLOCK, len);
+        int buf[PACK_BLOCK];
+        int local_sum = 0;
+
+        /*Reduce*/
+        for(uint64_t i = begin; i < end; i += PACK_BLOCK) {
+            uint64_t num = std::min((uint64_t)PACK_BLOCK, end - i);
+            unpack_range(input, buf, i, i + num, bits);
+            for(uint64_t j = 0; j < num; j++) local_sum += buf[j];
+        }
+        reduce_sum[tid] = local_sum;
+#pragma omp barrier
+
+        /*Scan*/
+#pragma omp single
+        {
+            int acc = 0;
+            for (int i = 0; i < nthreads; i++) {
+                int temp = reduce_sum[i];
+                reduce_sum[i] = acc;
+                acc += temp;
+            }
+        }
+
+        /*Scan*/
+        local_sum = reduce_sum[tid];
+        for(uint64_t i = begin; i < end; i += PACK_BLOCK) {
+            uint64_t num = std::min((uint64_t)PACK_BLOCK, end - i);
+            unpack_range(input, buf, i, i + num, bits);
+            for(uint64_t j = 0; j < num; j++) {
+                output[i+j] = local_sum;
+                local_sum += buf[j];
+            }
+        }
+    }
+    return t.elapsed()*1000;
+}
@@ -0,0 +1,102 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <limits>
+#include "../primitives.h"
+#include "timer.h"
+
+#define REDUCE_VEC_BYTES    (32)        /*AVX2 register*/
+#define REDUCE_VECS         (4)         /*independent vector accumulators, hides the add/min/max latency*/
+
+template<typename T>
+inline T identity(ReduceOp op) {
+    switch (op) {
+        case REDUCE_MIN:    return std::numeric_limits<T>::max();
+        case REDUCE_MAX:    return std::numeric_limits<T>::lowest();
+        default:            return 0;
+    }
+}
+
+template<ReduceOp op, typename T>
+inline T combine(T a, T b) {
+    switch (op) {       /*resolved at compile time*/
+        case REDUCE_MIN:    return (b < a) ? b : a;
+        case REDUCE_MAX:    return (b > a) ? b : a;
+        default:            return a + b;
+    }
+}
+
+/*
+ * accumulator type: float sums are accumulated in double, a float
+ * accumulator stops growing once the sum is 2^24 times the values
+ * */
+template<ReduceOp op, typename T>
+struct acc_type { typedef T type; };
+template<>
+struct acc_type<REDUCE_SUM, float> { typedef double type; };
+
+/*
+ * Reduce [begin, end) with ACCS independent accumulators, the inner loop
+ * maps to REDUCE_VECS vector registers, followed by a tree combine
+ * */
+template<ReduceOp op, typename T, typename A = typename acc_type<op, T>::type>
+static A reduce_chunk(const T *input, uint64_t begin, uint64_t end) {
+    const int ACCS = REDUCE_VECS * REDUCE_VEC_BYTES / sizeof(A);
+    A acc[ACCS];
+    for(int k = 0; k < ACCS; k++) acc[k] = identity<A>(op);
+
+    uint64_t i = begin;
+    for(; i + ACCS <= end; i += ACCS) {
+        for(int k = 0; k < ACCS; k++) acc[k] = combine<op>(acc[k], (A)input[i+k]);
+    }
+    for(; i < end; i++) acc[0] = combine<op>(acc[0], (A)input[i]);
+
+    for(int width = ACCS/2; width > 0; width >>= 1) {
+        for(int k = 0; k < width; k++) acc[k] = combine<op>(acc[k], acc[k+width]);
+    }
+    return acc[0];
+}
+
+template<ReduceOp op, typename T>
+static T reduce_impl(const T *input, uint64_t len) {
+    typedef typename acc_type<op, T>::type A;
+    A partial[MAX_THREAD_NUM];
+    int nthreads = 1;
+
+#pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+#pragma omp single
+        nthreads = omp_get_num_threads();
+        uint64_t begin = len * tid / nthreads;
+        uint64_t end = len * (tid+1) / nthreads;
+        partial[tid] = reduce_chunk<op>(input, begin, end);
+    }
+
+    /*tree combine of the per-thread results*/
+    for(int width = 1; width < nthreads; width <<= 1) {
+        for(int t = 0; t + width < nthreads; t += 2*width) {
+            partial[t] = combine<op>(partial[t], partial[t+width]);
+        }
+    }
+    return (T)partial[0];      /*rounded once*/
+}
+
+template<typename T>
+double reduce_omp(const T *input, uint64_t len, ReduceOp op, T &res) {
+    Timer t;
+    switch (op) {
+        case REDUCE_SUM:    res = reduce_impl<REDUCE_SUM>(input, len); break;
+        case REDUCE_MIN:    res = reduce_impl<REDUCE_MIN>(input, len); break;
+        case REDUCE_MAX:    res = reduce_impl<REDUCE_MAX>(input, len); break;
+        case REDUCE_COUNT:  res = (T)len; break;
+    }
+    return t.elapsed()*1000;
+}
+
+template double reduce_omp<int32_t>(const int32_t*, uint64_t, ReduceOp, int32_t&);
+template double reduce_omp<int64_t>(const int64_t*, uint64_t, ReduceOp, int64_t&);
+template double reduce_omp<float>(const float*, uint64_t, ReduceOp, float&);
+template double reduce_omp<double>(const double*, uint64_t, ReduceOp, double&);
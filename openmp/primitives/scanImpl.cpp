@@ -0,0 +1,126 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include "../primitives.h"
+#include "timer.h"
+#include "thread_pool.h"
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_scan.h"
+
+using namespace tbb;
+
+/* TBB exclusive scan*/
+template<typename T>
+class ScanBody_ex {
+    T sum;
+    T* const y;
+    const T* const x;
+public:
+    ScanBody_ex( T y_[], const T x_[] ) : sum(0), x(x_), y(y_) {}
+    T get_sum() const {return sum;}
+
+    template<typename Tag>
+    void operator()( const blocked_range<int>& r, Tag ) {
+        T temp = sum;
+        int end = r.end();
+        for( int i=r.begin(); i<end; ++i ) {
+            if( Tag::is_final_scan() )
+                y[i] = temp;
+            temp = temp + x[i];
+        }
+        sum = temp;
+    }
+    ScanBody_ex( ScanBody_ex& b, split ) : x(b.x), y(b.y), sum(0) {}
+    void reverse_join( ScanBody_ex& a ) { sum = a.sum + sum;}
+    void assign( ScanBody_ex& b ) {sum = b.sum;}
+};
+
+double scan_tbb(int *input, int* output, uint64_t len) {
+    Timer t;
+    ScanBody_ex<int> body(output,input);
+    parallel_scan(blocked_range<int>(0,len), body, auto_partitioner());
+    return t.elapsed()*1000;
+};
+
+/*exclusive scan of the per-thread sums, on the caller between two pool jobs*/
+static void scan_thread_sums(int *reduce_sum, int nthreads) {
+    int acc = 0;
+    for (int i = 0; i < nthreads; i++) {
+        int temp = reduce_sum[i];
+        reduce_sum[i] = acc;
+        acc += temp;
+    }
+}
+
+/*
+ * Scan-scan-add scheme, 4n data accesses. The passes are jobs of the thread
+ * pool (thread_pool.h) on the same static partition, single-threaded on small
+ * inputs.
+ * */
+double scan_SSA_omp(int *input, int* output, uint64_t len) {
+    int reduce_sum[MAX_THREAD_NUM] = {0};
+    Timer t;
+    ThreadPool &pool = ThreadPool::get();
+    int nthreads = pool.threads_for(len);
+
+    /*Scan*/
+    pool.run(nthreads, [&](int tid, int nthreads) {
+        int local_sum = 0;
+        uint64_t begin = len * tid / nthreads, end = len * (tid+1) / nthreads;
+        for (uint64_t i = begin; i < end; i++) {
+            output[i] = local_sum;
+            local_sum += input[i];
+        }
+        reduce_sum[tid] = local_sum;
+    });
+    if (nthreads == 1) return t.elapsed()*1000;
+
+    /*Scan*/
+    scan_thread_sums(reduce_sum, nthreads);
+
+    /*Add*/
+    pool.run(nthreads, [&](int tid, int nthreads) {
+        int offset = reduce_sum[tid];
+        uint64_t begin = len * tid / nthreads, end = len * (tid+1) / nthreads;
+        for (uint64_t i = begin; i < end; i++) {
+            output[i] += offset;
+        }
+    });
+    return t.elapsed()*1000;
+}
+
+/*reduce-then-scan scheme, 3n data accesses, on the thread pool as scan_SSA_omp*/
+double scan_RTS_omp(int *input, int* output, uint64_t len) {
+    int reduce_sum[MAX_THREAD_NUM] = {0};
+    Timer t;
+    ThreadPool &pool = ThreadPool::get();
+    int nthreads = pool.threads_for(len);
+
+    /*Reduce*/
+    if (nthreads > 1) {
+        pool.run(nthreads, [&](int tid, int nthreads) {
+            int local_sum = 0;
+            uint64_t begin = len * tid / nthreads, end = len * (tid+1) / nthreads;
+            for (uint64_t i = begin; i < end; i++) {
+                local_sum += input[i];
+            }
+            reduce_sum[tid] = local_sum;
+        });
+    }
+
+    /*Scan*/
+    scan_thread_sums(reduce_sum, nthreads);
+
+    /*Scan*/
+    pool.run(nthreads, [&](int tid, int nthreads) {
+        int local_sum = reduce_sum[tid];
+        uint64_t begin = len * tid / nthreads, end = len * (tid+1) / nthreads;
+        for (uint64_t i = begin; i < end; i++) {
+            output[i] = local_sum;
+            local_sum += input[i];
+        }
+    });
+    return t.elapsed()*1000;
+}
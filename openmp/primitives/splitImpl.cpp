@@ -0,0 +1,442 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#include "../primitives.h"
+#include "../typed_primitives.h"
+#include "timer.h"
+#include "log.h"
+
+#define SWWC_TUPLES     (16)    /*ints in a cache line*/
+
+#ifdef __AVX512CD__
+#define SIMD_LANES      (16)
+#else
+#define SIMD_LANES      (8)     /*AVX2*/
+#endif
+
+#define SPLIT_BUCKET(key, shift, mask)  ((((unsigned)(key)) >> (shift)) & (mask))
+
+/*
+ * Counts of the next-pass digit of the tuples written by a scatter, in the
+ * histogram layout of the next pass: his[c*(mask+1)+d] counts the tuples of
+ * digit d in chunk c, where chunk c of the output is [len*c/chunks, len*(c+1)/chunks)
+ * */
+struct next_count_t {
+    int shift;
+    unsigned mask;
+    uint64_t len;
+    int chunks;
+    uint64_t *his;
+};
+
+/*count the num keys written from position pos on, the chunk is derived once per line*/
+static void count_next(const int *keys, uint64_t pos, int num, next_count_t *next) {
+    uint64_t c = ((pos + 1) * next->chunks - 1) / next->len;      /*chunk holding pos*/
+    uint64_t c_end = next->len * (c + 1) / next->chunks;
+    if (pos + num <= c_end) {   /*the usual case: the line lies in a single chunk*/
+        uint64_t *row = next->his + c*(next->mask+1);
+        for(int k = 0; k < num; k++) row[SPLIT_BUCKET(keys[k], next->shift, next->mask)]++;
+        return;
+    }
+    for(int k = 0; k < num; k++) {
+        while (pos + k >= c_end) c_end = next->len * (++c + 1) / next->chunks;
+        next->his[c*(next->mask+1) + SPLIT_BUCKET(keys[k], next->shift, next->mask)]++;
+    }
+}
+
+/*
+ * Software write-combining scatter of [begin, end): tuples are staged in a
+ * cache-line buffer per bucket and written a full line at a time, so that the
+ * scatter touches one line (and one TLB entry) per bucket instead of per tuple.
+ * @pos is the next output position of each bucket and is advanced.
+ * If @next is set, the digit of the next pass is counted from the staged lines.
+ * */
+static void scatter_swwc(const int *keys_in, const int *values_in,
+                         int *keys_out, int *values_out,
+                         uint64_t begin, uint64_t end,
+                         int buckets, int shift, uint64_t *pos,
+                         next_count_t *next=nullptr) {
+    unsigned mask = buckets - 1;
+    int *buf_keys = host_new<int>(buckets*SWWC_TUPLES);
+    int *buf_values = (values_in != nullptr) ? host_new<int>(buckets*SWWC_TUPLES) : nullptr;
+    int *buf_cnt = host_new<int>(buckets);
+    memset(buf_cnt, 0, sizeof(int)*buckets);
+
+    for(uint64_t i = begin; i < end; i++) {
+        int key = keys_in[i];
+        unsigned b = SPLIT_BUCKET(key, shift, mask);
+        int c = buf_cnt[b]++;
+        buf_keys[b*SWWC_TUPLES+c] = key;
+        if (buf_values) buf_values[b*SWWC_TUPLES+c] = values_in[i];
+        if (c == SWWC_TUPLES-1) {   /*a full line*/
+            if (next) count_next(buf_keys+b*SWWC_TUPLES, pos[b], SWWC_TUPLES, next);
+            memcpy(keys_out+pos[b], buf_keys+b*SWWC_TUPLES, sizeof(int)*SWWC_TUPLES);
+            if (buf_values) memcpy(values_out+pos[b], buf_values+b*SWWC_TUPLES, sizeof(int)*SWWC_TUPLES);
+            pos[b] += SWWC_TUPLES;
+            buf_cnt[b] = 0;
+        }
+    }
+    for(int b = 0; b < buckets; b++) {  /*flush the partial lines*/
+        if (next) count_next(buf_keys+b*SWWC_TUPLES, pos[b], buf_cnt[b], next);
+        memcpy(keys_out+pos[b], buf_keys+b*SWWC_TUPLES, sizeof(int)*buf_cnt[b]);
+        if (buf_values) memcpy(values_out+pos[b], buf_values+b*SWWC_TUPLES, sizeof(int)*buf_cnt[b]);
+        pos[b] += buf_cnt[b];
+    }
+
+    host_delete(buf_keys);
+    host_delete(buf_values);
+    host_delete(buf_cnt);
+}
+
+void split_seq(const int *keys_in, const int *values_in,
+               int *keys_out, int *values_out,
+               uint64_t len, int buckets, int shift, uint64_t *start) {
+    unsigned mask = buckets - 1;
+    for(int b = 0; b <= buckets; b++) start[b] = 0;
+    for(uint64_t i = 0; i < len; i++) {
+        start[SPLIT_BUCKET(keys_in[i], shift, mask)+1]++;
+    }
+    for(int b = 0; b < buckets; b++) start[b+1] += start[b];
+
+    uint64_t *pos = host_new<uint64_t>(buckets);
+    memcpy(pos, start, sizeof(uint64_t)*buckets);
+    scatter_swwc(keys_in, values_in, keys_out, values_out, 0, len, buckets, shift, pos);
+    host_delete(pos);
+}
+
+/*bucket-major exclusive scan of the per-thread histograms, his[th*buckets+b] becomes the first position of thread th in bucket b*/
+static void scan_histograms(uint64_t *his, int nthreads, int buckets, uint64_t *start) {
+    uint64_t acc = 0;
+    for(int b = 0; b < buckets; b++) {
+        start[b] = acc;
+        for(int th = 0; th < nthreads; th++) {
+            uint64_t temp = his[(uint64_t)th*buckets+b];
+            his[(uint64_t)th*buckets+b] = acc;
+            acc += temp;
+        }
+    }
+    start[buckets] = acc;
+}
+
+/*the split of typed_primitives.h on a compile-time bucket count*/
+template<int Buckets>
+static void split_fixed(const int *keys_in, const int *values_in,
+                        int *keys_out, int *values_out,
+                        uint64_t len, int shift, uint64_t *start) {
+    if (values_in) prim::split<int, int, prim::SOA, Buckets>(keys_in, values_in, keys_out, values_out, len, shift, start);
+    else prim::split<int, void, prim::SOA, Buckets>(keys_in, keys_out, len, shift, start);
+}
+
+/*
+ * Parallel split with per-thread histograms:
+ * 1. each thread counts the buckets of its static chunk
+ * 2. bucket-major scan of the histograms (keeps the split stable)
+ * 3. each thread scatters its chunk with write-combining buffers
+ * Up to 4096 buckets, the split of typed_primitives.h is instantiated for the
+ * bucket count, the loop below covers the larger fan-outs.
+ * */
+void split_par(const int *keys_in, const int *values_in,
+               int *keys_out, int *values_out,
+               uint64_t len, int buckets, int shift, uint64_t *start) {
+    switch (buckets) {
+        case 2:     split_fixed<2>(keys_in, values_in, keys_out, values_out, len, shift, start);       return;
+        case 4:     split_fixed<4>(keys_in, values_in, keys_out, values_out, len, shift, start);       return;
+        case 8:     split_fixed<8>(keys_in, values_in, keys_out, values_out, len, shift, start);       return;
+        case 16:    split_fixed<16>(keys_in, values_in, keys_out, values_out, len, shift, start);      return;
+        case 32:    split_fixed<32>(keys_in, values_in, keys_out, values_out, len, shift, start);      return;
+        case 64:    split_fixed<64>(keys_in, values_in, keys_out, values_out, len, shift, start);      return;
+        case 128:   split_fixed<128>(keys_in, values_in, keys_out, values_out, len, shift, start);     return;
+        case 256:   split_fixed<256>(keys_in, values_in, keys_out, values_out, len, shift, start);     return;
+        case 512:   split_fixed<512>(keys_in, values_in, keys_out, values_out, len, shift, start);     return;
+        case 1024:  split_fixed<1024>(keys_in, values_in, keys_out, values_out, len, shift, start);    return;
+        case 2048:  split_fixed<2048>(keys_in, values_in, keys_out, values_out, len, shift, start);    return;
+        case 4096:  split_fixed<4096>(keys_in, values_in, keys_out, values_out, len, shift, start);    return;
+        default:    break;
+    }
+    unsigned mask = buckets - 1;
+    uint64_t *his = host_new<uint64_t>((uint64_t)omp_get_max_threads()*buckets);
+
+#pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint64_t begin = len * tid / nthreads;
+        uint64_t end = len * (tid+1) / nthreads;
+        uint64_t *my_his = his + (uint64_t)tid*buckets;
+
+        /*1.histogram*/
+        for(int b = 0; b < buckets; b++) my_his[b] = 0;
+        for(uint64_t i = begin; i < end; i++) {
+            my_his[SPLIT_BUCKET(keys_in[i], shift, mask)]++;
+        }
+#pragma omp barrier
+
+        /*2.scan*/
+#pragma omp single
+        scan_histograms(his, nthreads, buckets, start);
+
+        /*3.scatter*/
+        scatter_swwc(keys_in, values_in, keys_out, values_out, begin, end, buckets, shift, my_his);
+    }
+    host_delete(his);
+}
+
+double split_omp(const int *keys_in, const int *values_in,
+                 int *keys_out, int *values_out,
+                 uint64_t len, int buckets, int shift, uint64_t *start) {
+    Timer t;
+    split_par(keys_in, values_in, keys_out, values_out, len, buckets, shift, start);
+    return t.elapsed()*1000;
+}
+
+/*
+ * split_par on a key column bit-packed with bits bits: the threads take
+ * block-aligned chunks and unpack PACKED_SPLIT_KEYS keys at a time to a
+ * private buffer, which the histogram counts and scatter_swwc then reads,
+ * so the keys come from memory twice in their packed size
+ * */
+#define PACKED_SPLIT_KEYS   (1<<14)     /*64KB of keys, a multiple of PACK_BLOCK*/
+
+double split_packed_omp(const uint32_t *keys_in, int bits, const int *values_in,
+                        int *keys_out, int *values_out,
+                        uint64_t len, int buckets, int shift, uint64_t *start) {
+    if (bits < 1 || bits > 32) {
+        log_error("Wrong parameters: packed keys of %d bits", bits);
+        return -1;
+    }
+    unsigned mask = buckets - 1;
+    uint64_t blocks = (len + PACK_BLOCK - 1) / PACK_BLOCK;
+    uint64_t *his = host_new<uint64_t>((uint64_t)omp_get_max_threads()*buckets);
+    Timer t;
+
+#pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint64_t begin = std::min(blocks * tid / nthreads * PACK_BLOCK, len);
+        uint64_t end = std::min(blocks * (tid+1) / nthreads * PACK_BLOCK, len);
+        uint64_t *my_his = his + (uint64_t)tid*buckets;
+        int *buf = host_new<int>(PACKED_SPLIT_KEYS);
+
+        /*1.histogram*/
+        for(int b = 0; b < buckets; b++) my_his[b] = 0;
+        for(uint64_t i = begin; i < end; i += PACKED_SPLIT_KEYS) {
+            uint64_t num = std::min((uint64_t)PACKED_SPLIT_KEYS, end - i);
+            unpack_range(keys_in, buf, i, i + num, bits);
+            for(uint64_t j = 0; j < num; j++) my_his[SPLIT_BUCKET(buf[j], shift, mask)]++;
+        }
+#pragma omp barrier
+
+        /*2.scan*/
+#pragma omp single
+        scan_histograms(his, nthreads, buckets, start);
+
+        /*3.scatter*/
+        for(uint64_t i = begin; i < end; i += PACKED_SPLIT_KEYS) {
+            uint64_t num = std::min((uint64_t)PACKED_SPLIT_KEYS, end - i);
+            unpack_range(keys_in, buf, i, i + num, bits);
+            scatter_swwc(buf, values_in ? values_in + i : nullptr, keys_out, values_out,
+                         0, num, buckets, shift, my_his);
+        }
+        host_delete(buf);
+    }
+    double total_time = t.elapsed()*1000;
+
+    host_delete(his);
+    return total_time;
+}
+
+/*
+ * LSD radix split on the low bits of the keys, each pass is the split of
+ * split_par on fixed chunks (one per thread) so that the chunks of a pass are
+ * known to the one before. In the fused mode, the scatter of chunk w counts
+ * the next digit per output chunk in next_his[w], and the next pass sums them
+ * into its histograms instead of reading its input.
+ * */
+double radix_split_omp(const int *keys_in, const int *values_in,
+                       int *keys_out, int *values_out,
+                       uint64_t len, int bits, int pass_bits, bool fused) {
+    if (bits < 1 || bits > 31 || pass_bits < 1) {
+        log_error("Wrong parameters: radix split on %d bits in passes of %d bits", bits, pass_bits);
+        return -1;
+    }
+    pass_bits = std::min(pass_bits, bits);
+    int passes = (bits + pass_bits - 1) / pass_bits;
+    int chunks = omp_get_max_threads();
+    uint64_t max_buckets = 1ull << pass_bits;
+
+    /*the next-digit counts of the fused mode should not outgrow the input they save a read of*/
+    if (fused && sizeof(uint64_t)*chunks*chunks*max_buckets > sizeof(int)*len) {
+        log_trace("Radix split: %d threads and %d-bit passes, counting the next digits costs more than reading the keys",
+                  chunks, pass_bits);
+        fused = false;
+    }
+    int *keys_tmp = (passes > 1) ? host_new<int>(len) : nullptr;
+    int *values_tmp = (passes > 1 && values_in) ? host_new<int>(len) : nullptr;
+    uint64_t *his = host_new<uint64_t>(chunks*max_buckets);
+    uint64_t *next_his = fused ? host_new<uint64_t>((uint64_t)chunks*chunks*max_buckets) : nullptr;
+    Timer t;
+
+    const int *src_keys = keys_in, *src_values = values_in;
+    for(int p = 0; p < passes; p++) {
+        int shift = bits * p / passes;
+        int buckets = 1 << (bits * (p+1) / passes - shift);
+        unsigned mask = buckets - 1;
+        bool to_out = ((passes - 1 - p) % 2 == 0);  /*the last pass writes the output*/
+        int *dst_keys = to_out ? keys_out : keys_tmp;
+        int *dst_values = to_out ? values_out : values_tmp;
+        bool count_next_pass = fused && (p < passes - 1);
+        bool his_known = fused && (p > 0);
+        int next_shift = bits * (p+1) / passes;
+        int next_buckets = 1 << (bits * (p+2) / passes - next_shift);
+
+#pragma omp parallel
+        {
+            /*1.histogram of each chunk, counted by the previous pass or from the input*/
+#pragma omp for schedule(static, 1)
+            for(int c = 0; c < chunks; c++) {
+                uint64_t *my_his = his + (uint64_t)c*buckets;
+                if (his_known) {
+                    for(int b = 0; b < buckets; b++) {
+                        uint64_t acc = 0;
+                        for(int w = 0; w < chunks; w++) acc += next_his[((uint64_t)w*chunks+c)*buckets+b];
+                        my_his[b] = acc;
+                    }
+                }
+                else {
+                    for(int b = 0; b < buckets; b++) my_his[b] = 0;
+                    for(uint64_t i = len * c / chunks; i < len * (c+1) / chunks; i++)
+                        my_his[SPLIT_BUCKET(src_keys[i], shift, mask)]++;
+                }
+            }
+
+            /*2.scan*/
+#pragma omp single
+            {
+                uint64_t acc = 0;
+                for(int b = 0; b < buckets; b++) {
+                    for(int c = 0; c < chunks; c++) {
+                        uint64_t temp = his[(uint64_t)c*buckets+b];
+                        his[(uint64_t)c*buckets+b] = acc;
+                        acc += temp;
+                    }
+                }
+            }
+
+            /*3.scatter*/
+#pragma omp for schedule(static, 1)
+            for(int c = 0; c < chunks; c++) {
+                next_count_t next;
+                if (count_next_pass) {
+                    next = {next_shift, (unsigned)(next_buckets - 1), len, chunks,
+                            next_his + (uint64_t)c*chunks*next_buckets};
+                    memset(next.his, 0, sizeof(uint64_t)*chunks*next_buckets);
+                }
+                scatter_swwc(src_keys, src_values, dst_keys, dst_values,
+                             len * c / chunks, len * (c+1) / chunks, buckets, shift,
+                             his + (uint64_t)c*buckets, count_next_pass ? &next : nullptr);
+            }
+        }
+        src_keys = dst_keys;
+        src_values = dst_values;
+    }
+    double total_time = t.elapsed()*1000;
+
+    host_delete(keys_tmp);
+    host_delete(values_tmp);
+    host_delete(his);
+    host_delete(next_his);
+    return total_time;
+}
+
+/*
+ * Bucket IDs of SIMD_LANES keys and the lower-lane mask of each lane: bit j
+ * of lower[l] is set if lane j < l falls in the bucket of lane l, so the rank
+ * of lane l in its bucket is popcnt(lower[l]). This is the CPU counterpart of
+ * the warp ballots in cuda/test_split.cu: one compare mask per lane with
+ * AVX2, a single conflict detection with AVX-512.
+ * */
+static inline void simd_rank(const int *keys, int shift, unsigned mask, int *ids, uint32_t *lower) {
+#ifdef __AVX512CD__
+    __m512i v = _mm512_and_si512(_mm512_srli_epi32(_mm512_loadu_si512(keys), shift), _mm512_set1_epi32(mask));
+    _mm512_storeu_si512(ids, v);
+    _mm512_storeu_si512(lower, _mm512_conflict_epi32(v));
+#else
+    __m256i v = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)keys), _mm_cvtsi32_si128(shift)),
+                                 _mm256_set1_epi32(mask));
+    _mm256_storeu_si256((__m256i*)ids, v);
+    for(int l = 0; l < SIMD_LANES; l++)
+        lower[l] = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, _mm256_set1_epi32(ids[l])))) & ((1u << l) - 1);
+#endif
+}
+
+/*
+ * Split with in-register ranking: the scatter ranks a vector of keys inside
+ * their buckets with compare masks and popcnt instead of incrementing the
+ * bucket positions key by key. The histogram, the scan and the output layout
+ * are the ones of split_par, the result is stable.
+ * */
+static void split_simd_par(const int *keys_in, const int *values_in,
+                           int *keys_out, int *values_out,
+                           uint64_t len, int buckets, int shift, uint64_t *start) {
+    unsigned mask = buckets - 1;
+    uint64_t *his = host_new<uint64_t>((uint64_t)omp_get_max_threads()*buckets);
+
+#pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint64_t begin = len * tid / nthreads;
+        uint64_t end = len * (tid+1) / nthreads;
+        uint64_t vec_end = begin + (end - begin) / SIMD_LANES * SIMD_LANES;
+        uint64_t *my_his = his + (uint64_t)tid*buckets;
+        int ids[SIMD_LANES];
+        uint32_t lower[SIMD_LANES];
+        uint64_t base[SIMD_LANES];
+
+        /*1.histogram*/
+        for(int b = 0; b < buckets; b++) my_his[b] = 0;
+        for(uint64_t i = begin; i < end; i++) my_his[SPLIT_BUCKET(keys_in[i], shift, mask)]++;
+#pragma omp barrier
+
+        /*2.scan*/
+#pragma omp single
+        scan_histograms(his, nthreads, buckets, start);
+
+        /*
+         * 3.scatter, lane l goes to its rank among the lower lanes of its
+         * bucket. The positions are read before any update and the last lane
+         * of a bucket stores the final one, so there is no branch and no
+         * chain of increments on a bucket inside a vector.
+         * */
+        for(uint64_t i = begin; i < vec_end; i += SIMD_LANES) {
+            simd_rank(keys_in+i, shift, mask, ids, lower);
+            for(int l = 0; l < SIMD_LANES; l++) base[l] = my_his[ids[l]];
+            for(int l = 0; l < SIMD_LANES; l++) {
+                uint64_t pos = base[l] + __builtin_popcount(lower[l]);
+                keys_out[pos] = keys_in[i+l];
+                if (values_in) values_out[pos] = values_in[i+l];
+                my_his[ids[l]] = pos + 1;
+            }
+        }
+        for(uint64_t i = vec_end; i < end; i++) {
+            uint64_t pos = my_his[SPLIT_BUCKET(keys_in[i], shift, mask)]++;
+            keys_out[pos] = keys_in[i];
+            if (values_in) values_out[pos] = values_in[i];
+        }
+    }
+    host_delete(his);
+}
+
+double split_simd_omp(const int *keys_in, const int *values_in,
+                      int *keys_out, int *values_out,
+                      uint64_t len, int buckets, int shift, uint64_t *start) {
+    Timer t;
+    split_simd_par(keys_in, values_in, keys_out, values_out, len, buckets, shift, start);
+    return t.elapsed()*1000;
+}
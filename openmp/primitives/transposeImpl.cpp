@@ -0,0 +1,198 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <immintrin.h>
+#include "../primitives.h"
+#include "timer.h"
+#include "cache_probe.h"
+#include "log.h"
+
+/*
+ * A block of TRANSPOSE_LANES records is held in num_fields registers. The
+ * field order is changed by log2(num_fields) rounds of a two-register
+ * even/odd split (AOS->SOA) or its inverse zip (SOA->AOS): each round halves
+ * (or doubles) the record period, so 2, 4 and 8 fields share the same code.
+ * */
+#ifdef __AVX512F__
+#define TRANSPOSE_LANES     (16)
+typedef __m512i vec_t;
+
+static inline vec_t vec_load(const int *p)      { return _mm512_loadu_si512(p); }
+static inline void vec_store(int *p, vec_t v)   { _mm512_storeu_si512(p, v); }
+static inline void vec_stream(int *p, vec_t v)  { _mm512_stream_si512((__m512i*)p, v); }
+
+/*even and odd elements of the 32-element sequence (x, y)*/
+static inline void even_odd(vec_t x, vec_t y, vec_t &even, vec_t &odd) {
+    const vec_t idx_even = _mm512_setr_epi32(0,2,4,6,8,10,12,14,16,18,20,22,24,26,28,30);
+    const vec_t idx_odd = _mm512_setr_epi32(1,3,5,7,9,11,13,15,17,19,21,23,25,27,29,31);
+    even = _mm512_permutex2var_epi32(x, idx_even, y);
+    odd = _mm512_permutex2var_epi32(x, idx_odd, y);
+}
+
+/*inverse of even_odd: (lo, hi) is e0,o0,e1,o1,...,e15,o15*/
+static inline void zip(vec_t e, vec_t o, vec_t &lo, vec_t &hi) {
+    const vec_t idx_lo = _mm512_setr_epi32(0,16,1,17,2,18,3,19,4,20,5,21,6,22,7,23);
+    const vec_t idx_hi = _mm512_setr_epi32(8,24,9,25,10,26,11,27,12,28,13,29,14,30,15,31);
+    lo = _mm512_permutex2var_epi32(e, idx_lo, o);
+    hi = _mm512_permutex2var_epi32(e, idx_hi, o);
+}
+#else
+#define TRANSPOSE_LANES     (8)     /*AVX2*/
+typedef __m256i vec_t;
+
+static inline vec_t vec_load(const int *p)      { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void vec_store(int *p, vec_t v)   { _mm256_storeu_si256((__m256i*)p, v); }
+static inline void vec_stream(int *p, vec_t v)  { _mm256_stream_si256((__m256i*)p, v); }
+
+/*even and odd elements of the 16-element sequence (x, y)*/
+static inline void even_odd(vec_t x, vec_t y, vec_t &even, vec_t &odd) {
+    const vec_t idx = _mm256_setr_epi32(0,2,4,6,1,3,5,7);
+    x = _mm256_permutevar8x32_epi32(x, idx);    /*x0 x2 x4 x6 | x1 x3 x5 x7*/
+    y = _mm256_permutevar8x32_epi32(y, idx);
+    even = _mm256_permute2x128_si256(x, y, 0x20);
+    odd = _mm256_permute2x128_si256(x, y, 0x31);
+}
+
+/*inverse of even_odd: (lo, hi) is e0,o0,e1,o1,...,e7,o7*/
+static inline void zip(vec_t e, vec_t o, vec_t &lo, vec_t &hi) {
+    vec_t a = _mm256_unpacklo_epi32(e, o);      /*e0 o0 e1 o1 | e4 o4 e5 o5*/
+    vec_t b = _mm256_unpackhi_epi32(e, o);      /*e2 o2 e3 o3 | e6 o6 e7 o7*/
+    lo = _mm256_permute2x128_si256(a, b, 0x20);
+    hi = _mm256_permute2x128_si256(a, b, 0x31);
+}
+#endif
+
+/*F registers of interleaved records -> F registers of one field each*/
+template<int F>
+static inline void deinterleave(const vec_t *rec, vec_t *fld) {
+    vec_t even[F/2], odd[F/2], even_fld[F/2], odd_fld[F/2];
+    for(int k = 0; k < F/2; k++) even_odd(rec[2*k], rec[2*k+1], even[k], odd[k]);
+    deinterleave<F/2>(even, even_fld);      /*fields 0, 2, 4, ...*/
+    deinterleave<F/2>(odd, odd_fld);        /*fields 1, 3, 5, ...*/
+    for(int j = 0; j < F/2; j++) {
+        fld[2*j] = even_fld[j];
+        fld[2*j+1] = odd_fld[j];
+    }
+}
+template<>
+inline void deinterleave<1>(const vec_t *rec, vec_t *fld) { fld[0] = rec[0]; }
+
+/*F registers of one field each -> F registers of interleaved records*/
+template<int F>
+static inline void interleave(const vec_t *fld, vec_t *rec) {
+    vec_t even_fld[F/2], odd_fld[F/2], even[F/2], odd[F/2];
+    for(int j = 0; j < F/2; j++) {
+        even_fld[j] = fld[2*j];
+        odd_fld[j] = fld[2*j+1];
+    }
+    interleave<F/2>(even_fld, even);
+    interleave<F/2>(odd_fld, odd);
+    for(int k = 0; k < F/2; k++) zip(even[k], odd[k], rec[2*k], rec[2*k+1]);
+}
+template<>
+inline void interleave<1>(const vec_t *fld, vec_t *rec) { rec[0] = fld[0]; }
+
+/*streaming stores keep a large output from evicting the input, each thread fences its own stores*/
+template<bool STREAM>
+static inline void block_store(int *p, vec_t v) {
+    if (STREAM)     vec_stream(p, v);
+    else            vec_store(p, v);
+}
+
+template<int F, bool STREAM>
+static void aos_to_soa_blocks(const int *records, int * const *fields, uint64_t blocks) {
+#pragma omp parallel
+    {
+#pragma omp for schedule(static)
+        for(uint64_t b = 0; b < blocks; b++) {
+            vec_t rec[F], fld[F];
+            for(int f = 0; f < F; f++) rec[f] = vec_load(records + (b*F + f)*TRANSPOSE_LANES);
+            deinterleave<F>(rec, fld);
+            for(int f = 0; f < F; f++) block_store<STREAM>(fields[f] + b*TRANSPOSE_LANES, fld[f]);
+        }
+        if (STREAM) _mm_sfence();
+    }
+}
+
+template<int F, bool STREAM>
+static void soa_to_aos_blocks(const int * const *fields, int *records, uint64_t blocks) {
+#pragma omp parallel
+    {
+#pragma omp for schedule(static)
+        for(uint64_t b = 0; b < blocks; b++) {
+            vec_t fld[F], rec[F];
+            for(int f = 0; f < F; f++) fld[f] = vec_load(fields[f] + b*TRANSPOSE_LANES);
+            interleave<F>(fld, rec);
+            for(int f = 0; f < F; f++) block_store<STREAM>(records + (b*F + f)*TRANSPOSE_LANES, rec[f]);
+        }
+        if (STREAM) _mm_sfence();
+    }
+}
+
+/*
+ * Stream the output if it does not fit in half of the LLC and every output
+ * array is vector-aligned. More concurrent streams than the write-combining
+ * buffers can hold flush partial lines, which made 8-field aos_to_soa ~3.5x
+ * slower than with regular stores, so the number of output arrays is capped.
+ * */
+#define MAX_STREAMS         (4)
+
+static bool use_streaming(int * const *outputs, int num_outputs, uint64_t out_bytes) {
+    if (num_outputs > MAX_STREAMS || out_bytes <= get_cache_info().llc_size / 2) return false;
+    for(int o = 0; o < num_outputs; o++)
+        if ((uint64_t)outputs[o] % sizeof(vec_t) != 0) return false;
+    return true;
+}
+
+/*
+ * AOS to SOA: fields[f][i] = records[i*num_fields+f]
+ * The blocks are transposed in registers, the last len % TRANSPOSE_LANES records are copied one by one.
+ * */
+double aos_to_soa(const int *records, int * const *fields, int num_fields, uint64_t len) {
+    if (num_fields != 2 && num_fields != 4 && num_fields != 8) {
+        log_error("Wrong parameters: records of %d fields, only 2, 4 and 8 are supported", num_fields);
+        return -1;
+    }
+    uint64_t blocks = len / TRANSPOSE_LANES;
+    bool stream = use_streaming(fields, num_fields, len*num_fields*sizeof(int));
+
+    Timer t;
+    switch ((num_fields << 1) | stream) {
+        case (2 << 1):      aos_to_soa_blocks<2, false>(records, fields, blocks); break;
+        case (2 << 1) | 1:  aos_to_soa_blocks<2, true>(records, fields, blocks); break;
+        case (4 << 1):      aos_to_soa_blocks<4, false>(records, fields, blocks); break;
+        case (4 << 1) | 1:  aos_to_soa_blocks<4, true>(records, fields, blocks); break;
+        case (8 << 1):      aos_to_soa_blocks<8, false>(records, fields, blocks); break;
+        case (8 << 1) | 1:  aos_to_soa_blocks<8, true>(records, fields, blocks); break;
+    }
+    for(uint64_t i = blocks*TRANSPOSE_LANES; i < len; i++)
+        for(int f = 0; f < num_fields; f++)
+            fields[f][i] = records[i*num_fields+f];
+    return t.elapsed()*1000; //in ms
+}
+
+/*SOA to AOS: records[i*num_fields+f] = fields[f][i], the inverse of aos_to_soa*/
+double soa_to_aos(const int * const *fields, int *records, int num_fields, uint64_t len) {
+    if (num_fields != 2 && num_fields != 4 && num_fields != 8) {
+        log_error("Wrong parameters: records of %d fields, only 2, 4 and 8 are supported", num_fields);
+        return -1;
+    }
+    uint64_t blocks = len / TRANSPOSE_LANES;
+    bool stream = use_streaming(&records, 1, len*num_fields*sizeof(int));
+
+    Timer t;
+    switch ((num_fields << 1) | stream) {
+        case (2 << 1):      soa_to_aos_blocks<2, false>(fields, records, blocks); break;
+        case (2 << 1) | 1:  soa_to_aos_blocks<2, true>(fields, records, blocks); break;
+        case (4 << 1):      soa_to_aos_blocks<4, false>(fields, records, blocks); break;
+        case (4 << 1) | 1:  soa_to_aos_blocks<4, true>(fields, records, blocks); break;
+        case (8 << 1):      soa_to_aos_blocks<8, false>(fields, records, blocks); break;
+        case (8 << 1) | 1:  soa_to_aos_blocks<8, true>(fields, records, blocks); break;
+    }
+    for(uint64_t i = blocks*TRANSPOSE_LANES; i < len; i++)
+        for(int f = 0; f < num_fields; f++)
+            records[i*num_fields+f] = fields[f][i];
+    return t.elapsed()*1000; //in ms
+}
@@ -30,58 +30,11 @@
 #include "util/utility.h"
 #include "util/log.h"
 #include "util/timer.h"
+#include "util/perf_counter.h"
+#include "primitives.h"
 #include "params.h"
 using namespace std;
 
-#define SCALAR  (3)
-
-/* Sequential memory copy operation */
-double copy_omp(int *input, int *output, uint64_t len) {
-    Timer t;
-#pragma omp parallel for schedule(static)
-    for(uint64_t i = 0; i < len; i++) {
-        output[i] = input[i];
-    }
-    return t.elapsed()*1000; //in ms
-}
-
-/* Sequential scaling operation */
-double scale_omp(int *input, int *output, uint64_t len) {
-    Timer t;
-#pragma omp parallel for schedule(static)
-    for(uint64_t i = 0; i < len; i++) {
-        output[i] = input[i] * SCALAR;
-    }
-    return t.elapsed()*1000; //in ms
-}
-
-/* Sequential memory copy operation with nontemporal streaming stores */
-double copy_omp_ss(int *input, int *output, uint64_t len) {
-    Timer t;
-#pragma omp parallel for schedule(auto)
-    for(uint64_t i = 0; i < len/8; i++) { //256-bit = 8 int values
-        register __m256i *dest = (__m256i*)output + i;
-        register __m256i source = *((__m256i*)input + i);
-        _mm256_stream_si256(dest,source);   //streaming store
-    }
-    return t.elapsed()*1000; //in ms
-}
-
-/* Sequential memory copy operation with nontemporal streaming stores */
-double scale_omp_ss(int *input, int *output, uint64_t len) {
-    __m256i v = _mm256_set_epi32(SCALAR,SCALAR,SCALAR,SCALAR,
-                                 SCALAR,SCALAR,SCALAR,SCALAR);
-    Timer t;
-#pragma omp parallel for schedule(auto)
-    for(uint64_t i = 0; i < len/8; i++) { //256-bit = 8 int values
-        register __m256i *dest = (__m256i*)output + i;
-        register __m256i source = *((__m256i*)input + i);
-        source = _mm256_mullo_epi32 (source, v);
-        _mm256_stream_si256(dest,source);   //streaming store
-    }
-    return t.elapsed()*1000; //in ms
-}
-
 bool test_bandwidth(int max_len_log) {
     log_info("Function: %s", __FUNCTION__);
     assert(max_len_log > 10);
@@ -100,12 +53,16 @@ bool test_bandwidth(int max_len_log) {
     for(auto len_log = 10; len_log < max_len_log; len_log++) {
         uint64_t len = pow(2,len_log);
         double times[EXPERIMENT_TIMES];
+        perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+        perf_clear(counters);
         for(auto e = 0; e < EXPERIMENT_TIMES; e++) {
             times[e] = copy_omp(input, output, len);
+            perf_accumulate(counters, perf_last_sample());
         }
         auto ave_time = average_Hampel(times, EXPERIMENT_TIMES);
         log_info("Len=%d, time=%.1f ms, throughput=%.1f GB/s",
         len, ave_time, compute_bandwidth(len*2, sizeof(int), ave_time));
+        perf_print("copy", counters, EXPERIMENT_TIMES, len);
     }
 
     /* scale operation without streaming stores*/
@@ -113,12 +70,16 @@ bool test_bandwidth(int max_len_log) {
     for(auto len_log = 10; len_log < 30; len_log++) {
         uint64_t len = pow(2,len_log);
         double times[EXPERIMENT_TIMES];
+        perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+        perf_clear(counters);
         for(auto e = 0; e < EXPERIMENT_TIMES; e++) {
             times[e] = scale_omp(input, output, len);
+            perf_accumulate(counters, perf_last_sample());
         }
         auto ave_time = average_Hampel(times, EXPERIMENT_TIMES);
         log_info("Len=%d, time=%.1f ms, throughput=%.1f GB/s",
                  len, ave_time, compute_bandwidth(len*2, sizeof(int), ave_time));
+        perf_print("scale", counters, EXPERIMENT_TIMES, len);
     }
 
     /* copy operation without streaming stores*/
@@ -126,12 +87,16 @@ bool test_bandwidth(int max_len_log) {
     for(auto len_log = 10; len_log < 30; len_log++) {
         uint64_t len = pow(2,len_log);
         double times[EXPERIMENT_TIMES];
+        perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+        perf_clear(counters);
         for(auto e = 0; e < EXPERIMENT_TIMES; e++) {
             times[e] = copy_omp_ss(input_aligned, output_aligned, len);
+            perf_accumulate(counters, perf_last_sample());
         }
         auto ave_time = average_Hampel(times, EXPERIMENT_TIMES);
         log_info("Len=%d, time=%.1f ms, throughput=%.1f GB/s",
                  len, ave_time, compute_bandwidth(len*2, sizeof(int), ave_time));
+        perf_print("copy_ss", counters, EXPERIMENT_TIMES, len);
     }
 
     /* scale operation without streaming stores*/
@@ -139,12 +104,16 @@ bool test_bandwidth(int max_len_log) {
     for(auto len_log = 10; len_log < 30; len_log++) {
         uint64_t len = pow(2,len_log);
         double times[EXPERIMENT_TIMES];
+        perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+        perf_clear(counters);
         for(auto e = 0; e < EXPERIMENT_TIMES; e++) {
             times[e] = scale_omp_ss(input_aligned, output_aligned, len);
+            perf_accumulate(counters, perf_last_sample());
         }
         auto ave_time = average_Hampel(times, EXPERIMENT_TIMES);
         log_info("Len=%d, time=%.1f ms, throughput=%.1f GB/s",
                  len, ave_time, compute_bandwidth(len*2, sizeof(int), ave_time));
+        perf_print("scale_ss", counters, EXPERIMENT_TIMES, len);
     }
 
     delete[] input;
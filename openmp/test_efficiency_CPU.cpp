@@ -0,0 +1,106 @@
+/*
+ * Roofline-style efficiency of the OpenMP primitives
+ * 1. the peak bandwidth is measured with the Stream copy/scale operations
+ * 2. each primitive is reported as the fraction of the peak it achieves,
+ *    computed from the number of data accesses the algorithm performs
+ *
+ * Execute:
+ *      ./test_efficiency_CPU DATA_NUM
+ */
+#include <iostream>
+#include <omp.h>
+#include <cmath>
+#include <immintrin.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/timer.h"
+#include "primitives.h"
+using namespace std;
+
+typedef double (*prim_func_t)(int *input, int *output, int *idx, uint64_t len);
+
+/*
+ * Data accesses (in elements, each of 4 bytes) of one run on n elements.
+ * Write-allocate traffic is not counted, as in the Stream Benchmark.
+ * */
+struct prim_model_t {
+    const char  *name;
+    prim_func_t func;
+    int         accesses_per_ele;
+};
+
+double run_copy(int *input, int *output, int *idx, uint64_t len)       { return copy_omp(input, output, len); }
+double run_copy_ss(int *input, int *output, int *idx, uint64_t len)    { return copy_omp_ss(input, output, len); }
+double run_scale(int *input, int *output, int *idx, uint64_t len)      { return scale_omp(input, output, len); }
+double run_scale_ss(int *input, int *output, int *idx, uint64_t len)   { return scale_omp_ss(input, output, len); }
+double run_gather(int *input, int *output, int *idx, uint64_t len)     { return gather(input, output, idx, len); }
+double run_scatter(int *input, int *output, int *idx, uint64_t len)    { return scatter(input, output, idx, len); }
+double run_scan_SSA(int *input, int *output, int *idx, uint64_t len)   { return scan_SSA_omp(input, output, len); }
+double run_scan_RTS(int *input, int *output, int *idx, uint64_t len)   { return scan_RTS_omp(input, output, len); }
+double run_scan_tbb(int *input, int *output, int *idx, uint64_t len)   { return scan_tbb(input, output, len); }
+
+/*average time of EXPERIMENT_TIMES runs, the first run is only for warm-up*/
+double measure(prim_func_t func, int *input, int *output, int *idx, uint64_t len) {
+    double times[EXPERIMENT_TIMES];
+    func(input, output, idx, len);
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        times[e] = func(input, output, idx, len);
+    }
+    return average_Hampel(times, EXPERIMENT_TIMES);
+}
+
+bool test_efficiency(uint64_t len) {
+    log_info("Function: %s", __FUNCTION__);
+    int *input = (int*)_mm_malloc(sizeof(int)*len, 64);
+    int *output = (int*)_mm_malloc(sizeof(int)*len, 64);
+    int *idx = (int*)_mm_malloc(sizeof(int)*len, 64);
+
+    random_generator_int_unique(idx, len, 1234);
+#pragma omp parallel for schedule(static)
+    for(uint64_t i = 0; i < len; i++) input[i] = 1;
+
+    /*1.peak bandwidth*/
+    prim_model_t peak_ops[] = {
+            {"copy",        run_copy,       2},
+            {"copy_ss",     run_copy_ss,    2},
+            {"scale",       run_scale,      2},
+            {"scale_ss",    run_scale_ss,   2},
+    };
+    double peak = 0;
+    for(auto &op : peak_ops) {
+        double time = measure(op.func, input, output, idx, len);
+        double bandwidth = compute_bandwidth(len*op.accesses_per_ele, sizeof(int), time);
+        log_info("%-10s time=%.2f ms, throughput=%.1f GB/s", op.name, time, bandwidth);
+        peak = std::max(peak, bandwidth);
+    }
+    log_info("Peak bandwidth: %.1f GB/s", peak);
+
+    /*2.primitives*/
+    prim_model_t prims[] = {
+            {"gather",      run_gather,     3}, /*read idx, random read input, write output*/
+            {"scatter",     run_scatter,    3}, /*read idx, read input, random write output*/
+            {"scan_SSA",    run_scan_SSA,   4}, /*scan: read+write, add: read+write*/
+            {"scan_RTS",    run_scan_RTS,   3}, /*reduce: read, scan: read+write*/
+            {"scan_TBB",    run_scan_tbb,   3}, /*pre-scan on stolen ranges, at most 3n*/
+    };
+    for(auto &op : prims) {
+        double time = measure(op.func, input, output, idx, len);
+        double bandwidth = compute_bandwidth(len*op.accesses_per_ele, sizeof(int), time);
+        log_info("%-10s time=%.2f ms, accesses=%dn, throughput=%.1f GB/s, %.1f%% of peak",
+                 op.name, time, op.accesses_per_ele, bandwidth, 100.0*bandwidth/peak);
+    }
+
+    _mm_free(input);
+    _mm_free(output);
+    _mm_free(idx);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    assert(argc == 2);
+    uint64_t len = stoull(argv[1]);
+    assert(len % 8 == 0);   /*the streaming-store operations process 8 ints at a time*/
+    assert(test_efficiency(len));
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Filter (stream compaction) on CPU
+ * 1. key < constant with selectivity from 1/64 to 1
+ * 2. range and bitmap predicates
+ * for key-only and key-value inputs. Keys are uniform in [0, DATA_NUM), values
+ * are the input positions so that the order of the output is checked as well.
+ *
+ * Execute:
+ *      ./test_filter_CPU [DATA_NUM=32M]
+ */
+#include <iostream>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/perf_counter.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+static bool host_predicate(int key, const predicate_t &pred) {
+    switch (pred.type) {
+        case PRED_EQ:       return key == pred.low;
+        case PRED_NE:       return key != pred.low;
+        case PRED_LT:       return key < pred.low;
+        case PRED_LE:       return key <= pred.low;
+        case PRED_GT:       return key > pred.low;
+        case PRED_GE:       return key >= pred.low;
+        case PRED_RANGE:    return (key >= pred.low) && (key < pred.high);
+        case PRED_BITMAP:   return (key >= 0) && ((uint64_t)key < pred.bitmap_bits) && ((pred.bitmap[key>>5] >> (key&31)) & 1);
+    }
+    return false;
+}
+
+bool test_filter(int *keys, int *values, uint64_t len, const predicate_t &pred, bool kv, const char *name) {
+    int *keys_out = new int[len];
+    int *values_out = kv ? new int[len] : nullptr;
+
+    bool res = true;
+    double times[EXPERIMENT_TIMES];
+    perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+    perf_clear(counters);
+    uint64_t res_len = 0;
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        times[e] = filter_omp(keys, kv ? values : nullptr, keys_out, values_out, len, pred, res_len);
+        perf_accumulate(counters, perf_last_sample());
+
+        if (e == 0) { /*check the outputs*/
+            uint64_t j = 0;
+            for(uint64_t i = 0; i < len && res; i++) {
+                if (!host_predicate(keys[i], pred)) continue;
+                if (j >= res_len || keys_out[j] != keys[i] || (kv && values_out[j] != values[i])) {
+                    log_error("Wrong results at output %llu", j);
+                    res = false;
+                }
+                j++;
+            }
+            if (res && j != res_len) {
+                log_error("Wrong results, %llu outputs, expected %llu", res_len, j);
+                res = false;
+            }
+        }
+    }
+    double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("%s %s: selected=%llu, time=%.1f ms, throughput=%.1f GB/s", kv ? "KV" : "KO", name,
+             res_len, ave_time, compute_bandwidth(len, sizeof(int), ave_time));
+    perf_print(name, counters, EXPERIMENT_TIMES, len);
+
+    delete[] keys_out;
+    if (values_out) delete[] values_out;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+    int *keys = new int[len];
+    int *values = new int[len];
+    random_generator_int(keys, len, (int)len, 1234);
+#pragma omp parallel for
+    for(uint64_t i = 0; i < len; i++) values[i] = (int)i;
+
+    /*bitmap selecting every third key*/
+    uint32_t *bitmap = new uint32_t[(len+31)/32]();
+    for(uint64_t k = 0; k < len; k += 3) bitmap[k>>5] |= (1u << (k&31));
+
+    for(int kv = 0; kv <= 1; kv++) {
+        for(int sel = 64; sel >= 1; sel >>= 1) {
+            predicate_t pred = {PRED_LT, (int)(len/sel), 0, nullptr, 0};
+            char name[100];
+            sprintf(name, "key < %d", pred.low);
+            assert(test_filter(keys, values, len, pred, kv, name));
+        }
+        predicate_t range = {PRED_RANGE, (int)(len/4), (int)(len/2), nullptr, 0};
+        predicate_t empty = {PRED_RANGE, (int)(len/2), (int)(len/4), nullptr, 0};   /*high < low, no match*/
+        predicate_t bits = {PRED_BITMAP, 0, 0, bitmap, len};
+        assert(test_filter(keys, values, len, range, kv, "range"));
+        assert(test_filter(keys, values, len, empty, kv, "empty range"));
+        assert(test_filter(keys, values, len, bits, kv, "bitmap"));
+    }
+
+    delete[] keys;
+    delete[] values;
+    delete[] bitmap;
+    return 0;
+}
@@ -14,47 +14,35 @@
 #include <cmath>
 #include <immintrin.h>
 #include <cassert>
+#include <cstring>
+#include <vector>
 #include "util/utility.h"
 #include "util/log.h"
 #include "util/timer.h"
+#include "util/perf_counter.h"
+#include "util/cache_probe.h"
+#include "primitives.h"
 #include "params.h"
 using namespace std;
 
-/*gather*/
-double gather(int *input, int *output, int *idx, uint64_t len) {
-    Timer t;
-#pragma omp parallel for schedule(auto)
-    for(int i = 0; i < len; i++) {
-        output[i] = input[idx[i]];
-    }
-    return t.elapsed()*1000;
-}
-
-/*scatter*/
-double scatter(int *input, int *output, int *idx, uint64_t len) {
-    Timer t;
-#pragma omp parallel for schedule(auto)
-    for(int i = 0; i < len; i++) {
-        output[idx[i]] = input[i];
-    }
-    return t.elapsed()*1000;
-}
-
 bool test_gather_and_scatter(uint64_t len) {
     log_info("Function: %s", __FUNCTION__);
     int *input = new int[len];
     int *idx = new int[len];
     int *output = new int[len];
 
-    random_generator_int_unique(idx, len);
+    random_generator_int_unique(idx, len, 1234);
 #pragma omp parallel for schedule(auto)
     for(int i = 0; i < len; i++){
         input[i] = i;
     }
 
     double times[EXPERIMENT_TIMES];
+    perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+    perf_clear(counters);
     for(int e = 0; e < EXPERIMENT_TIMES; e++) {
         times[e] = gather(input, output, idx, len);
+        perf_accumulate(counters, perf_last_sample());
 
         if (e == 0) { /*check the outputs*/
             bool res = true;
@@ -69,9 +57,32 @@ bool test_gather_and_scatter(uint64_t len) {
     }
     double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
     log_info("Performance of gather: time=%.1f ms, throughput=%.1f GB/s", ave_time, compute_bandwidth(len, sizeof(int), ave_time));
+    perf_print("gather", counters, EXPERIMENT_TIMES, len);
+
+    /*multi-pass gather, the number of passes is derived from the LLC size*/
+    int pass = gather_passes(len*sizeof(int), get_cache_info());
+    perf_clear(counters);
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        times[e] = gather_mp(input, output, idx, len, pass);
+        perf_accumulate(counters, perf_last_sample());
+
+        if (e == 0) { /*check the outputs*/
+            for(int i = 0; i < len; i++) {
+                if(output[i] != input[idx[i]]) {
+                    log_error("Wrong results");
+                    break;
+                }
+            }
+        }
+    }
+    ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("Performance of %d-pass gather: time=%.1f ms, throughput=%.1f GB/s", pass, ave_time, compute_bandwidth(len, sizeof(int), ave_time));
+    perf_print("multi-pass gather", counters, EXPERIMENT_TIMES, len);
 
+    perf_clear(counters);
     for(int e = 0; e < EXPERIMENT_TIMES; e++) {
         times[e] = scatter(input, output, idx, len);
+        perf_accumulate(counters, perf_last_sample());
 
         if (e == 0) { /*check the outputs*/
             bool res = true;
@@ -89,6 +100,7 @@ bool test_gather_and_scatter(uint64_t len) {
     }
     ave_time = average_Hampel(times, EXPERIMENT_TIMES);
     log_info("Performance of scatter: time=%.1f ms, throughput=%.1f GB/s", ave_time, compute_bandwidth(len, sizeof(int), ave_time));
+    perf_print("scatter", counters, EXPERIMENT_TIMES, len);
 
     if(input)  delete[] input;
     if(output)  delete[] output;
@@ -96,9 +108,71 @@ bool test_gather_and_scatter(uint64_t len) {
     return true;
 }
 
+typedef double (*columns_func_t)(const column_t*, int, const int*, uint64_t);
+
+/*
+ * num_columns columns of 4 and 8 bytes moved by one call per column and by a
+ * single call, for gather and for scatter
+ * */
+bool test_columns(uint64_t len, int num_columns) {
+    log_info("Function: %s", __FUNCTION__);
+    bool res = true;
+    int *idx = new int[len];
+    random_generator_int_unique(idx, len, 1234);
+
+    vector<column_t> columns(num_columns);
+    uint64_t total_bytes = 0;
+    for(int c = 0; c < num_columns; c++) {
+        int width = (c % 2 == 0) ? sizeof(int32_t) : sizeof(int64_t);
+        char *in = new char[width*len];
+        for(uint64_t b = 0; b < width*len; b++) in[b] = (char)(b * 7 + c);
+        columns[c].in = in;
+        columns[c].out = new char[width*len];
+        columns[c].width = width;
+        total_bytes += width*len;
+    }
+
+    for(int gather_mode = 1; gather_mode >= 0; gather_mode--) {
+        columns_func_t func = gather_mode ? gather_columns : scatter_columns;
+        double separate_times[EXPERIMENT_TIMES], multi_times[EXPERIMENT_TIMES];
+        for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+            separate_times[e] = 0;
+            for(int c = 0; c < num_columns; c++) separate_times[e] += func(&columns[c], 1, idx, len);
+            multi_times[e] = func(columns.data(), num_columns, idx, len);
+        }
+        for(int c = 0; c < num_columns && res; c++) {
+            int width = columns[c].width;
+            const char *in = (const char*)columns[c].in, *out = (const char*)columns[c].out;
+            for(uint64_t i = 0; i < len; i++) {
+                const char *expected = gather_mode ? in + (uint64_t)idx[i]*width : in + i*width;
+                const char *actual = gather_mode ? out + i*width : out + (uint64_t)idx[i]*width;
+                if (memcmp(expected, actual, width) != 0) {
+                    log_error("Wrong result in column %d at %llu", c, i);
+                    res = false;
+                    break;
+                }
+            }
+        }
+        double separate_time = average_Hampel(separate_times, EXPERIMENT_TIMES);
+        double multi_time = average_Hampel(multi_times, EXPERIMENT_TIMES);
+        log_info("%s of %d columns: separate=%.1f ms (%.1f GB/s), multi-column=%.1f ms (%.1f GB/s)",
+                 gather_mode ? "gather" : "scatter", num_columns,
+                 separate_time, compute_bandwidth(total_bytes, 1, separate_time),
+                 multi_time, compute_bandwidth(total_bytes, 1, multi_time));
+    }
+
+    for(int c = 0; c < num_columns; c++) {
+        delete[] (const char*)columns[c].in;
+        delete[] (char*)columns[c].out;
+    }
+    delete[] idx;
+    return res;
+}
+
 int main(int argc, char *argv[]) {
     assert(argc == 2);
     uint64_t len = stoull(argv[1]);
     assert(test_gather_and_scatter(len));
+    assert(test_columns(len, 8));
     return 0;
 }
\ No newline at end of file
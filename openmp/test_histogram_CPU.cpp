@@ -0,0 +1,90 @@
+/*
+ * Histogram on CPU with the radix, mod and hash bucket functions, 16 to 64K
+ * buckets, on uniform keys in [0, DATA_NUM) and Zipf keys (alpha = 1) in [0, 1M).
+ * Each strategy is run, and HIST_AUTO reports the one it picked.
+ *
+ * Execute:
+ *      ./test_histogram_CPU [DATA_NUM=32M]
+ */
+#include <iostream>
+#include <vector>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/perf_counter.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+static uint32_t host_bucket(int key, const bucket_func_t &func) {
+    switch (func.type) {
+        case BUCKET_MOD:    return (unsigned)key % (unsigned)func.buckets;
+        case BUCKET_HASH:   return (uint32_t)(((uint64_t)((unsigned)key * 0x9E3779B1u) * (unsigned)func.buckets) >> 32);
+        default:            return ((unsigned)key >> func.shift) & (func.buckets - 1);
+    }
+}
+
+bool test_histogram(const int *keys, uint64_t len, const bucket_func_t &func, HistStrategy strategy, const char *name) {
+    const char *strategy_names[] = {"auto", "private", "shared", "sort"};
+    bool res = true;
+    double times[EXPERIMENT_TIMES];
+    perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+    perf_clear(counters);
+
+    uint64_t *his = new uint64_t[func.buckets];
+    vector<uint64_t> expected(func.buckets, 0);
+    for(uint64_t i = 0; i < len; i++) expected[host_bucket(keys[i], func)]++;
+
+    HistStrategy used = strategy;
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        used = strategy;
+        times[e] = histogram_omp(keys, len, func, his, used);
+        perf_accumulate(counters, perf_last_sample());
+
+        if (e == 0) {
+            for(int b = 0; b < func.buckets; b++) {
+                if (his[b] != expected[b]) {
+                    log_error("Wrong result at bucket %d, %llu, expected %llu", b, his[b], expected[b]);
+                    res = false;
+                    break;
+                }
+            }
+        }
+    }
+    double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("%s, %s%s%s: time=%.2f ms, throughput=%.1f GB/s", name, strategy_names[strategy],
+             (strategy == HIST_AUTO) ? "->" : "", (strategy == HIST_AUTO) ? strategy_names[used] : "",
+             ave_time, compute_bandwidth(len, sizeof(int), ave_time));
+    perf_print(name, counters, EXPERIMENT_TIMES, len);
+
+    delete[] his;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+    const char *func_names[] = {"radix", "mod", "hash"};
+
+    int *uniform = new int[len];
+    int *zipf = new int[len];
+    random_generator_int(uniform, len, (int)len, 1234);
+    random_generator_zipf(zipf, len, 1<<20, 1.0, 1234);
+
+    for(auto keys : {uniform, zipf}) {
+        for(int buckets : {16, 1024, 1<<16}) {
+            for(int f = BUCKET_RADIX; f <= BUCKET_HASH; f++) {
+                bucket_func_t func = {(BucketFunc)f, buckets, 0};
+                char name[100];
+                sprintf(name, "%s %s buckets=%d", (keys == uniform) ? "uniform" : "zipf", func_names[f], buckets);
+                for(int s = HIST_AUTO; s <= HIST_SORT; s++) {
+                    assert(test_histogram(keys, len, func, (HistStrategy)s, name));
+                }
+            }
+        }
+    }
+
+    delete[] uniform;
+    delete[] zipf;
+    return 0;
+}
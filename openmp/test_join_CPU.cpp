@@ -0,0 +1,138 @@
+/*
+ * Hash joins on CPU, the partitioned one is the baseline of the OpenCL join (test_join)
+ * 1. R has unique keys in [0, R_NUM), S keys are drawn from [0, R_NUM*ratio) for
+ *    match ratios of S from 100% down to 12.5%, as in test_join.
+ *    Both payloads are set to the keys so that every output pair holds the same value twice.
+ * 2. Crossover of the partitioned and non-partitioned joins, for build sides whose
+ *    non-partitioned table ranges from L2-resident to DRAM-resident.
+ *
+ * Execute:
+ *      ./test_join_CPU [R_NUM=16M] [S_NUM=16M]
+ */
+#include <iostream>
+#include <omp.h>
+#include <cassert>
+#include <unordered_map>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/perf_counter.h"
+#include "util/cache_probe.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+typedef double (*join_func_t)(const int*, const int*, uint64_t,
+                              const int*, const int*, uint64_t,
+                              uint64_t&, int**, int**);
+
+bool test_join(uint64_t r_len, uint64_t s_len, int s_range, bool materialize,
+               join_func_t join_func, const char *name) {
+    log_info("Function: %s, %s, R=%llu, S=%llu, S range=%d, %s", __FUNCTION__, name,
+             r_len, s_len, s_range, materialize ? "pairs" : "count");
+    int *R_keys = new int[r_len];
+    int *S_keys = new int[s_len];
+    random_generator_int_unique(R_keys, r_len, 1234);
+    random_generator_int(S_keys, s_len, s_range, 1234);
+
+    /*expected number of results*/
+    unordered_map<int,int> r_multiplicity;
+    for(uint64_t i = 0; i < r_len; i++) r_multiplicity[R_keys[i]]++;
+    uint64_t expected = 0;
+    for(uint64_t i = 0; i < s_len; i++) {
+        auto it = r_multiplicity.find(S_keys[i]);
+        if (it != r_multiplicity.end()) expected += it->second;
+    }
+
+    bool res = true;
+    double times[EXPERIMENT_TIMES];
+    perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+    perf_clear(counters);
+    uint64_t res_len = 0;
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        int *out_R = nullptr, *out_S = nullptr;
+        if (materialize) {
+            times[e] = join_func(R_keys, R_keys, r_len, S_keys, S_keys, s_len, res_len, &out_R, &out_S);
+        }
+        else {
+            times[e] = join_func(R_keys, R_keys, r_len, S_keys, S_keys, s_len, res_len, nullptr, nullptr);
+        }
+        perf_accumulate(counters, perf_last_sample());
+
+        if (e == 0) { /*check the outputs*/
+            if (res_len != expected) {
+                log_error("Wrong results, %llu results, expected %llu", res_len, expected);
+                res = false;
+            }
+            else if (materialize) {
+                for(uint64_t i = 0; i < res_len; i++) {
+                    if (out_R[i] != out_S[i]) {
+                        log_error("Wrong results, pair %llu is (%d, %d)", i, out_R[i], out_S[i]);
+                        res = false;
+                        break;
+                    }
+                }
+            }
+        }
+        if (out_R) delete[] out_R;
+        if (out_S) delete[] out_S;
+    }
+    double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("results=%llu, time=%.1f ms, throughput=%.1f GB/s, %.1f M tuples/s", res_len, ave_time,
+             compute_bandwidth(r_len+s_len, sizeof(int), ave_time), (r_len+s_len)/ave_time/1000);
+    perf_print(name, counters, EXPERIMENT_TIMES, r_len+s_len);
+
+    delete[] R_keys;
+    delete[] S_keys;
+    return res;
+}
+
+/*
+ * Count-only joins with build sides from half of the L2 up to 8x the LLC,
+ * measured by the size of the non-partitioned table (2 slots of 8 bytes per R tuple)
+ * */
+void join_crossover(uint64_t s_len) {
+    log_info("Function: %s", __FUNCTION__);
+    const cache_info_t &info = get_cache_info();
+    uint64_t min_r = std::max<uint64_t>(info.l2_size / 2 / 16, 1024);
+    uint64_t max_r = std::min<uint64_t>(info.llc_size * 8 / 16, 1<<27);
+    int *S_keys = new int[s_len];
+    double times_p[EXPERIMENT_TIMES], times_np[EXPERIMENT_TIMES];
+
+    for(uint64_t r_len = min_r; r_len <= max_r; r_len <<= 1) {
+        int *R_keys = new int[r_len];
+        random_generator_int_unique(R_keys, r_len, 1234);
+        random_generator_int(S_keys, s_len, (int)r_len, 1234);
+
+        uint64_t res_p, res_np;
+        for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+            times_p[e] = hash_join_omp(R_keys, R_keys, r_len, S_keys, S_keys, s_len, res_p);
+            times_np[e] = hash_join_np_omp(R_keys, R_keys, r_len, S_keys, S_keys, s_len, res_np);
+        }
+        if (res_p != res_np) log_error("Wrong results, %llu vs. %llu", res_p, res_np);
+
+        double time_p = average_Hampel(times_p, EXPERIMENT_TIMES);
+        double time_np = average_Hampel(times_np, EXPERIMENT_TIMES);
+        uint64_t table_bytes = r_len * 16;
+        const char *level = (table_bytes <= info.l2_size) ? "L2" : (table_bytes <= info.llc_size) ? "LLC" : "DRAM";
+        log_info("R=%llu (table %.1f MB, %s): partitioned=%.1f ms, non-partitioned=%.1f ms, %s wins",
+                 r_len, table_bytes/1024.0/1024, level, time_p, time_np,
+                 (time_p < time_np) ? "partitioned" : "non-partitioned");
+        delete[] R_keys;
+    }
+    delete[] S_keys;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t r_len = (argc > 1) ? stoull(argv[1]) : (1<<24);
+    uint64_t s_len = (argc > 2) ? stoull(argv[2]) : (1<<24);
+
+    for(int ratio = 1; ratio <= 8; ratio <<= 1) {
+        assert(test_join(r_len, s_len, (int)(r_len*ratio), true, hash_join_omp, "partitioned join"));
+        assert(test_join(r_len, s_len, (int)(r_len*ratio), true, hash_join_np_omp, "non-partitioned join"));
+    }
+    assert(test_join(r_len, s_len, (int)r_len, false, hash_join_omp, "partitioned join"));    /*aggregate only*/
+    assert(test_join(r_len, s_len, (int)r_len, false, hash_join_np_omp, "non-partitioned join"));
+
+    join_crossover(s_len);
+    return 0;
+}
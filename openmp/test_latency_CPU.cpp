@@ -0,0 +1,83 @@
+/*
+ * Memory latency with randomized pointer chasing, used as a cache-hierarchy probe
+ * 1. latency-vs-size curve from 4KB to MAX_MB
+ * 2. L1/L2/LLC/DRAM transitions detected on the curve (compared with sysconf)
+ * 3. the derived gather pass count and split fan-out
+ * 4. loaded latency: all threads chasing private chains concurrently (of MAX_MB,
+ *    less if the chains would take more than a quarter of the memory)
+ *
+ * Execute:
+ *      ./test_latency_CPU [MAX_MB=256] [STRIDE=64] [PAGE=default|small|huge] [THREADS=1]
+ * Huge pages keep TLB misses out of the curve, which makes the detection more reliable.
+ */
+#include <iostream>
+#include <omp.h>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <unistd.h>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/cache_probe.h"
+#include "params.h"
+using namespace std;
+
+bool test_latency(uint64_t max_bytes, uint64_t stride, PageType page, int threads) {
+    log_info("Function: %s", __FUNCTION__);
+
+    /*1.latency curve*/
+    auto curve = latency_curve(4*1024, max_bytes, stride, page, threads);
+    for(auto &p : curve) {
+        log_info("size=%10.1f KB, latency=%6.2f ns", p.bytes/1024.0, p.latency);
+    }
+
+    /*2.transitions*/
+    cache_info_t os = cache_info_sysconf();
+    cache_info_t probed = detect_cache_levels(curve);
+    log_info("sysconf: L1=%llu KB, L2=%llu KB, LLC=%llu KB, cacheline=%llu B",
+             os.l1_size/1024, os.l2_size/1024, os.llc_size/1024, os.cacheline_size);
+    if (probed.probed) {
+        log_info("probed:  L1=%llu KB, L2=%llu KB, LLC=%llu KB",
+                 probed.l1_size/1024, probed.l2_size/1024, probed.llc_size/1024);
+        set_cache_info(probed);
+    }
+    else {
+        log_warn("No transition found on the curve, using the sysconf sizes");
+    }
+
+    /*3.derived parameters*/
+    const cache_info_t &info = get_cache_info();
+    for(uint64_t mb = 64; mb <= 1024; mb <<= 2) {
+        log_info("gather on %llu MB input: %d pass(es)", mb, gather_passes(mb*1024*1024, info));
+    }
+    log_info("split fan-out: %d bits (%d buckets) per pass",
+             split_fanout_bits(info), 1<<split_fanout_bits(info));
+
+    /*4.loaded latency at the DRAM level, the chains of all the threads take at most a quarter of the memory*/
+    int max_threads = omp_get_max_threads();
+    uint64_t phys_bytes = (uint64_t)sysconf(_SC_PHYS_PAGES) * (uint64_t)sysconf(_SC_PAGE_SIZE);
+    uint64_t chain_bytes = std::min(max_bytes, phys_bytes / 4 / max_threads / stride * stride);
+    double *per_thread = new double[max_threads];
+    double loaded = chase_latency(chain_bytes, stride, page, max_threads, per_thread);
+    log_info("loaded latency with %d threads on %.1f MB each: %.2f ns", max_threads, chain_bytes/1024.0/1024, loaded);
+    for(int t = 0; t < max_threads; t++) {
+        log_info("  thread %d: %.2f ns", t, per_thread[t]);
+    }
+    delete[] per_thread;
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t max_mb = (argc > 1) ? stoull(argv[1]) : 256;
+    uint64_t stride = (argc > 2) ? stoull(argv[2]) : 64;
+    PageType page = PAGE_DEFAULT;
+    if (argc > 3) {
+        if (!strcmp(argv[3], "small"))       page = PAGE_SMALL;
+        else if (!strcmp(argv[3], "huge"))   page = PAGE_HUGE;
+    }
+    int threads = (argc > 4) ? stoi(argv[4]) : 1;
+
+    assert(test_latency(max_mb*1024*1024, stride, page, threads));
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Primitives on bit-packed key columns on CPU against the same primitives on
+ * the int columns, for 8 to 32-bit keys: pack/unpack round trip, gather into
+ * ints and into a packed column, scan and split (256 buckets). The results
+ * have to be equal to the ones on the int column.
+ *
+ * Execute:
+ *      ./test_pack_CPU [DATA_NUM=32M]
+ */
+#include <iostream>
+#include <cstring>
+#include <climits>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+#define SPLIT_BUCKETS   (256)
+
+bool test_packed(const int *keys, const int *idx, uint64_t len, int bits) {
+    bool res = true;
+    double int_times[EXPERIMENT_TIMES], packed_times[EXPERIMENT_TIMES];
+
+    uint64_t num_words = packed_words(len, bits);
+    uint32_t *packed = new uint32_t[num_words];
+    uint32_t *packed_out = new uint32_t[num_words];
+    int *out = new int[len];
+    int *ref = new int[len];
+    uint64_t *start = new uint64_t[SPLIT_BUCKETS+1];
+    uint64_t *start_ref = new uint64_t[SPLIT_BUCKETS+1];
+
+    /*1.round trip*/
+    double pack_time = pack_omp(keys, packed, len, bits);
+    double unpack_time = unpack_omp(packed, out, len, bits);
+    if (memcmp(out, keys, sizeof(int)*len) != 0) {
+        log_error("Wrong result of unpack_omp");
+        res = false;
+    }
+    log_info("bits=%d: pack time=%.2f ms, unpack time=%.2f ms, %.1f%% of the int column",
+             bits, pack_time, unpack_time, 100.0 * num_words / len);
+
+    /*2.gather*/
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        int_times[e] = gather((int*)keys, ref, (int*)idx, len);
+        packed_times[e] = gather_packed_omp(packed, bits, idx, len, out);
+    }
+    double packed_out_time = gather_packed_omp(packed, bits, idx, len, nullptr, packed_out);
+    if (memcmp(out, ref, sizeof(int)*len) != 0) {
+        log_error("Wrong result of gather_packed_omp");
+        res = false;
+    }
+    unpack_omp(packed_out, out, len, bits);
+    if (memcmp(out, ref, sizeof(int)*len) != 0) {
+        log_error("Wrong result of gather_packed_omp with packed output");
+        res = false;
+    }
+    log_info("bits=%d: gather time=%.2f ms, gather_packed_omp time=%.2f ms, with packed output=%.2f ms",
+             bits, average_Hampel(int_times, EXPERIMENT_TIMES),
+             average_Hampel(packed_times, EXPERIMENT_TIMES), packed_out_time);
+
+    /*3.scan*/
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        int_times[e] = scan_RTS_omp((int*)keys, ref, len);
+        packed_times[e] = scan_packed_omp(packed, bits, out, len);
+    }
+    if (memcmp(out, ref, sizeof(int)*len) != 0) {
+        log_error("Wrong result of scan_packed_omp");
+        res = false;
+    }
+    log_info("bits=%d: scan_RTS_omp time=%.2f ms, scan_packed_omp time=%.2f ms", bits,
+             average_Hampel(int_times, EXPERIMENT_TIMES), average_Hampel(packed_times, EXPERIMENT_TIMES));
+
+    /*4.key-only split, both are stable*/
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        int_times[e] = split_omp(keys, nullptr, ref, nullptr, len, SPLIT_BUCKETS, 0, start_ref);
+        packed_times[e] = split_packed_omp(packed, bits, nullptr, out, nullptr, len, SPLIT_BUCKETS, 0, start);
+    }
+    if (memcmp(out, ref, sizeof(int)*len) != 0 ||
+        memcmp(start, start_ref, sizeof(uint64_t)*(SPLIT_BUCKETS+1)) != 0) {
+        log_error("Wrong result of split_packed_omp");
+        res = false;
+    }
+    log_info("bits=%d: split_omp time=%.2f ms, split_packed_omp time=%.2f ms", bits,
+             average_Hampel(int_times, EXPERIMENT_TIMES), average_Hampel(packed_times, EXPERIMENT_TIMES));
+
+    delete[] packed;
+    delete[] packed_out;
+    delete[] out;
+    delete[] ref;
+    delete[] start;
+    delete[] start_ref;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+
+    int *keys = new int[len];
+    int *idx = new int[len];
+    random_generator_int_unique(idx, len, 1234);
+    for(int bits : {8, 13, 24, 32}) {
+        random_generator_int(keys, len, (bits == 32) ? INT_MAX : (1 << bits), 1234);
+        assert(test_packed(keys, idx, len, bits));
+    }
+    /*a partial last block*/
+    random_generator_int_unique(idx, 1000003, 1234);
+    assert(test_packed(keys, idx, 1000003, 32));
+
+    delete[] keys;
+    delete[] idx;
+    return 0;
+}
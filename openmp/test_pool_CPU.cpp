@@ -0,0 +1,181 @@
+/*
+ * The persistent thread pool (util/thread_pool.h): every element of a
+ * parallel_for with skewed chunk costs is visited exactly once (work
+ * stealing), nested calls run inline, scans stay correct while another
+ * thread holds the pool, and the dispatch time and the scans of 1K to 16M ints
+ * against an OpenMP fork/join reduce-then-scan.
+ *
+ * Execute:
+ *      ./test_pool_CPU
+ */
+#include <iostream>
+#include <vector>
+#include <omp.h>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/timer.h"
+#include "util/thread_pool.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+#define DISPATCH_TIMES  (1000)
+#define CONCURRENT_SCANS    (16)
+
+/*the reduce-then-scan of scan_RTS_omp in a "#pragma omp parallel" region*/
+double scan_RTS_fork_join(int *input, int *output, uint64_t len) {
+    int reduce_sum[MAX_THREAD_NUM] = {0};
+    Timer t;
+#pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        int local_sum = 0;
+#pragma omp for schedule(static) nowait
+        for (int i = 0; i < len; i++) local_sum += input[i];
+        reduce_sum[tid] = local_sum;
+#pragma omp barrier
+#pragma omp single
+        {
+            int acc = 0;
+            for (int i = 0; i < nthreads; i++) {
+                int temp = reduce_sum[i];
+                reduce_sum[i] = acc;
+                acc += temp;
+            }
+        }
+        local_sum = reduce_sum[tid];
+#pragma omp for schedule(static) nowait
+        for (int i = 0; i < len; i++) {
+            output[i] = local_sum;
+            local_sum += input[i];
+        }
+    }
+    return t.elapsed()*1000;
+}
+
+bool test_coverage() {
+    ThreadPool &pool = ThreadPool::get();
+    uint64_t threshold = pool.serial_threshold();
+    pool.set_serial_threshold(0);       /*always dispatched*/
+
+    uint64_t len = 1<<22;
+    vector<int> visits(len, 0), nested(len, 0);
+    /*chunks in the first quarter are 64x more expensive, so the other threads have to steal them*/
+    pool.parallel_for(len, 1<<10, [&](uint64_t begin, uint64_t end) {
+        int reps = (begin < len / 4) ? 64 : 1;
+        for(int r = 0; r < reps; r++)
+            for(uint64_t i = begin; i < end; i++) visits[i] += (r == 0);
+        pool.parallel_for(end - begin, 64, [&](uint64_t b, uint64_t e) {   /*inline*/
+            for(uint64_t i = b; i < e; i++) nested[begin + i]++;
+        });
+    });
+    pool.set_serial_threshold(threshold);
+
+    for(uint64_t i = 0; i < len; i++) {
+        if (visits[i] != 1 || nested[i] != 1) {
+            log_error("Element %llu visited %d times (%d nested)", (unsigned long long)i, visits[i], nested[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * A second host thread dispatches a 5 ms job every 10 ms, so the passes of
+ * the scans are dispatched or run on the caller depending on the timing,
+ * and both have to use the same partition.
+ * */
+bool test_concurrent_callers() {
+    ThreadPool &pool = ThreadPool::get();
+    uint64_t len = 1<<24;
+    int *input = new int[len];
+    int *output = new int[len];
+    for(uint64_t i = 0; i < len; i++) input[i] = 1;
+
+    atomic<bool> stop(false);
+    thread holder([&] {
+        while (!stop) {
+            pool.run(pool.num_threads(), [](int tid, int) {
+                auto until = chrono::steady_clock::now() + chrono::milliseconds(5);
+                if (tid == 0) while (chrono::steady_clock::now() < until);
+            });
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+    });
+
+    bool res = true;
+    for(int e = 0; e < CONCURRENT_SCANS && res; e++) {
+        if (e % 2 == 0) scan_RTS_omp(input, output, len);
+        else            scan_SSA_omp(input, output, len);
+        for(uint64_t i = 0; i < len && res; i++) {
+            if (output[i] != (int)i) {
+                log_error("Wrong %s result at %llu with a concurrent caller: %d",
+                          (e % 2 == 0) ? "scan_RTS_omp" : "scan_SSA_omp", (unsigned long long)i, output[i]);
+                res = false;
+            }
+        }
+    }
+    stop = true;
+    holder.join();
+    delete[] input;
+    delete[] output;
+    return res;
+}
+
+bool test_latency() {
+    ThreadPool &pool = ThreadPool::get();
+    log_info("Pool: %d threads, serial threshold=%llu ints",
+             pool.num_threads(), (unsigned long long)pool.serial_threshold());
+
+    Timer t;
+    for(int e = 0; e < DISPATCH_TIMES; e++) pool.run(pool.num_threads(), [](int, int) {});
+    double pool_us = t.elapsed() * 1e6 / DISPATCH_TIMES;
+    t.reset();
+    for(int e = 0; e < DISPATCH_TIMES; e++) {
+#pragma omp parallel
+        {
+#pragma omp barrier
+        }
+    }
+    double omp_us = t.elapsed() * 1e6 / DISPATCH_TIMES;
+    log_info("Empty job: pool=%.2f us, omp parallel=%.2f us", pool_us, omp_us);
+
+    uint64_t max_len = 1<<24;
+    int *input = new int[max_len];
+    int *output = new int[max_len];
+    int *ref = new int[max_len];
+    for(uint64_t i = 0; i < max_len; i++) input[i] = 1;
+
+    bool res = true;
+    for(uint64_t len = 1<<10; len <= max_len && res; len <<= 2) {
+        double pool_times[EXPERIMENT_TIMES], omp_times[EXPERIMENT_TIMES];
+        for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+            pool_times[e] = scan_RTS_omp(input, output, len);
+            omp_times[e] = scan_RTS_fork_join(input, ref, len);
+        }
+        for(uint64_t i = 0; i < len && res; i++) {
+            if (output[i] != ref[i] || output[i] != (int)i) {
+                log_error("Wrong scan result at %llu", (unsigned long long)i);
+                res = false;
+            }
+        }
+        log_info("len=%llu: scan_RTS_omp (pool) time=%.4f ms, fork/join time=%.4f ms", (unsigned long long)len,
+                 average_Hampel(pool_times, EXPERIMENT_TIMES), average_Hampel(omp_times, EXPERIMENT_TIMES));
+    }
+    delete[] input;
+    delete[] output;
+    delete[] ref;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    assert(test_coverage());
+    assert(test_concurrent_callers());
+    assert(test_latency());
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Reduction on CPU, sum/min/max/count over int32, int64, float and double.
+ * Integers are uniform in [0, 1024), floating-point values in [0, 1). The
+ * int32 values are narrowed so that their sum fits in an int32.
+ *
+ * Execute:
+ *      ./test_reduce_CPU [DATA_NUM=32M]
+ */
+#include <iostream>
+#include <cmath>
+#include <type_traits>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/perf_counter.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+/*host reference, sums are accumulated in double for the floating-point types*/
+template<typename T>
+static double host_reduce(const T *input, uint64_t len, ReduceOp op) {
+    double acc = (op == REDUCE_SUM || op == REDUCE_COUNT || len == 0) ? 0 : (double)input[0];
+    T acc_int = 0;
+    for(uint64_t i = 0; i < len; i++) {
+        switch (op) {
+            case REDUCE_SUM:    acc += input[i]; acc_int += input[i]; break;
+            case REDUCE_MIN:    acc = std::min(acc, (double)input[i]); break;
+            case REDUCE_MAX:    acc = std::max(acc, (double)input[i]); break;
+            case REDUCE_COUNT:  acc += 1; break;
+        }
+    }
+    return (op == REDUCE_SUM && std::is_integral<T>::value) ? (double)acc_int : acc;
+}
+
+template<typename T>
+bool test_reduce(const T *input, uint64_t len, ReduceOp op, const char *name) {
+    bool res = true;
+    double times[EXPERIMENT_TIMES];
+    perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+    perf_clear(counters);
+    double expected = host_reduce(input, len, op);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        T result;
+        times[e] = reduce_omp(input, len, op, result);
+        perf_accumulate(counters, perf_last_sample());
+
+        /*floating-point sums depend on the reduction order*/
+        double tolerance = std::is_integral<T>::value ? 0 : 1e-6 * fabs(expected);
+        if (e == 0 && fabs((double)result - expected) > tolerance) {
+            log_error("Wrong result, %.4f, expected %.4f", (double)result, expected);
+            res = false;
+        }
+    }
+    double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("%s: time=%.2f ms, throughput=%.1f GB/s", name, ave_time, compute_bandwidth(len, sizeof(T), ave_time));
+    perf_print(name, counters, EXPERIMENT_TIMES, len);
+    return res;
+}
+
+template<typename T>
+void test_all_ops(uint64_t len, const char *type_name) {
+    const char *op_names[] = {"sum", "min", "max", "count"};
+    T *input = new T[len];
+    uint64_t int_range = 1024;
+    if (std::is_same<T, int32_t>::value && len > 0)     /*no signed overflow in the int32 sums*/
+        int_range = std::max(std::min(int_range, (uint64_t)INT32_MAX / len), (uint64_t)1);
+    srand(1234);
+    for(uint64_t i = 0; i < len; i++) {
+        if (std::is_integral<T>::value) input[i] = (T)(rand() % int_range);
+        else                            input[i] = (T)rand() / RAND_MAX;
+    }
+    for(int o = REDUCE_SUM; o <= REDUCE_COUNT; o++) {
+        char name[100];
+        sprintf(name, "%s %s", type_name, op_names[o]);
+        assert(test_reduce(input, len, (ReduceOp)o, name));
+    }
+    delete[] input;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+
+    test_all_ops<int32_t>(len, "int32");
+    test_all_ops<int64_t>(len, "int64");
+    test_all_ops<float>(len, "float");
+    test_all_ops<double>(len, "double");
+    return 0;
+}
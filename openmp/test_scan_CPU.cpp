@@ -26,14 +26,9 @@
 #include "util/utility.h"
 #include "util/log.h"
 #include "util/timer.h"
+#include "util/perf_counter.h"
+#include "primitives.h"
 #include "params.h"
-#include "tbb/task_scheduler_init.h"
-#include "tbb/blocked_range.h"
-#include "tbb/parallel_scan.h"
-#include "tbb/tick_count.h"
-
-using namespace tbb;
-#define MAX_THREAD_NUM (256)
 using namespace std;
 
 inline bool scan_check(int *input, int *output, uint64_t len) {
@@ -48,120 +43,6 @@ inline bool scan_check(int *input, int *output, uint64_t len) {
     return true;
 }
 
-/* TBB exclusive scan*/
-template<typename T>
-class ScanBody_ex {
-    T sum;
-    T* const y;
-    const T* const x;
-public:
-    ScanBody_ex( T y_[], const T x_[] ) : sum(0), x(x_), y(y_) {}
-    T get_sum() const {return sum;}
-
-    template<typename Tag>
-    void operator()( const blocked_range<int>& r, Tag ) {
-        T temp = sum;
-        int end = r.end();
-        for( int i=r.begin(); i<end; ++i ) {
-            if( Tag::is_final_scan() )
-                y[i] = temp;
-            temp = temp + x[i];
-        }
-        sum = temp;
-    }
-    ScanBody_ex( ScanBody_ex& b, split ) : x(b.x), y(b.y), sum(0) {}
-    void reverse_join( ScanBody_ex& a ) { sum = a.sum + sum;}
-    void assign( ScanBody_ex& b ) {sum = b.sum;}
-};
-
-double scan_tbb(int *input, int* output, uint64_t len) {
-    Timer t;
-    ScanBody_ex<int> body(output,input);
-    parallel_scan(blocked_range<int>(0,len), body, auto_partitioner());
-    return t.elapsed()*1000;
-};
-
-/*OpenMP-based scan-scan-add scheme, 4n data accesses*/
-double scan_SSA_omp(int *input, int* output, uint64_t len) {
-    int reduce_sum[MAX_THREAD_NUM] = {0};
-    Timer t;
-
-#pragma omp parallel
-    {
-        int nthreads = omp_get_num_threads();
-        int tid = omp_get_thread_num();
-        int local_sum = 0;
-
-        /*Scan*/
-#pragma omp for schedule(static) nowait
-        for (int i = 0; i < len; i++) {
-            output[i] = local_sum;
-            local_sum += input[i];
-        }
-        reduce_sum[tid] = local_sum;
-#pragma omp barrier
-
-        /*Scan*/
-#pragma omp single
-        {
-            int acc = 0;
-            for (int i = 0; i < nthreads; i++) {
-                int temp = reduce_sum[i];
-                reduce_sum[i] = acc;
-                acc += temp;
-            }
-        }
-
-        /*Add*/
-#pragma omp for schedule(static) nowait
-        for (int i = 0; i < len; i++) {
-            output[i] += reduce_sum[tid];
-        }
-    }
-    return t.elapsed()*1000;
-}
-
-/*OpenMP-based reduce-then-scan scheme, 3n data accesses*/
-double scan_RTS_omp(int *input, int* output, uint64_t len) {
-    int reduce_sum[MAX_THREAD_NUM] = {0};
-    Timer t;
-
-#pragma omp parallel
-    {
-        int nthreads = omp_get_num_threads();
-        int tid = omp_get_thread_num();
-        int local_sum = 0;
-
-        /*Reduce*/
-#pragma omp for schedule(static) nowait
-        for (int i = 0; i < len; i++) {
-            local_sum += input[i];
-        }
-        reduce_sum[tid] = local_sum;
-#pragma omp barrier
-
-        /*Scan*/
-#pragma omp single
-        {
-            int acc = 0;
-            for (int i = 0; i < nthreads; i++) {
-                int temp = reduce_sum[i];
-                reduce_sum[i] = acc;
-                acc += temp;
-            }
-        }
-
-        /*Scan*/
-        local_sum = reduce_sum[tid];
-#pragma omp for schedule(static) nowait
-        for (int i = 0; i < len; i++) {
-            output[i] = local_sum;
-            local_sum += input[i];
-        }
-    }
-    return t.elapsed()*1000;
-}
-
 bool test_scan() {
     log_info("Function: %s", __FUNCTION__);
     int scale_min = 10, scale_max = 30;
@@ -180,10 +61,13 @@ bool test_scan() {
         int cur_len = 1<<scale;
         log_info("Current length = %d", cur_len);
         double tempTimes[EXPERIMENT_TIMES];
+        perf_sample_t counters; /*only collected when compiled with USE_PERF*/
 
         /*SSA scan*/
+        perf_clear(counters);
         for(int e = 0; e < EXPERIMENT_TIMES; e++) {
             tempTimes[e] = scan_SSA_omp(input, output, cur_len);
+            perf_accumulate(counters, perf_last_sample());
             if (e == 0) res = scan_check(input, output, cur_len);
         }
         ave_time = average_Hampel(tempTimes, EXPERIMENT_TIMES);
@@ -191,12 +75,15 @@ bool test_scan() {
         if (res) {
             log_info("SAA scan: time=%.1f ms, throughput=%.1f GB/s",
                      ave_time, compute_bandwidth(cur_len, sizeof(int), ave_time));
+            perf_print("SSA scan", counters, EXPERIMENT_TIMES, cur_len);
         }
         else break;
 
         /*RTS scan*/
+        perf_clear(counters);
         for(int e = 0; e < EXPERIMENT_TIMES; e++) {
             tempTimes[e] = scan_RTS_omp(input, output, cur_len);
+            perf_accumulate(counters, perf_last_sample());
             if (e == 0) res = scan_check(input, output, cur_len);
         }
         ave_time = average_Hampel(tempTimes, EXPERIMENT_TIMES);
@@ -204,10 +91,11 @@ bool test_scan() {
         if (res) {
             log_info("RTS scan: time=%.1f ms, throughput=%.1f GB/s",
                      ave_time, compute_bandwidth(cur_len, sizeof(int), ave_time));
+            perf_print("RTS scan", counters, EXPERIMENT_TIMES, cur_len);
         }
         else break;
 
-        /*TBB scan*/
+        /*TBB scan, no counters since TBB workers are not the OpenMP threads being counted*/
         for(int e = 0; e < EXPERIMENT_TIMES; e++) {
             tempTimes[e] = scan_tbb(input, output, cur_len);
             if (e == 0) res = scan_check(input, output, cur_len);
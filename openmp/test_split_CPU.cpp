@@ -0,0 +1,139 @@
+/*
+ * Radix split on CPU, the per-thread-histogram split (split_omp) against the
+ * one with in-register ranking (split_simd_omp), 2 to 1024 buckets on uniform
+ * keys. Both outputs are stable and checked against a sequential split.
+ * Then the multi-pass LSD radix split (radix_split_omp) with and without
+ * counting the next histogram in the scatter.
+ * With KEY_FILE, the keys are the first DATA_NUM ones of the first column of
+ * that column file (util/column_file.h) instead of uniform ones.
+ *
+ * Execute:
+ *      ./test_split_CPU [DATA_NUM=32M] [KEY_FILE]
+ */
+#include <iostream>
+#include <cstring>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/perf_counter.h"
+#include "util/column_file.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+typedef double (*split_func_t)(const int*, const int*, int*, int*, uint64_t, int, int, uint64_t*);
+
+bool test_split(const int *keys, const int *values, uint64_t len, int buckets,
+                split_func_t func, const char *name) {
+    bool res = true;
+    double times[EXPERIMENT_TIMES];
+    perf_sample_t counters; /*only collected when compiled with USE_PERF*/
+    perf_clear(counters);
+
+    int *keys_out = new int[len];
+    int *values_out = new int[len];
+    int *keys_ref = new int[len];
+    int *values_ref = new int[len];
+    uint64_t *start = new uint64_t[buckets+1];
+    uint64_t *start_ref = new uint64_t[buckets+1];
+    split_seq(keys, values, keys_ref, values_ref, len, buckets, 0, start_ref);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        times[e] = func(keys, values, keys_out, values_out, len, buckets, 0, start);
+        perf_accumulate(counters, perf_last_sample());
+
+        if (e == 0) {
+            if (memcmp(start, start_ref, sizeof(uint64_t)*(buckets+1)) != 0) {
+                log_error("Wrong bucket start positions");
+                res = false;
+            }
+            for(uint64_t i = 0; i < len && res; i++) {
+                if ((keys_out[i] != keys_ref[i]) || (values_out[i] != values_ref[i])) {
+                    log_error("Wrong result at %llu: (%d,%d), expected (%d,%d)",
+                              i, keys_out[i], values_out[i], keys_ref[i], values_ref[i]);
+                    res = false;
+                }
+            }
+        }
+    }
+    double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("%s, buckets=%d: time=%.2f ms, throughput=%.1f GB/s",
+             name, buckets, ave_time, compute_bandwidth(len, 2*sizeof(int), ave_time));
+    perf_print(name, counters, EXPERIMENT_TIMES, len);
+
+    delete[] keys_out;
+    delete[] values_out;
+    delete[] keys_ref;
+    delete[] values_ref;
+    delete[] start;
+    delete[] start_ref;
+    return res;
+}
+
+bool test_radix_split(const int *keys, const int *values, uint64_t len,
+                      int bits, int pass_bits, bool fused) {
+    bool res = true;
+    double times[EXPERIMENT_TIMES];
+    const char *name = fused ? "radix_split_omp (fused)" : "radix_split_omp";
+    perf_sample_t counters;
+    perf_clear(counters);
+
+    int *keys_out = new int[len];
+    int *values_out = new int[len];
+    int *keys_ref = new int[len];
+    int *values_ref = new int[len];
+    uint64_t *start_ref = new uint64_t[(1<<bits)+1];
+    split_seq(keys, values, keys_ref, values_ref, len, 1<<bits, 0, start_ref);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        times[e] = radix_split_omp(keys, values, keys_out, values_out, len, bits, pass_bits, fused);
+        perf_accumulate(counters, perf_last_sample());
+
+        if (e == 0) {
+            for(uint64_t i = 0; i < len && res; i++) {
+                if ((keys_out[i] != keys_ref[i]) || (values_out[i] != values_ref[i])) {
+                    log_error("Wrong result at %llu: (%d,%d), expected (%d,%d)",
+                              i, keys_out[i], values_out[i], keys_ref[i], values_ref[i]);
+                    res = false;
+                }
+            }
+        }
+    }
+    double ave_time = average_Hampel(times, EXPERIMENT_TIMES);
+    log_info("%s, bits=%d, pass_bits=%d: time=%.2f ms, throughput=%.1f GB/s",
+             name, bits, pass_bits, ave_time, compute_bandwidth(len, 2*sizeof(int), ave_time));
+    perf_print(name, counters, EXPERIMENT_TIMES, len);
+
+    delete[] keys_out;
+    delete[] values_out;
+    delete[] keys_ref;
+    delete[] values_ref;
+    delete[] start_ref;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+
+    int *keys = new int[len];
+    int *values = new int[len];
+    if (argc > 2) {
+        if (!column_file_read(argv[2], 0, keys, len)) return 1;
+    }
+    else random_generator_int(keys, len, (int)len, 1234);
+    for(uint64_t i = 0; i < len; i++) values[i] = (int)i;
+
+    for(int buckets = 2; buckets <= 1024; buckets <<= 1) {
+        assert(test_split(keys, values, len, buckets, split_omp, "split_omp"));
+        assert(test_split(keys, values, len, buckets, split_simd_omp, "split_simd_omp"));
+    }
+    for(auto config : {make_pair(16, 8), make_pair(15, 5)}) {
+        assert(test_radix_split(keys, values, len, config.first, config.second, false));
+        assert(test_radix_split(keys, values, len, config.first, config.second, true));
+    }
+
+    delete[] keys;
+    delete[] values;
+    return 0;
+}
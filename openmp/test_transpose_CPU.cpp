@@ -0,0 +1,99 @@
+/*
+ * AOS <-> SOA transpose on CPU for records of 2, 4 and 8 int fields, the
+ * SIMD primitives (aos_to_soa, soa_to_aos) against plain per-record loops.
+ * Both directions are checked, the round trip has to give back the records.
+ *
+ * Execute:
+ *      ./test_transpose_CPU [DATA_NUM=32M]
+ */
+#include <iostream>
+#include <cstring>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "util/timer.h"
+#include "util/perf_counter.h"
+#include "primitives.h"
+#include "params.h"
+using namespace std;
+
+/*the per-record loops the primitives replace*/
+double aos_to_soa_loop(const int *records, int * const *fields, int num_fields, uint64_t len) {
+    Timer t;
+#pragma omp parallel for schedule(static)
+    for(uint64_t i = 0; i < len; i++)
+        for(int f = 0; f < num_fields; f++)
+            fields[f][i] = records[i*num_fields+f];
+    return t.elapsed()*1000;
+}
+
+double soa_to_aos_loop(const int * const *fields, int *records, int num_fields, uint64_t len) {
+    Timer t;
+#pragma omp parallel for schedule(static)
+    for(uint64_t i = 0; i < len; i++)
+        for(int f = 0; f < num_fields; f++)
+            records[i*num_fields+f] = fields[f][i];
+    return t.elapsed()*1000;
+}
+
+bool test_transpose(uint64_t len, int num_fields, bool simd) {
+    bool res = true;
+    const char *name = simd ? "SIMD" : "loop";
+    double aos_soa_times[EXPERIMENT_TIMES], soa_aos_times[EXPERIMENT_TIMES];
+
+    /*2MB-aligned, so that the primitives can use streaming stores*/
+    uint64_t bytes = len*num_fields*sizeof(int);
+    int *records = (int*)alloc_huge_pages(bytes);
+    int *back = (int*)alloc_huge_pages(bytes);
+    int *fields[8];
+    for(int f = 0; f < num_fields; f++) fields[f] = (int*)alloc_huge_pages(len*sizeof(int));
+    random_generator_int(records, len*num_fields, (int)len, 1234);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        aos_soa_times[e] = simd ? aos_to_soa(records, fields, num_fields, len)
+                                : aos_to_soa_loop(records, fields, num_fields, len);
+        soa_aos_times[e] = simd ? soa_to_aos(fields, back, num_fields, len)
+                                : soa_to_aos_loop(fields, back, num_fields, len);
+
+        if (e == 0) {
+            for(int f = 0; f < num_fields && res; f++) {
+                for(uint64_t i = 0; i < len; i++) {
+                    if (fields[f][i] != records[i*num_fields+f]) {
+                        log_error("Wrong SOA result in field %d at %llu: %d, expected %d",
+                                  f, i, fields[f][i], records[i*num_fields+f]);
+                        res = false;
+                        break;
+                    }
+                }
+            }
+            if (res && memcmp(back, records, bytes) != 0) {
+                log_error("Wrong AOS result after the round trip");
+                res = false;
+            }
+        }
+    }
+    /*every record is read once and written once*/
+    double aos_soa_time = average_Hampel(aos_soa_times, EXPERIMENT_TIMES);
+    double soa_aos_time = average_Hampel(soa_aos_times, EXPERIMENT_TIMES);
+    log_info("%s, fields=%d: aos_to_soa time=%.2f ms (%.1f GB/s), soa_to_aos time=%.2f ms (%.1f GB/s)",
+             name, num_fields, aos_soa_time, compute_bandwidth(len, 2*num_fields*sizeof(int), aos_soa_time),
+             soa_aos_time, compute_bandwidth(len, 2*num_fields*sizeof(int), soa_aos_time));
+
+    free_huge_pages(records);
+    free_huge_pages(back);
+    for(int f = 0; f < num_fields; f++) free_huge_pages(fields[f]);
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+
+    for(int num_fields : {2, 4, 8}) {
+        assert(test_transpose(len, num_fields, false));
+        assert(test_transpose(len, num_fields, true));
+    }
+    /*tail records that do not fill a register*/
+    assert(test_transpose(1000003, 8, true));
+    return 0;
+}
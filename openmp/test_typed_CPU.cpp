@@ -0,0 +1,222 @@
+/*
+ * The typed primitives (typed_primitives.h) against the untyped ones: split
+ * of int keys and payloads with a compile-time bucket count against split_seq
+ * on 16 to 1024 buckets, timed along with split_omp that dispatches to it,
+ * keys-only int64 and AOS splits checked against split_seq, scans on the
+ * three operators (also while another thread holds the thread pool) and
+ * gathers of int64 values with unsigned indexes.
+ *
+ * Execute:
+ *      ./test_typed_CPU [DATA_NUM=32M]
+ */
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <omp.h>
+#include <cassert>
+#include "util/utility.h"
+#include "util/log.h"
+#include "primitives.h"
+#include "typed_primitives.h"
+#include "params.h"
+using namespace std;
+
+template<int Buckets>
+bool test_split_soa(const int *keys, const int *values, uint64_t len) {
+    bool res = true;
+    double typed_times[EXPERIMENT_TIMES], untyped_times[EXPERIMENT_TIMES];
+
+    int *keys_out = new int[len];
+    int *values_out = new int[len];
+    int *keys_ref = new int[len];
+    int *values_ref = new int[len];
+    uint64_t *start = new uint64_t[Buckets+1];
+    uint64_t *start_ref = new uint64_t[Buckets+1];
+    split_seq(keys, values, keys_ref, values_ref, len, Buckets, 0, start_ref);
+
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        typed_times[e] = prim::split<int, int, prim::SOA, Buckets>(keys, values, keys_out, values_out, len, 0, start);
+        if (e == 0) {
+            if (memcmp(start, start_ref, sizeof(uint64_t)*(Buckets+1)) != 0) {
+                log_error("Wrong bucket start positions");
+                res = false;
+            }
+            for(uint64_t i = 0; i < len && res; i++) {
+                if ((keys_out[i] != keys_ref[i]) || (values_out[i] != values_ref[i])) {
+                    log_error("Wrong result at %llu: (%d,%d), expected (%d,%d)",
+                              i, keys_out[i], values_out[i], keys_ref[i], values_ref[i]);
+                    res = false;
+                }
+            }
+        }
+        untyped_times[e] = split_omp(keys, values, keys_out, values_out, len, Buckets, 0, start);
+    }
+    log_info("buckets=%d: split<int,int,SOA,%d> time=%.2f ms, split_omp time=%.2f ms", Buckets, Buckets,
+             average_Hampel(typed_times, EXPERIMENT_TIMES), average_Hampel(untyped_times, EXPERIMENT_TIMES));
+
+    delete[] keys_out;
+    delete[] values_out;
+    delete[] keys_ref;
+    delete[] values_ref;
+    delete[] start;
+    delete[] start_ref;
+    return res;
+}
+
+/*keys-only int64 split on the high digit and AOS split, against split_seq on the int keys*/
+bool test_split_layouts(const int *keys, const int *values, uint64_t len) {
+    const int buckets = 64, shift = 4;
+    bool res = true;
+    int *keys_ref = new int[len];
+    int *values_ref = new int[len];
+    int *shifted = new int[len];
+    uint64_t *start_ref = new uint64_t[buckets+1];
+    for(uint64_t i = 0; i < len; i++) shifted[i] = (int)((unsigned)keys[i] >> shift);
+    split_seq(shifted, values, keys_ref, values_ref, len, buckets, 0, start_ref);
+
+    vector<int64_t> keys64(len), keys64_out(len);
+    for(uint64_t i = 0; i < len; i++) keys64[i] = ((int64_t)values[i] << 32) | (unsigned)keys[i];
+    double keys_time = prim::split<int64_t, void, prim::SOA, buckets>(keys64.data(), keys64_out.data(), len, shift, nullptr);
+
+    typedef prim::record_t<int, int> rec_t;
+    vector<rec_t> records(len), records_out(len);
+    for(uint64_t i = 0; i < len; i++) records[i] = {keys[i], values[i]};
+    double aos_time = prim::split<int, int, prim::AOS, buckets>(records.data(), records_out.data(), len, shift, nullptr);
+
+    for(uint64_t i = 0; i < len && res; i++) {
+        if ((int)(keys64_out[i] >> 32) != values_ref[i] || records_out[i].payload != values_ref[i]) {
+            log_error("Wrong split at %llu", (unsigned long long)i);
+            res = false;
+        }
+    }
+    log_info("split<int64_t,void,SOA,%d> time=%.2f ms, split<int,int,AOS,%d> time=%.2f ms",
+             buckets, keys_time, buckets, aos_time);
+
+    delete[] keys_ref;
+    delete[] values_ref;
+    delete[] shifted;
+    delete[] start_ref;
+    return res;
+}
+
+template<typename T, ReduceOp Op>
+bool check_scan(const T *input, const T *output, uint64_t len, T identity, const char *name) {
+    T acc = identity;
+    for(uint64_t i = 0; i < len; i++) {
+        if (output[i] != acc) {
+            log_error("Wrong %s scan at %llu", name, (unsigned long long)i);
+            return false;
+        }
+        if (Op == REDUCE_SUM) acc += input[i];
+        else if (Op == REDUCE_MIN) acc = std::min(acc, input[i]);
+        else acc = std::max(acc, input[i]);
+    }
+    return true;
+}
+
+bool test_scan(const int *keys, uint64_t len) {
+    double typed_times[EXPERIMENT_TIMES], untyped_times[EXPERIMENT_TIMES];
+    int *input = new int[len];
+    int *output = new int[len];
+    for(uint64_t i = 0; i < len; i++) input[i] = keys[i] & 0xf;    /*sums of 32M values fit in an int*/
+
+    bool res = true;
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        typed_times[e] = prim::scan<int, REDUCE_SUM>(input, output, len);
+        if (e == 0) res &= check_scan<int, REDUCE_SUM>(input, output, len, 0, "sum");
+        untyped_times[e] = scan_RTS_omp(input, output, len);
+    }
+    log_info("scan<int,REDUCE_SUM> time=%.2f ms, scan_RTS_omp time=%.2f ms",
+             average_Hampel(typed_times, EXPERIMENT_TIMES), average_Hampel(untyped_times, EXPERIMENT_TIMES));
+
+    vector<int64_t> input64(len), output64(len);
+    for(uint64_t i = 0; i < len; i++) input64[i] = (int64_t)keys[i] * (int64_t)(len - i);
+    prim::scan<int64_t, REDUCE_MAX>(input64.data(), output64.data(), len);
+    res &= check_scan<int64_t, REDUCE_MAX>(input64.data(), output64.data(), len,
+                                           std::numeric_limits<int64_t>::lowest(), "max");
+    prim::scan<int64_t, REDUCE_MIN>(input64.data(), output64.data(), len);
+    res &= check_scan<int64_t, REDUCE_MIN>(input64.data(), output64.data(), len,
+                                           std::numeric_limits<int64_t>::max(), "min");
+
+    /*a second host thread dispatches a 5 ms job every 10 ms, the two passes may run differently*/
+    ThreadPool &pool = ThreadPool::get();
+    atomic<bool> stop(false);
+    thread holder([&] {
+        while (!stop) {
+            pool.run(pool.num_threads(), [](int tid, int) {
+                auto until = chrono::steady_clock::now() + chrono::milliseconds(5);
+                if (tid == 0) while (chrono::steady_clock::now() < until);
+            });
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+    });
+    for(int e = 0; e < EXPERIMENT_TIMES && res; e++) {
+        prim::scan<int, REDUCE_SUM>(input, output, len);
+        res &= check_scan<int, REDUCE_SUM>(input, output, len, 0, "concurrent sum");
+    }
+    stop = true;
+    holder.join();
+
+    delete[] input;
+    delete[] output;
+    return res;
+}
+
+bool test_gather(const int *keys, uint64_t len) {
+    double typed_times[EXPERIMENT_TIMES], untyped_times[EXPERIMENT_TIMES];
+    int *input = new int[len];
+    int *output = new int[len];
+    int *idx = new int[len];
+    vector<uint32_t> idx32(len);
+    vector<int64_t> input64(len), output64(len);
+    for(uint64_t i = 0; i < len; i++) {
+        input[i] = (int)i;
+        input64[i] = (int64_t)i << 20;
+        idx[i] = (int)((unsigned)keys[i] % len);
+        idx32[i] = (uint32_t)idx[i];
+    }
+
+    bool res = true;
+    for(int e = 0; e < EXPERIMENT_TIMES; e++) {
+        typed_times[e] = prim::gather<int64_t, uint32_t>(input64.data(), output64.data(), idx32.data(), len);
+        untyped_times[e] = gather(input, output, idx, len);
+    }
+    for(uint64_t i = 0; i < len && res; i++) {
+        if (output64[i] != ((int64_t)output[i] << 20)) {
+            log_error("Wrong gather at %llu", (unsigned long long)i);
+            res = false;
+        }
+    }
+    log_info("gather<int64_t,uint32_t> time=%.2f ms, gather (int) time=%.2f ms",
+             average_Hampel(typed_times, EXPERIMENT_TIMES), average_Hampel(untyped_times, EXPERIMENT_TIMES));
+
+    delete[] input;
+    delete[] output;
+    delete[] idx;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t len = (argc > 1) ? stoull(argv[1]) : (1<<25);
+
+    int *keys = new int[len];
+    int *values = new int[len];
+    random_generator_int(keys, len, (int)len, 1234);
+    for(uint64_t i = 0; i < len; i++) values[i] = (int)i;
+
+    assert(test_split_soa<16>(keys, values, len));
+    assert(test_split_soa<64>(keys, values, len));
+    assert(test_split_soa<256>(keys, values, len));
+    assert(test_split_soa<1024>(keys, values, len));
+    assert(test_split_layouts(keys, values, len));
+    assert(test_scan(keys, len));
+    assert(test_gather(keys, len));
+
+    delete[] keys;
+    delete[] values;
+    return 0;
+}
@@ -0,0 +1,251 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#pragma once
+
+#include <omp.h>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "primitives.h"
+#include "timer.h"
+#include "thread_pool.h"
+
+/*
+ * Header-only typed versions of split, scan and gather. The element types,
+ * the layout and the bucket count are template parameters, so each
+ * instantiation is compiled for its own types and constants: the bucket mask
+ * and the loops over the buckets are constants, and there is no runtime
+ * switch on the layout. The algorithms are the ones of split_par, scan_RTS_omp
+ * and gather; split_par itself runs the split below for up to 4096 buckets.
+ * opencl/typed_primitives.h maps the same parameters to the kernel
+ * compilation flags.
+ *
+ * All the primitives return the elapsed time in ms.
+ * */
+namespace prim {
+
+/*layouts of the split tuples*/
+struct SOA {};      /*keys and payloads in separate arrays*/
+struct AOS {};      /*array of record_t*/
+
+template<typename Key, typename Payload>
+struct record_t {
+    Key key;
+    Payload payload;
+};
+
+namespace detail {
+
+struct no_column_t {};
+
+#define PRIM_SWWC_BYTES     (64)        /*bytes of a write-combining line*/
+#define PRIM_POOL_GRAIN     (1<<12)     /*elements per chunk of the pool jobs*/
+
+template<typename Key>
+inline Key key_of(const Key &key) { return key; }
+
+template<typename Key, typename Payload>
+inline Key key_of(const record_t<Key, Payload> &rec) { return rec.key; }
+
+/*bucket of a key, Buckets is a power of 2*/
+template<int Buckets, typename Key>
+inline unsigned bucket_of(Key key, int shift) {
+    typedef typename std::make_unsigned<Key>::type ukey_t;
+    return (unsigned)(((ukey_t)key >> shift) & (ukey_t)(Buckets - 1));
+}
+
+/*
+ * scatter_swwc of splitImpl.cpp on a fixed bucket count: T0 carries the keys
+ * (a key or a record), T1 is the payload column of SOA or no_column_t.
+ * A line holds PRIM_SWWC_BYTES of T0, the payloads are staged alongside.
+ * */
+template<int Buckets, typename T0, typename T1>
+void scatter_swwc(const T0 *in0, const T1 *in1, T0 *out0, T1 *out1,
+                  uint64_t begin, uint64_t end, int shift, uint64_t *pos) {
+    const bool has1 = !std::is_same<T1, no_column_t>::value;
+    const int line = (PRIM_SWWC_BYTES / sizeof(T0) > 0) ? PRIM_SWWC_BYTES / sizeof(T0) : 1;
+    T0 *buf0 = host_new<T0>(Buckets*line);
+    T1 *buf1 = has1 ? host_new<T1>(Buckets*line) : nullptr;
+    int cnt[Buckets];
+    for(int b = 0; b < Buckets; b++) cnt[b] = 0;
+
+    for(uint64_t i = begin; i < end; i++) {
+        T0 t = in0[i];
+        unsigned b = bucket_of<Buckets>(key_of(t), shift);
+        int c = cnt[b]++;
+        buf0[b*line+c] = t;
+        if (has1) buf1[b*line+c] = in1[i];
+        if (c == line-1) {      /*a full line*/
+            memcpy(out0+pos[b], buf0+b*line, sizeof(T0)*line);
+            if (has1) memcpy(out1+pos[b], buf1+b*line, sizeof(T1)*line);
+            pos[b] += line;
+            cnt[b] = 0;
+        }
+    }
+    for(int b = 0; b < Buckets; b++) {  /*flush the partial lines*/
+        memcpy(out0+pos[b], buf0+b*line, sizeof(T0)*cnt[b]);
+        if (has1) memcpy(out1+pos[b], buf1+b*line, sizeof(T1)*cnt[b]);
+        pos[b] += cnt[b];
+    }
+    host_delete(buf0);
+    host_delete(buf1);
+}
+
+/*split_par of splitImpl.cpp on a fixed bucket count, start is optional*/
+template<int Buckets, typename T0, typename T1>
+double split_par(const T0 *in0, const T1 *in1, T0 *out0, T1 *out1,
+                 uint64_t len, int shift, uint64_t *start) {
+    static_assert(Buckets > 0 && (Buckets & (Buckets - 1)) == 0, "Buckets should be a power of 2");
+    uint64_t *his = host_new<uint64_t>((uint64_t)omp_get_max_threads()*Buckets);
+    Timer t;
+
+#pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        uint64_t begin = len * tid / nthreads;
+        uint64_t end = len * (tid+1) / nthreads;
+        uint64_t *my_his = his + (uint64_t)tid*Buckets;
+
+        /*1.histogram*/
+        for(int b = 0; b < Buckets; b++) my_his[b] = 0;
+        for(uint64_t i = begin; i < end; i++) my_his[bucket_of<Buckets>(key_of(in0[i]), shift)]++;
+#pragma omp barrier
+
+        /*2.bucket-major scan of the histograms*/
+#pragma omp single
+        {
+            uint64_t acc = 0;
+            for(int b = 0; b < Buckets; b++) {
+                if (start) start[b] = acc;
+                for(int th = 0; th < nthreads; th++) {
+                    uint64_t temp = his[(uint64_t)th*Buckets+b];
+                    his[(uint64_t)th*Buckets+b] = acc;
+                    acc += temp;
+                }
+            }
+            if (start) start[Buckets] = acc;
+        }
+
+        /*3.scatter*/
+        scatter_swwc<Buckets>(in0, in1, out0, out1, begin, end, shift, my_his);
+    }
+    double total_time = t.elapsed()*1000;
+
+    host_delete(his);
+    return total_time;
+}
+
+/*operators of the scans, Op is the ReduceOp of reduce_omp*/
+template<typename T, ReduceOp Op> struct scan_op;
+
+/*double if Layout is L and Payload is void or not as KeysOnly, selects the overload of split*/
+template<typename Payload, typename Layout, typename L, bool KeysOnly>
+using split_ret_t = typename std::enable_if<std::is_same<Layout, L>::value &&
+                                            std::is_void<Payload>::value == KeysOnly, double>::type;
+
+template<typename T> struct scan_op<T, REDUCE_SUM> {
+    static T identity()             { return (T)0; }
+    static T apply(T a, T b)        { return a + b; }
+};
+template<typename T> struct scan_op<T, REDUCE_MIN> {
+    static T identity()             { return std::numeric_limits<T>::max(); }
+    static T apply(T a, T b)        { return (b < a) ? b : a; }
+};
+template<typename T> struct scan_op<T, REDUCE_MAX> {
+    static T identity()             { return std::numeric_limits<T>::lowest(); }
+    static T apply(T a, T b)        { return (b > a) ? b : a; }
+};
+
+} /*namespace detail*/
+
+/*
+ * split of len tuples into Buckets buckets on (key >> shift) & (Buckets-1),
+ * stable, start[b] (Buckets+1 values, optional) is the first position of bucket b
+ *      split<Key, void, SOA, Buckets>:     keys only
+ *      split<Key, Payload, SOA, Buckets>:  keys and payloads in two arrays
+ *      split<Key, Payload, AOS, Buckets>:  record_t<Key, Payload> array
+ * */
+template<typename Key, typename Payload, typename Layout, int Buckets>
+detail::split_ret_t<Payload, Layout, SOA, true>
+split(const Key *keys_in, Key *keys_out, uint64_t len, int shift, uint64_t *start) {
+    static_assert(std::is_integral<Key>::value, "split keys should be integers");
+    return detail::split_par<Buckets>(keys_in, (const detail::no_column_t*)nullptr,
+                                      keys_out, (detail::no_column_t*)nullptr, len, shift, start);
+}
+
+template<typename Key, typename Payload, typename Layout, int Buckets>
+detail::split_ret_t<Payload, Layout, SOA, false>
+split(const Key *keys_in, const Payload *payloads_in, Key *keys_out, Payload *payloads_out,
+      uint64_t len, int shift, uint64_t *start) {
+    static_assert(std::is_integral<Key>::value, "split keys should be integers");
+    return detail::split_par<Buckets>(keys_in, payloads_in, keys_out, payloads_out, len, shift, start);
+}
+
+template<typename Key, typename Payload, typename Layout, int Buckets>
+detail::split_ret_t<Payload, Layout, AOS, false>
+split(const record_t<Key, Payload> *records_in, record_t<Key, Payload> *records_out,
+      uint64_t len, int shift, uint64_t *start) {
+    static_assert(std::is_integral<Key>::value, "split keys should be integers");
+    return detail::split_par<Buckets>(records_in, (const detail::no_column_t*)nullptr,
+                                      records_out, (detail::no_column_t*)nullptr, len, shift, start);
+}
+
+/*
+ * exclusive scan on Op (REDUCE_SUM, REDUCE_MIN or REDUCE_MAX), reduce-then-scan
+ * on the thread pool, both passes on the partition of nthreads even if one of
+ * them runs on the caller (ThreadPool::run)
+ * */
+template<typename T, ReduceOp Op>
+double scan(const T *input, T *output, uint64_t len) {
+    static_assert(Op != REDUCE_COUNT, "no scan of REDUCE_COUNT");
+    typedef detail::scan_op<T, Op> op;
+    T reduce_res[MAX_THREAD_NUM];
+    Timer t;
+    ThreadPool &pool = ThreadPool::get();
+    int nthreads = pool.threads_for(len);
+
+    /*Reduce*/
+    reduce_res[0] = op::identity();
+    if (nthreads > 1) {
+        pool.run(nthreads, [&](int tid, int nthreads) {
+            T acc = op::identity();
+            uint64_t begin = len * tid / nthreads, end = len * (tid+1) / nthreads;
+            for(uint64_t i = begin; i < end; i++) acc = op::apply(acc, input[i]);
+            reduce_res[tid] = acc;
+        });
+        T acc = op::identity();
+        for(int i = 0; i < nthreads; i++) {
+            T temp = reduce_res[i];
+            reduce_res[i] = acc;
+            acc = op::apply(acc, temp);
+        }
+    }
+
+    /*Scan*/
+    pool.run(nthreads, [&](int tid, int nthreads) {
+        T acc = reduce_res[tid];
+        uint64_t begin = len * tid / nthreads, end = len * (tid+1) / nthreads;
+        for(uint64_t i = begin; i < end; i++) {
+            output[i] = acc;
+            acc = op::apply(acc, input[i]);
+        }
+    });
+    return t.elapsed()*1000;
+}
+
+/*gather (output[i] = input[idx[i]]) of any element and index types, chunks of indexes on the thread pool*/
+template<typename T, typename Idx>
+double gather(const T *input, T *output, const Idx *idx, uint64_t len) {
+    static_assert(std::is_integral<Idx>::value, "gather indexes should be integers");
+    Timer t;
+    ThreadPool::get().parallel_for(len, PRIM_POOL_GRAIN, [=](uint64_t begin, uint64_t end) {
+        for(uint64_t i = begin; i < end; i++) output[i] = input[idx[i]];
+    });
+    return t.elapsed()*1000;
+}
+
+} /*namespace prim*/
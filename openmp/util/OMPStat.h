@@ -0,0 +1,196 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+/*OpenMP memory and time stat classes, the counterparts of cuda/util/CUDAStat.cuh*/
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "log.h"
+
+/*memory statistics*/
+class OMPMemStat {
+private:
+    long cur_use; //current use of memory in bytes
+    long max_use; //maximum use of memory in bytes
+    long acc_use; //accumulated memory used in bytes
+    long untracked; //releases of arrays allocated outside of the wrappers
+
+    std::map<unsigned long, long> addr_bytes; //store the allocated address and sizes
+    std::mutex lock; //the wrappers are also called in parallel regions, e.g., per task in the join
+public:
+    OMPMemStat() {
+        reset();
+    }
+    void malloc_mem_stat(unsigned long addr, long add_bytes) {
+        std::lock_guard<std::mutex> guard(lock);
+        cur_use += add_bytes;
+        acc_use += add_bytes;
+        if (cur_use > max_use) {
+            max_use = cur_use;
+        }
+
+        /*record the allocated address and memory size*/
+        addr_bytes[addr] = add_bytes;
+    }
+    void delete_mem_stat(unsigned long addr) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto iter = addr_bytes.find(addr);
+        if (iter == addr_bytes.end()) {
+            untracked++;
+            return;
+        }
+
+        long delete_bytes = iter->second;
+        addr_bytes.erase(iter); //remove the address
+        cur_use -= delete_bytes;
+        assert(cur_use >= 0);
+    }
+    long get_max_use() {
+        return max_use;
+    }
+    long get_acc_use() {
+        return acc_use;
+    }
+    long get_cur_use() {
+        return cur_use;
+    }
+    long get_untracked() {
+        return untracked;
+    }
+    void reset() {
+        cur_use = 0;
+        max_use = 0;
+        acc_use = 0;
+        untracked = 0;
+
+        addr_bytes.clear();
+    }
+};
+
+/*
+ * time statistics of the timed regions, i.e., the parallel part of each
+ * primitive, keyed by the file and the function that opened the Timer
+ * */
+class OMPTimeStat {
+private:
+    uint32_t idx;                               //current start idx of the region interested
+    std::vector<std::string> file_name;         //name of the file of the region
+    std::vector<std::string> func_name;         //name of the function of the region
+    std::vector<float> region_time;             //region time in ms
+    std::mutex lock;
+
+public:
+    OMPTimeStat() {
+        idx = 0;
+    }
+
+    uint32_t get_idx() {
+        return region_time.size();
+    }
+
+    void reset() {
+        idx = (uint32_t)region_time.size();
+    }
+
+    float diff_time(uint32_t start_idx) {
+        float res = 0.0;
+        for(auto i = start_idx; i < (uint32_t)region_time.size(); i++)
+            res += this->region_time[i];
+        return res;
+    }
+
+    void insert_record(std::string file, std::string func, float time) {
+        std::lock_guard<std::mutex> guard(lock);
+        file_name.emplace_back(file);
+        func_name.emplace_back(func);
+        region_time.emplace_back(time);
+    }
+
+    /*calls and time of each (file, function) since the last reset, nested regions are reported on their own*/
+    void print() {
+        std::map<std::pair<std::string, std::string>, std::pair<int, double>> stages;
+        for(auto i = idx; i < (uint32_t)region_time.size(); i++) {
+            auto &stage = stages[std::make_pair(file_name[i], func_name[i])];
+            stage.first++;
+            stage.second += region_time[i];
+        }
+        for(auto &stage : stages) {
+            log_info("%s:%s, calls=%d, time=%.3f ms, average=%.3f ms",
+                     stage.first.first.c_str(), stage.first.second.c_str(), stage.second.first,
+                     stage.second.second, stage.second.second / stage.second.first);
+        }
+    }
+};
+
+/*end-of-run summary, registered on the first use of a stat with USE_STAT*/
+inline void omp_stat_print();
+
+inline void omp_stat_register() {
+#ifdef USE_STAT
+    static bool registered = (atexit(omp_stat_print) == 0);
+    (void)registered;
+#endif
+}
+
+/*
+ * Process-wide stats, filled only when compiled with USE_STAT: arrays of
+ * host_new/host_delete and alloc_huge_pages/free_huge_pages, and the regions
+ * timed by Timer. Never destroyed, so they outlive the summary at exit.
+ * */
+inline OMPMemStat &omp_mem_stat() {
+    static OMPMemStat *stat = new OMPMemStat();
+    omp_stat_register();
+    return *stat;
+}
+inline OMPTimeStat &omp_time_stat() {
+    static OMPTimeStat *stat = new OMPTimeStat();
+    omp_stat_register();
+    return *stat;
+}
+
+/*recording hooks of the wrappers, no-ops without USE_STAT*/
+#ifdef USE_STAT
+#define STAT_MALLOC(addr, bytes)        omp_mem_stat().malloc_mem_stat((unsigned long)(addr), (long)(bytes))
+#define STAT_FREE(addr)                 omp_mem_stat().delete_mem_stat((unsigned long)(addr))
+#define STAT_REGION(file, func, time)   omp_time_stat().insert_record( \
+        (strrchr(file, '/') ? strrchr(file, '/') + 1 : file), func, (float)(time))
+#else
+#define STAT_MALLOC(addr, bytes)
+#define STAT_FREE(addr)
+#define STAT_REGION(file, func, time)
+#endif
+
+/*tracked new[]/delete[] of the temporary arrays in the primitives*/
+template<typename T>
+T *host_new(uint64_t num) {
+    T *addr = new T[num];
+    STAT_MALLOC(addr, sizeof(T) * num);
+    return addr;
+}
+
+template<typename T>
+void host_delete(T *addr) {
+    if (addr == nullptr) return;
+    STAT_FREE(addr);
+    delete[] addr;
+}
+
+inline void omp_stat_print() {
+    log_info("------ Host memory: max=%.1f MB, accumulated=%.1f MB, current=%.1f MB ------",
+             omp_mem_stat().get_max_use() / 1024.0 / 1024,
+             omp_mem_stat().get_acc_use() / 1024.0 / 1024,
+             omp_mem_stat().get_cur_use() / 1024.0 / 1024);
+    if (omp_mem_stat().get_untracked() > 0)
+        log_warn("%ld arrays were released without being allocated by the wrappers",
+                 omp_mem_stat().get_untracked());
+    log_info("------ Timed regions ------");
+    omp_time_stat().print();
+}
@@ -0,0 +1,228 @@
+//
+// Cache hierarchy probe based on randomized pointer chasing.
+//
+#include "cache_probe.h"
+#include "log.h"
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <omp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+using namespace std;
+
+#define HUGE_PAGE_SIZE      (2*1024*1024)
+#define CHASE_MIN_STEPS     (1<<20)
+#define CHASE_MAX_STEPS     (1<<22)
+#define GATHER_MAX_PASSES   (32)        /*the index array is read in every pass*/
+
+/*
+ * Link one node every @stride bytes into a single random cycle,
+ * so that the hardware prefetchers cannot predict the next address
+ * */
+static void build_chain(char *buf, uint64_t slots, uint64_t stride, unsigned seed) {
+    vector<uint64_t> order(slots);
+    for(uint64_t i = 0; i < slots; i++) order[i] = i;
+    mt19937_64 gen(seed);
+    for(uint64_t i = slots-1; i > 0; i--) {  /*Fisher-Yates*/
+        uniform_int_distribution<uint64_t> dist(0, i);
+        swap(order[i], order[dist(gen)]);
+    }
+    for(uint64_t i = 0; i < slots; i++) {
+        char *cur = buf + order[i] * stride;
+        char *next = buf + order[(i+1) % slots] * stride;
+        *(char**)cur = next;
+    }
+}
+
+static char *alloc_chain(uint64_t bytes, PageType page) {
+    void *buf = nullptr;
+    size_t padded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (posix_memalign(&buf, HUGE_PAGE_SIZE, padded) != 0) return nullptr;
+#ifdef MADV_HUGEPAGE
+    if (page == PAGE_HUGE)          madvise(buf, padded, MADV_HUGEPAGE);
+    else if (page == PAGE_SMALL)    madvise(buf, padded, MADV_NOHUGEPAGE);
+#endif
+    return (char*)buf;
+}
+
+/*ns per dependent load*/
+static double chase(char *start, uint64_t steps) {
+    char *p = start;
+    for(uint64_t s = 0; s < steps; s++) p = *(char**)p;     /*warm-up*/
+
+    auto beg = chrono::steady_clock::now();
+    for(uint64_t s = 0; s < steps; s += 8) {
+        p = *(char**)p; p = *(char**)p; p = *(char**)p; p = *(char**)p;
+        p = *(char**)p; p = *(char**)p; p = *(char**)p; p = *(char**)p;
+    }
+    auto end = chrono::steady_clock::now();
+
+    /*keep the chain alive*/
+    static char * volatile sink;
+    sink = p;
+    return chrono::duration<double, nano>(end - beg).count() / steps;
+}
+
+double chase_latency(uint64_t bytes, uint64_t stride, PageType page,
+                     int threads, double *per_thread_latency) {
+    if (stride < sizeof(char*)) stride = sizeof(char*);
+    uint64_t slots = std::max<uint64_t>(bytes / stride, 2);
+    uint64_t steps = std::min<uint64_t>(std::max<uint64_t>(slots*4, CHASE_MIN_STEPS), CHASE_MAX_STEPS);
+    double total = 0;
+    bool failed = false;
+
+#pragma omp parallel num_threads(threads) reduction(+:total) reduction(||:failed)
+    {
+        int tid = omp_get_thread_num();
+        char *buf = alloc_chain(slots*stride, page);  /*first touch by the chasing thread*/
+        if (buf != nullptr) build_chain(buf, slots, stride, 1234 + tid);
+#pragma omp barrier     /*all the chains are built before chasing*/
+        if (buf == nullptr) {
+            failed = true;
+        }
+        else {
+            double latency = chase(buf, steps);
+            if (per_thread_latency) per_thread_latency[tid] = latency;
+            total += latency;
+            free(buf);
+        }
+    }
+    if (failed) {
+        log_error("Failed to allocate the chain of %llu bytes", (unsigned long long)bytes);
+        return -1;
+    }
+    return total / threads;
+}
+
+vector<latency_point_t> latency_curve(uint64_t min_bytes, uint64_t max_bytes,
+                                      uint64_t stride, PageType page,
+                                      int threads, int steps_per_double) {
+    vector<latency_point_t> curve;
+    double factor = pow(2.0, 1.0 / steps_per_double);
+    for(double bytes = (double)min_bytes; bytes <= (double)max_bytes * 1.0001; bytes *= factor) {
+        latency_point_t point;
+        point.bytes = (uint64_t)bytes / stride * stride;
+        point.latency = chase_latency(point.bytes, stride, page, threads);
+        curve.emplace_back(point);
+    }
+    return curve;
+}
+
+/*
+ * A level ends where the latency rises above 1.5x the current plateau;
+ * the next plateau starts when the latency stops growing (< 10% per point)
+ * */
+cache_info_t detect_cache_levels(const vector<latency_point_t> &curve) {
+    cache_info_t info = cache_info_sysconf();
+    if (curve.size() < 2) return info;
+
+    vector<uint64_t> bounds;
+    double plateau = curve[0].latency;
+    bool rising = false;
+    for(size_t i = 1; i < curve.size(); i++) {
+        if (!rising && curve[i].latency > 1.5 * plateau) {
+            bounds.emplace_back(curve[i-1].bytes);
+            rising = true;
+        }
+        else if (rising && curve[i].latency < 1.1 * curve[i-1].latency) {
+            rising = false;
+            plateau = curve[i].latency;
+        }
+    }
+
+    if (bounds.size() >= 3) {
+        info.l1_size = bounds[0];
+        info.l2_size = bounds[1];
+        info.llc_size = bounds[2];
+    }
+    else if (bounds.size() == 2) {  /*no separate L2, or L2 and LLC not distinguishable*/
+        info.l1_size = bounds[0];
+        info.llc_size = bounds[1];
+        if (info.l2_size <= info.l1_size || info.l2_size > info.llc_size) info.l2_size = info.llc_size;
+    }
+    else if (bounds.size() == 1) {
+        info.l1_size = bounds[0];
+    }
+    info.probed = !bounds.empty();
+    return info;
+}
+
+cache_info_t cache_info_sysconf() {
+    cache_info_t info;
+    long l1 = 0, l2 = 0, l3 = 0, line = 0;
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+#endif
+    info.l1_size = (l1 > 0) ? l1 : 32*1024;
+    info.l2_size = (l2 > 0) ? l2 : 1024*1024;
+    info.llc_size = (l3 > 0) ? l3 : info.l2_size;
+    info.cacheline_size = (line > 0) ? line : 64;
+    info.probed = false;
+    return info;
+}
+
+/*the sysconf sizes, replaced by the probed ones saved in the CACHE_INFO file if there are some*/
+static cache_info_t load_cache_info() {
+    cache_info_t info = cache_info_sysconf();
+    const char *path = getenv("CACHE_INFO");
+    if (path == nullptr) return info;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr) return info;
+    unsigned long long l1, l2, llc, line;
+    if (fscanf(fp, "%llu %llu %llu %llu", &l1, &l2, &llc, &line) == 4 && l1 > 0 && l2 > 0 && llc > 0 && line > 0) {
+        info.l1_size = l1;
+        info.l2_size = l2;
+        info.llc_size = llc;
+        info.cacheline_size = line;
+        info.probed = true;
+        log_trace("Cache sizes from %s: L1=%llu, L2=%llu, LLC=%llu", path, l1, l2, llc);
+    }
+    else log_warn("Ignoring the malformed cache sizes in %s", path);
+    fclose(fp);
+    return info;
+}
+
+static cache_info_t &cur_cache_info() {
+    static cache_info_t info = load_cache_info();
+    return info;
+}
+
+const cache_info_t &get_cache_info() {
+    return cur_cache_info();
+}
+
+void set_cache_info(const cache_info_t &info) {
+    cur_cache_info() = info;
+    const char *path = getenv("CACHE_INFO");
+    if (!info.probed || path == nullptr) return;
+
+    FILE *fp = fopen(path, "w");
+    if (fp == nullptr) {
+        log_warn("Cannot save the cache sizes to %s", path);
+        return;
+    }
+    fprintf(fp, "%llu %llu %llu %llu\n", (unsigned long long)info.l1_size, (unsigned long long)info.l2_size,
+            (unsigned long long)info.llc_size, (unsigned long long)info.cacheline_size);
+    fclose(fp);
+}
+
+int gather_passes(uint64_t input_bytes, const cache_info_t &info) {
+    uint64_t budget = std::max<uint64_t>(info.llc_size / 2, 1);
+    uint64_t passes = (input_bytes + budget - 1) / budget;
+    return (int)std::min<uint64_t>(std::max<uint64_t>(passes, 1), GATHER_MAX_PASSES);
+}
+
+int split_fanout_bits(const cache_info_t &info) {
+    uint64_t lines = info.l1_size / 2 / info.cacheline_size;
+    int bits = 0;
+    while ((2ull << bits) <= lines) bits++;
+    return std::max(bits, 1);
+}
@@ -0,0 +1,64 @@
+//
+// Cache hierarchy probe based on randomized pointer chasing.
+//
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum PageType {
+    PAGE_DEFAULT,       /*whatever the system gives (THP may apply)*/
+    PAGE_SMALL,         /*madvise(MADV_NOHUGEPAGE), TLB misses included*/
+    PAGE_HUGE           /*madvise(MADV_HUGEPAGE), mostly free of TLB misses*/
+};
+
+struct cache_info_t {
+    uint64_t    l1_size;            /*in bytes*/
+    uint64_t    l2_size;
+    uint64_t    llc_size;
+    uint64_t    cacheline_size;
+    bool        probed;             /*false if the sizes come from sysconf*/
+};
+
+struct latency_point_t {
+    uint64_t    bytes;              /*working set*/
+    double      latency;            /*ns per dependent load, averaged over the threads*/
+};
+
+/*
+ * Chase a random single-cycle chain over a working set of @bytes, with one
+ * node every @stride bytes.
+ * With @threads > 1, every thread chases its private chain of the same size
+ * concurrently (loaded latency); per-thread latencies are stored to
+ * @per_thread_latency if it is not null.
+ * Returns the average latency in ns.
+ * */
+double chase_latency(uint64_t bytes, uint64_t stride, PageType page,
+                     int threads=1, double *per_thread_latency=nullptr);
+
+/*latency of working sets from @min_bytes to @max_bytes, @steps_per_double points per doubling*/
+std::vector<latency_point_t> latency_curve(uint64_t min_bytes, uint64_t max_bytes,
+                                           uint64_t stride, PageType page,
+                                           int threads=1, int steps_per_double=2);
+
+/*find the L1/L2/LLC/DRAM transitions on a curve, falling back to sysconf for the missing levels*/
+cache_info_t detect_cache_levels(const std::vector<latency_point_t> &curve);
+
+/*cache sizes reported by the OS (sysconf), with common defaults if unavailable*/
+cache_info_t cache_info_sysconf();
+
+/*
+ * Process-wide cache sizes used to configure the primitives.
+ * From sysconf unless set_cache_info is called with probed values. With the
+ * environment variable CACHE_INFO set to a file path, set_cache_info saves
+ * probed values to that file and get_cache_info loads them from it, so that
+ * the sizes probed once by test_latency_CPU are used by every process.
+ * */
+const cache_info_t &get_cache_info();
+void set_cache_info(const cache_info_t &info);
+
+/*number of passes so that the input range touched by each gather pass fits in half of the LLC (at most 32)*/
+int gather_passes(uint64_t input_bytes, const cache_info_t &info);
+
+/*radix bits per split pass so that one cache line per bucket fits in half of the L1*/
+int split_fanout_bits(const cache_info_t &info);
@@ -0,0 +1,60 @@
+//
+// Binary column files and the dataset cache of the benchmarks.
+//
+#pragma once
+
+#include <cstdint>
+
+/*
+ * File layout: a column_file_header_t, then num_columns columns of length
+ * elements of ele_size bytes, each starting at a multiple of
+ * COLUMN_FILE_ALIGN from the file start. The columns of a mapped file are thus
+ * page-aligned and can be used in place (e.g. wrapped by zero-copy buffers).
+ * */
+#define COLUMN_FILE_MAGIC       (0x4c4f4345)    /*"ECOL"*/
+#define COLUMN_FILE_VERSION     (1)
+#define COLUMN_FILE_ALIGN       (4096)
+#define COLUMN_FILE_MAX_COLUMNS (16)
+
+struct column_file_header_t {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    num_columns;
+    uint32_t    ele_size;                           /*bytes per element*/
+    uint64_t    length;                             /*elements per column*/
+    uint64_t    offsets[COLUMN_FILE_MAX_COLUMNS];   /*byte offset of each column*/
+};
+
+struct column_file_t {
+    void                        *addr = nullptr;    /*the whole mapped file*/
+    uint64_t                    bytes = 0;
+    const column_file_header_t  *header = nullptr;
+
+    uint64_t length() const     { return header->length; }
+    int num_columns() const     { return (int)header->num_columns; }
+    const void *column(int c) const { return (const char*)addr + header->offsets[c]; }
+};
+
+/*write num_columns columns of length elements, via a temporary file renamed at the end*/
+bool column_file_write(const char *path, const void *const *columns, int num_columns,
+                       uint64_t length, int ele_size=sizeof(int));
+
+/*
+ * Map a column file read-only, with all pages populated up front so the first
+ * pass over the columns is not timed with page faults (a writable private
+ * mapping would copy every page when populated)
+ * */
+bool column_file_map(const char *path, column_file_t &file);
+void column_file_unmap(column_file_t &file);
+
+/*copy the first length ints of column c of the file to keys, false if the file is shorter*/
+bool column_file_read(const char *path, int c, int *keys, uint64_t length);
+
+/*
+ * Dataset cache: with the environment variable DATASET_CACHE set to a
+ * directory, the random generators (utility.h) load their output from
+ * <DATASET_CACHE>/<name>.col, named after the distribution, length,
+ * parameters and seed, and write it there when it is missing.
+ * */
+bool dataset_cache_load(const char *name, int *keys, uint64_t length);
+void dataset_cache_store(const char *name, const int *keys, uint64_t length);
@@ -0,0 +1,218 @@
+//
+// Hardware performance counters of the timed regions (Linux perf_event_open).
+//
+#include "perf_counter.h"
+#include "log.h"
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <omp.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+static const char *event_names[PERF_NUM_EVENTS] = {
+        "cycles", "instructions", "LLC-misses", "dTLB-misses", "backend-stalls"
+};
+
+static vector<int> perf_fds;    /*[thread * PERF_NUM_EVENTS + event], -1 if unavailable*/
+static vector<pid_t> perf_extra_tids;   /*threads outside the OpenMP pool, e.g., the ThreadPool workers*/
+static int perf_threads = 0;    /*OpenMP threads with open counters*/
+static int perf_generation = 0;     /*bumped when the counters are reopened, invalidates the open marks*/
+static bool perf_failed = false;
+static perf_sample_t last_sample;
+static mutex perf_lock;             /*the regions of concurrent TaskGraph nodes*/
+
+#ifdef __linux__
+static void set_event(perf_event_attr &attr, int event) {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+        case PERF_CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_BACKEND_STALLS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
+            break;
+    }
+}
+
+/*open and start the counters of a thread, returns the number opened*/
+static int perf_open_thread(pid_t tid) {
+    int opened = 0;
+    for(int e = 0; e < PERF_NUM_EVENTS; e++) {
+        perf_event_attr attr;
+        set_event(attr, e);
+        int fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+        perf_fds.emplace_back(fd);
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            opened++;
+        }
+    }
+    return opened;
+}
+
+/*open the counters on every thread of the OpenMP pool and on the added threads*/
+static bool perf_init() {
+    int num_threads = omp_get_max_threads();
+    if (perf_threads >= num_threads) return true;      /*TaskGraph nodes run on fewer threads*/
+    if (perf_failed) return false;
+
+    for(auto fd : perf_fds) if (fd >= 0) close(fd);
+    perf_fds.clear();
+    perf_generation++;
+
+    /*the OpenMP runtime keeps the same worker threads across parallel regions*/
+    vector<pid_t> tids(num_threads, 0);
+#pragma omp parallel num_threads(num_threads)
+    {
+        tids[omp_get_thread_num()] = (pid_t)syscall(SYS_gettid);
+    }
+
+    int opened = 0;
+    for(auto tid : tids) opened += perf_open_thread(tid);
+    for(auto tid : perf_extra_tids) opened += perf_open_thread(tid);
+    if (opened == 0) {
+        log_warn("Hardware counters unavailable, check /proc/sys/kernel/perf_event_paranoid");
+        perf_failed = true;
+        perf_fds.clear();
+        return false;
+    }
+    perf_threads = num_threads;
+    return true;
+}
+
+/*value, time_enabled, time_running of each counter, all 0 for the unavailable ones*/
+static void perf_read(vector<uint64_t> &readings) {
+    readings.assign(perf_fds.size() * 3, 0);
+    for(size_t i = 0; i < perf_fds.size(); i++) {
+        if (perf_fds[i] < 0 || read(perf_fds[i], &readings[i*3], sizeof(uint64_t)*3) != sizeof(uint64_t)*3)
+            readings[i*3] = readings[i*3+1] = readings[i*3+2] = 0;
+    }
+}
+
+void perf_add_thread() {
+    lock_guard<mutex> guard(perf_lock);
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    perf_extra_tids.emplace_back(tid);
+    if (perf_threads > 0) perf_open_thread(tid);   /*counted from the next begin on*/
+}
+
+void perf_begin(perf_mark_t &mark) {
+    lock_guard<mutex> guard(perf_lock);
+    mark.generation = -1;
+    if (!perf_init()) return;
+    mark.generation = perf_generation;
+    perf_read(mark.readings);
+}
+
+void perf_end(const perf_mark_t &mark) {
+    lock_guard<mutex> guard(perf_lock);
+    perf_clear(last_sample);
+    if (perf_threads == 0 || mark.generation != perf_generation) return;
+
+    vector<uint64_t> readings;
+    perf_read(readings);
+    for(size_t t = 0; t < perf_fds.size() / PERF_NUM_EVENTS; t++) {
+        for(int e = 0; e < PERF_NUM_EVENTS; e++) {
+            size_t i = t*PERF_NUM_EVENTS+e;
+            if (perf_fds[i] < 0 || i*3 >= mark.readings.size()) continue;
+            uint64_t value = readings[i*3] - mark.readings[i*3];
+            uint64_t enabled = readings[i*3+1] - mark.readings[i*3+1];
+            uint64_t running = readings[i*3+2] - mark.readings[i*3+2];
+
+            /*scale the value if the PMU was multiplexed*/
+            double scaled = (double)value;
+            if (running != 0 && running < enabled) scaled *= (double)enabled / running;
+            last_sample.values[e] += (uint64_t)scaled;
+            last_sample.available[e] = true;
+            last_sample.valid = true;
+        }
+    }
+}
+#else
+void perf_add_thread() {}
+
+void perf_begin(perf_mark_t &mark) {
+    mark.generation = -1;
+    if (!perf_failed) log_warn("Hardware counters are only supported on Linux");
+    perf_failed = true;
+}
+void perf_end(const perf_mark_t &) { perf_clear(last_sample); }
+#endif
+
+perf_sample_t perf_last_sample() {
+    return last_sample;
+}
+
+void perf_clear(perf_sample_t &sample) {
+    sample.valid = false;
+    for(int e = 0; e < PERF_NUM_EVENTS; e++) {
+        sample.available[e] = false;
+        sample.values[e] = 0;
+    }
+}
+
+void perf_accumulate(perf_sample_t &acc, const perf_sample_t &sample) {
+    if (!sample.valid) return;
+    for(int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (!sample.available[e]) continue;
+        acc.values[e] += sample.values[e];
+        acc.available[e] = true;
+    }
+    acc.valid = true;
+}
+
+void perf_print(const char *name, const perf_sample_t &sample, int runs, uint64_t elements) {
+    if (!sample.valid || runs <= 0) return;
+    double total_ele = (double)elements * runs;
+    char buffer[500] = {'\0'};
+    int pos = 0;
+
+    for(int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (!sample.available[e]) continue;
+        pos += snprintf(buffer+pos, sizeof(buffer)-pos, "%s/ele=%.3f, ",
+                        event_names[e], sample.values[e] / total_ele);
+    }
+    /*derived metrics*/
+    if (sample.available[PERF_CYCLES] && sample.values[PERF_CYCLES] != 0) {
+        double cycles = (double)sample.values[PERF_CYCLES];
+        if (sample.available[PERF_INSTRUCTIONS])
+            pos += snprintf(buffer+pos, sizeof(buffer)-pos, "IPC=%.2f, ",
+                            sample.values[PERF_INSTRUCTIONS] / cycles);
+        if (sample.available[PERF_BACKEND_STALLS])
+            pos += snprintf(buffer+pos, sizeof(buffer)-pos, "backend-bound=%.1f%%, ",
+                            100.0 * sample.values[PERF_BACKEND_STALLS] / cycles);
+    }
+    if (pos >= 2) buffer[pos-2] = '\0'; /*remove the last ", "*/
+    log_info("Counters of %s: %s", name, buffer);
+}
@@ -0,0 +1,50 @@
+//
+// Hardware performance counters of the timed regions (Linux perf_event_open).
+//
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum PerfEvent {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_BACKEND_STALLS,    /*cycles stalled in the back-end, i.e., memory-bound*/
+    PERF_NUM_EVENTS
+};
+
+/*counter values of a region, summed over all the OpenMP threads and the added threads*/
+struct perf_sample_t {
+    bool        valid;                          /*false if no counter could be read*/
+    bool        available[PERF_NUM_EVENTS];     /*per-event, some events are not supported on every CPU*/
+    uint64_t    values[PERF_NUM_EVENTS];        /*scaled if the counters were multiplexed*/
+};
+
+/*counter readings at the beginning of a region*/
+struct perf_mark_t {
+    int                     generation;         /*of the open counters, -1 if none*/
+    std::vector<uint64_t>   readings;           /*value, time_enabled, time_running of each counter*/
+};
+
+/*
+ * The counters are opened lazily on each OpenMP worker thread at the first begin,
+ * and kept open and running for the rest of the run. A region is the difference
+ * of the readings at its end and at its begin (@mark), so regions can be nested,
+ * e.g., the primitives run by TaskGraph::run.
+ * Without permission (perf_event_paranoid) or PMU support, samples are invalid
+ * and a warning is printed once.
+ * */
+void perf_begin(perf_mark_t &mark);
+void perf_add_thread();                         /*also count the calling thread, for threads outside OpenMP*/
+void perf_end(const perf_mark_t &mark);         /*the sample is kept as the last sample*/
+perf_sample_t perf_last_sample();
+void perf_accumulate(perf_sample_t &acc, const perf_sample_t &sample);
+void perf_clear(perf_sample_t &sample);
+
+/*
+ * Log the counters of @runs runs, each processing @elements elements
+ * Prints nothing if the sample is invalid.
+ * */
+void perf_print(const char *name, const perf_sample_t &sample, int runs, uint64_t elements);
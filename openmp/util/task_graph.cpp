@@ -0,0 +1,157 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <thread>
+#include <algorithm>
+#include "task_graph.h"
+#include "timer.h"
+#include "log.h"
+using namespace std;
+
+TaskGraph::TaskGraph(int max_concurrency) : max_concurrency_(std::max(max_concurrency, 1)) {}
+
+TaskGraph::~TaskGraph() {
+    for(auto &b : buffers_) host_delete(b.addr);
+    free_spares();
+}
+
+char *TaskGraph::acquire(uint64_t bytes) {
+    for(size_t s = 0; s < spares_.size(); s++) {
+        if (spares_[s].first == bytes) {
+            char *addr = spares_[s].second;
+            spares_.erase(spares_.begin() + s);
+            return addr;
+        }
+    }
+    free_spares();      /*no spare fits, they would only add to the peak*/
+    cur_bytes_ += bytes;
+    peak_bytes_ = std::max(peak_bytes_, cur_bytes_);
+    return host_new<char>(bytes);
+}
+
+void TaskGraph::free_spares() {
+    for(auto &s : spares_) {
+        host_delete(s.second);
+        cur_bytes_ -= s.first;
+    }
+    spares_.clear();
+}
+
+int TaskGraph::add_buffer(uint64_t bytes) {
+    buffer_t b;
+    b.bytes = bytes;
+    b.addr = nullptr;
+    b.last_writer = -1;
+    b.users = 0;
+    b.remaining = 0;
+    buffers_.emplace_back(b);
+    return (int)buffers_.size() - 1;
+}
+
+int TaskGraph::add_node(const char *name, node_func_t func,
+                        const vector<int> &inputs, const vector<int> &outputs) {
+    int id = (int)nodes_.size();
+    node_t node;
+    node.name = name;
+    node.func = func;
+    node.predecessors = 0;
+    node.pending = 0;
+
+    vector<int> preds;
+    for(int b : inputs) {           /*read after write*/
+        if (buffers_[b].last_writer >= 0) preds.emplace_back(buffers_[b].last_writer);
+    }
+    for(int b : outputs) {          /*write after read and write after write*/
+        auto &buf = buffers_[b];
+        preds.insert(preds.end(), buf.readers.begin(), buf.readers.end());
+        if (buf.last_writer >= 0) preds.emplace_back(buf.last_writer);
+    }
+    sort(preds.begin(), preds.end());
+    preds.erase(unique(preds.begin(), preds.end()), preds.end());
+    for(int p : preds) {
+        nodes_[p].successors.emplace_back(id);
+        node.predecessors++;
+    }
+
+    for(int b : inputs) buffers_[b].readers.emplace_back(id);
+    for(int b : outputs) {
+        buffers_[b].last_writer = id;
+        buffers_[b].readers.clear();
+    }
+    node.buffers = inputs;
+    node.buffers.insert(node.buffers.end(), outputs.begin(), outputs.end());
+    sort(node.buffers.begin(), node.buffers.end());
+    node.buffers.erase(unique(node.buffers.begin(), node.buffers.end()), node.buffers.end());
+    for(int b : node.buffers) buffers_[b].users++;
+
+    nodes_.emplace_back(node);
+    return id;
+}
+
+/*take ready nodes until all the nodes are finished*/
+void TaskGraph::executor() {
+    unique_lock<mutex> lock(lock_);
+    while (true) {
+        cv_.wait(lock, [&] { return !ready_.empty() || finished_ == (int)nodes_.size(); });
+        if (ready_.empty()) return;
+        int id = ready_.back();
+        ready_.pop_back();
+        auto &node = nodes_[id];
+
+        for(int b : node.buffers) {
+            auto &buf = buffers_[b];
+            if (buf.addr == nullptr && buf.bytes > 0) buf.addr = acquire(buf.bytes);
+        }
+        running_++;
+        int sharing = std::min(running_ + (int)ready_.size(), max_concurrency_);
+        omp_set_num_threads(std::max(total_threads_ / sharing, 1));
+        lock.unlock();
+
+        log_trace("Task graph: running %s", node.name.c_str());
+        node.func();
+
+        lock.lock();
+        running_--;
+        finished_++;
+        for(int b : node.buffers) {
+            auto &buf = buffers_[b];
+            if (--buf.remaining == 0 && buf.addr != nullptr) {
+                spares_.emplace_back(buf.bytes, buf.addr);
+                buf.addr = nullptr;
+            }
+        }
+        for(int s : node.successors) {
+            if (--nodes_[s].pending == 0) ready_.emplace_back(s);
+        }
+        cv_.notify_all();
+    }
+}
+
+double TaskGraph::run() {
+    total_threads_ = omp_get_max_threads();
+    cur_bytes_ = peak_bytes_ = 0;
+    running_ = finished_ = 0;
+    ready_.clear();
+    for(auto &b : buffers_) b.remaining = b.users;
+    for(int i = (int)nodes_.size() - 1; i >= 0; i--) {     /*the first added nodes are taken first*/
+        nodes_[i].pending = nodes_[i].predecessors;
+        if (nodes_[i].pending == 0) ready_.emplace_back(i);
+    }
+    Timer t;
+
+    vector<thread> threads;
+    for(int i = 1; i < max_concurrency_; i++) {
+        threads.emplace_back([this] {
+            executor();
+        });
+    }
+    executor();
+    for(auto &th : threads) th.join();
+    free_spares();
+
+    double elapsed = t.elapsed()*1000;
+    omp_set_num_threads(total_threads_);    /*the calling thread was an executor*/
+    return elapsed;
+}
@@ -0,0 +1,92 @@
+//
+// DAG executor composing the primitives into plans.
+//
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <utility>
+
+/*
+ * Nodes are functions (usually primitive calls) that declare the buffers they
+ * read and write. As with OpenMP task dependences, a node waits for the
+ * earlier nodes (in the order they were added) that write its inputs, and for
+ * those that read or write its outputs.
+ *
+ * Ready nodes run concurrently on up to max_concurrency threads. Each node
+ * runs its OpenMP regions with an even share of the omp_get_max_threads()
+ * threads among the nodes running or ready when it starts.
+ *
+ * Buffers are owned by the graph. Each one is allocated (host_new) just
+ * before the first node using it starts, and is released once the last node
+ * using it finishes, so intermediate results live only as long as needed.
+ * A released buffer is kept as a spare and given to the next buffer of the
+ * same size, e.g., the partitions of the next pass of a multi-pass join. The
+ * spares are freed when a buffer finds none of its size and at the end of the
+ * run, so the peak is the one of freeing the buffers right away.
+ * A buffer of 0 bytes only orders the nodes.
+ *
+ * The executor threads other than the caller of run(), and the OpenMP threads
+ * of their nodes, are not added to the USE_PERF counters (perf_counter.h) as
+ * the ThreadPool workers are, so the counters of a run only cover part of it.
+ * */
+class TaskGraph {
+public:
+    typedef std::function<void()> node_func_t;
+
+    explicit TaskGraph(int max_concurrency=2);
+    ~TaskGraph();
+
+    int add_buffer(uint64_t bytes);
+    int add_node(const char *name, node_func_t func,
+                 const std::vector<int> &inputs, const std::vector<int> &outputs);
+
+    /*address of a buffer, valid in the nodes using it*/
+    template<typename T>
+    T *get(int buffer) const { return (T*)buffers_[buffer].addr; }
+
+    /*run all the nodes once, returns the elapsed time in ms*/
+    double run();
+
+    /*largest total size of the allocated buffers during the last run*/
+    uint64_t peak_bytes() const { return peak_bytes_; }
+
+private:
+    struct buffer_t {
+        uint64_t bytes;
+        char *addr;
+        int last_writer;                /*while adding nodes, -1 if none*/
+        std::vector<int> readers;       /*since the last writer*/
+        int users;                      /*nodes using the buffer*/
+        int remaining;                  /*users not finished in the current run*/
+    };
+    struct node_t {
+        std::string name;
+        node_func_t func;
+        std::vector<int> buffers;       /*inputs and outputs, without duplicates*/
+        std::vector<int> successors;
+        int predecessors;
+        int pending;                    /*predecessors not finished in the current run*/
+    };
+
+    void executor();
+    char *acquire(uint64_t bytes);      /*a spare of bytes bytes, or a new allocation*/
+    void free_spares();
+
+    int max_concurrency_;
+    std::vector<buffer_t> buffers_;
+    std::vector<node_t> nodes_;
+    uint64_t cur_bytes_ = 0, peak_bytes_ = 0;   /*the spares included*/
+    std::vector<std::pair<uint64_t, char*>> spares_;   /*released buffers, (bytes, addr)*/
+
+    /*state of the current run*/
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::vector<int> ready_;
+    int running_ = 0, finished_ = 0;
+    int total_threads_ = 1;
+};
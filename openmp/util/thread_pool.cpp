@@ -0,0 +1,190 @@
+//
+//  Created by Zhuohang Lai on 4/7/15.
+//  Copyright (c) 2015 Zhuohang Lai. All rights reserved.
+//
+#include <omp.h>
+#include <chrono>
+#include <algorithm>
+#include <immintrin.h>
+#include "thread_pool.h"
+#include "log.h"
+#ifdef USE_PERF
+#include "perf_counter.h"
+#endif
+using namespace std;
+
+#define CALIBRATE_LEN       (1<<14)     /*ints of the streaming loop timed for the threshold*/
+#define CALIBRATE_TIMES     (64)
+
+static thread_local bool in_pool_job = false;
+
+/*read before main, the TaskGraph executors lower the max of their OpenMP threads*/
+static const int initial_max_threads = omp_get_max_threads();
+
+/*pause, and give the core away now and then in case the threads outnumber the cores*/
+static inline void spin_pause(int spins) {
+    if ((spins & 63) == 63) this_thread::yield();
+    else _mm_pause();
+}
+
+static inline uint64_t pack_range(uint64_t begin, uint64_t end) { return (begin << 32) | end; }
+
+ThreadPool &ThreadPool::get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool() {
+    nthreads_ = std::max(1, initial_max_threads);
+    threshold_ = UINT64_MAX;
+    slots_ = vector<slot_t>(nthreads_);
+    for(int t = 1; t < nthreads_; t++) threads_.emplace_back(&ThreadPool::worker, this, t);
+    if (nthreads_ > 1) calibrate();
+    log_trace("Thread pool: %d threads, serial threshold %llu", nthreads_, (unsigned long long)threshold_);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(park_lock_);
+        stop_ = true;
+    }
+    park_cv_.notify_all();
+    for(auto &t : threads_) t.join();
+}
+
+/*median time of an empty dispatch against the time per element of a copy loop in the L1*/
+void ThreadPool::calibrate() {
+    typedef chrono::high_resolution_clock clock_;
+    vector<double> dispatch_ns(CALIBRATE_TIMES), element_ns(CALIBRATE_TIMES);
+    vector<int> in(CALIBRATE_LEN, 1), out(CALIBRATE_LEN);
+
+    for(int e = 0; e < CALIBRATE_TIMES; e++) {
+        auto beg = clock_::now();
+        run(nthreads_, [](int, int) {});
+        dispatch_ns[e] = chrono::duration<double, nano>(clock_::now() - beg).count();
+
+        beg = clock_::now();
+        for(int i = 0; i < CALIBRATE_LEN; i++) out[i] = in[i] + e;
+        element_ns[e] = chrono::duration<double, nano>(clock_::now() - beg).count() / CALIBRATE_LEN;
+    }
+    sort(dispatch_ns.begin(), dispatch_ns.end());
+    sort(element_ns.begin(), element_ns.end());
+    double per_element = std::max(element_ns[CALIBRATE_TIMES/2], 1e-3);
+    threshold_ = std::max((uint64_t)(dispatch_ns[CALIBRATE_TIMES/2] / per_element), (uint64_t)POOL_MIN_THRESHOLD);
+}
+
+void ThreadPool::worker(int tid) {
+    in_pool_job = true;
+#ifdef USE_PERF
+    perf_add_thread();
+#endif
+    uint64_t seen = 0;
+    while (true) {
+        /*spin, then park until the next job*/
+        int spins = 0;
+        while (epoch_.load(memory_order_acquire) == seen && !stop_.load(memory_order_relaxed)) {
+            if (spins < POOL_SPIN_ITERS) {
+                spin_pause(spins++);
+                continue;
+            }
+            unique_lock<mutex> lock(park_lock_);
+            parked_++;
+            park_cv_.wait(lock, [&] { return epoch_.load() != seen || stop_.load(); });
+            parked_--;
+        }
+        if (stop_) return;
+        seen = epoch_.load(memory_order_acquire);
+        execute(tid);
+        pending_.fetch_sub(1, memory_order_release);
+    }
+}
+
+void ThreadPool::dispatch() {
+    pending_.store(nthreads_ - 1, memory_order_relaxed);
+    epoch_.fetch_add(1);                /*seq_cst, ordered with parked_ against the parking workers*/
+    if (parked_.load() > 0) {
+        lock_guard<mutex> guard(park_lock_);
+        park_cv_.notify_all();
+    }
+    in_pool_job = true;
+    execute(0);
+    in_pool_job = false;
+    for(int spins = 0; pending_.load(memory_order_acquire) > 0; spins++) spin_pause(spins);
+}
+
+void ThreadPool::execute(int tid) {
+    if (thread_func_ != nullptr) {
+        (*thread_func_)(tid, nthreads_);
+        return;
+    }
+    uint64_t chunk;
+    do {
+        while (pop_chunk(tid, chunk))
+            (*range_func_)(chunk * grain_, std::min((chunk + 1) * grain_, len_));
+    } while (steal_chunks(tid));
+}
+
+/*take the first chunk of the own range*/
+bool ThreadPool::pop_chunk(int tid, uint64_t &chunk) {
+    auto &range = slots_[tid].range;
+    uint64_t r = range.load(memory_order_relaxed);
+    while (true) {
+        uint64_t begin = r >> 32, end = r & 0xffffffff;
+        if (begin >= end) return false;
+        if (range.compare_exchange_weak(r, pack_range(begin + 1, end), memory_order_acquire)) {
+            chunk = begin;
+            return true;
+        }
+    }
+}
+
+/*move the back half of the range of another thread to the own (empty) range*/
+bool ThreadPool::steal_chunks(int tid) {
+    for(int v = 1; v < nthreads_; v++) {
+        auto &range = slots_[(tid + v) % nthreads_].range;
+        uint64_t r = range.load(memory_order_relaxed);
+        while (true) {
+            uint64_t begin = r >> 32, end = r & 0xffffffff;
+            if (begin >= end) break;
+            uint64_t take = (end - begin + 1) / 2;
+            if (range.compare_exchange_weak(r, pack_range(begin, end - take), memory_order_acquire)) {
+                slots_[tid].range.store(pack_range(end - take, end), memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ThreadPool::parallel_for(uint64_t len, uint64_t grain, const range_func_t &func) {
+    if (len == 0) return;
+    grain = std::max(grain, (len >> 31) + 1);   /*chunk indexes fit in 32 bits*/
+    if (len < threshold_ || in_pool_job) {
+        func(0, len);
+        return;
+    }
+    dispatch_lock_.lock();      /*concurrent callers take turns with all the workers*/
+    uint64_t chunks = (len + grain - 1) / grain;
+    for(int t = 0; t < nthreads_; t++)
+        slots_[t].range.store(pack_range(chunks * t / nthreads_, chunks * (t+1) / nthreads_), memory_order_relaxed);
+    range_func_ = &func;
+    thread_func_ = nullptr;
+    len_ = len;
+    grain_ = grain;
+    dispatch();
+    dispatch_lock_.unlock();
+}
+
+void ThreadPool::run(int nthreads, const thread_func_t &func) {
+    if (nthreads <= 1 || nthreads_ == 1 || in_pool_job) {
+        /*same partition as a dispatched job, the passes of a multi-job primitive stay consistent*/
+        nthreads = std::max(nthreads, 1);
+        for(int t = 0; t < nthreads; t++) func(t, nthreads);
+        return;
+    }
+    dispatch_lock_.lock();
+    range_func_ = nullptr;
+    thread_func_ = &func;
+    dispatch();
+    dispatch_lock_.unlock();
+}
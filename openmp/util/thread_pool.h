@@ -0,0 +1,96 @@
+//
+// Persistent work-stealing thread pool for the primitives called on small inputs.
+//
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#define POOL_SPIN_ITERS     (1<<12)     /*pauses a worker spins on the job epoch before parking*/
+#define POOL_MIN_THRESHOLD  (1<<12)     /*lower bound of the calibrated serial threshold*/
+
+/*
+ * Opening a "#pragma omp parallel" region and its barriers costs
+ * microseconds, which is as much as scanning tens of thousands of ints. The
+ * pool keeps omp_get_max_threads()-1 workers alive across calls, taking the
+ * value at the start of the process whatever omp_set_num_threads is called
+ * with later. After a job, they spin on the job epoch for POOL_SPIN_ITERS
+ * pauses and then park on a condition variable.
+ *
+ * A range job is split evenly over the threads as ranges of chunks. A thread
+ * that runs out of chunks steals the back half of the range of another thread.
+ *
+ * Jobs of fewer than serial_threshold() elements run on the calling thread
+ * only. The threshold is calibrated when the pool is created: it is the
+ * number of elements of a streaming loop that take as long as a dispatch.
+ * Calls from within a job also run on the calling thread. A run() job that
+ * falls back to the calling thread still calls func for each tid of the
+ * requested nthreads in turn, so that consecutive jobs of a primitive always
+ * see the same partition. Calls made while another thread is dispatching
+ * wait for its job to finish and then use all the workers.
+ *
+ * With USE_PERF, the workers add themselves to the hardware counters
+ * (perf_add_thread).
+ * */
+class ThreadPool {
+public:
+    typedef std::function<void(uint64_t, uint64_t)> range_func_t;  /*(begin, end)*/
+    typedef std::function<void(int, int)> thread_func_t;            /*(tid, nthreads)*/
+
+    /*the process-wide pool, created on the first call*/
+    static ThreadPool &get();
+
+    int num_threads() const             { return nthreads_; }
+    uint64_t serial_threshold() const   { return threshold_; }
+    void set_serial_threshold(uint64_t threshold) { threshold_ = threshold; }
+
+    /*threads that run() uses for a job of len elements: 1 below the serial threshold*/
+    int threads_for(uint64_t len) const { return (len < threshold_) ? 1 : nthreads_; }
+
+    /*func on chunks of grain elements covering [0, len), in any order on any thread*/
+    void parallel_for(uint64_t len, uint64_t grain, const range_func_t &func);
+
+    /*
+     * func(tid, nthreads) once for each tid of nthreads (1 or num_threads()),
+     * tid 0 on the caller, for static partitions such as the passes of the scans
+     * */
+    void run(int nthreads, const thread_func_t &func);
+
+    ~ThreadPool();
+
+private:
+    struct alignas(64) slot_t {
+        std::atomic<uint64_t> range;    /*chunks [range>>32, range&0xffffffff) left to the thread*/
+    };
+
+    ThreadPool();
+    void worker(int tid);
+    void dispatch();                    /*start the current job on the workers, run tid 0, wait*/
+    void execute(int tid);
+    bool pop_chunk(int tid, uint64_t &chunk);
+    bool steal_chunks(int tid);
+    void calibrate();
+
+    int nthreads_;
+    uint64_t threshold_;
+    std::vector<std::thread> threads_;
+    std::vector<slot_t> slots_;
+
+    /*the current job*/
+    const range_func_t *range_func_ = nullptr;
+    const thread_func_t *thread_func_ = nullptr;
+    uint64_t len_ = 0, grain_ = 0;
+
+    std::mutex dispatch_lock_;          /*one job at a time, held from the setup of the job to its end*/
+    alignas(64) std::atomic<uint64_t> epoch_{0};
+    alignas(64) std::atomic<int> pending_{0};   /*workers still in the job*/
+    std::atomic<int> parked_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex park_lock_;
+    std::condition_variable park_cv_;
+};
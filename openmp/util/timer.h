@@ -3,22 +3,52 @@
 
 #include <iostream>
 #include <chrono>
+#include "OMPStat.h"
 
+/*with USE_PERF, each timed region also collects hardware counters, see perf_counter.h*/
+#ifdef USE_PERF
+#include "perf_counter.h"
+#define TIMER_PERF_BEGIN()  perf_begin(perf_mark_)
+#define TIMER_PERF_END()    perf_end(perf_mark_)
+#else
+#define TIMER_PERF_BEGIN()
+#define TIMER_PERF_END()
+#endif
+
+/*
+ * With USE_STAT, the first elapsed() after the construction or a reset() is
+ * also recorded under the file and function that created the Timer (see
+ * OMPStat.h) and ends the counter region of USE_PERF. Later calls only
+ * return the time since the start.
+ * */
 class Timer {
 public:
-    Timer() : beg_(clock_::now()) {}
+    Timer(const char *file=__builtin_FILE(), const char *func=__builtin_FUNCTION())
+            : file_(file), func_(func) { reset(); }
 
-    void reset() { beg_ = clock_::now(); }
+    void reset() { TIMER_PERF_BEGIN(); recorded_ = false; beg_ = clock_::now(); }
 
-    double elapsed() const {
-        return std::chrono::duration_cast<second_>
+    double elapsed() {
+        double res = std::chrono::duration_cast<second_>
                 (clock_::now() - beg_).count();
+        if (!recorded_) {
+            TIMER_PERF_END();
+            STAT_REGION(file_, func_, res*1000);
+            recorded_ = true;
+        }
+        return res;
     }
 
 private:
     typedef std::chrono::high_resolution_clock clock_;
     typedef std::chrono::duration<double, std::ratio<1> > second_;
     std::chrono::time_point<clock_> beg_;
+    const char *file_;
+    const char *func_;
+    bool recorded_;
+#ifdef USE_PERF
+    perf_mark_t perf_mark_;     /*the counters nest, each Timer subtracts its own readings*/
+#endif
 };
 
 #endif
@@ -12,8 +12,12 @@
 #include <algorithm>
 #include <vector>
 #include <cmath>
+#include <cstdlib>
+#include <sys/mman.h>
 #include "log.h"
 #include "utility.h"
+#include "column_file.h"
+#include "OMPStat.h"
 using namespace std;
 
 bool pair_cmp (pair<double, double> i , pair<double, double> j) {
@@ -73,8 +77,12 @@ double average_Hampel(double *input, int num) {
 /*data generators*/
 /*
  * Generate random uniform int value array
+ * The generators are served from the dataset cache (column_file.h) if enabled.
  * */
 void random_generator_int(int *keys, uint64_t length, int max, unsigned long long seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "uniform_%llu_%d_%llu", (unsigned long long)length, max, seed);
+    if (dataset_cache_load(name, keys, length)) return;
 #pragma omp parallel
     {
         unsigned int tid = omp_get_thread_num();
@@ -82,13 +90,47 @@ void random_generator_int(int *keys, uint64_t length, int max, unsigned long lon
 #pragma omp for schedule(dynamic)
         for(int i = 0; i < length ; i++)    keys[i] = rand_r(&my_seed) % max;
     }
+    dataset_cache_store(name, keys, length);
 }
 
 /*
- * Generate random uniform unique int value array
+ * Generate Zipf-distributed int value array in [0, max), key k has the
+ * probability proportional to 1/(k+1)^alpha, so key 0 is the most frequent.
+ * The CDF of the max keys is kept in memory.
  * */
-void random_generator_int_unique(int *keys, uint64_t length) {
-    srand((unsigned)time(nullptr));
+void random_generator_zipf(int *keys, uint64_t length, int max, double alpha, unsigned long long seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "zipf_%llu_%d_%.17g_%llu", (unsigned long long)length, max, alpha, seed);
+    if (dataset_cache_load(name, keys, length)) return;
+    std::vector<double> cdf(max);
+    double acc = 0;
+    for(int k = 0; k < max; k++) {
+        acc += 1.0 / pow(k + 1.0, alpha);
+        cdf[k] = acc;
+    }
+    for(int k = 0; k < max; k++) cdf[k] /= acc;
+#pragma omp parallel
+    {
+        unsigned int tid = omp_get_thread_num();
+        unsigned int my_seed = seed + tid;
+#pragma omp for schedule(dynamic)
+        for(uint64_t i = 0; i < length; i++) {
+            double u = (double)rand_r(&my_seed) / RAND_MAX;
+            int k = (int)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+            keys[i] = std::min(k, max - 1);
+        }
+    }
+    dataset_cache_store(name, keys, length);
+}
+
+/*
+ * Generate random uniform unique int value array, a permutation of [0, length) shuffled from seed
+ * */
+void random_generator_int_unique(int *keys, uint64_t length, unsigned long long seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "unique_%llu_%llu", (unsigned long long)length, seed);
+    if (dataset_cache_load(name, keys, length)) return;
+    srand((unsigned)seed);
 #pragma omp parallel for
     for(int i = 0; i < length ; i++) {
         keys[i] = i;
@@ -101,4 +143,27 @@ void random_generator_int_unique(int *keys, uint64_t length) {
         std::swap(keys[from], keys[to]);
     }
     log_trace("Key shuffling finished");
+    dataset_cache_store(name, keys, length);
+}
+
+#define HUGE_PAGE_SIZE      (2*1024*1024)
+
+void *alloc_huge_pages(uint64_t bytes) {
+    void *buf = nullptr;
+    uint64_t padded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (posix_memalign(&buf, HUGE_PAGE_SIZE, padded) != 0) {
+        log_error("Failed to allocate %llu bytes", (unsigned long long)bytes);
+        return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(buf, padded, MADV_HUGEPAGE);
+#endif
+    STAT_MALLOC(buf, padded);
+    return buf;
+}
+
+void free_huge_pages(void *addr) {
+    if (addr == nullptr) return;
+    STAT_FREE(addr);
+    free(addr);
 }
\ No newline at end of file
@@ -14,4 +14,9 @@ double compute_bandwidth(uint64_t num, int wordSize, double kernel_time);
 double average_Hampel(double *input, int num);
 
 void random_generator_int(int *keys, uint64_t length, int max, unsigned long long seed);
-void random_generator_int_unique(int *keys, uint64_t length);
\ No newline at end of file
+void random_generator_int_unique(int *keys, uint64_t length, unsigned long long seed);
+void random_generator_zipf(int *keys, uint64_t length, int max, double alpha, unsigned long long seed);
+
+/*2MB-aligned allocation advised to be backed by huge pages (falls back to normal pages), freed with free_huge_pages()*/
+void *alloc_huge_pages(uint64_t bytes);
+void free_huge_pages(void *addr);
\ No newline at end of file